@@ -1333,6 +1333,65 @@ ApiMac_status_t ApiMac_secAddDevice(ApiMac_secAddDevice_t *pAddDevice)
     return ((ApiMac_status_t)MtMac_addDeviceReq(&addDeviceReq));
 }
 
+/*!
+ Adds a list of MAC device table entries.
+
+ Public function defined in api_mac.h
+ */
+ApiMac_status_t ApiMac_secAddDeviceList(ApiMac_secAddDevice_t *pAddDevices,
+                                        uint16_t numDevices)
+{
+    MtMac_addDeviceReq_t *pAddDeviceReqs;
+    ApiMac_status_t status;
+    uint16_t i;
+
+    if(numDevices == 0)
+    {
+        return (ApiMac_status_success);
+    }
+
+    pAddDeviceReqs = (MtMac_addDeviceReq_t *)malloc(
+                    sizeof(MtMac_addDeviceReq_t) * numDevices);
+    if(pAddDeviceReqs == NULL)
+    {
+        /* Not enough memory to pipeline, add them one by one */
+        status = ApiMac_status_success;
+        for(i = 0; i < numDevices; i++)
+        {
+            ApiMac_status_t addStatus = ApiMac_secAddDevice(&pAddDevices[i]);
+            if((addStatus != ApiMac_status_success)
+               && (status == ApiMac_status_success))
+            {
+                status = addStatus;
+            }
+        }
+        return (status);
+    }
+
+    for(i = 0; i < numDevices; i++)
+    {
+        ApiMac_secAddDevice_t *pAddDevice = &pAddDevices[i];
+        MtMac_addDeviceReq_t *pReq = &pAddDeviceReqs[i];
+
+        pReq->PanID = pAddDevice->panID;
+        pReq->ShortAddr = pAddDevice->shortAddr;
+        memcpy(pReq->ExtAddr, pAddDevice->extAddr, APIMAC_SADDR_EXT_LEN);
+        pReq->FrameCounter = pAddDevice->frameCounter;
+        pReq->Exempt = pAddDevice->exempt;
+        pReq->Unique = pAddDevice->uniqueDevice;
+        pReq->Duplicate = pAddDevice->duplicateDevFlag;
+        pReq->DataSize = pAddDevice->keyIdLookupDataSize;
+        memcpy(pReq->LookupData, pAddDevice->keyIdLookupData,
+               sizeof(pAddDevice->keyIdLookupData));
+    }
+
+    status = (ApiMac_status_t)MtMac_addDeviceListReq(pAddDeviceReqs,
+                                                      numDevices);
+    free(pAddDeviceReqs);
+
+    return (status);
+}
+
 /*!
  Removes MAC device table entries.
 
@@ -1556,6 +1615,7 @@ static void ApiMac_processMtMacDataIndCB(MtMac_dataInd_t *pDataInd)
         ApiMac_mtAddrToApiMacsAddr(&apimacDataInd.dstAddr, pDataInd->DstAddr, pDataInd->DstAddrMode);
         apimacDataInd.timestamp = pDataInd->Timestamp;
         apimacDataInd.timestamp2 = pDataInd->Timestamp2;
+        apimacDataInd.rxTime = pDataInd->RxTime;
         apimacDataInd.srcPanId = pDataInd->SrcPanId;
         apimacDataInd.dstPanId = pDataInd->DstPanId;
         apimacDataInd.mpduLinkQuality = pDataInd->LinkQuality;
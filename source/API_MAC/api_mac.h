@@ -145,6 +145,7 @@
  Simplified Security Interfaces
  ===============================
  - ApiMac_secAddDevice()
+ - ApiMac_secAddDeviceList()
  - ApiMac_secDeleteDevice()
  - ApiMac_secDeleteKeyAndAssocDevices()
  - ApiMac_secDeleteAllDevices()
@@ -1597,6 +1598,11 @@ typedef struct _apimac_mcpsdataind
      The time, in internal MAC timer units, at which the data were received
      */
     uint16_t timestamp2;
+    /*!
+     The host time in milliseconds (Util_getTimeMs) at which the indication
+     started to arrive from the coprocessor
+     */
+    uint32_t rxTime;
     /*! The PAN ID of the sending device */
     uint16_t srcPanId;
     /*! The PAN ID of the destination device */
@@ -3304,6 +3310,21 @@ extern void ApiMac_buildMsgCapInfo(uint8_t cInfo,
  */
 extern ApiMac_status_t ApiMac_secAddDevice(ApiMac_secAddDevice_t *pAddDevice);
 
+/*!
+ * @brief      Adds a list of MAC device table entries. The requests are
+ *             pipelined to the coprocessor, which makes restoring a large
+ *             device table much faster than calling ApiMac_secAddDevice()
+ *             for every entry.
+ *
+ * @param      pAddDevices - array of add device information
+ * @param      numDevices - number of entries in pAddDevices
+ *
+ * @return     [ApiMac_status_success](@ref ApiMac_status_success) if
+ *             all entries were added, the first failure status if not.
+ */
+extern ApiMac_status_t ApiMac_secAddDeviceList(
+                ApiMac_secAddDevice_t *pAddDevices, uint16_t numDevices);
+
 /*!
  * @brief      Removes MAC device table entries.
  *
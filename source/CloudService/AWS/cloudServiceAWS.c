@@ -57,12 +57,17 @@
 
 
 /* Common interface includes                                                  */
+#define LOG_MODULE LogModule_CLOUD
 #include <Utils/uart_term.h>
+#include <Utils/msgLane.h>
+#include <Utils/mqStats.h>
 #include <Common/commonDefs.h>
 
 /* Application includes                                                       */
 #include <Board.h>
 #include <CloudService/cloudJson.h>
+#include <CloudService/cloud_service.h>
+#include <Utils/jsonWriter.h>
 #include "cloudServiceAWS.h"
 #include "certs.h"
 
@@ -110,13 +115,19 @@ const char *incomingDevCmds[] =
 {
  "updateFanSpeed",
  "sendToggle",
- "updateDoorLock"
+ "updateDoorLock",
+ "setGroup",
+ "startOad",
+ "setFilter"
 };
 const CmdTypes incomingDevCmdTypes[] =
 {
  CmdType_FAN_DATA,
  CmdType_LED_DATA,
- CmdType_DOORLOCK_DATA
+ CmdType_DOORLOCK_DATA,
+ CmdType_GROUP_CFG,
+ CmdType_OAD_START,
+ CmdType_FILTER_CFG
 };
 
 //*****************************************************************************
@@ -148,9 +159,9 @@ pthread_t g_rx_task_hndl = (pthread_t) NULL;
 
 
 /* Message Queue                                                              */
-mqd_t cloudSrvrMq;
+MsgLane_t *cloudSrvrMq;
 mqd_t disconnectedMq;
-mqd_t *gatewayMq;
+MsgLane_t **gatewayMq;
 AWS_IoT_Client mqttClient;
 bool wlanConnected = false;
 bool awsCloudConnected = false;
@@ -291,7 +302,7 @@ void *cloudAWS_MqttClientThread(void * pvParameters)
     queueElement.msgPtr = NULL;
     UART_PRINT("[Cloud Service] MQTT CLIENT disconnected, exit pthread\n\r");
     /* write message indicating disconnect Broker message.                    */
-    mq_send(cloudSrvrMq, (char*) &queueElement, sizeof(msgQueue_t), 0);
+    MsgLane_send(cloudSrvrMq, &queueElement);
 
     pthread_exit(0);
 
@@ -303,7 +314,7 @@ void *cloudAWS_MqttClientThread(void * pvParameters)
 
  Public function defined in cloudService.h
  */
-void cloudAWS_registerCliMq(mqd_t *pGatewayMq)
+void cloudAWS_registerCliMq(MsgLane_t **pGatewayMq)
 {
     gatewayMq = pGatewayMq;
 }
@@ -316,12 +327,11 @@ void cloudAWS_registerCliMq(mqd_t *pGatewayMq)
 void cloudAWS_init(const char *cloudSrvrMqName)
 {
     mq_attr attr;
-    unsigned mode = 0;
 
     attr.mq_maxmsg = MAX_DESCONNECTED_MSGS;
     attr.mq_msgsize = sizeof(msgQueue_t);
-    disconnectedMq = mq_open("disconnectedMQ", O_CREAT | O_NONBLOCK, mode, &attr);
-    cloudSrvrMq = mq_open(cloudSrvrMqName, O_WRONLY );//| O_NONBLOCK);
+    disconnectedMq = MqStats_open("disconnectedMQ", O_CREAT | O_NONBLOCK, &attr);
+    cloudSrvrMq = MsgLane_open(cloudSrvrMqName);
 
     if (cloudSrvrMq == NULL)
     {
@@ -354,7 +364,7 @@ void cloudAWS_start()
         if(awsCloudConnected)
         {
             msgQueue_t mqEvt = {CommonEvent_CLOUD_SERV_CONNECTED, NULL, 0};
-            mq_send(cloudSrvrMq, (char*)&mqEvt, sizeof(msgQueue_t), MQ_LOW_PRIOR);
+            MsgLane_send(cloudSrvrMq, &mqEvt);
         }
     }
 }
@@ -431,10 +441,12 @@ void CloudAWS_handleCloudConnect(void)
     uint8_t timeout = MAX_DESCONNECTED_MSGS;
     msgQueue_t queueElemRecv;
     // flush all queued msgs accumulated while cloud was disconnected
-    while(mq_receive(disconnectedMq, (char*) &queueElemRecv, sizeof(msgQueue_t), NULL) > 0 && timeout--)
+    while(MqStats_receive(disconnectedMq, &queueElemRecv) > 0 && timeout--)
     {
         char *tmpBuff;
         char *extractedJson;
+        char *nwkJson;
+        JsonWriter_t writer;
         char thingname[MAX_DEV_NAME];
         int32_t rc = 0;
         char stringToEchoDelta[SHADOW_MAX_SIZE_OF_RX_BUFFER];
@@ -450,7 +462,26 @@ void CloudAWS_handleCloudConnect(void)
                                         stringToEchoDelta, UpdateStatusCallback, NULL, 2, false);
             break;
 
+        case CloudServiceEvt_NWK_DELTA:
+            /* Only the network members are reported, the device list in the
+             * shadow is left as it is                                       */
+            nwkJson = strstr(tmpBuff, "\"nwk\":{");
+            if(nwkJson)
+            {
+                nwkJson += strlen("\"nwk\":");
+                buildJSONForReported(stringToEchoDelta, SHADOW_MAX_SIZE_OF_RX_BUFFER,
+                                     nwkJson, strlen(nwkJson) - 1);
+                rc = aws_iot_shadow_update(&mqttClient, nwkThingName,
+                                            stringToEchoDelta, UpdateStatusCallback, NULL, 2, false);
+            }
+            else
+            {
+                stringToEchoDelta[0] = '\0';
+            }
+            break;
+
         case CloudServiceEvt_DEV_UPDATE:
+        case CloudServiceEvt_CMD_DELIVERY:
             extractedJson = jsonParseIn(tmpBuff, "ext_addr");
             if(extractedJson)
             {
@@ -459,12 +490,25 @@ void CloudAWS_handleCloudConnect(void)
                 thingname[MAX_DEV_NAME - 1] = '\0';
                 free(extractedJson);
 
-                snprintf(stringToEchoDelta, SHADOW_MAX_SIZE_OF_RX_BUFFER,
-                        "{\"state\":{\"desired\": null, \"reported\":%.*s}}",
-                        queueElemRecv.msgPtrLen, tmpBuff);
-                rc = aws_iot_shadow_update(&mqttClient, thingname,
-                                           stringToEchoDelta, UpdateStatusCallback, NULL, 2, false);
-                cloudAWS_registerDevShadowDelta(thingname);
+                /* Written straight into the shadow buffer, an update that
+                 * does not fit is not sent cut                              */
+                JsonWriter_init(&writer, stringToEchoDelta, SHADOW_MAX_SIZE_OF_RX_BUFFER);
+                JsonWriter_beginObject(&writer, NULL);
+                JsonWriter_beginObject(&writer, "state");
+                JsonWriter_raw(&writer, "desired", "null", 4);
+                JsonWriter_raw(&writer, "reported", tmpBuff, strlen(tmpBuff));
+                JsonWriter_endObject(&writer);
+                JsonWriter_endObject(&writer);
+                if(JsonWriter_finish(&writer) < 0)
+                {
+                    IOT_WARN("Update of %s too large for its shadow", thingname);
+                }
+                else
+                {
+                    rc = aws_iot_shadow_update(&mqttClient, thingname,
+                                               stringToEchoDelta, UpdateStatusCallback, NULL, 2, false);
+                    cloudAWS_registerDevShadowDelta(thingname);
+                }
 
 
                 IOT_DEBUG("\n\rTHING NAME: %s", thingname);
@@ -515,10 +559,19 @@ void CloudAWS_handleGatewayEvt(msgQueue_t *inEvtMsg)
         cloudAWS_start();
     }
 
+    if((inEvtMsg->event == CloudServiceEvt_NWK_DELTA) &&
+       (strstr((char*)inEvtMsg->msgPtr, "\"op\":\"nwk\"") == NULL))
+    {
+        /* The shadow holds the devices as one array that cannot be patched
+         * in place, it is replaced with a snapshot instead                  */
+        cloudServiceRequestNwkSnapshot();
+        return;
+    }
+
     char *buf = (char*)malloc(inEvtMsg->msgPtrLen);
     memcpy(buf, inEvtMsg->msgPtr, inEvtMsg->msgPtrLen);
     msgQueue_t mqEvt = {inEvtMsg->event, buf, inEvtMsg->msgPtrLen};
-    if(mq_send(disconnectedMq, (char*) &mqEvt, sizeof(msgQueue_t), 0) != 0)
+    if(MqStats_send(disconnectedMq, &mqEvt, 0) != 0)
     {
         free(buf);
     }
@@ -567,18 +620,18 @@ void CloudAWS_handleCloudEvt(msgQueue_t *inEvtMsg)
     }
 
 
-    if(extractedJson)
+    if(jsonParseGroup(tmpBuff, inCommand->groupName) || extractedJson)
     {
-        UART_PRINT(" [CS_AWS] ExtractedJson: %s\n\r", extractedJson);
+        UART_PRINT(" [CS_AWS] ExtractedJson: %s\n\r", extractedJson ? extractedJson : inCommand->groupName);
         int shortAddr;
         inCommand->cmdType = CmdType_DEVICE_DATA;
         queueElementSend.event = GatewayEvent_DEVICE_CMD;
-        if(inCommand->shortAddr == 0x0000)
+        if((extractedJson != NULL) && (inCommand->shortAddr == 0x0000))
         {
             sscanf(extractedJson, "%x", &shortAddr);
             inCommand->shortAddr = shortAddr;
         }
-        else if(inCommand->shortAddr == 0xFFFF)
+        else if((extractedJson != NULL) && (inCommand->shortAddr == 0xFFFF))
         {
             *(uint64_t*)inCommand->extAddr = strtoull (extractedJson, NULL, 16);
         }
@@ -621,11 +674,9 @@ void CloudAWS_handleCloudEvt(msgQueue_t *inEvtMsg)
 
     queueElementSend.msgPtr = inCommand;
 
-    /* send message to gateway task for processing */
-    if(mq_send(*gatewayMq, (char*) &queueElementSend, sizeof(msgQueue_t), 0) != 0)
-    {
-        free(inCommand);
-    }
+    /* send message to gateway task for processing, the lane frees the
+     * command if it cannot be queued */
+    MsgLane_send(*gatewayMq, &queueElementSend);
 }
 
 
@@ -657,7 +708,7 @@ void cloudAWS_deltaCb(const char *pJsonValueBuffer, uint32_t valueLength,
         msgQueue_t mqEvt = {CloudServiceEvt_CLOUD_IN_MQTT, 
                             deltaBuf, 
                             valueLength};
-        mq_send(cloudSrvrMq, (char*)&mqEvt, sizeof(msgQueue_t), MQ_LOW_PRIOR);
+        MsgLane_send(cloudSrvrMq, &mqEvt);
 
     }
 }
@@ -734,7 +785,7 @@ static void cloudAWS_devShadowDeltaCb(AWS_IoT_Client *pClient, char *topicName,
         msgQueue_t mqEvt = {CloudServiceEvt_CLOUD_IN_MQTT,
                             deltaBuf,
                             deltaBufLen};
-        mq_send(cloudSrvrMq, (char*)&mqEvt, sizeof(msgQueue_t), MQ_LOW_PRIOR);
+        MsgLane_send(cloudSrvrMq, &mqEvt);
 
     }
 }
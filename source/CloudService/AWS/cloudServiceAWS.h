@@ -94,7 +94,7 @@ extern void cloudAWS_init(const char *cloudSrvrMqName);
  *
  * @return
  */
-extern void cloudAWS_registerCliMq(mqd_t *pGatewayMq);
+extern void cloudAWS_registerCliMq(MsgLane_t **pGatewayMq);
 
 
 
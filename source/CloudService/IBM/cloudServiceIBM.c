@@ -81,12 +81,20 @@
 #include <ti/net/mqtt/mqtt_server.h>
 
 /* Common interface includes                                                  */
+#define LOG_MODULE LogModule_CLOUD
 #include <Utils/uart_term.h>
+#include <Utils/msgLane.h>
+#include <Utils/mqStats.h>
 #include <Common/commonDefs.h>
 
 /* Application includes                                                       */
 #include <Board.h>
 #include <CloudService/cloudJson.h>
+#include <CloudService/cloud_service.h>
+#include <Collector/delivery.h>
+#include <Collector/rampBench.h>
+#include <Gateway/gtwayJson.h>
+#include <Gateway/gtwayCbor.h>
 #include "cloudServiceIBM.h"
 
 //*****************************************************************************
@@ -119,10 +127,12 @@
 #define RETAIN                  1
 
 /* Defining Number of topics                                                  */
-#define SUB_TOPIC_COUNT         1
+#define SUB_TOPIC_COUNT         2
 
 /* Defining Subscription Topic Values                                         */
 #define TOPIC0                  "iot-2/type/+/id/+/cmd/+/fmt/json"
+#define TOPIC1                  "iot-2/type/+/id/+/cmd/+/fmt/cbor"
+#define CBOR_TOPIC_SUFFIX       "/fmt/cbor"
 
 /* Spawn task priority and Task and Thread Stack Size                         */
 
@@ -144,21 +154,26 @@
 /* Seconds in the range of 0-59                                               */
 #define SEC                     00
 
-#define TOPICS_NUM 3
+#define TOPICS_NUM 4
 #define MAX_TOPIC_LEN 100
 char topicList[TOPICS_NUM][MAX_TOPIC_LEN];
-char *topicStrings[TOPICS_NUM] = {"nwkUpdate", "permitJoinCnf", "deviceUpdate"};
+char *topicStrings[TOPICS_NUM] = {"nwkUpdate", "permitJoinCnf", "deviceUpdate", "nwkDelta"};
 typedef enum
 {
     MqttTopicIBM_NWK_UPDT,
     MqttTopicIBM_STATE_UPDT,
     MqttTopicIBM_DEV_UPDT,
+    MqttTopicIBM_NWK_DELTA,
 }MqttTopic;
 
-const char topicBaseStr[] = "iot-2/type/%s/id/%s/evt/%s/fmt/json";
+const char topicBaseStr[] = "iot-2/type/%s/id/%s/evt/%s/fmt/%s";
 const char clienIdBaseStr[] = "g:%s:%s:%s";
 const char srvrBaseStr[] = "%s.messaging.internetofthings.ibmcloud.com";
 char topicList[TOPICS_NUM][MAX_TOPIC_LEN];
+#if CBOR_UPDATES
+/* Same events in CBOR, command outcomes and ramp frames stay in JSON         */
+char cborTopicList[TOPICS_NUM][MAX_TOPIC_LEN];
+#endif
 #define CLIENTID_MAX_LEN 32
 #define IBM_SRVR_ADDR_MAC_LEN 70
 char ClientId[CLIENTID_MAX_LEN];
@@ -170,14 +185,20 @@ const char *incomingDevCmds[] =
  "updateFanSpeed",
  "sendToggle",
  "updateDoorLock",
- "leakBuzzOff"
+ "leakBuzzOff",
+ "setGroup",
+ "startOad",
+ "setFilter"
 };
 const CmdTypes incomingDevCmdTypes[] =
 {
  CmdType_FAN_DATA,
  CmdType_LED_DATA,
  CmdType_DOORLOCK_DATA,
- CmdType_LEAK_DATA
+ CmdType_LEAK_DATA,
+ CmdType_GROUP_CFG,
+ CmdType_OAD_START,
+ CmdType_FILTER_CFG
 };
 
 //*****************************************************************************
@@ -187,6 +208,8 @@ const CmdTypes incomingDevCmdTypes[] =
 static void cloudIBM_stop();
 int32_t cloudIBM_startMqttCli();
 static void cloudIBM_mqttClientCb(int32_t event , void * metaData , uint32_t metaDateLen , void *data , uint32_t dataLen);
+static char *cloudIBM_parseIn(msgQueue_t *inEvtMsg, char *findToken);
+static bool cloudIBM_parseGroup(msgQueue_t *inEvtMsg, char *groupName);
 
 
 //*****************************************************************************
@@ -211,14 +234,19 @@ MQTTClient_SubscribeParams_t subInfo[SUB_TOPIC_COUNT] = {{
     TOPIC0,
     NULL,
     MQTT_QOS_0,
+    NULL},
+    {
+    TOPIC1,
+    NULL,
+    MQTT_QOS_0,
     NULL}
 };
 
 
 /* Message Queue                                                              */
-mqd_t cloudSrvrMq;
+MsgLane_t *cloudSrvrMq;
 mqd_t disconnectedMq;
-mqd_t *gatewayMq;
+MsgLane_t **gatewayMq;
 CloudIBM_Info_t *cloudConnectionInfo;
 bool wlanConnected = false;
 bool ibmCloudConnected = false;
@@ -297,7 +325,7 @@ void *cloudIBM_MqttClientThread(void * pvParameters)
 
  Public function defined in cloudService.h
  */
-void cloudIBM_registerCliMq(mqd_t *pGatewayMq)
+void cloudIBM_registerCliMq(MsgLane_t **pGatewayMq)
 {
     gatewayMq = pGatewayMq;
 }
@@ -310,12 +338,11 @@ void cloudIBM_registerCliMq(mqd_t *pGatewayMq)
 void cloudIBM_init(const char *cloudSrvrMqName)
 {
     mq_attr attr;
-    unsigned mode = 0;
 
     attr.mq_maxmsg = 20;
     attr.mq_msgsize = sizeof(msgQueue_t);
-    disconnectedMq = mq_open("disconnectedMQ", O_CREAT | O_NONBLOCK, mode, &attr);
-    cloudSrvrMq = mq_open(cloudSrvrMqName, O_WRONLY );//| O_NONBLOCK);
+    disconnectedMq = MqStats_open("disconnectedMQ", O_CREAT | O_NONBLOCK, &attr);
+    cloudSrvrMq = MsgLane_open(cloudSrvrMqName);
 
     if (cloudSrvrMq == NULL)
     {
@@ -354,7 +381,7 @@ void cloudIBM_start()
         if(ibmCloudConnected)
         {
             msgQueue_t mqEvt = {CommonEvent_CLOUD_SERV_CONNECTED, NULL, 0};
-            mq_send(cloudSrvrMq, (char*)&mqEvt, sizeof(msgQueue_t), MQ_LOW_PRIOR);
+            MsgLane_send(cloudSrvrMq, &mqEvt);
         }
     }
 }
@@ -378,8 +405,15 @@ int32_t cloudIBM_startMqttCli()
         snprintf(topicList[topicIdx], MAX_TOPIC_LEN - 1, topicBaseStr,
                  cloudConnectionInfo->devType,
                  cloudConnectionInfo->devId,
-                 topicStrings[topicIdx]);
+                 topicStrings[topicIdx], "json");
         UART_PRINT("\n\r[Cloud Service] TOPIC# %d: %s\n\r", topicIdx, topicList[topicIdx]);
+#if CBOR_UPDATES
+        snprintf(cborTopicList[topicIdx], MAX_TOPIC_LEN - 1, topicBaseStr,
+                 cloudConnectionInfo->devType,
+                 cloudConnectionInfo->devId,
+                 topicStrings[topicIdx], "cbor");
+        UART_PRINT("[Cloud Service] TOPIC# %d: %s\n\r", topicIdx, cborTopicList[topicIdx]);
+#endif
     }
 
     snprintf(ClientId, CLIENTID_MAX_LEN,clienIdBaseStr,
@@ -527,7 +561,7 @@ void CloudIBM_handleCloudConnect(void)
     uint8_t timeout = 20;
     msgQueue_t queueElemRecv;
     // flush all queued msgs accumulated while cloud was disconnected
-    while(mq_receive(disconnectedMq, (char*) &queueElemRecv, sizeof(msgQueue_t), NULL) > 0 && timeout--)
+    while(MqStats_receive(disconnectedMq, &queueElemRecv) > 0 && timeout--)
     {
         CloudIBM_handleGatewayEvt(&queueElemRecv);
         if(queueElemRecv.msgPtr)
@@ -539,6 +573,106 @@ void CloudIBM_handleCloudConnect(void)
 }
 void CloudIBM_handleGatewayEvt(msgQueue_t *inEvtMsg)
 {
+#if CBOR_UPDATES
+    /* Device and network updates are published from their CBOR twins, the
+     * JSON ones are for the other sinks                                     */
+    if((inEvtMsg->event == CloudServiceEvt_NWK_UPDATE) ||
+       (inEvtMsg->event == CloudServiceEvt_DEV_UPDATE) ||
+       (inEvtMsg->event == CloudServiceEvt_NWK_DELTA))
+    {
+        return;
+    }
+    if(inEvtMsg->event == CloudServiceEvt_NWK_DELTA_CBOR)
+    {
+        uint32_t op;
+
+        /* Not kept while disconnected, as the JSON deltas */
+        if(ibmCloudConnected)
+        {
+            char *tmpTopic = cborTopicList[MqttTopicIBM_NWK_DELTA];
+            MQTTClient_publish(gMqttClient, tmpTopic,
+                                     strlen(tmpTopic),
+                                     (char*) inEvtMsg->msgPtr,
+                                     inEvtMsg->msgPtrLen,
+                                     MQTT_QOS_0);
+            if(cborParseUint((uint8_t*) inEvtMsg->msgPtr, inEvtMsg->msgPtrLen,
+                             CborKey_op, &op) && (op == NwkDelta_nwk))
+            {
+                tmpTopic = cborTopicList[MqttTopicIBM_STATE_UPDT];
+                MQTTClient_publish(gMqttClient, tmpTopic,
+                                         strlen(tmpTopic),
+                                         (char*) inEvtMsg->msgPtr,
+                                         inEvtMsg->msgPtrLen,
+                                         MQTT_QOS_0 | MQTT_PUBLISH_RETAIN);
+            }
+            UART_PRINT("\n\r [Cloud Service] CC3200 Publishes %d bytes of CBOR\n\r",
+                       inEvtMsg->msgPtrLen);
+            UART_PRINT("\tTopic: %s\n\r", cborTopicList[MqttTopicIBM_NWK_DELTA]);
+        }
+        return;
+    }
+    if(ibmCloudConnected && ((inEvtMsg->event == CloudServiceEvt_NWK_UPDATE_CBOR) ||
+                             (inEvtMsg->event == CloudServiceEvt_DEV_UPDATE_CBOR)))
+    {
+        char *tmpTopic = cborTopicList[(inEvtMsg->event == CloudServiceEvt_NWK_UPDATE_CBOR) ?
+                                   MqttTopicIBM_NWK_UPDT : MqttTopicIBM_DEV_UPDT];
+        MQTTClient_publish(gMqttClient, tmpTopic,
+                                 strlen(tmpTopic),
+                                 (char*) inEvtMsg->msgPtr,
+                                 inEvtMsg->msgPtrLen,
+                                 MQTT_QOS_0 | MQTT_PUBLISH_RETAIN );
+
+        UART_PRINT("\n\r [Cloud Service] CC3200 Publishes %d bytes of CBOR\n\r",
+                   inEvtMsg->msgPtrLen);
+        UART_PRINT("\tTopic: %s\n\r", tmpTopic);
+        return;
+    }
+#endif
+
+    if(inEvtMsg->event == CloudServiceEvt_RAMP_DATA)
+    {
+        /* Benchmark frames are not retained, printed or kept for later */
+        if(ibmCloudConnected)
+        {
+            char *tmpTopic = topicList[MqttTopicIBM_DEV_UPDT];
+            MQTTClient_publish(gMqttClient, tmpTopic,
+                                     strlen(tmpTopic),
+                                     (char*) inEvtMsg->msgPtr,
+                                     strlen((char*) inEvtMsg->msgPtr),
+                                     MQTT_QOS_0);
+        }
+        return;
+    }
+
+    if(inEvtMsg->event == CloudServiceEvt_NWK_DELTA)
+    {
+        /* Only the retained snapshot is kept for a subscriber, deltas missed
+         * while disconnected are covered by the snapshot asked for on
+         * reconnect                                                         */
+        if(ibmCloudConnected)
+        {
+            char *tmpTopic = topicList[MqttTopicIBM_NWK_DELTA];
+            MQTTClient_publish(gMqttClient, tmpTopic,
+                                     strlen(tmpTopic),
+                                     (char*) inEvtMsg->msgPtr,
+                                     strlen((char*) inEvtMsg->msgPtr),
+                                     MQTT_QOS_0);
+            if(strstr((char*) inEvtMsg->msgPtr, "\"op\":\"nwk\"") != NULL)
+            {
+                tmpTopic = topicList[MqttTopicIBM_STATE_UPDT];
+                MQTTClient_publish(gMqttClient, tmpTopic,
+                                         strlen(tmpTopic),
+                                         (char*) inEvtMsg->msgPtr,
+                                         strlen((char*) inEvtMsg->msgPtr),
+                                         MQTT_QOS_0 | MQTT_PUBLISH_RETAIN);
+            }
+            UART_PRINT("\n\r [Cloud Service] CC3200 Publishes the following message \n\r");
+            UART_PRINT("\tTopic: %s\n\r", topicList[MqttTopicIBM_NWK_DELTA]);
+            UART_PRINT("\tData: %s\n\r", (char*) inEvtMsg->msgPtr);
+        }
+        return;
+    }
+
     if(ibmCloudConnected)
     {
         char *tmpBuff;
@@ -551,6 +685,7 @@ void CloudIBM_handleGatewayEvt(msgQueue_t *inEvtMsg)
             break;
 
         case CloudServiceEvt_DEV_UPDATE:
+        case CloudServiceEvt_CMD_DELIVERY:
             tmpTopic = topicList[MqttTopicIBM_DEV_UPDT];
             break;
 
@@ -586,7 +721,7 @@ void CloudIBM_handleGatewayEvt(msgQueue_t *inEvtMsg)
         char *buf = (char*)malloc(inEvtMsg->msgPtrLen);
         memcpy(buf, inEvtMsg->msgPtr, inEvtMsg->msgPtrLen);
         msgQueue_t mqEvt = {inEvtMsg->event, buf, inEvtMsg->msgPtrLen};
-        if(mq_send(disconnectedMq, (char*) &mqEvt, sizeof(msgQueue_t), 0) != 0)
+        if(MqStats_send(disconnectedMq, &mqEvt, 0) != 0)
         {
             free(buf);
         }
@@ -602,16 +737,21 @@ void CloudIBM_handleGatewayEvt(msgQueue_t *inEvtMsg)
 void CloudIBM_handleCloudEvt(msgQueue_t *inEvtMsg)
 {
     char *extractedJson;
-    char *tmpBuff;
     deviceCmd_t *inCommand;
     msgQueue_t queueElementSend;
     inCommand = malloc(sizeof(deviceCmd_t));
     inCommand->cmdType =   0xFFFF;
     inCommand->shortAddr = 0x0000;
-    tmpBuff = (char *)inEvtMsg->msgPtr;
-    UART_PRINT(" [CS_IBM] InCmd: %s\n\r", tmpBuff);
+    if(inEvtMsg->event == CloudServiceEvt_CLOUD_IN_CBOR)
+    {
+        UART_PRINT(" [CS_IBM] InCmd: %d bytes of CBOR\n\r", inEvtMsg->msgPtrLen);
+    }
+    else
+    {
+        UART_PRINT(" [CS_IBM] InCmd: %s\n\r", (char *)inEvtMsg->msgPtr);
+    }
 
-    extractedJson = jsonParseIn(tmpBuff, "action");
+    extractedJson = cloudIBM_parseIn(inEvtMsg, "action");
     if(extractedJson)
     {
         UART_PRINT(" [CS_IBM] ExtractedJson: %s\n\r", extractedJson);
@@ -625,35 +765,43 @@ void CloudIBM_handleCloudEvt(msgQueue_t *inEvtMsg)
         {
             inCommand->data = 0;
         }
+        else if(strncmp(extractedJson, "snapshot", 8) == 0)
+        {
+            /* A subscriber missed a network delta */
+            free(extractedJson);
+            free(inCommand);
+            cloudServiceRequestNwkSnapshot();
+            return;
+        }
         free(extractedJson);
     }
 
-    extractedJson = jsonParseIn(tmpBuff, "dstAddr");
+    extractedJson = cloudIBM_parseIn(inEvtMsg, "dstAddr");
     if(!extractedJson)
     {
-        extractedJson = jsonParseIn(tmpBuff, "ext_addr");
+        extractedJson = cloudIBM_parseIn(inEvtMsg, "ext_addr");
         inCommand->shortAddr = 0xFFFF;
     }
 
 
-    if(extractedJson)
+    if(cloudIBM_parseGroup(inEvtMsg, inCommand->groupName) || extractedJson)
     {
-        UART_PRINT(" [CS_IBM] ExtractedJson: %s\n\r", extractedJson);
+        UART_PRINT(" [CS_IBM] ExtractedJson: %s\n\r", extractedJson ? extractedJson : inCommand->groupName);
         int shortAddr;
         inCommand->cmdType = CmdType_DEVICE_DATA;
         queueElementSend.event = GatewayEvent_DEVICE_CMD;
-        if(inCommand->shortAddr == 0x0000)
+        if((extractedJson != NULL) && (inCommand->shortAddr == 0x0000))
         {
             sscanf(extractedJson, "%x", &shortAddr);
             inCommand->shortAddr = shortAddr;
         }
-        else if(inCommand->shortAddr == 0xFFFF)
+        else if((extractedJson != NULL) && (inCommand->shortAddr == 0xFFFF))
         {
             *(uint64_t*)inCommand->extAddr = strtoull (extractedJson, NULL, 16);
         }
         free(extractedJson);
 
-        extractedJson = jsonParseIn(tmpBuff, "devActionType");
+        extractedJson = cloudIBM_parseIn(inEvtMsg, "devActionType");
         if(extractedJson)
         {
             for(uint8_t cmds = 0; cmds < sizeof(incomingDevCmds); cmds++)
@@ -669,7 +817,7 @@ void CloudIBM_handleCloudEvt(msgQueue_t *inEvtMsg)
 
 
 
-        extractedJson = jsonParseIn(tmpBuff, "value");
+        extractedJson = cloudIBM_parseIn(inEvtMsg, "value");
         if(extractedJson)
         {
             inCommand->data = atoi(extractedJson);
@@ -684,11 +832,47 @@ void CloudIBM_handleCloudEvt(msgQueue_t *inEvtMsg)
     }
     queueElementSend.msgPtr = inCommand;
 
-    /* send message to gateway task for processing */
-    if(mq_send(*gatewayMq, (char*) &queueElementSend, sizeof(msgQueue_t), 0) != 0)
+    /* send message to gateway task for processing, the lane frees the
+     * command if it cannot be queued */
+    MsgLane_send(*gatewayMq, &queueElementSend);
+}
+
+//****************************************************************************
+//
+//! Find a member of a command, sent in JSON or in CBOR
+//!
+//! \param[in]  inEvtMsg    - received command
+//! \param[in]  findToken   - member to find
+//!
+//! return allocated value, NULL if not found
+//
+//****************************************************************************
+static char *cloudIBM_parseIn(msgQueue_t *inEvtMsg, char *findToken)
+{
+    if(inEvtMsg->event == CloudServiceEvt_CLOUD_IN_CBOR)
+    {
+        return cborParseIn((uint8_t*) inEvtMsg->msgPtr, inEvtMsg->msgPtrLen, findToken);
+    }
+    return jsonParseIn((char*) inEvtMsg->msgPtr, findToken);
+}
+
+//****************************************************************************
+//
+//! Copy the group name of a command, sent in JSON or in CBOR
+//!
+//! \param[in]  inEvtMsg    - received command
+//! \param[out] groupName   - group name, empty if there is none
+//!
+//! return true if the command is sent to a group
+//
+//****************************************************************************
+static bool cloudIBM_parseGroup(msgQueue_t *inEvtMsg, char *groupName)
+{
+    if(inEvtMsg->event == CloudServiceEvt_CLOUD_IN_CBOR)
     {
-        free(inCommand);
+        return cborParseGroup((uint8_t*) inEvtMsg->msgPtr, inEvtMsg->msgPtrLen, groupName);
     }
+    return jsonParseGroup((char*) inEvtMsg->msgPtr, groupName);
 }
 
 
@@ -738,6 +922,7 @@ void cloudIBM_mqttClientCb(int32_t event , void * metaData , uint32_t metaDateLe
         {
             MQTTClient_RecvMetaDataCB_t *recvMetaData =  (MQTTClient_RecvMetaDataCB_t *)metaData;
             uint32_t bufSizeReqd = 0;
+            uint8_t inEvent = CloudServiceEvt_CLOUD_IN_MQTT;
 
             char *pubBuff = NULL;
 
@@ -755,7 +940,18 @@ void cloudIBM_mqttClientCb(int32_t event , void * metaData , uint32_t metaDateLe
 
             UART_PRINT("\n\rMsg Recvd. by client\n\r");
             UART_PRINT("TOPIC: %s\n\r", recvMetaData->topic);
-            UART_PRINT("PAYLOAD: %s\n\r", pubBuff);
+            /* Commands sent with fmt/cbor are binary */
+            if((recvMetaData->topLen >= strlen(CBOR_TOPIC_SUFFIX)) &&
+               (strncmp(recvMetaData->topic + recvMetaData->topLen - strlen(CBOR_TOPIC_SUFFIX),
+                        CBOR_TOPIC_SUFFIX, strlen(CBOR_TOPIC_SUFFIX)) == 0))
+            {
+                inEvent = CloudServiceEvt_CLOUD_IN_CBOR;
+                UART_PRINT("PAYLOAD: %d bytes\n\r", dataLen);
+            }
+            else
+            {
+                UART_PRINT("PAYLOAD: %s\n\r", pubBuff);
+            }
             UART_PRINT("QOS: %d\n\r", recvMetaData->qos);
 
             if (recvMetaData->retain)
@@ -768,14 +964,14 @@ void cloudIBM_mqttClientCb(int32_t event , void * metaData , uint32_t metaDateLe
                 UART_PRINT("Duplicate\n\r");
             }
 
-            msgQueue_t mqEvt = {CloudServiceEvt_CLOUD_IN_MQTT, pubBuff, bufSizeReqd};
-            mq_send(cloudSrvrMq, (char*)&mqEvt, sizeof(msgQueue_t), MQ_LOW_PRIOR);
+            msgQueue_t mqEvt = {inEvent, pubBuff, bufSizeReqd};
+            MsgLane_send(cloudSrvrMq, &mqEvt);
         }
             break;
         case MQTT_CLIENT_DISCONNECT_CB_EVENT:
         {
             msgQueue_t mqEvt = {CommonEvent_CLOUD_SERV_DISCONNECTED, NULL, 0};
-            mq_send(cloudSrvrMq, (char*)&mqEvt, sizeof(msgQueue_t), MQ_LOW_PRIOR);
+            MsgLane_send(cloudSrvrMq, &mqEvt);
             UART_PRINT("BRIDGE DISCONNECTION\n\r");
         }
             break;
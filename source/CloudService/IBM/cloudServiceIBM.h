@@ -93,7 +93,7 @@ extern void cloudIBM_init(const char *cloudSrvrMqName);
  *
  * @return
  */
-extern void cloudIBM_registerCliMq(mqd_t *pGatewayMq);
+extern void cloudIBM_registerCliMq(MsgLane_t **pGatewayMq);
 
 /*!
  * @brief   Register cloud connection info
@@ -60,8 +60,12 @@
 /* TI-DRIVERS Header files */
 #include <ti/drivers/net/wifi/simplelink.h>
 #include <Common/commonDefs.h>
+#define LOG_MODULE LogModule_WEBSRVR
 #include <Utils/uart_term.h>
+#include <Utils/msgLane.h>
+#include <Utils/mqStats.h>
 #include <CloudService/cloudJson.h>
+#include <CloudService/cloud_service.h>
 #include <CloudService/IBM/cloudServiceIBM.h>
 #include "localWebSrvr.h"
 
@@ -81,7 +85,7 @@
 #define NETAPP_MAX_RX_FRAGMENT_LEN      SL_NETAPP_REQUEST_MAX_DATA_LEN
 #define NETAPP_MAX_METADATA_LEN         (100)
 #define NETAPP_MAX_ARGV_TO_CALLBACK SL_FS_MAX_FILE_NAME_LENGTH+50
-#define NUMBER_OF_URI_SERVICES          (6)
+#define NUMBER_OF_URI_SERVICES          (7)
 
 
 const uint8_t pgNotFound[] = "<html>404 - Sorry page not found</html>";
@@ -91,14 +95,20 @@ const char *incomingDevCmdsLocal[] =
  "updateFanSpeed",
  "sendToggle",
  "updateDoorLock",
- "leakBuzzOff"
+ "leakBuzzOff",
+ "setGroup",
+ "startOad",
+ "setFilter"
 };
 const CmdTypes incomingDevCmdTypesLocal[] =
 {
  CmdType_FAN_DATA,
  CmdType_LED_DATA,
  CmdType_DOORLOCK_DATA,
- CmdType_LEAK_DATA
+ CmdType_LEAK_DATA,
+ CmdType_GROUP_CFG,
+ CmdType_OAD_START,
+ CmdType_FILTER_CFG
 };
 
 /******************************************************************************
@@ -109,6 +119,7 @@ int32_t nwkGetCallback(uint8_t requestIdx, uint8_t *argcCallback, uint8_t **argv
 int32_t cmdPostCallback(uint8_t requestIdx, uint8_t *argcCallback, uint8_t **argvCallback, SlNetAppRequest_t *netAppRequest);
 int32_t actionPostCallback(uint8_t requestIdx, uint8_t *argcCallback, uint8_t **argvCallback, SlNetAppRequest_t *netAppRequest);
 int32_t cloudGetCallback(uint8_t requestIdx, uint8_t *argcCallback, uint8_t **argvCallback, SlNetAppRequest_t *netAppRequest);
+int32_t queuesGetCallback(uint8_t requestIdx, uint8_t *argcCallback, uint8_t **argvCallback, SlNetAppRequest_t *netAppRequest);
 int32_t cloudPostCallback(uint8_t requestIdx, uint8_t *argcCallback, uint8_t **argvCallback, SlNetAppRequest_t *netAppRequest);
 void NetAppRequestErrorResponse(SlNetAppResponse_t *pNetAppResponse);
 void httpGetHandler(SlNetAppRequest_t *netAppRequest);
@@ -142,6 +153,7 @@ http_RequestObj_t    httpRequest[NUMBER_OF_URI_SERVICES] =
                                                     {"type"},
                                                     {"id"},
                                                     {"password"}}, cloudPostCallback},
+        {6, SL_NETAPP_REQUEST_HTTP_GET, "/queues", {{"queues"}}, queuesGetCallback},
 };
 http_headerFieldType_t g_HeaderFields [] =
 {
@@ -207,14 +219,14 @@ static CloudIBM_Info_t ibmCloudInfo;
 bool localWlanConnected = false;
 bool cloudConnected = false;
 
-mqd_t cloudMq;
-mqd_t queDevUpdtMsgs;
-mqd_t queNwkUpdtMsgs;
-mqd_t *gatewayCliMq;
+MsgLane_t *cloudMq;
+MsgLane_t **gatewayCliMq;
 
 
 char *lastNwkUpdt;
 char *lastDevUpdt;
+/* The network document changed since the last snapshot */
+static bool nwkStale = false;
 
 uint8_t     gMetadataBuffer[NETAPP_MAX_METADATA_LEN];
 uint8_t     gPayloadBuffer[NETAPP_MAX_RX_FRAGMENT_LEN];
@@ -232,15 +244,9 @@ uint8_t     gHttpGetBuffer[NETAPP_MAX_ARGV_TO_CALLBACK];
  */
 void LocalWebSrvr_init(const char *cloudSrvrMqName)
 {
-    mq_attr attr;
-    attr.mq_curmsgs = 0;
-    attr.mq_flags = 0;
-    attr.mq_maxmsg = 20;
-    attr.mq_msgsize = sizeof(msgQueue_t);
-    cloudMq = mq_open(cloudSrvrMqName, O_WRONLY);// | O_NONBLOCK);
-    queDevUpdtMsgs = mq_open("localWebDevQmsgs", O_CREAT | O_NONBLOCK, 0, &attr);
-    attr.mq_maxmsg = 10;
-    queNwkUpdtMsgs = mq_open("localWebNwkQmsgs", O_CREAT | O_NONBLOCK, 0, &attr);
+    /* The pages poll for the last documents, kept by
+     * LocalWebSrvr_handleGatewayEvt(), no update queue is needed            */
+    cloudMq = MsgLane_open(cloudSrvrMqName);
 }
 
 /*!
@@ -248,7 +254,7 @@ void LocalWebSrvr_init(const char *cloudSrvrMqName)
 
  Public function defined in localWebSrvr.h
  */
-void LocalWebSrvr_registerCliMq(mqd_t *pGatewayMq)
+void LocalWebSrvr_registerCliMq(MsgLane_t **pGatewayMq)
 {
     gatewayCliMq = pGatewayMq;
 }
@@ -301,12 +307,6 @@ void LocalWebSrvr_handleCloudConnect()
  */
 void LocalWebSrvr_handleGatewayEvt(msgQueue_t *inEvtMsg)
 {
-    //queUpdtMsgs
-//    msgQueue_t msgToQue;
-//    msgToQue.event = inEvtMsg->event;
-//    msgToQue.msgPtr = malloc(inEvtMsg->msgPtrLen);
-//    msgToQue.msgPtrLen = inEvtMsg->msgPtrLen;
-//    memcpy(msgToQue.msgPtr, inEvtMsg->msgPtr, msgToQue.msgPtrLen);
     if(inEvtMsg->event == CloudServiceEvt_DEV_UPDATE)
     {
         if(lastDevUpdt)
@@ -315,17 +315,22 @@ void LocalWebSrvr_handleGatewayEvt(msgQueue_t *inEvtMsg)
         }
         lastDevUpdt = malloc(inEvtMsg->msgPtrLen);
         memcpy(lastDevUpdt, inEvtMsg->msgPtr, inEvtMsg->msgPtrLen);
-//        mq_send(queDevUpdtMsgs, (const char*)&msgToQue, sizeof(msgQueue_t), MQ_LOW_PRIOR);
+    }
+    else if(inEvtMsg->event == CloudServiceEvt_NWK_DELTA)
+    {
+        /* The page polls for the whole document, a snapshot is only asked
+         * for when it does                                                  */
+        nwkStale = true;
     }
     else
     {
+        nwkStale = false;
         if(lastNwkUpdt)
         {
             free(lastNwkUpdt);
         }
         lastNwkUpdt = malloc(inEvtMsg->msgPtrLen);
         memcpy(lastNwkUpdt, inEvtMsg->msgPtr, inEvtMsg->msgPtrLen);
-        //mq_send(queNwkUpdtMsgs, (const char*)&msgToQue, sizeof(msgQueue_t), MQ_LOW_PRIOR);
     }
 
 }
@@ -400,7 +405,6 @@ void LocalWebSrvr_handleHttpEvt(msgQueue_t *inEvtMsg)
 void SimpleLinkNetAppRequestEventHandler(SlNetAppRequest_t *pNetAppRequest, SlNetAppResponse_t *pNetAppResponse)
 {
     SlNetAppRequest_t *netAppRequest;
-    int32_t msgqRetVal;
 
 //    UART_PRINT("[Provisioning Task] NetApp Request Received - AppId = %d, Type = %d, Handle = %d\n\r", pNetAppRequest->AppId, pNetAppRequest->Type, pNetAppRequest->Handle);
 
@@ -481,11 +485,10 @@ void SimpleLinkNetAppRequestEventHandler(SlNetAppRequest_t *pNetAppRequest, SlNe
     }
 
     msgQueue_t mqEvt = {CloudServiceEvt_LOCAL_SERVR_HTTP, netAppRequest, sizeof(SlNetAppRequest_t)};
-    msgqRetVal = mq_send(cloudMq, (char*) &mqEvt, sizeof(msgQueue_t), 0);
-
-    if(msgqRetVal < 0)
+    if(MsgLane_send(cloudMq, &mqEvt) != MsgLane_status_sent)
     {
         UART_PRINT("[PROVISIONING task] could not send element to msg queue\n\r");
+        LogRing_flush();
         while (1);
     }
 
@@ -630,6 +633,11 @@ int32_t nwkGetCallback(uint8_t requestIdx, uint8_t *argcCallback, uint8_t **argv
     uint16_t metadataLen;
     uint16_t nwkStatLen = strlen (lastNwkUpdt);
 
+    /* The cached document is served, the next poll gets the fresh one */
+    if(nwkStale)
+    {
+        cloudServiceRequestNwkSnapshot();
+    }
     metadataLen = prepareGetMetadata(0, nwkStatLen, HttpContentTypeList_UrlEncoded);
 
     sl_NetAppSend (netAppRequest->Handle, metadataLen, gMetadataBuffer, (SL_NETAPP_REQUEST_RESPONSE_FLAGS_CONTINUATION | SL_NETAPP_REQUEST_RESPONSE_FLAGS_METADATA));
@@ -707,7 +715,7 @@ int32_t cmdPostCallback(uint8_t requestIdx, uint8_t *argcCallback, uint8_t **arg
     }
 
     queueElementSend.msgPtr = inCommand;
-    mq_send(*gatewayCliMq, (char*) &queueElementSend, sizeof(msgQueue_t), MQ_LOW_PRIOR);
+    MsgLane_send(*gatewayCliMq, &queueElementSend);
 
     metadataLen = preparePostMetadata(0);
 
@@ -764,18 +772,18 @@ int32_t actionPostCallback(uint8_t requestIdx, uint8_t *argcCallback, uint8_t **
                         }
 
 
-                        if(extractedJson)
+                        if(jsonParseGroup((char*) (argvArray + ARGV_VALUE_OFFSET), inCommand->groupName) || extractedJson)
                         {
-                            UART_PRINT(" [CS_AWS] ExtractedJson: %s\n\r", extractedJson);
+                            UART_PRINT(" [CS_AWS] ExtractedJson: %s\n\r", extractedJson ? extractedJson : inCommand->groupName);
                             int shortAddr;
                             inCommand->cmdType = CmdType_DEVICE_DATA;
                             queueElementSend.event = GatewayEvent_DEVICE_CMD;
-                            if(inCommand->shortAddr == 0x0000)
+                            if((extractedJson != NULL) && (inCommand->shortAddr == 0x0000))
                             {
                                 sscanf(extractedJson, "%x", &shortAddr);
                                 inCommand->shortAddr = shortAddr;
                             }
-                            else if(inCommand->shortAddr == 0xFFFF)
+                            else if((extractedJson != NULL) && (inCommand->shortAddr == 0xFFFF))
                             {
                                 *(uint64_t*)inCommand->extAddr = strtoull (extractedJson, NULL, 16);
                             }
@@ -828,7 +836,7 @@ int32_t actionPostCallback(uint8_t requestIdx, uint8_t *argcCallback, uint8_t **
 
     queueElementSend.msgPtr = inCommand;
 
-    mq_send(*gatewayCliMq, (char*) &queueElementSend, sizeof(msgQueue_t), 0);
+    MsgLane_send(*gatewayCliMq, &queueElementSend);
 
 
 
@@ -893,6 +901,49 @@ int32_t cloudGetCallback(uint8_t requestIdx, uint8_t *argcCallback, uint8_t **ar
     return status;
 }
 
+//*****************************************************************************
+//
+//! \brief Service callback for HTTP GET of the message queue counters
+//!
+//! \param[in]  requestIdx          request index to indicate the message
+//!
+//! \param[in]  argcCallback        count of input params to the service callback
+//!
+//! \param[in]  argvCallback        set of input params to the service callback
+//!
+//! \param[in] netAppRequest        netapp request structure
+//!
+//! \return 0 on success else negative
+//!
+//****************************************************************************
+int32_t queuesGetCallback(uint8_t requestIdx, uint8_t *argcCallback, uint8_t **argvCallback, SlNetAppRequest_t *netAppRequest)
+{
+    JsonWriter_t writer;
+    uint16_t metadataLen;
+    int32_t payloadLen;
+    int32_t status = 0;
+
+    JsonWriter_init(&writer, (char*)gPayloadBuffer, sizeof(gPayloadBuffer));
+    JsonWriter_beginObject(&writer, NULL);
+    MqStats_writeJson(&writer, "queues");
+    JsonWriter_endObject(&writer);
+    payloadLen = JsonWriter_finish(&writer);
+
+    if (payloadLen < 0)
+    {
+        strcpy((char *)gPayloadBuffer, (const char *)pgNotFound);
+        payloadLen = strlen((const char *)gPayloadBuffer);
+        status = -1;
+    }
+
+    metadataLen = prepareGetMetadata(status, payloadLen, HttpContentTypeList_ApplicationJson);
+
+    sl_NetAppSend (netAppRequest->Handle, metadataLen, gMetadataBuffer, (SL_NETAPP_REQUEST_RESPONSE_FLAGS_CONTINUATION | SL_NETAPP_REQUEST_RESPONSE_FLAGS_METADATA));
+    sl_NetAppSend (netAppRequest->Handle, payloadLen, gPayloadBuffer, 0); /* mark as last segment */
+
+    return status;
+}
+
 //*****************************************************************************
 //
 //! \brief This is a generic device service callback function for HTTP GET
@@ -995,7 +1046,7 @@ int32_t cloudPostCallback(uint8_t requestIdx, uint8_t *argcCallback, uint8_t **a
         memcpy(qmsgClInfo, &ibmCloudInfo, sizeof(CloudIBM_Info_t));
         msgQueue_t mqEvt = {CloudServiceEvt_CLOUDINFO_RX, qmsgClInfo, sizeof(CloudIBM_Info_t)};
         cloudInfoBitMask = 0;
-        mq_send(cloudMq, (char*)&mqEvt, sizeof(msgQueue_t), MQ_LOW_PRIOR);
+        MsgLane_send(cloudMq, &mqEvt);
     }
     metadataLen = preparePostMetadata(0);
 
@@ -217,7 +217,7 @@ extern void LocalWebSrvr_init(const char *cloudSrvrMqName);
  *
  * @return
  */
-extern void LocalWebSrvr_registerCliMq(mqd_t *pGatewayMq);
+extern void LocalWebSrvr_registerCliMq(MsgLane_t **pGatewayMq);
 
 /*!
  * @brief
@@ -48,9 +48,14 @@
 #include <string.h>
 #include <ThirdParty/jsmn.h>
 #include <Common/commonDefs.h>
+#include <Utils/cbor.h>
+#define LOG_MODULE LogModule_CLOUD
 #include <Utils/uart_term.h>
 #include "cloudJson.h"
 
+static bool cborFindKey(CborReader_t *pReader, const char *pTextKey,
+                        uint32_t intKey, CborItem_t *pValue);
+
 
 char* jsonParseIn(char* payload_str, char* findToken)
 {
@@ -80,3 +85,143 @@ char* jsonParseIn(char* payload_str, char* findToken)
     }
     return retToken;
 }
+
+bool jsonParseGroup(char* payload_str, char* groupName)
+{
+    char *extractedJson;
+
+    groupName[0] = '\0';
+    extractedJson = jsonParseIn(payload_str, "group");
+    if(extractedJson)
+    {
+        strncpy(groupName, extractedJson, MAX_GROUP_NAME_LEN - 1);
+        groupName[MAX_GROUP_NAME_LEN - 1] = '\0';
+        free(extractedJson);
+    }
+    return (groupName[0] != '\0');
+}
+
+char* cborParseIn(const uint8_t* payload, uint16_t len, char* findToken)
+{
+    char *retToken = NULL;
+    CborReader_t reader;
+    CborItem_t value;
+
+    CborReader_init(&reader, payload, len);
+    if(!cborFindKey(&reader, findToken, 0, &value))
+    {
+        return NULL;
+    }
+    switch(value.major)
+    {
+    case CBOR_MAJOR_TEXT:
+        retToken = (char*)malloc(value.value + 1);
+        memcpy(retToken, value.pData, value.value);
+        retToken[value.value] = '\0';
+        break;
+    case CBOR_MAJOR_BYTES:
+        /* Addresses, read back with %x or strtoull() as in JSON */
+        retToken = (char*)malloc((value.value * 2) + 1);
+        for(uint32_t byteIdx = 0; byteIdx < value.value; byteIdx++)
+        {
+            sprintf(retToken + (byteIdx * 2), "%02x", value.pData[byteIdx]);
+        }
+        retToken[value.value * 2] = '\0';
+        break;
+    case CBOR_MAJOR_UINT:
+    case CBOR_MAJOR_NINT:
+        retToken = (char*)malloc(12);
+        if(value.major == CBOR_MAJOR_UINT)
+        {
+            sprintf(retToken, "%lu", (unsigned long)value.value);
+        }
+        else
+        {
+            sprintf(retToken, "-%lu", (unsigned long)value.value + 1);
+        }
+        break;
+    case CBOR_MAJOR_SIMPLE:
+        if((value.value == CBOR_FALSE) || (value.value == CBOR_TRUE))
+        {
+            retToken = (char*)malloc(6);
+            strcpy(retToken, (value.value == CBOR_TRUE) ? "true" : "false");
+        }
+        break;
+    default:
+        break;
+    }
+    return retToken;
+}
+
+bool cborParseGroup(const uint8_t* payload, uint16_t len, char* groupName)
+{
+    char *extractedCbor;
+
+    groupName[0] = '\0';
+    extractedCbor = cborParseIn(payload, len, "group");
+    if(extractedCbor)
+    {
+        strncpy(groupName, extractedCbor, MAX_GROUP_NAME_LEN - 1);
+        groupName[MAX_GROUP_NAME_LEN - 1] = '\0';
+        free(extractedCbor);
+    }
+    return (groupName[0] != '\0');
+}
+
+bool cborParseUint(const uint8_t* payload, uint16_t len, uint32_t key, uint32_t* pValue)
+{
+    CborReader_t reader;
+    CborItem_t value;
+
+    CborReader_init(&reader, payload, len);
+    if(!cborFindKey(&reader, NULL, key, &value) ||
+       (value.major != CBOR_MAJOR_UINT))
+    {
+        return false;
+    }
+    *pValue = (uint32_t)value.value;
+    return true;
+}
+
+/*!
+ * @brief   Find a key of the top level map of a CBOR encoding
+ *
+ * @param   pReader - reader at the start of the encoding
+ * @param   pTextKey - text key to find, NULL for an integer key
+ * @param   intKey - integer key to find
+ * @param   pValue - value of the key
+ *
+ * @return  true if the key is found
+ */
+static bool cborFindKey(CborReader_t *pReader, const char *pTextKey,
+                        uint32_t intKey, CborItem_t *pValue)
+{
+    CborItem_t map;
+    CborItem_t key;
+
+    if(!CborReader_next(pReader, &map) || (map.major != CBOR_MAJOR_MAP))
+    {
+        return false;
+    }
+    for(uint64_t pairIdx = 0; pairIdx < map.value; pairIdx++)
+    {
+        if(!CborReader_next(pReader, &key) ||
+           !CborReader_next(pReader, pValue))
+        {
+            return false;
+        }
+        if(pTextKey ? ((key.major == CBOR_MAJOR_TEXT) &&
+                       (key.value == strlen(pTextKey)) &&
+                       (memcmp(key.pData, pTextKey, key.value) == 0)) :
+                      ((key.major == CBOR_MAJOR_UINT) && (key.value == intKey)))
+        {
+            return true;
+        }
+        /* Keys are expected to be plain, only the values are passed over */
+        if(!CborReader_skip(pReader, pValue))
+        {
+            return false;
+        }
+    }
+    return false;
+}
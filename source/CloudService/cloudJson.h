@@ -46,6 +46,8 @@
 #ifndef __CLOUDJSON_H_
 #define __CLOUDJSON_H_
 
+#include <stdbool.h>
+#include <stdint.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -61,6 +63,56 @@ extern "C" {
  */
 extern char* jsonParseIn(char* payload_str, char* findToken);
 
+/*!
+ * @brief   Copy the optional group name a device command is sent to
+ *
+ * @param   payload_str - JSON device command
+ * @param   groupName - buffer of MAX_GROUP_NAME_LEN bytes, set to an empty
+ *                      string if the command has no group
+ *
+ * @return  true if the command is sent to a group
+ */
+extern bool jsonParseGroup(char* payload_str, char* groupName);
+
+/*!
+ * @brief   Find a text key of a CBOR command, the counterpart of
+ *          jsonParseIn() for the commands sent with fmt/cbor. Text values
+ *          are copied, integers are written in decimal, byte strings in
+ *          hexadecimal and booleans as true or false.
+ *
+ * @param   payload - CBOR command, a map
+ * @param   len - length of the command
+ * @param   findToken - key to find
+ *
+ * @return  allocated string, to be freed by the caller, NULL if the key is
+ *          not found or its value is an array or a map
+ */
+extern char* cborParseIn(const uint8_t* payload, uint16_t len, char* findToken);
+
+/*!
+ * @brief   Copy the optional group name of a CBOR device command
+ *
+ * @param   payload - CBOR device command
+ * @param   len - length of the command
+ * @param   groupName - as for jsonParseGroup()
+ *
+ * @return  true if the command is sent to a group
+ */
+extern bool cborParseGroup(const uint8_t* payload, uint16_t len, char* groupName);
+
+/*!
+ * @brief   Read an unsigned integer under an integer key of a CBOR map,
+ *          e.g. a member of the CBOR updates of the gateway
+ *
+ * @param   payload - CBOR map
+ * @param   len - length of the map
+ * @param   key - key to find
+ * @param   pValue - value read
+ *
+ * @return  true if the key is found with an unsigned integer value
+ */
+extern bool cborParseUint(const uint8_t* payload, uint16_t len, uint32_t key, uint32_t* pValue);
+
 #ifdef __cplusplus
 }
 #endif
@@ -81,8 +81,11 @@
 
 /* Common interface includes                                                  */
 
+#define LOG_MODULE LogModule_CLOUD
 #include <Utils/uart_term.h>
+#include <Utils/msgLane.h>
 #include <Common/commonDefs.h>
+#include <Collector/rampBench.h>
 
 /* Application includes                                                       */
 #include <Board.h>
@@ -111,6 +114,7 @@
 //*****************************************************************************
 
 void *cloudService_thread(void *pvParameters);
+static MsgLane_class_t cloudServiceMsgClass(const msgQueue_t *pMsg);
 
 
 
@@ -126,10 +130,28 @@ void *cloudService_thread(void *pvParameters);
 
 
 /* Message Queue                                                              */
-mqd_t cloudSrvrMq;
-mqd_t registeredMq;
+MsgLane_t *cloudSrvrMq;
+MsgLane_t *registeredMq;
 pthread_t cloudServiceThreadHandle = (pthread_t) NULL;
 
+/* Version of the network document last passed on, a delta that does not
+ * follow it means one was lost on the way                                    */
+static uint32_t nwkVersion = 0;
+static bool nwkSnapshotPending = false;
+
+/* Device updates are dropped once the cloud falls behind, the gateway then
+ * holds its samples back. Network changes, incoming commands and connection
+ * events are not dropped, their senders wait for room.                      */
+static const MsgLane_config_t cloudServiceLaneConfig =
+{
+    .bound = {6, 6, 4, 4},
+    .policy = {MsgLane_policy_drop, MsgLane_policy_block,
+               MsgLane_policy_block, MsgLane_policy_block},
+    .congestedPct = 75,
+    .pfnClass = cloudServiceMsgClass,
+    .pfnKey = NULL
+};
+
 
 void *cloudService_thread(void *pvParameters)
 {
@@ -141,7 +163,7 @@ void *cloudService_thread(void *pvParameters)
         queueElemRecv.msgPtr = NULL;
         queueElemRecv.msgPtrLen = 0;
         /* waiting for signals                                                */
-        mq_receive(cloudSrvrMq, (char*) &queueElemRecv, sizeof(msgQueue_t), NULL);
+        MsgLane_receive(cloudSrvrMq, &queueElemRecv, NULL);
 
         switch (queueElemRecv.event)
         {
@@ -176,8 +198,38 @@ void *cloudService_thread(void *pvParameters)
 //For future feature handling AWS cloud connection from local fEnd
 #endif
             LocalWebSrvr_handleCloudConnect();
+            /* Deltas may have been dropped while the cloud was away */
+            cloudServiceRequestNwkSnapshot();
             break;
         case CloudServiceEvt_NWK_UPDATE:
+        case CloudServiceEvt_NWK_DELTA:
+        {
+            unsigned int version;
+
+            if(sscanf((char*)queueElemRecv.msgPtr, "{\"version\":%u",
+                      &version) == 1)
+            {
+                if(queueElemRecv.event == CloudServiceEvt_NWK_UPDATE)
+                {
+                    nwkSnapshotPending = false;
+                }
+                else if(version != nwkVersion + 1)
+                {
+                    UART_PRINT("[Cloud Service] Network delta %u after %u, "
+                               "resyncing\n\r", version,
+                               (unsigned int)nwkVersion);
+                    cloudServiceRequestNwkSnapshot();
+                }
+                nwkVersion = version;
+            }
+#if defined(USE_IBM_CLOUD)
+            CloudIBM_handleGatewayEvt(&queueElemRecv);
+#elif defined(USE_AWS_CLOUD)
+            CloudAWS_handleGatewayEvt(&queueElemRecv);
+#endif
+            LocalWebSrvr_handleGatewayEvt(&queueElemRecv);
+        }
+           break;
         case CloudServiceEvt_DEV_UPDATE:
         case CloudServiceEvt_STATE_CNF_EVT:
 #if defined(USE_IBM_CLOUD)
@@ -187,11 +239,55 @@ void *cloudService_thread(void *pvParameters)
 #endif
             LocalWebSrvr_handleGatewayEvt(&queueElemRecv);
            break;
+        case CloudServiceEvt_NWK_UPDATE_CBOR:
+        case CloudServiceEvt_DEV_UPDATE_CBOR:
+        case CloudServiceEvt_NWK_DELTA_CBOR:
+            /* Only IBM takes CBOR, the versions are checked on the JSON
+               twin sent right after */
+#if defined(USE_IBM_CLOUD)
+            CloudIBM_handleGatewayEvt(&queueElemRecv);
+#endif
+           break;
+        case CloudServiceEvt_CMD_DELIVERY:
+            /* The local web server only shows the latest device update */
+#if defined(USE_IBM_CLOUD)
+            CloudIBM_handleGatewayEvt(&queueElemRecv);
+#elif defined(USE_AWS_CLOUD)
+            CloudAWS_handleGatewayEvt(&queueElemRecv);
+#endif
+           break;
+        case CloudServiceEvt_RAMP_DATA:
+        {
+            /* Published as a device update, AWS device shadows are not
+               meant for this rate. The stand-in sink times and drops the
+               frame. */
+            RampBench_frame_t frame;
+            unsigned int seqNum, timestamp;
+#if defined(USE_IBM_CLOUD)
+            if(RAMPBENCH_CLOUD_SINK == false)
+            {
+                CloudIBM_handleGatewayEvt(&queueElemRecv);
+            }
+#endif
+            if(sscanf((char*)queueElemRecv.msgPtr, "{\"ramp\":{\"seq\":%u,\"ts\":%u",
+                      &seqNum, &timestamp) == 2)
+            {
+                frame.seqNum = seqNum;
+                frame.timestamp = timestamp;
+                RampBench_stamp(RampBench_stage_cloud, &frame);
+            }
+        }
+            break;
         case CloudServiceEvt_CLOUD_IN_MQTT:
 #if defined(USE_IBM_CLOUD)
             CloudIBM_handleCloudEvt(&queueElemRecv);
 #elif defined(USE_AWS_CLOUD)
             CloudAWS_handleCloudEvt(&queueElemRecv);
+#endif
+            break;
+        case CloudServiceEvt_CLOUD_IN_CBOR:
+#if defined(USE_IBM_CLOUD)
+            CloudIBM_handleCloudEvt(&queueElemRecv);
 #endif
             break;
         case CloudServiceEvt_LOCAL_SERVR_HTTP:
@@ -218,7 +314,7 @@ void *cloudService_thread(void *pvParameters)
 
 void cloudServiceCliMqReg(const char *cservClientMq)
 {
-    registeredMq = mq_open(cservClientMq, O_WRONLY | O_NONBLOCK);
+    registeredMq = MsgLane_open(cservClientMq);
 #if defined(USE_IBM_CLOUD)
     cloudIBM_registerCliMq(&registeredMq);
 #elif defined(USE_AWS_CLOUD)
@@ -227,6 +323,25 @@ void cloudServiceCliMqReg(const char *cservClientMq)
     LocalWebSrvr_registerCliMq(&registeredMq);
 
 }
+
+void cloudServiceRequestNwkSnapshot(void)
+{
+    msgQueue_t queueElementSend;
+
+    /* One snapshot answers all the requests made before it arrives */
+    if(nwkSnapshotPending)
+    {
+        return;
+    }
+
+    queueElementSend.event = GatewayEvent_NWK_SNAPSHOT;
+    queueElementSend.msgPtr = NULL;
+    queueElementSend.msgPtrLen = 0;
+    if(MsgLane_send(registeredMq, &queueElementSend) == MsgLane_status_sent)
+    {
+        nwkSnapshotPending = true;
+    }
+}
 //*****************************************************************************
 //
 //!  MQTT Start
@@ -242,13 +357,9 @@ void cloudServiceInit(const char *cloudSrvrMqName)
     pthread_attr_t pAttrs;
     struct sched_param priParam;
     int32_t retc = 0;
-    mq_attr attr;
-    unsigned mode = 0;
 
     /* sync object for inter thread communication                             */
-    attr.mq_maxmsg = 20;
-    attr.mq_msgsize = sizeof(msgQueue_t);
-    cloudSrvrMq = mq_open(cloudSrvrMqName, O_CREAT, mode, &attr);
+    cloudSrvrMq = MsgLane_create(cloudSrvrMqName, &cloudServiceLaneConfig);
 
 
     if (cloudSrvrMq == NULL)
@@ -276,6 +387,31 @@ void cloudServiceInit(const char *cloudSrvrMqName)
     LocalWebSrvr_init(cloudSrvrMqName);
 }
 
+static MsgLane_class_t cloudServiceMsgClass(const msgQueue_t *pMsg)
+{
+    switch(pMsg->event)
+    {
+    case CloudServiceEvt_DEV_UPDATE:
+    case CloudServiceEvt_DEV_UPDATE_CBOR:
+    case CloudServiceEvt_RAMP_DATA:
+        return MsgLane_class_telemetry;
+    case CloudServiceEvt_NWK_UPDATE:
+    case CloudServiceEvt_NWK_DELTA:
+    case CloudServiceEvt_NWK_UPDATE_CBOR:
+    case CloudServiceEvt_NWK_DELTA_CBOR:
+    case CloudServiceEvt_STATE_CNF_EVT:
+    case CloudServiceEvt_CMD_DELIVERY:
+        return MsgLane_class_state;
+    case CloudServiceEvt_CLOUD_IN_MQTT:
+    case CloudServiceEvt_CLOUD_IN_CBOR:
+    case CloudServiceEvt_LOCAL_SERVR_HTTP:
+        return MsgLane_class_actuator;
+    default:
+        /* WLAN and cloud connection, cloud info */
+        return MsgLane_class_control;
+    }
+}
+
 
 //*****************************************************************************
 //
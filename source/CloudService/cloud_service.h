@@ -47,6 +47,13 @@ extern void cloudServiceInit(const char *cloudMqName);
  */
 extern void cloudServiceCliMqReg(const char *cservClientMq);
 
+/*!
+ * @brief       Ask the gateway for a snapshot of the network document,
+ *              for a consumer that missed a delta or has none yet. Requests
+ *              made while a snapshot is on its way are merged into it.
+ */
+extern void cloudServiceRequestNwkSnapshot(void);
+
 
 #ifdef __cplusplus
 }
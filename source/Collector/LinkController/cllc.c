@@ -57,6 +57,10 @@
 #include <Utils/util.h>
 #include <API_MAC/api_mac.h>
 #include <Collector/config.h>
+#include <Collector/devFilter.h>
+#include <Collector/devGroups.h>
+#include <Collector/indirectQueue.h>
+#include <Collector/linkStats.h>
 #include "llc.h"
 #include "cllc.h"
 //#include "csf.h"
@@ -103,6 +107,14 @@
 
 #define CLLC_FH_MAX_TRICKLE             CONFIG_TRICKLE_MAX_CLK_DURATION
 #define CLLC_FH_MIN_TRICKLE             CONFIG_TRICKLE_MIN_CLK_DURATION
+/*! Trickle redundancy constant k */
+#define CLLC_FH_TRICKLE_K               CONFIG_TRICKLE_REDUNDANCY_CONST
+/*! Period over which the join rate is measured, in msec */
+#define CLLC_FH_TRICKLE_JOIN_WINDOW     CLLC_FH_MAX_TRICKLE
+/*! Joins in a window that bring the maximum interval back to its minimum */
+#define CLLC_FH_TRICKLE_JOIN_BUSY       2
+/*! Maximum number of extra doublings of the maximum interval */
+#define CLLC_FH_TRICKLE_MAX_EXTRA       4
 
 #define PA_HOP_NEIGHBOR_FOUND_MASK      0x1
 #define PA_FIXED_NEIGHBOR_FOUND_MASK    0x2
@@ -122,6 +134,36 @@
 /*! percent filter */
 #define CONFIG_PERCENTFILTER         0xFF
 
+/* Channel monitor */
+/*! Time without traffic before a background scan is started, in msec */
+#define CLLC_CHAN_MON_QUIET_TIME        2000
+/*! Number of times a scan is postponed before it is done anyway */
+#define CLLC_CHAN_MON_MAX_POSTPONE      10
+/*! Number of channels scanned in one background scan */
+#define CLLC_CHAN_MON_SCAN_CHANNELS     4
+/*! Energy level above which the operating channel is considered busy */
+#define CLLC_CHAN_MON_ENERGY_THRESHOLD  0x60
+/*! Energy improvement needed before moving to another channel */
+#define CLLC_CHAN_MON_ENERGY_MARGIN     0x20
+/*! Failed transmissions in percent that indicate interference */
+#define CLLC_CHAN_MON_FAILURE_PCT       20
+/*! Minimum transmissions in a window to judge the failure rate */
+#define CLLC_CHAN_MON_MIN_TX            10
+/*! Consecutive bad windows before a migration is attempted */
+#define CLLC_CHAN_MON_BAD_WINDOWS       3
+/*! Windows after a migration during which no other migration is done */
+#define CLLC_CHAN_MON_HOLDOFF_WINDOWS   6
+/*! No migration candidate */
+#define CLLC_CHAN_MON_NO_CANDIDATE      0xFF
+
+/* Admission control */
+/*! New devices admitted per second */
+#define CLLC_ADMIT_RATE                 4
+/*! New devices that can be admitted back to back */
+#define CLLC_ADMIT_BURST                8
+/*! Time after a known device returned during which new devices wait */
+#define CLLC_ADMIT_KNOWN_HOLDOFF        1000
+
 /******************************************************************************
  Security constants and definitions
  *****************************************************************************/
@@ -146,6 +188,30 @@ typedef struct
     ApiMac_panDesc_t panDescList;
 } panDescList_t;
 
+/* Trickle timer state (RFC 6206) of one async frame type */
+typedef struct
+{
+    /* Interval length I in msec, 0 if the timer is stopped */
+    uint32_t interval;
+    /* Transmission time t in the interval in msec */
+    uint32_t txTime;
+    /* Consistent frames heard in the interval, counter c */
+    uint8_t counter;
+    /* true once t has passed in the interval */
+    bool txDone;
+} trickleTimer_t;
+
+/* Admission decision for a new device */
+typedef enum
+{
+    /* Admit the device now */
+    admitDecision_accept,
+    /* Do not answer, the device retries the association later */
+    admitDecision_defer,
+    /* The association table is full */
+    admitDecision_full
+} admitDecision_t;
+
 /* Coordinator information, used to store default parameters */
 typedef struct
 {
@@ -205,8 +271,16 @@ STATIC CONST uint8_t fhGtkHash0[] = CLLC_FH_GTK0HASH;
 STATIC CONST uint8_t fhGtkHash1[] = CLLC_FH_GTK1HASH;
 STATIC CONST uint8_t fhGtkHash2[] = CLLC_FH_GTK2HASH;
 STATIC CONST uint8_t fhGtkHash3[] = CLLC_FH_GTK3HASH;
-STATIC uint32_t fhPAtrickleTime = CLLC_FH_MIN_TRICKLE;
-STATIC uint32_t fhPCtrickleTime = CLLC_FH_MIN_TRICKLE;
+/* Trickle timer of the PAN advertisement */
+STATIC trickleTimer_t fhPAtrickle = { 0 };
+/* Trickle timer of the PAN configuration */
+STATIC trickleTimer_t fhPCtrickle = { 0 };
+/* Extra doublings of the maximum trickle interval in a stable network */
+STATIC uint8_t fhTrickleExtra = 0;
+/* Associations in the current join rate window */
+STATIC uint16_t fhTrickleJoins = 0;
+/* Start of the current join rate window */
+STATIC uint32_t fhTrickleJoinStart = 0;
 /* set of channels on which target nodes are expected to listen */
 STATIC uint8_t optPAChMask[APIMAC_154G_CHANNEL_BITMAP_SIZ];
 /* set of channels on which target nodes are expected to listen */
@@ -214,6 +288,48 @@ STATIC uint8_t optPCChMask[APIMAC_154G_CHANNEL_BITMAP_SIZ];
 /* Flag to specify whether set of expected target channel is known */
 STATIC uint8_t optAsyncFlag = false;
 
+/* Last energy level measured on each channel */
+STATIC uint8_t chanMonEnergy[APIMAC_154G_MAX_NUM_CHANNEL];
+/* Channels in the background scan in progress */
+STATIC uint8_t chanMonScanMask[APIMAC_154G_CHANNEL_BITMAP_SIZ];
+/* Next channel to scan in the rotation over the channel mask */
+STATIC uint8_t chanMonNextChan = 0;
+/* Channel to confirm with the next scan before migrating */
+STATIC uint8_t chanMonCandidate = CLLC_CHAN_MON_NO_CANDIDATE;
+/* Channel in use before the migration in progress */
+STATIC uint8_t chanMonPrevChannel = 0;
+/* Consecutive windows with interference on the operating channel */
+STATIC uint8_t chanMonBadWindows = 0;
+/* Windows left before another migration is allowed */
+STATIC uint8_t chanMonHoldoff = 0;
+/* Number of times the pending scan was postponed */
+STATIC uint8_t chanMonPostponed = 0;
+/* true while a background scan is in progress */
+STATIC bool chanMonScanning = false;
+/* true while a channel migration is in progress */
+STATIC bool chanMonMigrating = false;
+/* Time of the last frame sent or received */
+STATIC uint32_t chanMonLastActivity = 0;
+/* Time the current channel was started */
+STATIC uint32_t chanMonStartTime = 0;
+/* Counters at the start of the current window */
+STATIC Cllc_txWindow_t chanMonWindowBase;
+/* Channel monitor statistics */
+STATIC Cllc_chanMonStats_t chanMonStats;
+
+/* Admission tokens, in thousandths of a new device */
+STATIC uint32_t admitTokens = CLLC_ADMIT_BURST * 1000;
+/* Time the admission tokens were last refilled */
+STATIC uint32_t admitRefillTime = 0;
+/* Time a known device last associated again */
+STATIC uint32_t admitKnownTime = 0;
+/* Time the network was restored */
+STATIC uint32_t admitRestoreTime = 0;
+/* Restored devices heard from, indexed like Cllc_associatedDevList */
+STATIC uint8_t admitReturned[(CONFIG_MAX_DEVICES + 7) / 8];
+/* Admission statistics */
+STATIC Cllc_admitStats_t admitStats;
+
 #ifdef FEATURE_MAC_SECURITY
 /******************************************************************************
  Local security variables
@@ -285,6 +401,7 @@ static void startCnfCb(ApiMac_mlmeStartCnf_t *pData);
 static void disassocIndCb(ApiMac_mlmeDisassociateInd_t *pData);
 static void wsAsyncIndCb(ApiMac_mlmeWsAsyncInd_t *pData);
 static void dataIndCb(ApiMac_mcpsDataInd_t *pData);
+static void dataCnfCb(ApiMac_mcpsDataCnf_t *pData);
 static void orphanIndCb(ApiMac_mlmeOrphanInd_t *pData);
 
 static void switchState(Cllc_coord_states_t newState);
@@ -306,12 +423,24 @@ static uint8_t findBestChannel(uint8_t *pResults);
 static uint16_t findChannel(uint16_t panID,uint8_t channel);
 
 static Cllc_associated_devices_t *findDevice(uint16_t shortAddr);
+static Cllc_associated_devices_t *findDeviceExt(ApiMac_sAddrExt_t *pExtAddr);
+static admitDecision_t admitNewDevice(void);
+static void markDeviceReturned(Cllc_associated_devices_t *pItem);
 static void updateState(Cllc_states_t state);
 static void sendAsyncReq(uint8_t frameType);
 static void joinPermitExpired(void);
-static void sendStartReq(bool startFH);
+static void getNetworkInfo(Llc_netInfo_t *pNetworkInfo);
+static void sendStartReq(bool startFH, bool coordRealign);
 static void sendScanReq(ApiMac_scantype_t type);
-static void setTrickleTime(uint32_t *pTrickleTime, uint8_t frameType);
+static void chanMonTimeout(void);
+static void chanMonSendScanReq(void);
+static void chanMonScanCnf(uint8_t *pResults);
+static void chanMonMigrate(uint8_t channel);
+static void chanMonMigrated(bool success);
+static trickleTimer_t *getTrickle(uint8_t frameType);
+static void startTrickleInterval(uint8_t frameType, uint32_t interval);
+static void processTrickleTimeout(uint8_t frameType);
+static void updateTrickleJoinRate(bool joined);
 static void processIncomingFHframe(uint8_t frameType);
 static void processIncomingAsyncUSIE(uint8_t frameType, uint8_t* pIEContent);
 
@@ -345,6 +474,7 @@ void Cllc_init(ApiMac_callbacks_t *pMacCbs, Cllc_callbacks_t *pCllcCbs)
     pMacCbs->pStartCnfCb = startCnfCb;
     pMacCbs->pDisassociateIndCb = disassocIndCb;
     pMacCbs->pDataIndCb = dataIndCb;
+    pMacCbs->pDataCnfCb = dataCnfCb;
 
     if(!CONFIG_FH_ENABLE)
     {
@@ -375,6 +505,9 @@ void Cllc_init(ApiMac_callbacks_t *pMacCbs, Cllc_callbacks_t *pCllcCbs)
     {
         /* initialize join permit timer clock */
         Csf_initializeJoinPermitClock();
+        /* initialize channel monitor clock */
+        Csf_initializeChanMonClock();
+        memset(chanMonEnergy, CLLC_MAX_ENERGY, sizeof(chanMonEnergy));
     }
     else
     {
@@ -437,8 +570,7 @@ void Cllc_process(void)
     {
         if(CONFIG_FH_ENABLE)
         {
-            setTrickleTime(&fhPAtrickleTime,
-                           ApiMac_wisunAsyncFrame_advertisement);
+            processTrickleTimeout(ApiMac_wisunAsyncFrame_advertisement);
         }
 
         /* Clear the event */
@@ -450,7 +582,7 @@ void Cllc_process(void)
     {
         if(CONFIG_FH_ENABLE)
         {
-            setTrickleTime(&fhPCtrickleTime, ApiMac_wisunAsyncFrame_config);
+            processTrickleTimeout(ApiMac_wisunAsyncFrame_config);
         }
 
         /* Clear the event */
@@ -475,6 +607,15 @@ void Cllc_process(void)
         /* Clear the event */
         Util_clearEvent(&Cllc_events, CLLC_JOIN_EVT);
     }
+
+    /* Process channel monitor event */
+    if(Cllc_events & CLLC_CHAN_MON_EVT)
+    {
+        chanMonTimeout();
+
+        /* Clear the event */
+        Util_clearEvent(&Cllc_events, CLLC_CHAN_MON_EVT);
+    }
 }
 
 /*!
@@ -540,7 +681,7 @@ void Cllc_restoreNetwork(Llc_netInfo_t *pNetworkInfo, uint8_t numDevices,
     ApiMac_mlmeSetReqUint16(ApiMac_attribute_shortAddress,
                              pNetworkInfo->devInfo.shortAddress);
 
-    sendStartReq(pNetworkInfo->fh);
+    sendStartReq(pNetworkInfo->fh, false);
 
     /* repopulate association table */
     for(i = 0; i < numDevices; i++, pDevList++)
@@ -548,7 +689,16 @@ void Cllc_restoreNetwork(Llc_netInfo_t *pNetworkInfo, uint8_t numDevices,
         /* Add to association table */
         maintainAssocTable(&pDevList->devInfo, &pDevList->capInfo, 1, 0,
                            (false));
+        DevFilter_bindShort(&pDevList->devInfo.extAddress,
+                            pDevList->devInfo.shortAddress);
     }
+
+    /* measure how long it takes until all devices are back */
+    memset(admitReturned, 0, sizeof(admitReturned));
+    admitStats.numRestored = numDevices;
+    admitStats.numReturned = 0;
+    admitStats.recoveryTime = 0;
+    admitRestoreTime = Util_getTimeMs();
 }
 
 /*!
@@ -597,6 +747,12 @@ void Cllc_removeDevice(ApiMac_sAddrExt_t *pExtAddr)
         {
             if(Cllc_associatedDevList[i].shortAddr == shortAddr)
             {
+                /* Nothing queued, measured or grouped is carried over to
+                   the next device given this entry or short address */
+                IndQueue_reset((uint8_t)i);
+                LinkStats_remove(shortAddr);
+                DevGroups_removeDevice((uint8_t)i);
+
                 /* Clear the entry - delete */
                 memset(&Cllc_associatedDevList[i], 0xFF,
                        sizeof(Cllc_associated_devices_t));
@@ -607,6 +763,16 @@ void Cllc_removeDevice(ApiMac_sAddrExt_t *pExtAddr)
     }
 }
 
+/*!
+ Get the admission control statistics.
+
+ Public function defined in cllc.h
+ */
+void Cllc_getAdmitStats(Cllc_admitStats_t *pStats)
+{
+    memcpy(pStats, &admitStats, sizeof(Cllc_admitStats_t));
+}
+
 /*!
  Send disassociation request.
 
@@ -631,6 +797,27 @@ void Cllc_sendDisassociationRequest(uint16_t shortAddr,bool rxOnIdle)
     ApiMac_mlmeDisassociateReq(&disassocReq);
 }
 
+/*!
+ Get the channel monitor statistics.
+
+ Public function defined in cllc.h
+ */
+void Cllc_getChanMonStats(Cllc_chanMonStats_t *pStats)
+{
+    memcpy(pStats, &chanMonStats, sizeof(Cllc_chanMonStats_t));
+    pStats->current.duration = Util_getTimeMs() - chanMonStartTime;
+}
+
+/*!
+ Get the operating channel.
+
+ Public function defined in cllc.h
+ */
+uint8_t Cllc_getChannel(void)
+{
+    return (coordInfoBlock.channel);
+}
+
 #ifdef FEATURE_MAC_SECURITY
 /*!
  Initialize the MAC Security
@@ -750,6 +937,60 @@ ApiMac_status_t Cllc_addSecDevice(uint16_t panID, uint16_t shortAddr,
         return(ApiMac_status_success);
     }
 }
+
+/*!
+ Add a list of devices to the MAC security device table.
+
+ Public function defined in cllc.h
+ */
+ApiMac_status_t Cllc_addSecDeviceList(uint16_t numDevices,
+                                      Llc_deviceListItem_t *pDevList)
+{
+    ApiMac_secAddDevice_t *pDevices;
+    ApiMac_status_t status;
+    uint16_t i;
+
+    if((macSecurity == false) || (numDevices == 0))
+    {
+        return(ApiMac_status_success);
+    }
+
+    pDevices = (ApiMac_secAddDevice_t *)Csf_malloc(
+                    sizeof(ApiMac_secAddDevice_t) * numDevices);
+    if(pDevices == NULL)
+    {
+        return(ApiMac_status_noResources);
+    }
+
+    for(i = 0; i < numDevices; i++)
+    {
+        ApiMac_secAddDevice_t *pDevice = &pDevices[i];
+        Llc_deviceListItem_t *pItem = &pDevList[i];
+        uint8_t keyIndex = 0;
+
+        pDevice->panID = pItem->devInfo.panID;
+        pDevice->shortAddr = pItem->devInfo.shortAddress;
+        memcpy(pDevice->extAddr, &pItem->devInfo.extAddress,
+               sizeof(ApiMac_sAddrExt_t));
+        pDevice->frameCounter = pItem->rxFrameCounter;
+        pDevice->exempt = false;
+
+        /* get the key lookup information from the initial loaded key */
+        pDevice->keyIdLookupDataSize =
+                        keyIdLookupList[keyIndex].lookupDataSize;
+        memcpy(pDevice->keyIdLookupData,
+               keyIdLookupList[keyIndex].lookupData,
+               (APIMAC_MAX_KEY_LOOKUP_LEN));
+
+        pDevice->uniqueDevice = false;
+        pDevice->duplicateDevFlag = false;
+    }
+
+    status = ApiMac_secAddDeviceList(pDevices, numDevices);
+    Csf_free(pDevices);
+
+    return(status);
+}
 #endif /* FEATURE_MAC_SECURITY */
 
 /******************************************************************************
@@ -805,7 +1046,7 @@ static void processState(Cllc_coord_states_t state)
                 ApiMac_mlmeSetReqUint16(ApiMac_attribute_shortAddress,
                                         coordInfoBlock.shortAddr);
             }
-            sendStartReq(CONFIG_FH_ENABLE);
+            sendStartReq(CONFIG_FH_ENABLE, false);
             break;
 
         case Cllc_coordStates_startCnf:
@@ -818,16 +1059,7 @@ static void processState(Cllc_coord_states_t state)
              */
             clearPANList();
 
-            networkInfo.fh = CONFIG_FH_ENABLE;
-            /* Setup basics */
-            ApiMac_mlmeGetReqUint8(ApiMac_attribute_logicalChannel,
-                                   &networkInfo.channel);
-            ApiMac_mlmeGetReqUint16(ApiMac_attribute_panId,
-                                    &networkInfo.devInfo.panID);
-            ApiMac_mlmeGetReqArray(ApiMac_attribute_extendedAddress,
-                                   (uint8_t*)&networkInfo.devInfo.extAddress);
-            ApiMac_mlmeGetReqUint16(ApiMac_attribute_shortAddress,
-                                    &networkInfo.devInfo.shortAddress);
+            getNetworkInfo(&networkInfo);
 
             /*  set join permit */
             ApiMac_mlmeSetReqBool(ApiMac_attribute_associatePermit, false);
@@ -835,12 +1067,13 @@ static void processState(Cllc_coord_states_t state)
             if(CONFIG_FH_ENABLE)
             {
                 ApiMac_startFH();
+                fhTrickleJoinStart = Util_getTimeMs();
                 /* start trickle timer for PA */
-                Csf_setTrickleClock(CLLC_FH_MIN_TRICKLE,
-                                    ApiMac_wisunAsyncFrame_advertisement);
+                startTrickleInterval(ApiMac_wisunAsyncFrame_advertisement,
+                                     CLLC_FH_MIN_TRICKLE);
                 /* start trickle timer for PC */
-                Csf_setTrickleClock(CLLC_FH_MIN_TRICKLE + (CLLC_FH_MIN_TRICKLE/2),
-                                    ApiMac_wisunAsyncFrame_config);
+                startTrickleInterval(ApiMac_wisunAsyncFrame_config,
+                                     CLLC_FH_MIN_TRICKLE);
             }
 
             /* Inform the application of a start */
@@ -860,6 +1093,15 @@ static void processState(Cllc_coord_states_t state)
             {
                 updateState(Cllc_states_started);
             }
+
+            if(!CONFIG_FH_ENABLE && (CONFIG_MAC_BEACON_ORDER == 15)
+               && (CONFIG_CHANNEL_MONITOR_INTERVAL != 0))
+            {
+                /* start monitoring the operating channel */
+                chanMonStartTime = Util_getTimeMs();
+                chanMonLastActivity = chanMonStartTime;
+                Csf_setChanMonClock(CONFIG_CHANNEL_MONITOR_INTERVAL);
+            }
         }
             break;
 
@@ -914,7 +1156,21 @@ static void configureStartParam(uint8_t channel)
  */
 static void scanCnfCb(ApiMac_mlmeScanCnf_t *pData)
 {
-    if((pData->status == ApiMac_status_success) || (pData->status
+    if(chanMonScanning == true)
+    {
+        /* background scan of the channel monitor */
+        chanMonScanning = false;
+        if((pData->status == ApiMac_status_success)
+           && (pData->scanType == ApiMac_scantype_energyDetect))
+        {
+            chanMonScanCnf(pData->result.pEnergyDetect);
+        }
+        else
+        {
+            Csf_setChanMonClock(CONFIG_CHANNEL_MONITOR_INTERVAL);
+        }
+    }
+    else if((pData->status == ApiMac_status_success) || (pData->status
                       == ApiMac_status_noBeacon))
     {
         if(pData->scanType == ApiMac_scantype_active)
@@ -923,6 +1179,9 @@ static void scanCnfCb(ApiMac_mlmeScanCnf_t *pData)
         }
         else if(pData->scanType == ApiMac_scantype_energyDetect)
         {
+            /* keep the startup results for the channel monitor */
+            memcpy(chanMonEnergy, pData->result.pEnergyDetect,
+                   sizeof(chanMonEnergy));
             coordInfoBlock.channel
                   = findBestChannel(pData->result.pEnergyDetect);
             switchState(Cllc_coordStates_scanEdCnf);
@@ -946,7 +1205,12 @@ static void scanCnfCb(ApiMac_mlmeScanCnf_t *pData)
  */
 static void startCnfCb(ApiMac_mlmeStartCnf_t *pData)
 {
-    if(pData->status == ApiMac_status_success)
+    if(chanMonMigrating == true)
+    {
+        /* coordinator realignment of the channel monitor */
+        chanMonMigrated(pData->status == ApiMac_status_success);
+    }
+    else if(pData->status == ApiMac_status_success)
     {
 #ifdef AUTO_ACK
         ApiMac_srcMatchEnable();
@@ -1111,6 +1375,24 @@ static void assocIndCb(ApiMac_mlmeAssociateInd_t *pData)
     /* Device joining callback */
     ApiMac_deviceDescriptor_t devInfo;
     ApiMac_mlmeAssociateRsp_t assocRsp;
+    Cllc_associated_devices_t *pKnown = NULL;
+    admitDecision_t decision;
+
+    if(DevFilter_admitAssoc(&pData->deviceAddress) == false)
+    {
+        /* Refused by the device filter, nothing is looked up or stored */
+        memset(&assocRsp.sec, 0, sizeof(ApiMac_sec_t));
+        Util_copyExtAddr(&assocRsp.deviceAddress, &pData->deviceAddress);
+        assocRsp.assocShortAddress = INVALID_SHORT_ADDR;
+        assocRsp.status = ApiMac_assocStatus_panAccessDenied;
+        ApiMac_mlmeAssociateRsp(&assocRsp);
+
+        if(macCallbacksCopy.pAssocIndCb != NULL)
+        {
+            macCallbacksCopy.pAssocIndCb(pData);
+        }
+        return;
+    }
 
     /* Setup the device information structure */
     Util_copyExtAddr(&devInfo.extAddress, &pData->deviceAddress);
@@ -1122,33 +1404,55 @@ static void assocIndCb(ApiMac_mlmeAssociateInd_t *pData)
      */
     devInfo.shortAddress = INVALID_SHORT_ADDR;
 #else
-    /* Check to see if the device exists */
-    devInfo.shortAddress = Csf_getDeviceShort(&pData->deviceAddress);
+    /*
+     Check to see if the device exists, the association table holds the
+     NV device list since the restore so NV is not searched
+     */
+    pKnown = findDeviceExt(&pData->deviceAddress);
+    devInfo.shortAddress = INVALID_SHORT_ADDR;
+    if(pKnown != NULL)
+    {
+        devInfo.shortAddress = pKnown->shortAddr;
+    }
 #endif
     if(devInfo.shortAddress == INVALID_SHORT_ADDR)
     {
+        decision = admitNewDevice();
+        if(decision == admitDecision_defer)
+        {
+            /* no response, the device tries again after its backoff */
+            admitStats.numDeferred++;
+            if(macCallbacksCopy.pAssocIndCb != NULL)
+            {
+                /* pass back to MAC API */
+                macCallbacksCopy.pAssocIndCb(pData);
+            }
+            return;
+        }
+
         /* New device, make a new short address */
         assocRsp.status = ApiMac_assocStatus_panAccessDenied;
         devInfo.shortAddress = (uint16_t) (Cllc_numOfDevices
                         + CLLC_ASSOC_DEVICE_STARTING_NUMBER);
 
-        if(pCllcCallbacksCopy && pCllcCallbacksCopy->pDeviceJoiningCb)
+        if(decision == admitDecision_full)
+        {
+            /* reject before the joining callback writes anything to NV */
+            assocRsp.status = ApiMac_assocStatus_panAtCapacity;
+            admitStats.numAtCapacity++;
+        }
+        else if(pCllcCallbacksCopy && pCllcCallbacksCopy->pDeviceJoiningCb)
         {
             /* callback for device joining */
             assocRsp.status = pCllcCallbacksCopy->pDeviceJoiningCb(&devInfo,
                                                  &pData->capabilityInformation);
         }
-#ifndef NV_RESTORE
-        if(Cllc_numOfDevices == CONFIG_MAX_DEVICES)
-        {
-            assocRsp.status = ApiMac_assocStatus_panAtCapacity;
-        }
-#endif
         if(assocRsp.status == ApiMac_assocStatus_success)
         {
             /* add to association table */
             maintainAssocTable(&devInfo, &pData->capabilityInformation, 1, 0,
                                (false));
+            admitStats.numAdmitted++;
 #ifdef POWER_MEAS
             if(POWER_TEST_PROFILE == POLL_DATA)
             {
@@ -1161,6 +1465,9 @@ static void assocIndCb(ApiMac_mlmeAssociateInd_t *pData)
     {
         /* Device already exists use the old short address */
         assocRsp.status = ApiMac_assocStatus_success;
+        admitStats.numKnown++;
+        admitKnownTime = Util_getTimeMs();
+        markDeviceReturned(pKnown);
     }
 
     /* Fill assoc rsp fields */
@@ -1171,6 +1478,16 @@ static void assocIndCb(ApiMac_mlmeAssociateInd_t *pData)
     /* Send response back to the device */
     ApiMac_mlmeAssociateRsp(&assocRsp);
 
+    if(assocRsp.status == ApiMac_assocStatus_success)
+    {
+        DevFilter_bindShort(&devInfo.extAddress, devInfo.shortAddress);
+    }
+
+    if(CONFIG_FH_ENABLE && (assocRsp.status == ApiMac_assocStatus_success))
+    {
+        updateTrickleJoinRate(true);
+    }
+
     if(macCallbacksCopy.pAssocIndCb != NULL)
     {
         /* pass back to MAC API */
@@ -1367,14 +1684,61 @@ static void wsAsyncIndCb(ApiMac_mlmeWsAsyncInd_t *pData)
 
 static void dataIndCb(ApiMac_mcpsDataInd_t *pData)
 {
+    if(DevFilter_admitFrame(&pData->srcAddr) == false)
+    {
+        /* Dropped before anything is parsed, stored or sent to the cloud */
+        return;
+    }
+
     Csf_updateFrameCounter(&pData->srcAddr, pData->frameCntr);
 
+    chanMonStats.current.rxFrames++;
+    chanMonLastActivity = Util_getTimeMs();
+
+    if((admitStats.numReturned < admitStats.numRestored)
+       && (pData->srcAddr.addrMode == ApiMac_addrType_short))
+    {
+        markDeviceReturned(findDevice(pData->srcAddr.addr.shortAddr));
+    }
+
     if(macCallbacksCopy.pDataIndCb != NULL)
     {
         macCallbacksCopy.pDataIndCb(pData);
     }
 }
 
+/*!
+ * @brief       Handle Data Confirm callback, count the transmissions for the
+ *              channel monitor
+ *
+ * @param       pData - pointer to Data Confirm
+ */
+static void dataCnfCb(ApiMac_mcpsDataCnf_t *pData)
+{
+    Cllc_txWindow_t *pWindow = &chanMonStats.current;
+
+    pWindow->txFrames++;
+    pWindow->retries += pData->retries;
+    if(pData->status == ApiMac_status_success)
+    {
+        pWindow->txSuccess++;
+    }
+    else if(pData->status == ApiMac_status_channelAccessFailure)
+    {
+        pWindow->channelAccessFailures++;
+    }
+    else if(pData->status == ApiMac_status_noAck)
+    {
+        pWindow->ackFailures++;
+    }
+    chanMonLastActivity = Util_getTimeMs();
+
+    if(macCallbacksCopy.pDataCnfCb != NULL)
+    {
+        macCallbacksCopy.pDataCnfCb(pData);
+    }
+}
+
 /*!
  * @brief      Find the associated device table entry matching an
  *             extended address.
@@ -1399,6 +1763,104 @@ static Cllc_associated_devices_t *findDevice(uint16_t shortAddr)
     return (NULL);
 }
 
+/*!
+ * @brief      Find the associated device table entry matching an
+ *             extended address.
+ *
+ * @param      pExtAddr - device's extended address
+ *
+ * @return     pointer to the associated device table entry,
+ *             NULL if not found.
+ */
+static Cllc_associated_devices_t *findDeviceExt(ApiMac_sAddrExt_t *pExtAddr)
+{
+    int x;
+
+    for(x = 0; (x < Cllc_numOfDevices); x++)
+    {
+        /* Make sure the entry is valid. */
+        if((Cllc_associatedDevList[x].shortAddr != INVALID_SHORT_ADDR)
+           && (memcmp(Cllc_associatedDevList[x].extAddr, pExtAddr,
+                      APIMAC_SADDR_EXT_LEN) == 0))
+        {
+            return (&Cllc_associatedDevList[x]);
+        }
+    }
+    return (NULL);
+}
+
+/*!
+ * @brief       Decide if a new device can associate. New devices are
+ *              admitted at CLLC_ADMIT_RATE per second and wait while known
+ *              devices are still returning, so that a network coming back
+ *              after a power outage recovers first.
+ *
+ * @return      admission decision
+ */
+static admitDecision_t admitNewDevice(void)
+{
+    uint32_t now = Util_getTimeMs();
+    uint32_t elapsed = now - admitRefillTime;
+
+    if((Cllc_numOfDevices == CONFIG_MAX_DEVICES)
+       && (findDevice(INVALID_SHORT_ADDR) == NULL))
+    {
+        return (admitDecision_full);
+    }
+
+    /* refill the tokens, CLLC_ADMIT_RATE thousandths per msec */
+    admitRefillTime = now;
+    if(elapsed > (CLLC_ADMIT_BURST * 1000 / CLLC_ADMIT_RATE))
+    {
+        elapsed = CLLC_ADMIT_BURST * 1000 / CLLC_ADMIT_RATE;
+    }
+    admitTokens += elapsed * CLLC_ADMIT_RATE;
+    if(admitTokens > (CLLC_ADMIT_BURST * 1000))
+    {
+        admitTokens = CLLC_ADMIT_BURST * 1000;
+    }
+
+    if((admitStats.numReturned < admitStats.numRestored)
+       && ((now - admitKnownTime) < CLLC_ADMIT_KNOWN_HOLDOFF))
+    {
+        return (admitDecision_defer);
+    }
+
+    if(admitTokens < 1000)
+    {
+        return (admitDecision_defer);
+    }
+    admitTokens -= 1000;
+    return (admitDecision_accept);
+}
+
+/*!
+ * @brief       Record that a restored device has been heard from again
+ *
+ * @param       pItem - association table entry of the device
+ */
+static void markDeviceReturned(Cllc_associated_devices_t *pItem)
+{
+    int idx;
+
+    if(pItem == NULL)
+    {
+        return;
+    }
+
+    idx = pItem - Cllc_associatedDevList;
+    if((idx < admitStats.numRestored)
+       && !(admitReturned[idx >> 3] & (1 << (idx & 7))))
+    {
+        admitReturned[idx >> 3] |= (1 << (idx & 7));
+        admitStats.numReturned++;
+        if(admitStats.numReturned == admitStats.numRestored)
+        {
+            admitStats.recoveryTime = Util_getTimeMs() - admitRestoreTime;
+        }
+    }
+}
+
 /*!
  * @brief       Process Orphan indication callback
  *
@@ -1412,7 +1874,8 @@ static void orphanIndCb(ApiMac_mlmeOrphanInd_t *pData)
     memcpy(&devAddr.addr.extAddr, &pData->orphanAddress,
            sizeof(ApiMac_sAddrExt_t));
 
-    if(Csf_getDevice(&devAddr, &item))
+    if((DevFilter_admitAssoc(&pData->orphanAddress) == true)
+       && Csf_getDevice(&devAddr, &item))
     {
         ApiMac_mlmeOrphanRsp_t orphanRsp;
 
@@ -1423,6 +1886,9 @@ static void orphanIndCb(ApiMac_mlmeOrphanInd_t *pData)
         orphanRsp.shortAddress = item.devInfo.shortAddress;
         ApiMac_mlmeOrphanRsp(&orphanRsp);
         maintainAssocTable(&item.devInfo, &item.capInfo, 1, 0, (true));
+        markDeviceReturned(findDevice(item.devInfo.shortAddress));
+        DevFilter_bindShort(&item.devInfo.extAddress,
+                            item.devInfo.shortAddress);
     }
 
     if(macCallbacksCopy.pOrphanIndCb != NULL)
@@ -1562,12 +2028,34 @@ static void joinPermitExpired(void)
     updateState(Cllc_states_joiningNotAllowed);
 }
 
+/*!
+ * @brief       Read the network information of the started coordinator
+ *
+ * @param       pNetworkInfo - place to put the network information
+ */
+static void getNetworkInfo(Llc_netInfo_t *pNetworkInfo)
+{
+    pNetworkInfo->fh = CONFIG_FH_ENABLE;
+    /* Setup basics */
+    ApiMac_mlmeGetReqUint8(ApiMac_attribute_logicalChannel,
+                           &pNetworkInfo->channel);
+    ApiMac_mlmeGetReqUint16(ApiMac_attribute_panId,
+                            &pNetworkInfo->devInfo.panID);
+    ApiMac_mlmeGetReqArray(ApiMac_attribute_extendedAddress,
+                           (uint8_t*)&pNetworkInfo->devInfo.extAddress);
+    ApiMac_mlmeGetReqUint16(ApiMac_attribute_shortAddress,
+                            &pNetworkInfo->devInfo.shortAddress);
+}
+
 /*!
  * @brief       Send Start Request
  *
  * @param       startFH - true if FH enable else false
+ * @param       coordRealign - true to move the running network to
+ *                             coordInfoBlock.channel with a coordinator
+ *                             realignment
  */
-static void sendStartReq(bool startFH)
+static void sendStartReq(bool startFH, bool coordRealign)
 {
     ApiMac_mlmeStartReq_t startReq;
     memset(&startReq, 0, sizeof(ApiMac_mlmeStartReq_t));
@@ -1582,7 +2070,7 @@ static void sendStartReq(bool startFH)
     startReq.superframeOrder = CONFIG_MAC_SUPERFRAME_ORDER;
     startReq.panCoordinator = true;
     startReq.batteryLifeExt = false;
-    startReq.coordRealignment = false;
+    startReq.coordRealignment = coordRealign;
     startReq.realignSec.securityLevel = false;
     startReq.startFH = startFH;
     startReq.mpmParams.offsetTimeSlot = CLLC_OFFSET_TIMESLOT;
@@ -1623,38 +2111,150 @@ static void sendScanReq(ApiMac_scantype_t type)
 }
 
 /*!
- * @brief       Set Trickle time
+ * @brief       Get the trickle timer of an async frame type
  *
- * @param       pTrickleTime - pointer to trickle time duration variable type
- *                            fhPAtrickleTime or fhPCtrickleTime
- * @param       frameType   - type of FH frame to be sent
+ * @param       frameType - type of async frame
+ *
+ * @return      pointer to the trickle timer
  */
-static void setTrickleTime(uint32_t *pTrickleTime, uint8_t frameType)
+static trickleTimer_t *getTrickle(uint8_t frameType)
 {
-    if(CONFIG_DOUBLE_TRICKLE_TIMER)
+    if(frameType == ApiMac_wisunAsyncFrame_advertisement)
     {
-        if((2 * (*pTrickleTime)) < CLLC_FH_MAX_TRICKLE)
+        return (&fhPAtrickle);
+    }
+    return (&fhPCtrickle);
+}
+
+/*!
+ * @brief       Begin a trickle interval, the transmission time t is picked
+ *              at random from the second half of the interval
+ *
+ * @param       frameType - type of async frame
+ * @param       interval - interval length I( in msec)
+ */
+static void startTrickleInterval(uint8_t frameType, uint32_t interval)
+{
+    trickleTimer_t *pTrickle = getTrickle(frameType);
+    uint16_t randomNum = ((ApiMac_randomByte() << 8) + ApiMac_randomByte());
+
+    pTrickle->interval = interval;
+    pTrickle->txTime = (interval >> 1) + (randomNum % (interval >> 1));
+    pTrickle->counter = 0;
+    pTrickle->txDone = false;
+
+    Csf_setTrickleClock(pTrickle->txTime, frameType);
+}
+
+/*!
+ * @brief       Process the trickle clock. At time t the frame is sent unless
+ *              k consistent frames were heard, at the end of the interval
+ *              the interval is doubled up to the maximum.
+ *
+ * @param       frameType - type of async frame
+ */
+static void processTrickleTimeout(uint8_t frameType)
+{
+    trickleTimer_t *pTrickle = getTrickle(frameType);
+
+    if(pTrickle->interval == 0)
+    {
+        return;
+    }
+
+    if(pTrickle->txDone == false)
+    {
+        pTrickle->txDone = true;
+        if(pTrickle->counter < CLLC_FH_TRICKLE_K)
+        {
+            sendAsyncReq(frameType);
+        }
+        else if(frameType == ApiMac_wisunAsyncFrame_advertisement)
+        {
+            Cllc_statistics.fhNumPASuppressed++;
+        }
+        else
+        {
+            Cllc_statistics.fhNumPANConfigSuppressed++;
+        }
+
+        /* wait for the end of the interval */
+        Csf_setTrickleClock(pTrickle->interval - pTrickle->txTime, frameType);
+    }
+    else if(CONFIG_DOUBLE_TRICKLE_TIMER)
+    {
+        uint32_t maxInterval;
+
+        updateTrickleJoinRate(false);
+        maxInterval = (uint32_t)CLLC_FH_MAX_TRICKLE << fhTrickleExtra;
+
+        if((2 * pTrickle->interval) < maxInterval)
         {
-            *pTrickleTime = 2 * (*pTrickleTime);
+            startTrickleInterval(frameType, 2 * pTrickle->interval);
         }
-        else if(((2 * (*pTrickleTime)) == CLLC_FH_MAX_TRICKLE) ||
-               ((2 * (*pTrickleTime)) > CLLC_FH_MAX_TRICKLE))
+        else
         {
-            (*pTrickleTime) = CLLC_FH_MAX_TRICKLE;
+            startTrickleInterval(frameType, maxInterval);
         }
-        /* Reset trickle timer */
-        Csf_setTrickleClock((*pTrickleTime),frameType);
     }
     else
     {
-        *pTrickleTime = 0;
+        /* without doubling the frame is only sent again on a solicit */
+        pTrickle->interval = 0;
     }
-    /* Process LLC Event */
-    sendAsyncReq(frameType);
 }
 
 /*!
- * @brief       Process incoming FH frame
+ * @brief       Track the join rate. Every window without a join doubles the
+ *              maximum trickle interval once more, a busy window brings it
+ *              back to CLLC_FH_MAX_TRICKLE and shortens longer intervals.
+ *
+ * @param       joined - true if a device has just associated
+ */
+static void updateTrickleJoinRate(bool joined)
+{
+    uint32_t now = Util_getTimeMs();
+
+    if(joined == true)
+    {
+        fhTrickleJoins++;
+        if((fhTrickleJoins >= CLLC_FH_TRICKLE_JOIN_BUSY)
+           && (fhTrickleExtra > 0))
+        {
+            fhTrickleExtra = 0;
+            if(fhPAtrickle.interval > CLLC_FH_MAX_TRICKLE)
+            {
+                startTrickleInterval(ApiMac_wisunAsyncFrame_advertisement,
+                                     CLLC_FH_MIN_TRICKLE);
+            }
+            if(fhPCtrickle.interval > CLLC_FH_MAX_TRICKLE)
+            {
+                startTrickleInterval(ApiMac_wisunAsyncFrame_config,
+                                     CLLC_FH_MIN_TRICKLE);
+            }
+        }
+    }
+
+    if((now - fhTrickleJoinStart) >= CLLC_FH_TRICKLE_JOIN_WINDOW)
+    {
+        if(fhTrickleJoins >= CLLC_FH_TRICKLE_JOIN_BUSY)
+        {
+            fhTrickleExtra = 0;
+        }
+        else if((fhTrickleJoins == 0)
+                && (fhTrickleExtra < CLLC_FH_TRICKLE_MAX_EXTRA))
+        {
+            fhTrickleExtra++;
+        }
+        fhTrickleJoins = 0;
+        fhTrickleJoinStart = now;
+    }
+}
+
+/*!
+ * @brief       Process incoming FH frame. Solicits are inconsistencies that
+ *              restart the trickle timer at the minimum interval, PA and PC
+ *              frames of this network are consistent and count towards k.
  *
  * @param       frameType   - type of FH frame to be sent
  */
@@ -1663,28 +2263,34 @@ static void processIncomingFHframe(uint8_t frameType)
 
     if(frameType == ApiMac_fhFrameType_panAdvertSolicit)
     {
-        if(fhPAtrickleTime != CLLC_FH_MIN_TRICKLE)
+        if(fhPAtrickle.interval != CLLC_FH_MIN_TRICKLE)
         {
-            fhPAtrickleTime = CLLC_FH_MIN_TRICKLE;
             /* reset trickle timer only if trickleTime not at Min */
-            Csf_setTrickleClock(fhPAtrickleTime,
-                                ApiMac_wisunAsyncFrame_advertisement);
+            startTrickleInterval(ApiMac_wisunAsyncFrame_advertisement,
+                                 CLLC_FH_MIN_TRICKLE);
         }
         /* PAS is received , increment statistics */
         Cllc_statistics.fhNumPASolicitReceived++;
     }
     else if(frameType == ApiMac_fhFrameType_configSolicit)
     {
-        if(fhPCtrickleTime != CLLC_FH_MIN_TRICKLE)
+        if(fhPCtrickle.interval != CLLC_FH_MIN_TRICKLE)
         {
-            fhPCtrickleTime = CLLC_FH_MIN_TRICKLE;
             /* reset trickle timer only if trickleTime not at Min */
-            Csf_setTrickleClock(fhPCtrickleTime,
-                                ApiMac_wisunAsyncFrame_config);
+            startTrickleInterval(ApiMac_wisunAsyncFrame_config,
+                                 CLLC_FH_MIN_TRICKLE);
         }
         /* PCS is received , increment statistics */
         Cllc_statistics.fhNumPANConfigSolicitsReceived++;
     }
+    else if(frameType == ApiMac_fhFrameType_panAdvert)
+    {
+        fhPAtrickle.counter++;
+    }
+    else if(frameType == ApiMac_fhFrameType_config)
+    {
+        fhPCtrickle.counter++;
+    }
 }
 
 /*!
@@ -1736,3 +2342,236 @@ static void processIncomingAsyncUSIE(uint8_t frameType, uint8_t* pIEContent)
         }
     }
 }
+
+/*!
+ * @brief       Channel monitor clock expired, start a background energy
+ *              detect scan once the network is quiet
+ */
+static void chanMonTimeout(void)
+{
+    uint32_t idleTime = Util_getTimeMs() - chanMonLastActivity;
+
+    if((chanMonScanning == true) || (chanMonMigrating == true)
+       || (coordInfoBlock.currentCoordState != Cllc_coordStates_startCnf))
+    {
+        return;
+    }
+
+    if((idleTime < CLLC_CHAN_MON_QUIET_TIME)
+       && (chanMonPostponed < CLLC_CHAN_MON_MAX_POSTPONE))
+    {
+        /* wait for a quiet period, the scan makes the coordinator deaf */
+        chanMonPostponed++;
+        Csf_setChanMonClock(CLLC_CHAN_MON_QUIET_TIME - idleTime);
+        return;
+    }
+
+    chanMonPostponed = 0;
+    chanMonSendScanReq();
+}
+
+/*!
+ * @brief       Send a short energy detect scan on the operating channel and
+ *              either the migration candidate or the next channels of the
+ *              channel mask
+ */
+static void chanMonSendScanReq(void)
+{
+    ApiMac_mlmeScanReq_t scanReq;
+    uint8_t numChannels = 1;
+    uint16_t count;
+
+    memset(chanMonScanMask, 0, sizeof(chanMonScanMask));
+    CLLC_SET_CHANNEL(chanMonScanMask, coordInfoBlock.channel);
+
+    if(chanMonCandidate != CLLC_CHAN_MON_NO_CANDIDATE)
+    {
+        CLLC_SET_CHANNEL(chanMonScanMask, chanMonCandidate);
+    }
+    else
+    {
+        for(count = 0; (count < APIMAC_154G_MAX_NUM_CHANNEL)
+            && (numChannels < CLLC_CHAN_MON_SCAN_CHANNELS); count++)
+        {
+            uint8_t chan = chanMonNextChan;
+
+            chanMonNextChan++;
+            if(chanMonNextChan >= APIMAC_154G_MAX_NUM_CHANNEL)
+            {
+                chanMonNextChan = 0;
+            }
+
+            if(CLLC_IS_CHANNEL_MASK_SET(chanMask, chan)
+               && (chan != coordInfoBlock.channel))
+            {
+                CLLC_SET_CHANNEL(chanMonScanMask, chan);
+                numChannels++;
+            }
+        }
+    }
+
+    memset(&scanReq, 0, sizeof(ApiMac_mlmeScanReq_t));
+    memcpy(scanReq.scanChannels, chanMonScanMask,
+           APIMAC_154G_CHANNEL_BITMAP_SIZ);
+    scanReq.scanType = ApiMac_scantype_energyDetect;
+    scanReq.scanDuration = CONFIG_CHANNEL_MONITOR_SCAN_DURATION;
+    scanReq.maxResults = 0;
+    scanReq.permitJoining = false;
+    scanReq.linkQuality = CONFIG_LINKQUALITY;
+    scanReq.percentFilter = CONFIG_PERCENTFILTER;
+    scanReq.channelPage = CONFIG_CHANNEL_PAGE;
+    scanReq.phyID = CONFIG_PHY_ID;
+    memset(&scanReq.sec, 0, sizeof(ApiMac_sec_t));
+
+    if(ApiMac_mlmeScanReq(&scanReq) == ApiMac_status_success)
+    {
+        chanMonScanning = true;
+    }
+    else
+    {
+        Csf_setChanMonClock(CONFIG_CHANNEL_MONITOR_INTERVAL);
+    }
+}
+
+/*!
+ * @brief       Process the results of a background scan. The energy on the
+ *              operating channel is correlated with the transmission failures
+ *              since the last scan, a sustained bad channel is replaced by
+ *              the quietest channel once a second scan confirms it.
+ *
+ * @param       pResults - energy detect results, indexed by channel
+ */
+static void chanMonScanCnf(uint8_t *pResults)
+{
+    uint8_t chan;
+    uint8_t curChan = coordInfoBlock.channel;
+    uint8_t curEnergy;
+    uint32_t txFrames;
+    uint32_t failures;
+    Cllc_txWindow_t *pCurrent = &chanMonStats.current;
+
+    for(chan = 0; chan < APIMAC_154G_MAX_NUM_CHANNEL; chan++)
+    {
+        if(CLLC_IS_CHANNEL_MASK_SET(chanMonScanMask, chan))
+        {
+            chanMonEnergy[chan] = pResults[chan];
+        }
+    }
+    curEnergy = chanMonEnergy[curChan];
+    chanMonStats.numScans++;
+    chanMonStats.lastEnergy = curEnergy;
+
+    /* transmissions since the last scan */
+    txFrames = pCurrent->txFrames - chanMonWindowBase.txFrames;
+    failures = (pCurrent->channelAccessFailures
+                - chanMonWindowBase.channelAccessFailures)
+               + (pCurrent->ackFailures - chanMonWindowBase.ackFailures);
+    memcpy(&chanMonWindowBase, pCurrent, sizeof(Cllc_txWindow_t));
+
+    if(chanMonCandidate != CLLC_CHAN_MON_NO_CANDIDATE)
+    {
+        chan = chanMonCandidate;
+        chanMonCandidate = CLLC_CHAN_MON_NO_CANDIDATE;
+        if((curEnergy > chanMonEnergy[chan])
+           && ((curEnergy - chanMonEnergy[chan])
+               >= CLLC_CHAN_MON_ENERGY_MARGIN))
+        {
+            chanMonMigrate(chan);
+            return;
+        }
+    }
+
+    /*
+     The channel is bad when the energy is high and the transmissions
+     suffer from it, with too little traffic the energy alone decides
+     */
+    if((curEnergy >= CLLC_CHAN_MON_ENERGY_THRESHOLD)
+       && ((txFrames < CLLC_CHAN_MON_MIN_TX)
+           || ((failures * 100) >= (txFrames * CLLC_CHAN_MON_FAILURE_PCT))))
+    {
+        chanMonStats.numBadWindows++;
+        chanMonBadWindows++;
+    }
+    else
+    {
+        chanMonBadWindows = 0;
+    }
+
+    if(chanMonHoldoff > 0)
+    {
+        chanMonHoldoff--;
+    }
+    else if(chanMonBadWindows >= CLLC_CHAN_MON_BAD_WINDOWS)
+    {
+        chan = findBestChannel(chanMonEnergy);
+        if((chan != curChan) && (curEnergy > chanMonEnergy[chan])
+           && ((curEnergy - chanMonEnergy[chan])
+               >= CLLC_CHAN_MON_ENERGY_MARGIN))
+        {
+            /* confirm the candidate with a fresh measurement */
+            chanMonCandidate = chan;
+            Csf_setChanMonClock(CLLC_CHAN_MON_QUIET_TIME);
+            return;
+        }
+    }
+
+    Csf_setChanMonClock(CONFIG_CHANNEL_MONITOR_INTERVAL);
+}
+
+/*!
+ * @brief       Move the network to a new channel. The coordinator realignment
+ *              reaches the devices with their receiver on, sleepy devices
+ *              find the network again with an orphan scan.
+ *
+ * @param       channel - new operating channel
+ */
+static void chanMonMigrate(uint8_t channel)
+{
+    chanMonMigrating = true;
+    chanMonPrevChannel = coordInfoBlock.channel;
+    coordInfoBlock.channel = channel;
+    sendStartReq(false, true);
+}
+
+/*!
+ * @brief       Complete a channel migration
+ *
+ * @param       success - true if the network moved to the new channel
+ */
+static void chanMonMigrated(bool success)
+{
+    chanMonMigrating = false;
+
+    if(success == true)
+    {
+        Llc_netInfo_t networkInfo = {0};
+        uint32_t now = Util_getTimeMs();
+
+        /* keep the counters of the old channel for comparison */
+        memcpy(&chanMonStats.beforeMigration, &chanMonStats.current,
+               sizeof(Cllc_txWindow_t));
+        chanMonStats.beforeMigration.duration = now - chanMonStartTime;
+        memset(&chanMonStats.current, 0, sizeof(Cllc_txWindow_t));
+        memset(&chanMonWindowBase, 0, sizeof(Cllc_txWindow_t));
+        chanMonStartTime = now;
+
+        chanMonStats.prevChannel = chanMonPrevChannel;
+        chanMonStats.numMigrations++;
+        chanMonBadWindows = 0;
+        chanMonHoldoff = CLLC_CHAN_MON_HOLDOFF_WINDOWS;
+
+        /* Inform the application of the new channel */
+        getNetworkInfo(&networkInfo);
+        if(pCllcCallbacksCopy && pCllcCallbacksCopy->pStartedCb)
+        {
+            pCllcCallbacksCopy->pStartedCb(&networkInfo);
+        }
+    }
+    else
+    {
+        coordInfoBlock.channel = chanMonPrevChannel;
+        chanMonStats.numMigrationFailures++;
+    }
+
+    Csf_setChanMonClock(CONFIG_CHANNEL_MONITOR_INTERVAL);
+}
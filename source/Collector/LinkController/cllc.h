@@ -70,6 +70,8 @@ extern "C"
 #define CLLC_JOIN_EVT           0x0004
 /*! Event ID - State change event */
 #define CLLC_STATE_CHANGE_EVT_EVT   0x0008
+/*! Event ID - Channel monitor event */
+#define CLLC_CHAN_MON_EVT       0x0010
 
 /*! Association status */
 #define CLLC_ASSOC_STATUS_ALIVE 0x0001
@@ -139,9 +141,75 @@ typedef struct
     uint32_t fhNumPANConfigSolicitsReceived;
     /*! number of PC messages sent */
     uint32_t fhNumPANConfigSent;
+    /*! number of PA messages suppressed by the trickle timer */
+    uint32_t fhNumPASuppressed;
+    /*! number of PC messages suppressed by the trickle timer */
+    uint32_t fhNumPANConfigSuppressed;
     uint32_t otherStats;
 } Cllc_statistics_t;
 
+/*! Transmissions of the coordinator over a period of time */
+typedef struct
+{
+    /*! Length of the period in milliseconds */
+    uint32_t duration;
+    /*! Frames sent, i.e. data confirms received */
+    uint32_t txFrames;
+    /*! Frames delivered */
+    uint32_t txSuccess;
+    /*! MAC retries needed for the frames sent */
+    uint32_t retries;
+    /*! Frames failed because of channel access failure */
+    uint32_t channelAccessFailures;
+    /*! Frames failed because the ACK was not received */
+    uint32_t ackFailures;
+    /*! Frames received */
+    uint32_t rxFrames;
+} Cllc_txWindow_t;
+
+/*! Channel monitor statistics */
+typedef struct
+{
+    /*! Number of background energy detect scans done */
+    uint32_t numScans;
+    /*! Number of scans that found interference on the operating channel */
+    uint32_t numBadWindows;
+    /*! Number of channel migrations done */
+    uint32_t numMigrations;
+    /*! Number of channel migrations rejected by the MAC */
+    uint32_t numMigrationFailures;
+    /*! Energy on the operating channel in the last scan */
+    uint8_t lastEnergy;
+    /*! Operating channel before the last migration */
+    uint8_t prevChannel;
+    /*! Transmissions on the operating channel */
+    Cllc_txWindow_t current;
+    /*! Transmissions on the channel used before the last migration */
+    Cllc_txWindow_t beforeMigration;
+} Cllc_chanMonStats_t;
+
+/*! Admission control statistics */
+typedef struct
+{
+    /*! Known devices that associated again */
+    uint32_t numKnown;
+    /*! New devices admitted */
+    uint32_t numAdmitted;
+    /*! Associations of new devices left unanswered to be retried later */
+    uint32_t numDeferred;
+    /*! New devices rejected because the association table is full */
+    uint32_t numAtCapacity;
+    /*! Devices restored from NV at the last restart */
+    uint16_t numRestored;
+    /*! Restored devices heard from since the last restart */
+    uint16_t numReturned;
+    /*!
+     Time from the restart until all restored devices were heard from, in
+     milliseconds, 0 while the recovery is in progress
+     */
+    uint32_t recoveryTime;
+} Cllc_admitStats_t;
+
 /*! Association table */
 extern Cllc_associated_devices_t Cllc_associatedDevList[CONFIG_MAX_DEVICES];
 /*! Cllc statistics */
@@ -232,7 +300,8 @@ extern void Csf_updateFrameCounter(ApiMac_sAddr_t *pDevAddr,
 /*!
  * @brief       Set trickle clock
  *
- * @param       trickleTime - duration of trickle timer( in msec)
+ * @param       trickleTime - time until the trickle timer expires( in msec),
+ *                            0 to stop it
  * @param       frameType - type of Async frame
  */
 extern void Csf_setTrickleClock(uint32_t trickleTime, uint8_t frameType);
@@ -257,6 +326,18 @@ extern void Csf_removeDeviceListItem(ApiMac_sAddrExt_t *pAddr);
  */
 extern void Csf_initializeTrickleClock(void);
 
+/*!
+ * @brief       Initialize the channel monitor clock
+ */
+extern void Csf_initializeChanMonClock(void);
+
+/*!
+ * @brief       Set the channel monitor clock
+ *
+ * @param       delay - time until the next channel check( in msec)
+ */
+extern void Csf_setChanMonClock(uint32_t delay);
+
 /*!
  * @brief       Initialize the clock setting join permit duration
  */
@@ -363,6 +444,40 @@ extern ApiMac_status_t Cllc_setJoinPermit(uint32_t duration);
  */
 extern void Cllc_sendDisassociationRequest(uint16_t shortAddr,bool rxOnIdle);
 
+/*!
+ * @brief       Get the channel monitor statistics.
+ *              <BR>
+ *              The background monitor runs short energy detect scans on
+ *              the operating channel when the network is quiet and moves
+ *              the network to a quieter channel when the energy and the
+ *              transmission failures stay high. Comparing current with
+ *              beforeMigration gives the throughput and retry rate before
+ *              and after the last migration.
+ *
+ * @param       pStats - place to put the statistics
+ */
+extern void Cllc_getChanMonStats(Cllc_chanMonStats_t *pStats);
+
+/*!
+ * @brief       Get the operating channel, the channel the network was started
+ *              on or migrated to. Not used with frequency hopping.
+ *
+ * @return      channel number
+ */
+extern uint8_t Cllc_getChannel(void);
+
+/*!
+ * @brief       Get the admission control statistics.
+ *              <BR>
+ *              Known devices are answered from the association table,
+ *              new devices are rate limited and wait while known devices
+ *              are returning. recoveryTime gives the time to full network
+ *              recovery after a restore.
+ *
+ * @param       pStats - place to put the statistics
+ */
+extern void Cllc_getAdmitStats(Cllc_admitStats_t *pStats);
+
 /*!
  * @brief       Initialize the MAC Security
  *
@@ -401,6 +516,19 @@ extern ApiMac_status_t Cllc_addSecDevice(uint16_t panID,
                                               ApiMac_sAddrExt_t *pExtAddr,
                                               uint32_t frameCounter);
 
+/*!
+ * @brief      Add a list of devices to the MAC security device table. The
+ *             entries are pipelined to the coprocessor, use this instead of
+ *             Cllc_addSecDevice() when restoring the device list.
+ *
+ * @param      numDevices - number of devices in pDevList
+ * @param      pDevList - pointer to the device list
+ *
+ * @return     status returned by ApiMac_secAddDeviceList()
+ */
+extern ApiMac_status_t Cllc_addSecDeviceList(uint16_t numDevices,
+                                             Llc_deviceListItem_t *pDevList);
+
 //*****************************************************************************
 //*****************************************************************************
 
@@ -0,0 +1,418 @@
+/******************************************************************************
+
+ @file airtime.c
+
+ @brief Airtime and duty cycle accounting
+
+ Group: WCS LPC
+ Target Device: CC13xx CC32xx
+
+ ******************************************************************************
+
+ Copyright (c) 2016-2017, Texas Instruments Incorporated
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions
+ are met:
+
+ *  Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+
+ *  Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+
+ *  Neither the name of Texas Instruments Incorporated nor the names of
+    its contributors may be used to endorse or promote products derived
+    from this software without specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+ ******************************************************************************
+ Release Name:
+ Release Date:
+ *****************************************************************************/
+
+/******************************************************************************
+ Includes
+ *****************************************************************************/
+#include <string.h>
+#include <Common/commonDefs.h>
+#include <Utils/util.h>
+#include <API_MAC/api_mac.h>
+#include "config.h"
+#include "LinkController/llc.h"
+#include "LinkController/cllc.h"
+#include "airtime.h"
+
+/******************************************************************************
+ Constants and definitions
+ *****************************************************************************/
+
+/* Frame control, sequence number and destination PAN ID */
+#define AIRTIME_MAC_HDR_LEN     5
+
+/* Security control and frame counter of the auxiliary security header */
+#define AIRTIME_SEC_HDR_LEN     5
+
+/* Duty cycle budget of the coordinator in microseconds per window */
+#define AIRTIME_BUDGET  ((uint32_t)CONFIG_DUTY_CYCLE_LIMIT * AIRTIME_WINDOW_TIME)
+
+/******************************************************************************
+ Structures
+ *****************************************************************************/
+
+/* Sliding window of air time, in microseconds */
+typedef struct
+{
+    uint32_t bucket[AIRTIME_NUM_BUCKETS];
+    uint32_t total;
+} airtimeWindow_t;
+
+/******************************************************************************
+ Local variables
+ *****************************************************************************/
+
+/* Transmissions of the coordinator */
+static airtimeWindow_t coordWindow;
+
+/* Transmissions of each device */
+static airtimeWindow_t devWindows[CONFIG_MAX_DEVICES];
+
+/* Short address each device window belongs to */
+static uint16_t devWindowAddr[CONFIG_MAX_DEVICES];
+
+/* All the frames of the network on each channel */
+static airtimeWindow_t chanWindows[APIMAC_154G_MAX_NUM_CHANNEL];
+
+/* Bucket being filled and the time it started */
+static uint8_t curBucket = 0;
+static uint32_t bucketStart = 0;
+
+/* Air time of the frames handed to the CoP and not confirmed yet */
+static uint32_t pendingTx = 0;
+
+/* Key identifier field length of each key identifier mode */
+static const uint8_t keyIdLen[] = { 0, 1, 5, 9 };
+
+/* MIC length of each security level, the low 2 bits */
+static const uint8_t micLen[] = { 0, 4, 8, 16 };
+
+/******************************************************************************
+ Local function prototypes
+ *****************************************************************************/
+static void advance(void);
+static void clearBucket(airtimeWindow_t *pWindow, uint8_t bucket);
+static void charge(airtimeWindow_t *pWindow, uint32_t airTime);
+static airtimeWindow_t *deviceWindow(uint8_t devIdx);
+static uint16_t dutyCycle(airtimeWindow_t *pWindow);
+
+/******************************************************************************
+ Public Functions
+ *****************************************************************************/
+
+/*!
+ Clear all the windows
+
+ Public function defined in airtime.h
+ */
+void Airtime_init(void)
+{
+    memset(&coordWindow, 0, sizeof(coordWindow));
+    memset(devWindows, 0, sizeof(devWindows));
+    memset(devWindowAddr, 0xFF, sizeof(devWindowAddr));
+    memset(chanWindows, 0, sizeof(chanWindows));
+    curBucket = 0;
+    bucketStart = Util_getTimeMs();
+    pendingTx = 0;
+}
+
+/*!
+ Get the length of the PSDU of a data frame
+
+ Public function defined in airtime.h
+ */
+uint16_t Airtime_psduLen(ApiMac_addrType_t dstAddrMode,
+                         ApiMac_addrType_t srcAddrMode,
+                         ApiMac_sec_t *pSec, uint16_t payloadLen)
+{
+    uint16_t len = AIRTIME_MAC_HDR_LEN + payloadLen + AIRTIME_FCS_LEN;
+
+    /* The source PAN ID is compressed */
+    len += (dstAddrMode == ApiMac_addrType_extended) ?
+                    APIMAC_SADDR_EXT_LEN :
+           (dstAddrMode == ApiMac_addrType_short) ? 2 : 0;
+    len += (srcAddrMode == ApiMac_addrType_extended) ?
+                    APIMAC_SADDR_EXT_LEN :
+           (srcAddrMode == ApiMac_addrType_short) ? 2 : 0;
+
+    if((pSec != NULL) && (pSec->securityLevel != ApiMac_secLevel_none))
+    {
+        len += AIRTIME_SEC_HDR_LEN + keyIdLen[pSec->keyIdMode & 0x03]
+               + micLen[pSec->securityLevel & 0x03];
+    }
+
+    return (len);
+}
+
+/*!
+ Get the time a frame is on the air
+
+ Public function defined in airtime.h
+ */
+uint32_t Airtime_frameTime(uint16_t psduLen)
+{
+    return (((uint32_t)(AIRTIME_PHY_OVERHEAD + psduLen) * 8000000UL)
+            / AIRTIME_BIT_RATE);
+}
+
+/*!
+ Check a downlink frame against the duty cycle budget
+
+ Public function defined in airtime.h
+ */
+bool Airtime_admitTx(uint32_t airTime)
+{
+    if(CONFIG_DUTY_CYCLE_LIMIT != 0)
+    {
+        advance();
+        if((coordWindow.total + pendingTx + airTime) > AIRTIME_BUDGET)
+        {
+            return (false);
+        }
+    }
+
+    pendingTx += airTime;
+    return (true);
+}
+
+/*!
+ Charge the transmissions of a confirmed downlink frame
+
+ Public function defined in airtime.h
+ */
+void Airtime_txDone(uint8_t devIdx, uint8_t channel, uint32_t airTime,
+                    uint8_t numTx, bool acked)
+{
+    uint32_t txTime = airTime * numTx;
+    uint32_t ackTime = 0;
+
+    pendingTx = (pendingTx > airTime) ? (pendingTx - airTime) : 0;
+
+    if(numTx == 0)
+    {
+        return;
+    }
+
+    advance();
+
+    charge(&coordWindow, txTime);
+    if(acked == true)
+    {
+        ackTime = Airtime_frameTime(AIRTIME_ACK_PSDU_LEN);
+        charge(deviceWindow(devIdx), ackTime);
+    }
+    if(channel < APIMAC_154G_MAX_NUM_CHANNEL)
+    {
+        charge(&chanWindows[channel], txTime + ackTime);
+    }
+}
+
+/*!
+ Charge a received frame
+
+ Public function defined in airtime.h
+ */
+void Airtime_rx(uint8_t devIdx, uint8_t channel, uint32_t airTime,
+                bool acked)
+{
+    uint32_t ackTime = 0;
+
+    advance();
+
+    charge(deviceWindow(devIdx), airTime);
+    if(acked == true)
+    {
+        ackTime = Airtime_frameTime(AIRTIME_ACK_PSDU_LEN);
+        charge(&coordWindow, ackTime);
+    }
+    if(channel < APIMAC_154G_MAX_NUM_CHANNEL)
+    {
+        charge(&chanWindows[channel], airTime + ackTime);
+    }
+}
+
+/*!
+ Get the time until the oldest bucket expires
+
+ Public function defined in airtime.h
+ */
+uint32_t Airtime_nextRelease(void)
+{
+    uint32_t elapsed;
+
+    advance();
+    elapsed = Util_getTimeMs() - bucketStart;
+
+    return ((elapsed < AIRTIME_BUCKET_TIME) ?
+                    (AIRTIME_BUCKET_TIME - elapsed) : 1);
+}
+
+/*!
+ Get the duty cycle of the coordinator
+
+ Public function defined in airtime.h
+ */
+uint16_t Airtime_coordDuty(void)
+{
+    advance();
+    return (dutyCycle(&coordWindow));
+}
+
+/*!
+ Get the duty cycle of a device
+
+ Public function defined in airtime.h
+ */
+uint16_t Airtime_deviceDuty(uint8_t devIdx)
+{
+    airtimeWindow_t *pWindow;
+
+    advance();
+    pWindow = deviceWindow(devIdx);
+    return ((pWindow != NULL) ? dutyCycle(pWindow) : 0);
+}
+
+/*!
+ Get the occupancy of a channel
+
+ Public function defined in airtime.h
+ */
+uint16_t Airtime_channelDuty(uint8_t channel)
+{
+    if(channel >= APIMAC_154G_MAX_NUM_CHANNEL)
+    {
+        return (0);
+    }
+
+    advance();
+    return (dutyCycle(&chanWindows[channel]));
+}
+
+/******************************************************************************
+ Local Functions
+ *****************************************************************************/
+
+/*!
+ * @brief       Move the windows to the current time. The expired buckets of
+ *              all the windows are cleared together, at most once per
+ *              bucket time, so charging a frame stays O(1).
+ */
+static void advance(void)
+{
+    uint32_t now = Util_getTimeMs();
+    uint8_t i;
+
+    if((now - bucketStart) >= AIRTIME_WINDOW_TIME)
+    {
+        /* Nothing was charged for a whole window */
+        memset(&coordWindow, 0, sizeof(coordWindow));
+        memset(devWindows, 0, sizeof(devWindows));
+        memset(chanWindows, 0, sizeof(chanWindows));
+        bucketStart = now;
+        return;
+    }
+
+    while((now - bucketStart) >= AIRTIME_BUCKET_TIME)
+    {
+        curBucket = (curBucket + 1) % AIRTIME_NUM_BUCKETS;
+        bucketStart += AIRTIME_BUCKET_TIME;
+
+        clearBucket(&coordWindow, curBucket);
+        for(i = 0; i < CONFIG_MAX_DEVICES; i++)
+        {
+            clearBucket(&devWindows[i], curBucket);
+        }
+        for(i = 0; i < APIMAC_154G_MAX_NUM_CHANNEL; i++)
+        {
+            clearBucket(&chanWindows[i], curBucket);
+        }
+    }
+}
+
+/*!
+ * @brief       Drop a bucket from a window
+ *
+ * @param       pWindow - window
+ * @param       bucket - bucket to drop
+ */
+static void clearBucket(airtimeWindow_t *pWindow, uint8_t bucket)
+{
+    pWindow->total -= pWindow->bucket[bucket];
+    pWindow->bucket[bucket] = 0;
+}
+
+/*!
+ * @brief       Add air time to the current bucket of a window
+ *
+ * @param       pWindow - window, NULL to charge nothing
+ * @param       airTime - air time in microseconds
+ */
+static void charge(airtimeWindow_t *pWindow, uint32_t airTime)
+{
+    if(pWindow != NULL)
+    {
+        pWindow->bucket[curBucket] += airTime;
+        pWindow->total += airTime;
+    }
+}
+
+/*!
+ * @brief       Get the window of a device, a reused association table slot
+ *              starts with an empty window
+ *
+ * @param       devIdx - index of the device in the association table
+ *
+ * @return      pointer to the window, NULL if the index is not valid
+ */
+static airtimeWindow_t *deviceWindow(uint8_t devIdx)
+{
+    uint16_t shortAddr;
+
+    if(devIdx >= CONFIG_MAX_DEVICES)
+    {
+        return (NULL);
+    }
+
+    shortAddr = Cllc_associatedDevList[devIdx].shortAddr;
+    if(devWindowAddr[devIdx] != shortAddr)
+    {
+        memset(&devWindows[devIdx], 0, sizeof(airtimeWindow_t));
+        devWindowAddr[devIdx] = shortAddr;
+    }
+    return (&devWindows[devIdx]);
+}
+
+/*!
+ * @brief       Get the duty cycle of a window
+ *
+ * @param       pWindow - window
+ *
+ * @return      air time over the window length, in per mille
+ */
+static uint16_t dutyCycle(airtimeWindow_t *pWindow)
+{
+    /* microseconds per millisecond of window is per mille */
+    return ((uint16_t)(pWindow->total / AIRTIME_WINDOW_TIME));
+}
@@ -0,0 +1,217 @@
+/******************************************************************************
+
+ @file airtime.h
+
+ @brief Airtime and duty cycle accounting
+
+ Group: WCS LPC
+ Target Device: CC13xx CC32xx
+
+ ******************************************************************************
+
+ Copyright (c) 2016-2017, Texas Instruments Incorporated
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions
+ are met:
+
+ *  Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+
+ *  Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+
+ *  Neither the name of Texas Instruments Incorporated nor the names of
+    its contributors may be used to endorse or promote products derived
+    from this software without specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+ ******************************************************************************
+ Release Name:
+ Release Date:
+ *****************************************************************************/
+
+#ifndef COLLECTOR_AIRTIME_H_
+#define COLLECTOR_AIRTIME_H_
+//*****************************************************************************
+//
+// If building with a C++ compiler, make all of the definitions in this header
+// have a C binding.
+//
+//*****************************************************************************
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <API_MAC/api_mac.h>
+#include "config.h"
+
+/******************************************************************************
+ Constants and definitions
+ *****************************************************************************/
+
+/*! Number of buckets of the sliding window */
+#define AIRTIME_NUM_BUCKETS     6
+
+/*! Length of a bucket in milliseconds, the window is one hour */
+#define AIRTIME_BUCKET_TIME     600000
+
+/*! Length of the sliding window in milliseconds */
+#define AIRTIME_WINDOW_TIME     (AIRTIME_NUM_BUCKETS * AIRTIME_BUCKET_TIME)
+
+/*! Bit rate of the PHY in bits per second */
+#if ((CONFIG_PHY_ID >= APIMAC_GENERIC_US_LRM_915_PHY_129) && \
+     (CONFIG_PHY_ID <= APIMAC_GENERIC_ETSI_LRM_863_PHY_131))
+/* Long range mode, after FEC and spreading */
+#define AIRTIME_BIT_RATE        5000
+#elif ((CONFIG_PHY_ID == APIMAC_GENERIC_US_915_PHY_132) || \
+       (CONFIG_PHY_ID == APIMAC_GENERIC_ETSI_863_PHY_133))
+#define AIRTIME_BIT_RATE        200000
+#else
+#define AIRTIME_BIT_RATE        50000
+#endif
+
+/*! Synchronization header (4 byte preamble, 2 byte SFD) and 2 byte PHR */
+#define AIRTIME_PHY_OVERHEAD    8
+
+/*! Frame check sequence, 802.15.4g uses the 4 byte CRC by default */
+#define AIRTIME_FCS_LEN         4
+
+/*! PSDU length of an immediate ACK */
+#define AIRTIME_ACK_PSDU_LEN    (3 + AIRTIME_FCS_LEN)
+
+/*! Device index of frames that are not charged to a device */
+#define AIRTIME_NO_DEVICE       0xFF
+
+/*! Channel of frames that are not charged to a channel (frequency hopping) */
+#define AIRTIME_NO_CHANNEL      0xFF
+
+/******************************************************************************
+ Function Prototypes
+ *****************************************************************************/
+
+/*!
+ * @brief       Clear all the windows
+ */
+extern void Airtime_init(void);
+
+/*!
+ * @brief       Get the length of the PSDU of a data frame
+ *
+ * @param       dstAddrMode - destination address mode
+ * @param       srcAddrMode - source address mode
+ * @param       pSec - security parameters of the frame
+ * @param       payloadLen - length of the MAC payload, including payload IEs
+ *
+ * @return      PSDU length in bytes
+ */
+extern uint16_t Airtime_psduLen(ApiMac_addrType_t dstAddrMode,
+                                ApiMac_addrType_t srcAddrMode,
+                                ApiMac_sec_t *pSec, uint16_t payloadLen);
+
+/*!
+ * @brief       Get the time a frame is on the air
+ *
+ * @param       psduLen - length of the PSDU
+ *
+ * @return      on-air time in microseconds
+ */
+extern uint32_t Airtime_frameTime(uint16_t psduLen);
+
+/*!
+ * @brief       Check if a downlink frame fits the duty cycle budget of the
+ *              coordinator and reserve its air time until it is confirmed
+ *              with Airtime_txDone()
+ *
+ * @param       airTime - on-air time of the frame in microseconds
+ *
+ * @return      true if the frame can be sent, false if it would exceed
+ *              CONFIG_DUTY_CYCLE_LIMIT
+ */
+extern bool Airtime_admitTx(uint32_t airTime);
+
+/*!
+ * @brief       Release the reservation of a downlink frame and charge the
+ *              transmissions that were made
+ *
+ * @param       devIdx - index of the destination in the association table,
+ *                       AIRTIME_NO_DEVICE for a broadcast
+ * @param       channel - operating channel or AIRTIME_NO_CHANNEL
+ * @param       airTime - on-air time of the frame in microseconds
+ * @param       numTx - number of transmissions, 0 if never sent
+ * @param       acked - true if the destination sent an ACK
+ */
+extern void Airtime_txDone(uint8_t devIdx, uint8_t channel, uint32_t airTime,
+                           uint8_t numTx, bool acked);
+
+/*!
+ * @brief       Charge a received frame
+ *
+ * @param       devIdx - index of the source in the association table,
+ *                       AIRTIME_NO_DEVICE if not known
+ * @param       channel - operating channel or AIRTIME_NO_CHANNEL
+ * @param       airTime - on-air time of the frame in microseconds
+ * @param       acked - true if the coordinator sent an ACK
+ */
+extern void Airtime_rx(uint8_t devIdx, uint8_t channel, uint32_t airTime,
+                       bool acked);
+
+/*!
+ * @brief       Get the time until the oldest part of the window expires and
+ *              deferred frames can be tried again
+ *
+ * @return      time in milliseconds
+ */
+extern uint32_t Airtime_nextRelease(void);
+
+/*!
+ * @brief       Get the duty cycle of the coordinator transmissions
+ *
+ * @return      duty cycle over the window, in per mille
+ */
+extern uint16_t Airtime_coordDuty(void);
+
+/*!
+ * @brief       Get the duty cycle of the transmissions of a device
+ *
+ * @param       devIdx - index of the device in the association table
+ *
+ * @return      duty cycle over the window, in per mille
+ */
+extern uint16_t Airtime_deviceDuty(uint8_t devIdx);
+
+/*!
+ * @brief       Get the occupancy of a channel by the network
+ *
+ * @param       channel - channel number
+ *
+ * @return      air time used over the window, in per mille
+ */
+extern uint16_t Airtime_channelDuty(uint8_t channel);
+
+//*****************************************************************************
+//
+// Mark the end of the C bindings section for C++ compilers.
+//
+//*****************************************************************************
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* COLLECTOR_AIRTIME_H_ */
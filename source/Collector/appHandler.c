@@ -48,7 +48,9 @@
   Includes
 *****************************************************************************/
 
+#define LOG_MODULE LogModule_COLLECTOR
 #include "Utils/uart_term.h"
+#include "Utils/util.h"
 #include "pthread.h"
 #include "mqueue.h"
 #include "Common/commonDefs.h"
@@ -74,7 +76,7 @@
 /*******************************************************************
  * LOCAL VARIABLES
  ********************************************************************/
-static mqd_t *appHCliMq;
+static MsgLane_t **appHCliMq;
 
 ///*******************************************************************
 // * LOCAL FUNCTIONS
@@ -201,7 +203,7 @@ void appsrv_networkUpdate(bool restored, Llc_netInfo_t *networkInfo)
 
     queueElement.event = GatewayEvent_NWK_UPDATE;
     queueElement.msgPtr = pNwk;
-    mq_send(*appHCliMq, (char*) &queueElement, sizeof(msgQueue_t), 0);
+    MsgLane_send(*appHCliMq, &queueElement);
 }
 
 /*!
@@ -223,11 +225,12 @@ void appsrv_deviceUpdate(Llc_deviceListItem_t *pDevListItem)
     pDev->rssi = 0;
     pDev->active = true;
     pDev->objectCount = 0;
+    pDev->rxTime = Util_getTimeMs();
 
     msgQueue_t queueElement;
     queueElement.event = GatewayEvent_DEV_UPDATE;
     queueElement.msgPtr =  pDev;
-    mq_send(*appHCliMq, (char*) &queueElement, sizeof(msgQueue_t), 0);
+    MsgLane_send(*appHCliMq, &queueElement);
 }
 
 /*!
@@ -252,11 +255,12 @@ void appsrv_deviceConfigUpdate(ApiMac_sAddr_t *pSrcAddr, int8_t rssi,
         memcpy(pDev->extAddr, pSrcAddr->addr.extAddr, APIMAC_SADDR_EXT_LEN);
     }
     pDev->rssi = (signed int) rssi;
+    pDev->rxTime = Util_getTimeMs();
 
     msgQueue_t queueElement;
     queueElement.event = GatewayEvent_DEV_CNF_UPDATE;
     queueElement.msgPtr = pDev;
-    mq_send(*appHCliMq, (char*) &queueElement, sizeof(msgQueue_t), 0);
+    MsgLane_send(*appHCliMq, &queueElement);
 }
 /*!
   Csf module calls this function to inform the user/appClient
@@ -277,11 +281,34 @@ void appsrv_deviceNotActiveUpdate(ApiMac_deviceDescriptor_t *pDevInfo,
     pDev->rssi = 0;
     pDev->topic = NULL;
     pDev->active = false;
+    pDev->rxTime = Util_getTimeMs();
 
     msgQueue_t queueElement;
     queueElement.event = GatewayEvent_DEV_NOT_ACTIVE;
     queueElement.msgPtr = pDev;
-    mq_send(*appHCliMq, (char*) &queueElement, sizeof(msgQueue_t), 0);
+    MsgLane_send(*appHCliMq, &queueElement);
+}
+
+/*!
+  Csf module calls this function to inform the user/appClient
+  that a device left the network
+
+  Public function defined in appHandler.h
+*/
+void appsrv_deviceRemoveUpdate(ApiMac_sAddrExt_t *pExtAddr)
+{
+    dev_t *pDev;
+    pDev = (dev_t*) malloc(sizeof(dev_t));
+
+    memset(pDev, 0, sizeof(dev_t));
+    memcpy(pDev->extAddr, pExtAddr, APIMAC_SADDR_EXT_LEN);
+    pDev->shortAddr = 0xFFFF;
+    pDev->rxTime = Util_getTimeMs();
+
+    msgQueue_t queueElement;
+    queueElement.event = GatewayEvent_DEV_REMOVED;
+    queueElement.msgPtr = pDev;
+    MsgLane_send(*appHCliMq, &queueElement);
 }
 
 /*!
@@ -291,6 +318,7 @@ void appsrv_deviceNotActiveUpdate(ApiMac_deviceDescriptor_t *pDevInfo,
   Public function defined in appsrv_Collector.h
 */
 void appsrv_deviceSensorDataUpdate(ApiMac_sAddr_t *pSrcAddr, int8_t rssi,
+                                   uint32_t rxTime,
                                    Smsgs_sensorMsg_t *pSensorMsg)
 {
     dev_t *pDev;
@@ -308,6 +336,7 @@ void appsrv_deviceSensorDataUpdate(ApiMac_sAddr_t *pSrcAddr, int8_t rssi,
     }
     memcpy(pDev->extAddr, pSensorMsg->extAddress, APIMAC_SADDR_EXT_LEN);
     pDev->rssi = (signed int) rssi;
+    pDev->rxTime = rxTime;
     pDev->object[0].typeId = LIGHT_TYPE_ID;//light type
     pDev->object[0].sensorVal = 0.0;
     pDev->object[0].unit[0] = '\0';
@@ -420,7 +449,7 @@ void appsrv_deviceSensorDataUpdate(ApiMac_sAddr_t *pSrcAddr, int8_t rssi,
     msgQueue_t queueElement;
     queueElement.event = GatewayEvent_SENSOR_DATA_UPDATE;
     queueElement.msgPtr = pDev;
-    mq_send(*appHCliMq, (char*) &queueElement, sizeof(msgQueue_t), 0);
+    MsgLane_send(*appHCliMq, &queueElement);
 }
 
 /*!
@@ -437,11 +466,81 @@ void appsrv_stateChangeUpdate(Cllc_states_t state)
     msgQueue_t queueElement;
     queueElement.event = GatewayEvent_NWK_STATE_CHANGE;
     queueElement.msgPtr = pNwk;
-    mq_send(*appHCliMq, (char*) &queueElement, sizeof(msgQueue_t), 0);
+    MsgLane_send(*appHCliMq, &queueElement);
+}
+
+/*!
+  The OAD server calls this function to report the download progress
+  of a device
+
+  Public function defined in appHandler.h
+*/
+void appsrv_oadProgressUpdate(OadServer_progress_t *pProgress)
+{
+    OadServer_progress_t *pOad;
+    pOad = (OadServer_progress_t*) malloc(sizeof(OadServer_progress_t));
+    memcpy(pOad, pProgress, sizeof(OadServer_progress_t));
+
+    msgQueue_t queueElement;
+    queueElement.event = GatewayEvent_OAD_UPDATE;
+    queueElement.msgPtr = pOad;
+    MsgLane_send(*appHCliMq, &queueElement);
+}
+
+/*!
+  The delivery manager calls this function to report the final outcome
+  of a command
+
+  Public function defined in appHandler.h
+*/
+void appsrv_deliveryUpdate(Delivery_outcome_t *pOutcome)
+{
+    Delivery_outcome_t *pDelivery;
+    pDelivery = (Delivery_outcome_t*) malloc(sizeof(Delivery_outcome_t));
+    memcpy(pDelivery, pOutcome, sizeof(Delivery_outcome_t));
+
+    msgQueue_t queueElement;
+    queueElement.event = GatewayEvent_DELIVERY_UPDATE;
+    queueElement.msgPtr = pDelivery;
+    MsgLane_send(*appHCliMq, &queueElement);
+}
+
+/*!
+  The collector calls this function to pass a ramp benchmark frame on to
+  the gateway
+
+  Public function defined in appHandler.h
+*/
+void appsrv_rampData(RampBench_frame_t *pFrame)
+{
+    RampBench_frame_t *pRamp;
+    pRamp = (RampBench_frame_t*) malloc(sizeof(RampBench_frame_t));
+    memcpy(pRamp, pFrame, sizeof(RampBench_frame_t));
+
+    msgQueue_t queueElement;
+    queueElement.event = GatewayEvent_RAMP_DATA;
+    queueElement.msgPtr = pRamp;
+    MsgLane_send(*appHCliMq, &queueElement);
 }
 
+/*!
+  The ramp benchmark calls this function to report the results of a step
+
+  Public function defined in appHandler.h
+*/
+void appsrv_rampReport(RampBench_report_t *pReport)
+{
+    RampBench_report_t *pRamp;
+    pRamp = (RampBench_report_t*) malloc(sizeof(RampBench_report_t));
+    memcpy(pRamp, pReport, sizeof(RampBench_report_t));
+
+    msgQueue_t queueElement;
+    queueElement.event = GatewayEvent_RAMP_REPORT;
+    queueElement.msgPtr = pRamp;
+    MsgLane_send(*appHCliMq, &queueElement);
+}
 
-void appCliMqReg(mqd_t *pAppCliMq)
+void appCliMqReg(MsgLane_t **pAppCliMq)
 {
      appHCliMq = pAppCliMq;
 
@@ -50,6 +50,10 @@
 #include <string.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include "Utils/msgLane.h"
+#include "oadServer.h"
+#include "delivery.h"
+#include "rampBench.h"
 
 /******************************************************************************
  Typedefs
@@ -58,7 +62,7 @@
 /******************************************************************************
  Function Prototypes
  *****************************************************************************/
-void appCliMqReg(mqd_t *pAppCliMq);
+void appCliMqReg(MsgLane_t **pAppCliMq);
 
 
 /*
@@ -118,6 +122,15 @@ void APP_main(const char *appSrvMqName);
  */
  void appsrv_deviceNotActiveUpdate(ApiMac_deviceDescriptor_t *pDevInfo,
                                       bool timeout);
+
+/*!
+ * @brief        Csf module calls this function to inform the application
+ *               client that a device left the network and was removed from
+ *               the device list
+ *
+ * @param        pExtAddr - extended address of the device
+ */
+ void appsrv_deviceRemoveUpdate(ApiMac_sAddrExt_t *pExtAddr);
   /*!
  * @brief        Csf module calls this function to inform the applicaiton client
                          of the reported sensor data from a network device
@@ -127,7 +140,7 @@ void APP_main(const char *appSrvMqName);
  * @return
  */
  void appsrv_deviceSensorDataUpdate(ApiMac_sAddr_t *pSrcAddr, int8_t rssi,
-                                       Smsgs_sensorMsg_t *pMsg);
+                                       uint32_t rxTime, Smsgs_sensorMsg_t *pMsg);
 
 /*!
  * @brief        TBD
@@ -138,3 +151,35 @@ void APP_main(const char *appSrvMqName);
  */
  void appsrv_stateChangeUpdate(Cllc_states_t state);
 
+/*!
+ * @brief        The OAD server calls this function to report the download
+ *               progress of a device
+ *
+ * @param        pProgress - download progress, copied
+ */
+ void appsrv_oadProgressUpdate(OadServer_progress_t *pProgress);
+
+/*!
+ * @brief        The delivery manager calls this function to report the
+ *               final outcome of a command sent to a device
+ *
+ * @param        pOutcome - outcome of the command, copied
+ */
+ void appsrv_deliveryUpdate(Delivery_outcome_t *pOutcome);
+
+/*!
+ * @brief        The collector calls this function to pass a ramp benchmark
+ *               frame on to the gateway
+ *
+ * @param        pFrame - benchmark frame, copied
+ */
+ void appsrv_rampData(RampBench_frame_t *pFrame);
+
+/*!
+ * @brief        The ramp benchmark calls this function to report the
+ *               results of a step
+ *
+ * @param        pReport - results of the step, copied
+ */
+ void appsrv_rampReport(RampBench_report_t *pReport);
+
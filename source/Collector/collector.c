@@ -54,6 +54,7 @@
 #include <Common/commonDefs.h>
 
 #include <Utils/uart_term.h>
+#include <Utils/mqStats.h>
 #include <NPI/npiParse.h>
 #include <NPIcmds/mtSys.h>
 #include <API_MAC/api_mac.h>
@@ -63,6 +64,17 @@
 #include "smsgs.h"
 #include "csf.h"
 #include "appHandler.h"
+#include "linkStats.h"
+#include "indirectQueue.h"
+#include "devGroups.h"
+#include "devFilter.h"
+#include "reportCtrl.h"
+#include "airtime.h"
+#include "delivery.h"
+#include "rampBench.h"
+#include "inFlight.h"
+#include "oadServer.h"
+#include "oadImage.h"
 #include "collector.h"
 
 
@@ -90,8 +102,8 @@
 /* MAC Indirect Persistent Timeout */
 #define INDIRECT_PERSISTENT_TIME 750
 
-/* default MSDU Handle rollover */
-#define MSDU_HANDLE_MAX 0x3F
+/* MSDU handle bits given out by the in-flight table */
+#define MSDU_HANDLE_MAX (INFLIGHT_NUM_HANDLES - 1)
 
 /* App marker in MSDU handle */
 #define APP_MARKER_MSDU_HANDLE 0x80
@@ -161,11 +173,17 @@ STATIC Cllc_states_t cllcState = Cllc_states_initWaiting;
 /*! Device's PAN ID */
 STATIC uint16_t devicePanId = 0xFFFF;
 
-/*! Device's Outgoing MSDU Handle values */
-STATIC uint8_t deviceTxMsduHandle = 0;
-
 STATIC bool fhEnabled = false;
 
+/*! true if frames to sleepy devices were held back by the in-flight limit */
+STATIC bool inFlightHeld = false;
+
+/*! true while the in-flight sweep clock is running */
+STATIC bool inFlightSweep = false;
+
+/*! Device the next interval update search starts at */
+STATIC uint8_t reportCtrlNextDev = 0;
+
 Llc_netInfo_t coordInfo;
 
 /******************************************************************************
@@ -186,13 +204,37 @@ static void processConfigResponse(ApiMac_mcpsDataInd_t *pDataInd);
 static void processTrackingResponse(ApiMac_mcpsDataInd_t *pDataInd);
 static void processToggleLedResponse(ApiMac_mcpsDataInd_t *pDataInd);
 static void processSensorData(ApiMac_mcpsDataInd_t *pDataInd);
+static void processRampData(ApiMac_mcpsDataInd_t *pDataInd);
+static void forwardRampData(RampBench_frame_t *pFrame);
 static Cllc_associated_devices_t *findDevice(ApiMac_sAddr_t *pAddr);
 static Cllc_associated_devices_t *findDeviceStatusBit(uint16_t mask, uint16_t statusBit);
-static uint8_t getMsduHandle(Smsgs_cmdIds_t msgType);
+static uint8_t getMsduHandle(Smsgs_cmdIds_t msgType, uint8_t handle);
 static bool sendMsg(Smsgs_cmdIds_t type, uint16_t dstShortAddr, bool rxOnIdle,
                     uint16_t len,
                     uint8_t *pData);
+static ApiMac_status_t sendDataReq(Smsgs_cmdIds_t type,
+                                   uint16_t dstShortAddr, bool rxOnIdle,
+                                   uint16_t len, uint8_t *pData,
+                                   uint8_t *pMsduHandle);
+static void releaseIndirect(Cllc_associated_devices_t *pDev);
+static void releaseDeferred(void);
+static uint8_t airtimeChannel(void);
+static void chargeDataCnf(ApiMac_mcpsDataCnf_t *pDataCnf,
+                          InFlight_frame_t *pFrame);
+static void purgeCnfCB(ApiMac_mcpsPurgeCnf_t *pPurgeCnf);
+static void inFlightReclaimCB(uint8_t handle, InFlight_frame_t *pFrame);
+static bool sendCmd(uint16_t shortAddr, uint16_t len, uint8_t *pData);
+static void cancelCmd(uint16_t shortAddr, uint8_t cmdId);
+static void chargeDataInd(ApiMac_mcpsDataInd_t *pDataInd,
+                          ApiMac_addrType_t srcAddrMode);
+static void processGroupConfig(deviceCmd_t *pCmd);
+static void sendGroupConfig(Cllc_associated_devices_t *pDev);
+static void sendGroupMsg(const char *pName, uint16_t len, uint8_t *pData);
+static void startOad(uint16_t shortAddr);
+static bool sendOadMsg(uint16_t shortAddr, bool rxOnIdle, uint16_t len,
+                       uint8_t *pData);
 static void generateConfigRequests(void);
+static void adaptIntervals(void);
 static void generateTrackingRequests(void);
 static void sendTrackingRequest(Cllc_associated_devices_t *pDev);
 static void commStatusIndCB(ApiMac_mlmeCommStatusInd_t *pCommStatusInd);
@@ -236,7 +278,7 @@ ApiMac_callbacks_t Collector_macCallbacks =
       /*! Data Indication callback */
       dataIndCB,
       /*! Purge Confirm callback */
-      NULL,
+      purgeCnfCB,
       /*! WiSUN Async Indication callback */
       NULL,
       /*! WiSUN Async Confirmation callback */
@@ -254,6 +296,35 @@ STATIC Cllc_callbacks_t cllcCallbacks =
       /*! The state has changed callback */
       cllcStateChangedCB
     };
+/*! OAD server callback table */
+static const OadServer_callbacks_t oadCallbacks =
+    {
+      /*! Send an OAD message */
+      sendOadMsg,
+      /*! Download progress callback */
+      appsrv_oadProgressUpdate
+    };
+
+/*! Delivery manager callback table */
+static const Delivery_callbacks_t deliveryCallbacks =
+    {
+      /*! Send a command */
+      sendCmd,
+      /*! Drop a queued command */
+      cancelCmd,
+      /*! Final outcome callback */
+      appsrv_deliveryUpdate
+    };
+
+/*! Ramp benchmark callback table */
+static const RampBench_callbacks_t rampCallbacks =
+    {
+      /*! Send a generated frame down the path */
+      forwardRampData,
+      /*! Results of a step */
+      appsrv_rampReport
+    };
+
 void mtsysCoPResetInd(MtSys_resetInd_t *pResetInd);
 static MtSys_callbacks_t mysysResetCbs =
 {
@@ -262,26 +333,26 @@ static MtSys_callbacks_t mysysResetCbs =
 
 
 static mqd_t collectorMq = NULL;
-mqd_t regGatewayMq = NULL;
+MsgLane_t *regGatewayMq = NULL;
 pthread_t collThreadH = (pthread_t) NULL;
 
 extern void triggerCollectorEvt(uint16_t evt)
 {
     msgQueue_t mqEvt = {COLLECTOR_PROCESS_EVT, NULL, 0};
     Util_setEvent(&Collector_events, evt);
-    mq_send(collectorMq, (char*)&mqEvt, sizeof(msgQueue_t), MQ_LOW_PRIOR);
+    MqStats_send(collectorMq, &mqEvt, MQ_LOW_PRIOR);
 }
 extern void triggerCllcEvt(uint16_t evt)
 {
     msgQueue_t mqEvt = {CLLC_PROCESS_EVT, NULL, 0};
     Util_setEvent(&Cllc_events, evt);
-    mq_send(collectorMq, (char*)&mqEvt, sizeof(msgQueue_t), MQ_LOW_PRIOR);
+    MqStats_send(collectorMq, &mqEvt, MQ_LOW_PRIOR);
 }
 extern void triggerCsfEvt(uint16_t evt)
 {
     msgQueue_t mqEvt = {CSF_PROCESS_EVT, NULL, 0};
     Util_setEvent(&Csf_events, evt);
-    mq_send(collectorMq, (char*)&mqEvt, sizeof(msgQueue_t), MQ_LOW_PRIOR);
+    MqStats_send(collectorMq, &mqEvt, MQ_LOW_PRIOR);
 }
 
 void mtsysCoPResetInd(MtSys_resetInd_t *pResetInd)
@@ -291,7 +362,7 @@ void mtsysCoPResetInd(MtSys_resetInd_t *pResetInd)
     initMsg.event = CollectorEvent_INIT_COP;
     initMsg.msgPtr = NULL;
     initMsg.msgPtrLen = 0;
-    mq_send(collectorMq, (char*)&initMsg, sizeof(msgQueue_t), MQ_LOW_PRIOR);
+    MqStats_send(collectorMq, &initMsg, MQ_LOW_PRIOR);
 }
 
 void Collector_initCop(void)
@@ -299,6 +370,11 @@ void Collector_initCop(void)
 //    /* Initialize the collector's statistics */
     memset(&Collector_statistics, 0, sizeof(Collector_statistics_t));
 //
+//    /* A reset CoP holds no frames */
+    InFlight_flush();
+    IndQueue_flush();
+    inFlightSweep = false;
+//
 //    /* Initialize the MAC */
     ApiMac_init(CONFIG_FH_ENABLE);
 //
@@ -332,11 +408,22 @@ void collectorInit(const char *collectorMqName)
 
     pthread_attr_t pAttrs;
     mq_attr attr;
-    unsigned mode = 0;
     struct sched_param priParam;
     attr.mq_maxmsg = 51;
     attr.mq_msgsize = sizeof(msgQueue_t);
-    collectorMq = mq_open(collectorMqName, O_CREAT, mode, &attr);
+    collectorMq = MqStats_open(collectorMqName, O_CREAT, &attr);
+
+    LinkStats_init();
+    DevFilter_init();
+    ReportCtrl_init();
+    Airtime_init();
+    IndQueue_init();
+    InFlight_init(inFlightReclaimCB);
+    DevGroups_init();
+    OadServer_init(&oadCallbacks);
+    OadServer_setImage(&OadImage_file);
+    Delivery_init(&deliveryCallbacks);
+    RampBench_init(&rampCallbacks);
 
     pthread_attr_init(&pAttrs);
     priParam.sched_priority = COLLECTOR_TASK_PRI;
@@ -351,7 +438,7 @@ void collectorInit(const char *collectorMqName)
 void collectorClientRegister(const char *npiMq, const char *gatewayMq)
 {
     //regNpiMq = mq_open(npiMq, O_WRONLY);
-    regGatewayMq = mq_open(gatewayMq, O_WRONLY);
+    regGatewayMq = MsgLane_open(gatewayMq);
     appCliMqReg(&regGatewayMq);
 
     //if(restarted)
@@ -402,6 +489,81 @@ void Collector_process(void)
         /* Clear the event */
         Util_clearEvent(&Collector_events, COLLECTOR_CONFIG_EVT);
     }
+
+    /* Adapt the reporting and polling intervals to the channel load */
+    if(Collector_events & COLLECTOR_REPORT_CTRL_EVT)
+    {
+        adaptIntervals();
+        Csf_setReportCtrlClock(REPORT_CTRL_PERIOD);
+
+        /* Clear the event */
+        Util_clearEvent(&Collector_events, COLLECTOR_REPORT_CTRL_EVT);
+    }
+
+    /* Take back the frames whose confirm got lost */
+    if(Collector_events & COLLECTOR_INFLIGHT_EVT)
+    {
+        if((InFlight_reclaim() != 0) && inFlightHeld)
+        {
+            inFlightHeld = false;
+            releaseDeferred();
+        }
+
+        /* Keep sweeping while frames are still waiting for a confirm */
+        inFlightSweep = (InFlight_count() != 0);
+        if(inFlightSweep)
+        {
+            Csf_setInFlightClock(INFLIGHT_SWEEP_TIME);
+        }
+
+        /* Clear the event */
+        Util_clearEvent(&Collector_events, COLLECTOR_INFLIGHT_EVT);
+    }
+
+    /* Part of the duty cycle window expired, retry the held back frames */
+    if(Collector_events & COLLECTOR_AIRTIME_EVT)
+    {
+        releaseDeferred();
+
+        /* Clear the event */
+        Util_clearEvent(&Collector_events, COLLECTOR_AIRTIME_EVT);
+    }
+
+    /* Retry, expire or purge the followed downlink commands */
+    if(Collector_events & COLLECTOR_DELIVERY_EVT)
+    {
+        if(Delivery_process())
+        {
+            Csf_setDeliveryClock(DELIVERY_TICK_MS);
+        }
+
+        /* Clear the event */
+        Util_clearEvent(&Collector_events, COLLECTOR_DELIVERY_EVT);
+    }
+
+    /* Generate the benchmark frames due and report the finished steps */
+    if(Collector_events & COLLECTOR_RAMP_EVT)
+    {
+        if(RampBench_process())
+        {
+            Csf_setRampClock(RAMPBENCH_TICK_MS);
+        }
+
+        /* Clear the event */
+        Util_clearEvent(&Collector_events, COLLECTOR_RAMP_EVT);
+    }
+
+    /* Serve paced OAD blocks and start waiting downloads */
+    if(Collector_events & COLLECTOR_OAD_EVT)
+    {
+        if(OadServer_process())
+        {
+            Csf_setOadClock(OAD_TICK_MS);
+        }
+
+        /* Clear the event */
+        Util_clearEvent(&Collector_events, COLLECTOR_OAD_EVT);
+    }
     /*
      Don't process ApiMac messages until all of the collector events
      are processed.
@@ -423,7 +585,7 @@ void * collectorThread(void *pvParameters)
         incomingMsg.msgPtr = NULL;
         incomingMsg.msgPtrLen = 0;
 
-        mq_receive(collectorMq, (char*)&incomingMsg, sizeof(msgQueue_t), NULL);
+        MqStats_receive(collectorMq, &incomingMsg);
 
         switch (incomingMsg.event)
         {
@@ -435,7 +597,7 @@ void * collectorThread(void *pvParameters)
                 initMsg.event = CollectorEvent_RESET_COP;
                 initMsg.msgPtr = NULL;
                 initMsg.msgPtrLen = 0;
-                mq_send(collectorMq, (char*)&initMsg, sizeof(msgQueue_t), MQ_LOW_PRIOR);
+                MqStats_send(collectorMq, &initMsg, MQ_LOW_PRIOR);
             }
         }
             break;
@@ -484,6 +646,18 @@ void * collectorThread(void *pvParameters)
                     devMsgBuf = (uint8_t*)malloc(msgLen);
                     devMsgBuf[0] = (uint8_t)Smsgs_cmdIds_buzzerCtrlReq;
                     break;
+                case CmdType_GROUP_CFG:
+                    /* Membership change, the frame is built per device */
+                    devMsgBuf = NULL;
+                    break;
+                case CmdType_OAD_START:
+                    /* The OAD server builds its own messages */
+                    devMsgBuf = NULL;
+                    break;
+                case CmdType_FILTER_CFG:
+                    /* Local to the collector, nothing goes over the air */
+                    devMsgBuf = NULL;
+                    break;
                 default:
                     msgLen = SMSGS_SENSOR_DOORLOCK_LEN;
                     devMsgBuf = (uint8_t*)malloc(msgLen);
@@ -492,10 +666,31 @@ void * collectorThread(void *pvParameters)
                     break;
                 }
 
-                sendMsg((Smsgs_cmdIds_t)devMsgBuf[0], inCmd->shortAddr,
-                                        false,
-                                        (msgLen),
-                                        devMsgBuf);
+                if(inCmd->cmdType == CmdType_GROUP_CFG)
+                {
+                    processGroupConfig(inCmd);
+                }
+                else if(inCmd->cmdType == CmdType_OAD_START)
+                {
+                    startOad(inCmd->shortAddr);
+                }
+                else if(inCmd->cmdType == CmdType_FILTER_CFG)
+                {
+                    DevFilter_processCmd((ApiMac_sAddrExt_t*)inCmd->extAddr,
+                                         inCmd->shortAddr,
+                                         (DevFilter_cmd_t)inCmd->data);
+                }
+                else if(inCmd->groupName[0] != '\0')
+                {
+                    sendGroupMsg(inCmd->groupName, msgLen, devMsgBuf);
+                }
+                else
+                {
+                    /* Followed until the device has it or it is given up */
+                    Delivery_send(inCmd->shortAddr, inCmd->cmdType, msgLen,
+                                  devMsgBuf);
+                    Csf_setDeliveryClock(DELIVERY_TICK_MS);
+                }
                 free(devMsgBuf);
             }
             break;
@@ -651,6 +846,12 @@ static void initializeClocks(void)
     /* Initialize the tracking clock */
     Csf_initializeTrackingClock();
     Csf_initializeConfigClock();
+    Csf_initializeOadClock();
+    Csf_initializeReportCtrlClock();
+    Csf_initializeAirtimeClock();
+    Csf_initializeDeliveryClock();
+    Csf_initializeRampClock();
+    Csf_initializeInFlightClock();
 }
 
 /*!
@@ -674,6 +875,15 @@ static void cllcStartedCB(Llc_netInfo_t *pStartedInfo)
 
     /* Start the tracking clock */
     Csf_setTrackingClock(TRACKING_DELAY_TIME);
+
+    /* Start adapting the intervals to the channel load */
+    Csf_setReportCtrlClock(REPORT_CTRL_PERIOD);
+
+#if CONFIG_RAMP_BENCH
+    /* Measure the sensor data path */
+    RampBench_start(CONFIG_RAMP_BENCH_GENERATE);
+    Csf_setRampClock(RAMPBENCH_TICK_MS);
+#endif
 }
 
 /*!
@@ -697,16 +907,20 @@ static ApiMac_assocStatus_t cllcDeviceJoiningCB(
     if(pDevInfo->panID == devicePanId)
     {
         ApiMac_sAddr_t pDstAddr;
+        uint32_t reportingInterval;
+        uint32_t pollingInterval;
         pDstAddr.addrMode = ApiMac_addrType_short;
         pDstAddr.addr.shortAddr = pDevInfo->shortAddress;
 
         /* Update the user that a device is joining */
         status = Csf_deviceUpdate(pDevInfo, pCapInfo);
-        /* Send the Config Request */
+        /* Send the Config Request, with the intervals of the current load */
+        ReportCtrl_getIntervals(REPORT_CTRL_NO_DEVICE, &reportingInterval,
+                                &pollingInterval);
         Collector_sendConfigRequest(
                         &pDstAddr, (CONFIG_FRAME_CONTROL),
-                        (CONFIG_REPORTING_INTERVAL),
-                        (CONFIG_POLLING_INTERVAL));
+                        reportingInterval,
+                        pollingInterval);
         appsrv_networkUpdate(false, &coordInfo);
         if(status==ApiMac_assocStatus_success)
         {
@@ -741,7 +955,7 @@ static void cllcStateChangedCB(Cllc_states_t state)
     {
         collectorStarted = true;
         msgQueue_t initMsg = {CollectorEvent_START_COP, NULL, 0};
-        mq_send(collectorMq, (char*)&initMsg, sizeof(msgQueue_t), MQ_LOW_PRIOR);
+        MqStats_send(collectorMq, &initMsg, MQ_LOW_PRIOR);
     }
     /* Notify the user interface */
     Csf_stateChangeUpdate(cllcState);
@@ -754,6 +968,28 @@ static void cllcStateChangedCB(Cllc_states_t state)
  */
 static void dataCnfCB(ApiMac_mcpsDataCnf_t *pDataCnf)
 {
+    InFlight_frame_t frame;
+    bool inFlight = false;
+    int x;
+
+    /* Record the outcome against the destination device */
+    if(pDataCnf->msduHandle & APP_MARKER_MSDU_HANDLE)
+    {
+        inFlight = InFlight_txDone((pDataCnf->msduHandle & MSDU_HANDLE_MAX),
+                                   pDataCnf->status, &frame);
+        if(inFlight)
+        {
+            LinkStats_txResult(frame.dstAddr, pDataCnf->status);
+            chargeDataCnf(pDataCnf, &frame);
+            if((frame.msgType == Smsgs_cmdIds_oad)
+               && (pDataCnf->status != ApiMac_status_success))
+            {
+                OadServer_txFailed(frame.dstAddr);
+            }
+        }
+        Delivery_txDone(pDataCnf->msduHandle, pDataCnf->status);
+    }
+
     /* Record statistics */
     if(pDataCnf->status == ApiMac_status_channelAccessFailure)
     {
@@ -852,6 +1088,45 @@ static void dataCnfCB(ApiMac_mcpsDataCnf_t *pDataCnf)
                 Collector_statistics.trackingReqRequestSent++;
             }
         }
+
+        /* The CoP is done with the frame, hand it the next queued one */
+        if(inFlight)
+        {
+            Cllc_associated_devices_t *pDst;
+            ApiMac_sAddr_t dstAddr;
+
+            dstAddr.addrMode = ApiMac_addrType_short;
+            dstAddr.addr.shortAddr = frame.dstAddr;
+            pDst = findDevice(&dstAddr);
+            if((pDst != NULL) && IndQueue_txDone(
+                   (uint8_t)(pDst - Cllc_associatedDevList),
+                   pDataCnf->msduHandle, pDataCnf->status))
+            {
+                releaseIndirect(pDst);
+            }
+        }
+        else
+        {
+            /* The handle was already taken back, don't leave the device
+               waiting for a frame the host queue thinks the CoP holds */
+            for(x = 0; x < CONFIG_MAX_DEVICES; x++)
+            {
+                if((Cllc_associatedDevList[x].shortAddr != INVALID_SHORT_ADDR)
+                   && IndQueue_txDone((uint8_t)x, pDataCnf->msduHandle,
+                                      pDataCnf->status))
+                {
+                    releaseIndirect(&Cllc_associatedDevList[x]);
+                    break;
+                }
+            }
+        }
+
+        /* A handle is free again, retry the frames held back by the limit */
+        if(inFlightHeld)
+        {
+            inFlightHeld = false;
+            releaseDeferred();
+        }
     }
 }
 
@@ -866,6 +1141,7 @@ static void dataIndCB(ApiMac_mcpsDataInd_t *pDataInd)
        && (pDataInd->msdu.len > 0))
     {
         Smsgs_cmdIds_t cmdId = (Smsgs_cmdIds_t)*(pDataInd->msdu.p);
+        ApiMac_addrType_t srcAddrMode = pDataInd->srcAddr.addrMode;
 
 #ifdef FEATURE_MAC_SECURITY
         if(Cllc_securityCheck(&(pDataInd->sec)) == false)
@@ -892,6 +1168,10 @@ static void dataIndCB(ApiMac_mcpsDataInd_t *pDataInd)
             }
         }
 
+        LinkStats_rxFrame(pDataInd->srcAddr.addr.shortAddr, pDataInd->rssi,
+                          pDataInd->mpduLinkQuality);
+        chargeDataInd(pDataInd, srcAddrMode);
+
         switch(cmdId)
         {
             case Smsgs_cmdIds_configRsp:
@@ -911,6 +1191,15 @@ static void dataIndCB(ApiMac_mcpsDataInd_t *pDataInd)
                 processSensorData(pDataInd);
                 break;
 
+            case Smsgs_cmdIds_rampdata:
+                processRampData(pDataInd);
+                break;
+
+            case Smsgs_cmdIds_oad:
+                OadServer_processMsg(pDataInd->srcAddr.addr.shortAddr,
+                                     pDataInd->msdu.len, pDataInd->msdu.p);
+                break;
+
 
 
             default:
@@ -927,57 +1216,27 @@ static void processStartEvent(void)
 {
     Llc_netInfo_t netInfo;
     uint32_t frameCounter = 0;
+    Llc_deviceListItem_t *pDevList = NULL;
+    uint16_t numDevices = 0;
+    uint32_t restoreStart = Util_getTimeMs();
 
     Csf_getFrameCounter(NULL, &frameCounter);
     /* See if there is existing network information */
-    if(Csf_getNetworkInformation(&netInfo))
+    if(Csf_getNetworkSnapshot(&netInfo, &numDevices, &pDevList))
     {
-        Llc_deviceListItem_t *pDevList = NULL;
-        uint16_t numDevices = 0;
-
 #ifdef FEATURE_MAC_SECURITY
         /* Initialize the MAC Security */
         Cllc_securityInit(frameCounter);
-#endif /* FEATURE_MAC_SECURITY */
 
-        numDevices = Csf_getNumDeviceListEntries();
-        if (numDevices > 0)
-        {
-            /* Allocate enough memory for all know devices */
-            pDevList = (Llc_deviceListItem_t *)Csf_malloc(
-                            sizeof(Llc_deviceListItem_t) * numDevices);
-            if(pDevList)
-            {
-                uint8_t i = 0;
-
-                /* Use a temp pointer to cycle through the list */
-                Llc_deviceListItem_t *pItem = pDevList;
-                for(i = 0; i < numDevices; i++, pItem++)
-                {
-                    Csf_getDeviceItem(i, pItem);
-
-#ifdef FEATURE_MAC_SECURITY
-                    /* Add device to security device table */
-                    Cllc_addSecDevice(pItem->devInfo.panID,
-                                      pItem->devInfo.shortAddress,
-                                      &pItem->devInfo.extAddress,
-                                      pItem->rxFrameCounter);
+        /* Add all known devices to the security device table */
+        Cllc_addSecDeviceList(numDevices, pDevList);
 #endif /* FEATURE_MAC_SECURITY */
-                }
-            }
-            else
-            {
-                numDevices = 0;
-            }
-        }
 
         /* Restore with the network and device information */
         Cllc_restoreNetwork(&netInfo, (uint8_t)numDevices, pDevList);
 
-        if (pDevList)
-        {
-            Csf_free(pDevList);
-        }
+        Collector_statistics.restoredDevices = numDevices;
+        Collector_statistics.restoreTime = Util_getTimeMs() - restoreStart;
 
         restarted = true;
     }
@@ -1033,6 +1292,18 @@ static void processConfigResponse(ApiMac_mcpsDataInd_t *pDataInd)
             /* Clear the sent flag and set the response flag */
             pDev->status &= ~ASSOC_CONFIG_SENT;
             pDev->status |= ASSOC_CONFIG_RSP;
+
+            ReportCtrl_configured((uint8_t)(pDev - Cllc_associatedDevList),
+                                  configRsp.reportingInterval,
+                                  configRsp.pollingInterval);
+
+            /* The device may have reset, restore its group membership. After
+               a collector restart it is sent at least once, so a device
+               drops group IDs that may be given to new groups. */
+            if(DevGroups_configDue((uint8_t)(pDev - Cllc_associatedDevList)))
+            {
+                sendGroupConfig(pDev);
+            }
         }
 
         /* report the config response */
@@ -1109,6 +1380,7 @@ static void processToggleLedResponse(ApiMac_mcpsDataInd_t *pDataInd)
 static void processSensorData(ApiMac_mcpsDataInd_t *pDataInd)
 {
     Smsgs_sensorMsg_t sensorData;
+    Cllc_associated_devices_t *pDev;
     uint8_t *pBuf = pDataInd->msdu.p;
 
     memset(&sensorData, 0, sizeof(Smsgs_sensorMsg_t));
@@ -1204,6 +1476,9 @@ static void processSensorData(ApiMac_mcpsDataInd_t *pDataInd)
         sensorData.msgStats.interimDelay = Util_buildUint16(pBuf[0],
                                                             pBuf[1]);
         pBuf += 2;
+
+        LinkStats_msgStats(pDataInd->srcAddr.addr.shortAddr,
+                           &sensorData.msgStats);
     }
 
     if(sensorData.frameControl & Smsgs_dataFields_configSettings)
@@ -1272,13 +1547,69 @@ static void processSensorData(ApiMac_mcpsDataInd_t *pDataInd)
 
     Collector_statistics.sensorMessagesReceived++;
 
+    pDev = findDevice(&pDataInd->srcAddr);
+    if(pDev != NULL)
+    {
+        uint8_t devIdx = (uint8_t)(pDev - Cllc_associatedDevList);
+
+        ReportCtrl_sensorData(devIdx, sensorData.frameControl);
+        if(sensorData.frameControl & Smsgs_dataFields_configSettings)
+        {
+            ReportCtrl_configured(devIdx,
+                            sensorData.configSettings.reportingInterval,
+                            sensorData.configSettings.pollingInterval);
+        }
+    }
+
     /* Report the sensor data */
     Csf_deviceSensorDataUpdate(&pDataInd->srcAddr, pDataInd->rssi,
-                               &sensorData);
+                               pDataInd->rxTime, &sensorData);
 
     processDataRetry(&(pDataInd->srcAddr));
 }
 
+/*!
+ * @brief      Process the Ramp Data message, timed by the ramp benchmark
+ *             from the sender's sequence number and send time.
+ *
+ * @param      pDataInd - pointer to the data indication information
+ */
+static void processRampData(ApiMac_mcpsDataInd_t *pDataInd)
+{
+    RampBench_frame_t frame;
+    uint8_t *pBuf = pDataInd->msdu.p;
+    uint16_t senderSeq;
+    uint32_t senderTime;
+
+    if(pDataInd->msdu.len != SMSGS_RAMP_DATA_MSG_LEN)
+    {
+        return;
+    }
+
+    /* Skip the command ID */
+    pBuf++;
+    senderSeq = Util_buildUint16(pBuf[0], pBuf[1]);
+    pBuf += 2;
+    senderTime = Util_buildUint32(pBuf[0], pBuf[1], pBuf[2], pBuf[3]);
+
+    if(RampBench_accept(pDataInd->srcAddr.addr.shortAddr, senderSeq,
+                        senderTime, &frame))
+    {
+        forwardRampData(&frame);
+    }
+}
+
+/*!
+ * @brief      Pass a ramp benchmark frame on to the gateway.
+ *
+ * @param      pFrame - benchmark frame
+ */
+static void forwardRampData(RampBench_frame_t *pFrame)
+{
+    RampBench_stamp(RampBench_stage_collector, pFrame);
+    appsrv_rampData(pFrame);
+}
+
 /*!
  * @brief      Find the associated device table entry matching pAddr.
  *
@@ -1347,30 +1678,21 @@ static Cllc_associated_devices_t *findDeviceStatusBit(uint16_t mask, uint16_t st
 }
 
 /*!
- * @brief      Get the next MSDU Handle
+ * @brief      Build the MSDU Handle
  *             <BR>
  *             The MSDU handle has 3 parts:<BR>
  *             - The MSBit(7), when set means the the application sent the message
  *             - Bit 6, when set means that the app message is a config request
- *             - Bits 0-5, used as a message counter that rolls over.
+ *             - Bits 0-5, the handle given out by the in-flight table
  *
  * @param      msgType - message command id needed
+ * @param      handle - handle returned by InFlight_alloc()
  *
  * @return     msdu Handle
  */
-static uint8_t getMsduHandle(Smsgs_cmdIds_t msgType)
+static uint8_t getMsduHandle(Smsgs_cmdIds_t msgType, uint8_t handle)
 {
-    uint8_t msduHandle = deviceTxMsduHandle;
-
-    /* Increment for the next msdu handle, or roll over */
-    if(deviceTxMsduHandle >= MSDU_HANDLE_MAX)
-    {
-        deviceTxMsduHandle = 0;
-    }
-    else
-    {
-        deviceTxMsduHandle++;
-    }
+    uint8_t msduHandle = handle & MSDU_HANDLE_MAX;
 
     /* Add the App specific bit */
     msduHandle |= APP_MARKER_MSDU_HANDLE;
@@ -1385,7 +1707,8 @@ static uint8_t getMsduHandle(Smsgs_cmdIds_t msgType)
 }
 
 /*!
- * @brief      Send MAC data request
+ * @brief      Send a message to a device. Frames for sleepy devices are
+ *             queued on the host and handed to the CoP one at a time.
  *
  * @param      type - message type
  * @param      dstShortAddr - destination short address
@@ -1393,13 +1716,437 @@ static uint8_t getMsduHandle(Smsgs_cmdIds_t msgType)
  * @param      len - length of payload
  * @param      pData - pointer to the buffer
  *
- * @return  true if sent, false if not
+ * @return  true if sent or queued, false if not
  */
 static bool sendMsg(Smsgs_cmdIds_t type, uint16_t dstShortAddr, bool rxOnIdle,
                     uint16_t len,
                     uint8_t *pData)
+{
+    ApiMac_status_t status;
+
+    if(rxOnIdle == false)
+    {
+        Cllc_associated_devices_t *pDev;
+        ApiMac_sAddr_t dstAddr;
+
+        dstAddr.addrMode = ApiMac_addrType_short;
+        dstAddr.addr.shortAddr = dstShortAddr;
+        pDev = findDevice(&dstAddr);
+        if((pDev != NULL) && (pDev->capInfo.rxOnWhenIdle == false)
+           && IndQueue_push((uint8_t)(pDev - Cllc_associatedDevList),
+                            dstShortAddr, len, pData))
+        {
+            releaseIndirect(pDev);
+            return (true);
+        }
+    }
+
+    status = sendDataReq(type, dstShortAddr, rxOnIdle, len, pData, NULL);
+    if(status == ApiMac_status_limitReached)
+    {
+        Collector_statistics.airtimeRejected++;
+    }
+    else if(status == ApiMac_status_noResources)
+    {
+        Collector_statistics.inFlightRejected++;
+    }
+
+    return (status == ApiMac_status_success);
+}
+
+/*!
+ * @brief      Hand the next queued frame of a sleepy device to the CoP,
+ *             unless the CoP still holds one for it
+ *
+ * @param      pDev - pointer to the device's associate device table entry
+ */
+static void releaseIndirect(Cllc_associated_devices_t *pDev)
+{
+    uint8_t devIdx = (uint8_t)(pDev - Cllc_associatedDevList);
+    IndQueue_frame_t *pFrame;
+    ApiMac_status_t status;
+    uint8_t msduHandle;
+
+    pFrame = IndQueue_peek(devIdx);
+    if(pFrame != NULL)
+    {
+        status = sendDataReq((Smsgs_cmdIds_t)pFrame->cmdId, pDev->shortAddr,
+                             false, pFrame->len, pFrame->data, &msduHandle);
+        if(status == ApiMac_status_success)
+        {
+            IndQueue_released(devIdx, msduHandle);
+        }
+        else if(status == ApiMac_status_limitReached)
+        {
+            /* Keep it queued until part of the duty cycle window expires */
+            Collector_statistics.airtimeDeferred++;
+            Csf_setAirtimeClock(Airtime_nextRelease());
+        }
+        else if(status == ApiMac_status_noResources)
+        {
+            /* Keep it queued until the CoP confirms one of its frames */
+            Collector_statistics.inFlightDeferred++;
+            inFlightHeld = true;
+        }
+        else
+        {
+            IndQueue_discard(devIdx);
+        }
+    }
+}
+
+/*!
+ * @brief      Try again to hand the frames held back by the duty cycle
+ *             budget or the in-flight limit to the CoP
+ */
+static void releaseDeferred(void)
+{
+    int x;
+
+    for(x = 0; x < CONFIG_MAX_DEVICES; x++)
+    {
+        if((Cllc_associatedDevList[x].shortAddr != INVALID_SHORT_ADDR)
+           && (Cllc_associatedDevList[x].capInfo.rxOnWhenIdle == false))
+        {
+            releaseIndirect(&Cllc_associatedDevList[x]);
+        }
+    }
+}
+
+/*!
+ * @brief      Get the channel the frames are charged to
+ *
+ * @return     operating channel, AIRTIME_NO_CHANNEL when hopping
+ */
+static uint8_t airtimeChannel(void)
+{
+    return ((fhEnabled == true) ? AIRTIME_NO_CHANNEL : Cllc_getChannel());
+}
+
+/*!
+ * @brief      Charge the transmissions of a confirmed frame
+ *
+ * @param      pDataCnf - pointer to the data confirm information
+ * @param      pFrame - the frame as it was handed to the CoP
+ */
+static void chargeDataCnf(ApiMac_mcpsDataCnf_t *pDataCnf,
+                          InFlight_frame_t *pFrame)
+{
+    Cllc_associated_devices_t *pDev;
+    ApiMac_sAddr_t dstAddr;
+    uint8_t devIdx = AIRTIME_NO_DEVICE;
+    uint8_t numTx = 0;
+
+    /* An expired frame or one that never got the channel was not sent */
+    if((pDataCnf->status == ApiMac_status_success)
+       || (pDataCnf->status == ApiMac_status_noAck))
+    {
+        numTx = 1 + pDataCnf->retries;
+    }
+
+    dstAddr.addrMode = ApiMac_addrType_short;
+    dstAddr.addr.shortAddr = pFrame->dstAddr;
+    pDev = findDevice(&dstAddr);
+    if(pDev != NULL)
+    {
+        devIdx = (uint8_t)(pDev - Cllc_associatedDevList);
+    }
+
+    Airtime_txDone(devIdx, airtimeChannel(), pFrame->airTime, numTx,
+                   ((pDataCnf->status == ApiMac_status_success)
+                    && (pFrame->dstAddr != APIMAC_SHORT_ADDR_BROADCAST)));
+}
+
+/*!
+ * @brief      MAC Purge Confirm callback. A purged frame never goes on the
+ *             air and gets no data confirm.
+ *
+ * @param      pPurgeCnf - pointer to the purge confirm information
+ */
+static void purgeCnfCB(ApiMac_mcpsPurgeCnf_t *pPurgeCnf)
+{
+    uint8_t handle = pPurgeCnf->msduHandle & MSDU_HANDLE_MAX;
+    InFlight_frame_t *pFrame = InFlight_get(handle);
+    Cllc_associated_devices_t *pDst;
+    ApiMac_sAddr_t dstAddr;
+
+    if(((pPurgeCnf->msduHandle & APP_MARKER_MSDU_HANDLE) == 0)
+       || (pPurgeCnf->status != ApiMac_status_success) || (pFrame == NULL))
+    {
+        /* The CoP no longer had the frame, its data confirm follows */
+        return;
+    }
+
+    Collector_statistics.txPurged++;
+
+    /* Give back the reserved air time and the handle */
+    Airtime_txDone(AIRTIME_NO_DEVICE, AIRTIME_NO_CHANNEL, pFrame->airTime,
+                   0, false);
+    dstAddr.addrMode = ApiMac_addrType_short;
+    dstAddr.addr.shortAddr = pFrame->dstAddr;
+    InFlight_free(handle);
+
+    Delivery_purgeCnf(pPurgeCnf->msduHandle, pPurgeCnf->status);
+
+    /* Hand the CoP the next queued frame, it is counted as not delivered */
+    pDst = findDevice(&dstAddr);
+    if((pDst != NULL) && IndQueue_txDone(
+           (uint8_t)(pDst - Cllc_associatedDevList),
+           pPurgeCnf->msduHandle, ApiMac_status_transactionExpired))
+    {
+        releaseIndirect(pDst);
+    }
+}
+
+/*!
+ * @brief      In-flight reclaim callback. The frame was taken back because
+ *             the CoP was reset or its confirm got lost, fail it like an
+ *             expired frame. Nothing is sent from here.
+ *
+ * @param      handle - handle the frame had
+ * @param      pFrame - the frame as it was handed to the CoP
+ */
+static void inFlightReclaimCB(uint8_t handle, InFlight_frame_t *pFrame)
+{
+    uint8_t msduHandle = getMsduHandle((Smsgs_cmdIds_t)pFrame->msgType,
+                                       handle);
+
+    /* Give back the reserved air time */
+    Airtime_txDone(AIRTIME_NO_DEVICE, AIRTIME_NO_CHANNEL, pFrame->airTime,
+                   0, false);
+
+    if(pFrame->devIdx < CONFIG_MAX_DEVICES)
+    {
+        /* Let the device's next poll take its next queued frame */
+        IndQueue_txDone(pFrame->devIdx, msduHandle,
+                        ApiMac_status_transactionExpired);
+    }
+    Delivery_txDone(msduHandle, ApiMac_status_transactionExpired);
+
+    if(pFrame->msgType == Smsgs_cmdIds_oad)
+    {
+        OadServer_txFailed(pFrame->dstAddr);
+    }
+}
+
+/*!
+ * @brief      Send a command followed by the delivery manager
+ *
+ * @param      shortAddr - destination short address
+ * @param      len - length of the command
+ * @param      pData - command, starting with the command ID
+ *
+ * @return     true if sent or queued, false if not
+ */
+static bool sendCmd(uint16_t shortAddr, uint16_t len, uint8_t *pData)
+{
+    return (sendMsg((Smsgs_cmdIds_t)pData[0], shortAddr, false, len, pData));
+}
+
+/*!
+ * @brief      Drop a command still waiting in the host queue of a device
+ *
+ * @param      shortAddr - short address of the device
+ * @param      cmdId - command ID
+ */
+static void cancelCmd(uint16_t shortAddr, uint8_t cmdId)
+{
+    Cllc_associated_devices_t *pDev;
+    ApiMac_sAddr_t dstAddr;
+
+    dstAddr.addrMode = ApiMac_addrType_short;
+    dstAddr.addr.shortAddr = shortAddr;
+    pDev = findDevice(&dstAddr);
+    if(pDev != NULL)
+    {
+        IndQueue_cancel((uint8_t)(pDev - Cllc_associatedDevList), cmdId);
+    }
+}
+
+/*!
+ * @brief      Charge a received frame
+ *
+ * @param      pDataInd - pointer to the data indication information
+ * @param      srcAddrMode - source address mode the frame was sent with
+ */
+static void chargeDataInd(ApiMac_mcpsDataInd_t *pDataInd,
+                          ApiMac_addrType_t srcAddrMode)
+{
+    Cllc_associated_devices_t *pDev;
+    uint8_t devIdx = AIRTIME_NO_DEVICE;
+    uint16_t psduLen;
+    bool acked;
+
+    psduLen = Airtime_psduLen(pDataInd->dstAddr.addrMode, srcAddrMode,
+                              &pDataInd->sec,
+                              (pDataInd->payloadIeLen + pDataInd->msdu.len));
+
+    /* Only frames sent to the coordinator are acknowledged */
+    acked = (pDataInd->dstAddr.addrMode == ApiMac_addrType_extended)
+            || ((pDataInd->dstAddr.addrMode == ApiMac_addrType_short)
+                && (pDataInd->dstAddr.addr.shortAddr
+                    != APIMAC_SHORT_ADDR_BROADCAST));
+
+    pDev = findDevice(&pDataInd->srcAddr);
+    if(pDev != NULL)
+    {
+        devIdx = (uint8_t)(pDev - Cllc_associatedDevList);
+    }
+
+    Airtime_rx(devIdx, airtimeChannel(), Airtime_frameTime(psduLen), acked);
+}
+
+/*!
+ * @brief      Add a device to or remove it from a named group and send
+ *             the device its new group mask
+ *
+ * @param      pCmd - group configuration command, data is 1 to join
+ *                    and 0 to leave the group
+ */
+static void processGroupConfig(deviceCmd_t *pCmd)
+{
+    Cllc_associated_devices_t *pDev;
+    ApiMac_sAddr_t devAddr;
+    uint8_t groupId;
+    bool member = (pCmd->data != 0);
+
+    devAddr.addrMode = ApiMac_addrType_short;
+    devAddr.addr.shortAddr = pCmd->shortAddr;
+    pDev = findDevice(&devAddr);
+
+    groupId = DevGroups_find(pCmd->groupName, member);
+    if((pDev != NULL) && (groupId != DEVGROUPS_INVALID_ID))
+    {
+        DevGroups_setMember((uint8_t)(pDev - Cllc_associatedDevList), groupId,
+                            member);
+        sendGroupConfig(pDev);
+    }
+}
+
+/*!
+ * @brief      Send the Group Configuration Request to a device
+ *
+ * @param      pDev - pointer to the device's associate device table entry
+ */
+static void sendGroupConfig(Cllc_associated_devices_t *pDev)
+{
+    uint8_t buffer[SMSGS_GROUP_CONFIG_REQUEST_MSG_LEN];
+    uint32_t groupMask;
+
+    groupMask = DevGroups_getMask((uint8_t)(pDev - Cllc_associatedDevList));
+    DevGroups_configSent((uint8_t)(pDev - Cllc_associatedDevList));
+
+    buffer[0] = (uint8_t)Smsgs_cmdIds_groupCfgReq;
+    Util_bufferUint32(&buffer[1], groupMask);
+
+    sendMsg(Smsgs_cmdIds_groupCfgReq, pDev->shortAddr,
+            pDev->capInfo.rxOnWhenIdle, SMSGS_GROUP_CONFIG_REQUEST_MSG_LEN,
+            buffer);
+}
+
+/*!
+ * @brief      Send a command to all members of a group. Devices that listen
+ *             while idle get it from a single broadcast frame whatever the
+ *             group size, sleepy members get it with their next poll.
+ *
+ * @param      pName - group name
+ * @param      len - length of the command
+ * @param      pData - command, starting with the command ID
+ */
+static void sendGroupMsg(const char *pName, uint16_t len, uint8_t *pData)
+{
+    uint8_t buffer[SMSGS_GROUP_CMD_HDR_LEN + INDQ_MAX_FRAME_LEN];
+    uint8_t groupId = DevGroups_find(pName, false);
+    int x;
+
+    if((groupId == DEVGROUPS_INVALID_ID) || (len > INDQ_MAX_FRAME_LEN))
+    {
+        return;
+    }
+
+    buffer[0] = (uint8_t)Smsgs_cmdIds_groupCmd;
+    buffer[1] = groupId;
+    memcpy(&buffer[SMSGS_GROUP_CMD_HDR_LEN], pData, len);
+
+    /* Members filter on the group ID, the others drop the frame */
+    sendDataReq(Smsgs_cmdIds_groupCmd, APIMAC_SHORT_ADDR_BROADCAST, true,
+                (SMSGS_GROUP_CMD_HDR_LEN + len), buffer, NULL);
+
+    /* A sleepy device misses the broadcast, queue the plain command */
+    for(x = 0; x < CONFIG_MAX_DEVICES; x++)
+    {
+        if((Cllc_associatedDevList[x].shortAddr != INVALID_SHORT_ADDR)
+           && (Cllc_associatedDevList[x].capInfo.rxOnWhenIdle == false)
+           && DevGroups_isMember((uint8_t)x, groupId))
+        {
+            sendMsg((Smsgs_cmdIds_t)pData[0],
+                    Cllc_associatedDevList[x].shortAddr, false, len, pData);
+        }
+    }
+}
+
+/*!
+ * @brief      Start the download of the sensor image to a device
+ *
+ * @param      shortAddr - short address of the device
+ */
+static void startOad(uint16_t shortAddr)
+{
+    Cllc_associated_devices_t *pDev;
+    ApiMac_sAddr_t devAddr;
+
+    devAddr.addrMode = ApiMac_addrType_short;
+    devAddr.addr.shortAddr = shortAddr;
+    pDev = findDevice(&devAddr);
+
+    if((pDev != NULL)
+       && (OadServer_start(shortAddr, pDev->capInfo.rxOnWhenIdle)
+           <= OadServer_status_waiting))
+    {
+        Csf_setOadClock(OAD_TICK_MS);
+    }
+}
+
+/*!
+ * @brief      OAD server callback to send a message to a device
+ *
+ * @param      shortAddr - destination short address
+ * @param      rxOnIdle - true if not a sleepy device
+ * @param      len - length of payload
+ * @param      pData - pointer to the buffer
+ *
+ * @return  true if sent, false if not
+ */
+static bool sendOadMsg(uint16_t shortAddr, bool rxOnIdle, uint16_t len,
+                       uint8_t *pData)
+{
+    return (sendMsg(Smsgs_cmdIds_oad, shortAddr, rxOnIdle, len, pData));
+}
+
+/*!
+ * @brief      Send MAC data request
+ *
+ * @param      type - message type
+ * @param      dstShortAddr - destination short address
+ * @param      rxOnIdle - true if not a sleepy device
+ * @param      len - length of payload
+ * @param      pData - pointer to the buffer
+ * @param      pMsduHandle - returns the MSDU handle used, can be NULL
+ *
+ * @return  true if sent, false if not
+ */
+static ApiMac_status_t sendDataReq(Smsgs_cmdIds_t type,
+                                   uint16_t dstShortAddr, bool rxOnIdle,
+                                   uint16_t len, uint8_t *pData,
+                                   uint8_t *pMsduHandle)
 {
     ApiMac_mcpsDataReq_t dataReq;
+    Cllc_associated_devices_t *pDev;
+    ApiMac_sAddr_t devAddr;
+    ApiMac_status_t status;
+    uint32_t airTime;
+    uint8_t devIdx = INFLIGHT_NO_DEVICE;
+    uint8_t handle;
 
     /* Fill the data request field */
     memset(&dataReq, 0, sizeof(ApiMac_mcpsDataReq_t));
@@ -1408,7 +2155,7 @@ static bool sendMsg(Smsgs_cmdIds_t type, uint16_t dstShortAddr, bool rxOnIdle,
     dataReq.dstAddr.addr.shortAddr = dstShortAddr;
     dataReq.srcAddrMode = ApiMac_addrType_short;
 
-    if(fhEnabled)
+    if(fhEnabled && (dstShortAddr != APIMAC_SHORT_ADDR_BROADCAST))
     {
         Llc_deviceListItem_t item;
 
@@ -1423,15 +2170,14 @@ static bool sendMsg(Smsgs_cmdIds_t type, uint16_t dstShortAddr, bool rxOnIdle,
         else
         {
             /* Can't send the message */
-            return (false);
+            return (ApiMac_status_invalidAddress);
         }
     }
 
     dataReq.dstPanId = devicePanId;
 
-    dataReq.msduHandle = getMsduHandle(type);
-
-    dataReq.txOptions.ack = true;
+    /* Broadcast frames are not acknowledged */
+    dataReq.txOptions.ack = (dstShortAddr != APIMAC_SHORT_ADDR_BROADCAST);
     if(rxOnIdle == false)
     {
         dataReq.txOptions.indirect = true;
@@ -1445,16 +2191,59 @@ static bool sendMsg(Smsgs_cmdIds_t type, uint16_t dstShortAddr, bool rxOnIdle,
     Cllc_securityFill(&dataReq.sec);
 #endif /* FEATURE_MAC_SECURITY */
 
+    airTime = Airtime_frameTime(Airtime_psduLen(dataReq.dstAddr.addrMode,
+                                                dataReq.srcAddrMode,
+                                                &dataReq.sec, len));
+
+    /* Hold the frame back if the CoP has too many frames already */
+    devAddr.addrMode = ApiMac_addrType_short;
+    devAddr.addr.shortAddr = dstShortAddr;
+    pDev = findDevice(&devAddr);
+    if(pDev != NULL)
+    {
+        devIdx = (uint8_t)(pDev - Cllc_associatedDevList);
+    }
+    handle = InFlight_alloc(dstShortAddr, devIdx, (uint8_t)type, airTime);
+    if(handle == INFLIGHT_NO_HANDLE)
+    {
+        return (ApiMac_status_noResources);
+    }
+
+    /* Start looking for lost confirms with the first outstanding frame */
+    if(inFlightSweep == false)
+    {
+        inFlightSweep = true;
+        Csf_setInFlightClock(INFLIGHT_SWEEP_TIME);
+    }
+
+    /* Hold the frame back if it would exceed the duty cycle budget */
+    if(Airtime_admitTx(airTime) == false)
+    {
+        InFlight_free(handle);
+        return (ApiMac_status_limitReached);
+    }
+
+    dataReq.msduHandle = getMsduHandle(type, handle);
+    if(pMsduHandle != NULL)
+    {
+        *pMsduHandle = dataReq.msduHandle;
+    }
+
     /* Send the message */
-    if(ApiMac_mcpsDataReq(&dataReq) != ApiMac_status_success)
+    status = ApiMac_mcpsDataReq(&dataReq);
+    if(status != ApiMac_status_success)
     {
-        /*  transaction overflow occurred */
-        return (false);
+        /*  transaction overflow occurred, nothing goes on the air */
+        Airtime_txDone(AIRTIME_NO_DEVICE, AIRTIME_NO_CHANNEL, airTime, 0,
+                       false);
+        InFlight_free(handle);
     }
     else
     {
-        return (true);
+        Delivery_sent(dstShortAddr, (uint8_t)type, dataReq.msduHandle);
     }
+
+    return (status);
 }
 
 /*!
@@ -1507,19 +2296,27 @@ static void generateConfigRequests(void)
                 {
                     ApiMac_sAddr_t dstAddr;
                     Collector_status_t stat;
+                    uint32_t reportingInterval;
+                    uint32_t pollingInterval;
 
                     /* Set up the destination address */
                     dstAddr.addrMode = ApiMac_addrType_short;
                     dstAddr.addr.shortAddr =
                         Cllc_associatedDevList[x].shortAddr;
 
+                    ReportCtrl_getIntervals((uint8_t)x, &reportingInterval,
+                                            &pollingInterval);
+
                     /* Send the Config Request */
                     stat = Collector_sendConfigRequest(
                                     &dstAddr, (CONFIG_FRAME_CONTROL),
-                                    (CONFIG_REPORTING_INTERVAL),
-                                    (CONFIG_POLLING_INTERVAL));
+                                    reportingInterval,
+                                    pollingInterval);
                     if(stat == Collector_status_success)
                     {
+                        ReportCtrl_requested((uint8_t)x, reportingInterval,
+                                             pollingInterval);
+
                         /*
                          Mark as the message has been sent and expecting a response
                          */
@@ -1536,6 +2333,44 @@ static void generateConfigRequests(void)
 }
 
 
+/*!
+ * @brief      Adapt the reporting and polling intervals to the channel load
+ *             and mark the devices that need new ones, the config requests
+ *             are then sent one at a time by generateConfigRequests().
+ */
+static void adaptIntervals(void)
+{
+    uint8_t numUpdates = 0;
+    int x;
+
+    ReportCtrl_process();
+
+    /* Start where the last period stopped so every device gets its turn */
+    for(x = 0; (x < CONFIG_MAX_DEVICES)
+               && (numUpdates < REPORT_CTRL_MAX_UPDATES); x++)
+    {
+        uint8_t devIdx = (uint8_t)((reportCtrlNextDev + x)
+                                   % CONFIG_MAX_DEVICES);
+        Cllc_associated_devices_t *pDev = &Cllc_associatedDevList[devIdx];
+
+        if((pDev->shortAddr != INVALID_SHORT_ADDR)
+           && (pDev->status & CLLC_ASSOC_STATUS_ALIVE)
+           && ((pDev->status & ASSOC_CONFIG_SENT) == 0)
+           && (ReportCtrl_needsUpdate(devIdx) == true))
+        {
+            /* A device without either flag is sent a config request */
+            pDev->status &= ~(ASSOC_CONFIG_SENT | ASSOC_CONFIG_RSP);
+            numUpdates++;
+        }
+    }
+    reportCtrlNextDev = (uint8_t)((reportCtrlNextDev + x) % CONFIG_MAX_DEVICES);
+
+    if(numUpdates > 0)
+    {
+        triggerCollectorEvt(COLLECTOR_CONFIG_EVT);
+    }
+}
+
 /*!
  * @brief      Generate Config Requests for all associate devices
  *             that need one.
@@ -1685,6 +2520,8 @@ static void generateTrackingRequests(void)
 static void sendTrackingRequest(Cllc_associated_devices_t *pDev)
 {
     uint8_t cmdId = Smsgs_cmdIds_trackingReq;
+    uint32_t reportingInterval;
+    uint32_t pollingInterval;
 
     /* Send the Tracking Request */
    if((sendMsg(Smsgs_cmdIds_trackingReq, pDev->shortAddr,
@@ -1695,8 +2532,17 @@ static void sendTrackingRequest(Cllc_associated_devices_t *pDev)
         /* Mark as Tracking Request sent */
         pDev->status |= ASSOC_TRACKING_SENT;
 
-        /* Setup Timeout for response */
-        Csf_setTrackingClock(TRACKING_TIMEOUT_TIME);
+        /* Setup Timeout for response, a sleepy device answers on its poll */
+        ReportCtrl_getIntervals((uint8_t)(pDev - Cllc_associatedDevList),
+                                &reportingInterval, &pollingInterval);
+        if((pollingInterval * 2) > TRACKING_TIMEOUT_TIME)
+        {
+            Csf_setTrackingClock(pollingInterval * 2);
+        }
+        else
+        {
+            Csf_setTrackingClock(TRACKING_TIMEOUT_TIME);
+        }
 
         /* Update stats */
         Collector_statistics.trackingRequestAttempts++;
@@ -1753,6 +2599,17 @@ static void pollIndCB(ApiMac_mlmePollInd_t *pPollInd)
                         &pPollInd->srcAddr.addr.extAddr);
     }
 
+    /* The device is awake, give the CoP its next queued frame */
+    if(addr.addr.shortAddr != INVALID_SHORT_ADDR)
+    {
+        Cllc_associated_devices_t *pDev = findDevice(&addr);
+        if(pDev != NULL)
+        {
+            releaseIndirect(pDev);
+        }
+        OadServer_poll(addr.addr.shortAddr);
+    }
+
     processDataRetry(&addr);
 }
 
@@ -137,6 +137,23 @@ typedef struct
     uint32_t txTransactionExpired;
     /* Total transaction Overflow error */
     uint32_t txTransactionOverflow;
+    /*! Number of devices restored at the last restart */
+    uint32_t restoredDevices;
+    /*!
+     Time taken by the last restore, from reading NV until the coprocessor
+     device table was programmed and the start request sent, in msec
+     */
+    uint32_t restoreTime;
+    /*! Frames to sleepy devices held back by the duty cycle budget */
+    uint32_t airtimeDeferred;
+    /*! Frames refused by the duty cycle budget */
+    uint32_t airtimeRejected;
+    /*! Superseded or expired frames purged from the coprocessor */
+    uint32_t txPurged;
+    /*! Frames to sleepy devices held back by the in-flight limit */
+    uint32_t inFlightDeferred;
+    /*! Frames refused by the in-flight limit */
+    uint32_t inFlightRejected;
 } Collector_statistics_t;
 
 /******************************************************************************
@@ -77,6 +77,25 @@ extern "C"
 #define CONFIG_SCAN_DURATION         5
 /*! maximum devices in association table */
 #define CONFIG_MAX_DEVICES           50
+/*!
+ Interval in milliseconds between background energy detect scans of the
+ operating channel, 0 disables the channel monitor. Only used in non beacon
+ mode without frequency hopping.
+ */
+#define CONFIG_CHANNEL_MONITOR_INTERVAL      300000
+/*! scan duration of a background energy detect scan */
+#define CONFIG_CHANNEL_MONITOR_SCAN_DURATION 2
+/*!
+ Set to true to run the ramp benchmark of the sensor data path once the
+ network is started (see rampBench.h). The results of each step are printed
+ by the gateway.
+ */
+#define CONFIG_RAMP_BENCH            false
+/*!
+ true for the collector to generate the benchmark frames at increasing rates,
+ false to time the rampdata frames sent by the sensors
+ */
+#define CONFIG_RAMP_BENCH_GENERATE   true
 
 /*!
  Setting beacon order to 15 will disable the beacon, 8 is a good value for
@@ -102,6 +121,19 @@ extern "C"
 #error "PHY ID is wrong."
 #endif
 
+/*!
+ Duty cycle budget of the coordinator transmissions, in per mille of a one
+ hour window, 0 for no limit. Most of the ETSI 863-870 MHz sub-bands allow
+ 1 percent.
+ */
+#if ((CONFIG_PHY_ID == APIMAC_STD_ETSI_863_PHY_3) || \
+     (CONFIG_PHY_ID == APIMAC_GENERIC_ETSI_LRM_863_PHY_131) || \
+     (CONFIG_PHY_ID == APIMAC_GENERIC_ETSI_863_PHY_133))
+#define CONFIG_DUTY_CYCLE_LIMIT      10
+#else
+#define CONFIG_DUTY_CYCLE_LIMIT      0
+#endif
+
 /*! Application traffic profile */
 #if (((CONFIG_PHY_ID >= APIMAC_MRFSK_STD_PHY_ID_BEGIN) && (CONFIG_PHY_ID <= APIMAC_MRFSK_GENERIC_PHY_ID_BEGIN)) || \
     ((CONFIG_PHY_ID >= APIMAC_GENERIC_US_915_PHY_132) && (CONFIG_PHY_ID <= APIMAC_GENERIC_ETSI_863_PHY_133)))
@@ -262,6 +294,11 @@ extern "C"
  Recommended values are 1 min and 16 min respectively.
 */
 #define CONFIG_DOUBLE_TRICKLE_TIMER    false
+/*!
+ Trickle redundancy constant k. A PA or PC frame is not sent in a trickle
+ interval in which k consistent frames of this network were heard.
+ */
+#define CONFIG_TRICKLE_REDUNDANCY_CONST 1
 /*! value for ApiMac_FHAttribute_netName */
 #define CONFIG_FH_NETNAME            {"FHTest"}
 /*!
@@ -63,6 +63,14 @@
 #include "LinkController/cllc.h"
 
 #include "smsgs.h"
+#include "oadServer.h"
+#include "devFilter.h"
+#include "reportCtrl.h"
+#include "airtime.h"
+#include "delivery.h"
+#include "linkStats.h"
+#include "inFlight.h"
+#include "rampBench.h"
 #include "csf.h"
 #include "appHandler.h"
 /******************************************************************************
@@ -86,6 +94,13 @@
 #define CSF_NV_FRAMECOUNTER_ID 0x0006
 /* NV Item ID - reset reason */
 #define CSF_NV_RESET_REASON_ID 0x0007
+/*
+ NV Item ID - network snapshot, sub IDs 0 and 1 hold two copies that are
+ written alternately
+ */
+#define CSF_NV_SNAPSHOT_ID 0x0008
+/* NV Item ID - device admission filter */
+#define CSF_NV_DEV_FILTER_ID 0x0009
 
 /* Maximum number of black list entries */
 #define CSF_MAX_BLACKLIST_ENTRIES 10
@@ -112,6 +127,26 @@
 #define JOIN_TIMEOUT_VALUE       20
 /* timeout value for config request delay */
 #define CONFIG_TIMEOUT_VALUE 1000
+
+/* Maximum number of new devices waiting to be written to NV */
+#define CSF_MAX_PENDING_DEVICES 16
+/* Delay before the new devices are written to NV in one batch */
+#define CSF_NV_BATCH_DELAY 2000
+
+/* Network snapshot identification, "CSNP" */
+#define CSF_SNAPSHOT_MAGIC 0x434E5350
+/* Network snapshot format version, bump when Csf_snapshot_t changes */
+#define CSF_SNAPSHOT_VERSION 1
+/* Number of network snapshot copies kept in NV */
+#define CSF_SNAPSHOT_COPIES 2
+/*
+ Delay before a snapshot holding only frame counter changes is written.
+ Device list and network changes are written after CSF_NV_BATCH_DELAY.
+ */
+#define CSF_SNAPSHOT_DELAY 60000
+
+/* Delay before device filter changes are written to NV */
+#define CSF_DEV_FILTER_DELAY 10000
 /*
  The increment value needed to save a frame counter. Example, setting this
  constant to 100, means that the frame counter will be saved when the new
@@ -127,6 +162,49 @@
 /*! NV driver item ID for reset reason */
 #define NVID_RESET {NVINTF_SYSID_APP, CSF_NV_RESET_REASON_ID, 0}
 
+/******************************************************************************
+ Structures
+ *****************************************************************************/
+
+/* Network snapshot header */
+typedef struct
+{
+    /* CSF_SNAPSHOT_MAGIC */
+    uint32_t magic;
+    /* CSF_SNAPSHOT_VERSION */
+    uint16_t version;
+    /* Size of the snapshot, changes with CONFIG_MAX_DEVICES */
+    uint16_t size;
+    /* Incremented for every snapshot written, the newest copy is used */
+    uint32_t sequence;
+    /* CRC-16 of the snapshot, computed with this field set to 0 */
+    uint16_t checksum;
+    /* Number of entries used in devList */
+    uint16_t numDevices;
+    /* Network information */
+    Llc_netInfo_t netInfo;
+} Csf_snapshotHdr_t;
+
+/*
+ Network snapshot, everything needed to restore the network in one NV
+ item instead of an item per device list entry
+ */
+typedef struct
+{
+    Csf_snapshotHdr_t hdr;
+    Llc_deviceListItem_t devList[CSF_MAX_DEVICELIST_ENTRIES];
+} Csf_snapshot_t;
+
+/* Device admission filter as stored in NV */
+typedef struct
+{
+    /* Number of entries used */
+    uint16_t numEntries;
+    /* DevFilter_mode_t */
+    uint16_t mode;
+    DevFilter_entry_t entries[DEV_FILTER_MAX_ENTRIES];
+} Csf_devFilterNv_t;
+
 /******************************************************************************
  External variables
  *****************************************************************************/
@@ -159,9 +237,58 @@ STATIC Clock_Handle joinClkHandle;
 STATIC Clock_Struct configClkStruct;
 STATIC Clock_Handle configClkHandle;
 
+/* timer for the device list NV batch */
+STATIC Clock_Struct nvBatchClkStruct;
+STATIC Clock_Handle nvBatchClkHandle;
+
+/* timer for the channel monitor */
+STATIC Clock_Struct chanMonClkStruct;
+STATIC Clock_Handle chanMonClkHandle;
+
+/* timer for the OAD server */
+STATIC Clock_Struct oadClkStruct;
+STATIC Clock_Handle oadClkHandle;
+
+/* timer for the interval controller */
+STATIC Clock_Struct reportCtrlClkStruct;
+STATIC Clock_Handle reportCtrlClkHandle;
+
+/* timer for the frames held back by the duty cycle budget */
+STATIC Clock_Struct airtimeClkStruct;
+STATIC Clock_Handle airtimeClkHandle;
+
+/* timer for the delivery manager */
+STATIC Clock_Struct deliveryClkStruct;
+STATIC Clock_Handle deliveryClkHandle;
+
+/* timer for the ramp benchmark */
+STATIC Clock_Struct rampClkStruct;
+STATIC Clock_Handle rampClkHandle;
+
+/* timer for the in-flight frame sweep */
+STATIC Clock_Struct inFlightClkStruct;
+STATIC Clock_Handle inFlightClkHandle;
+
 /* NV Function Pointers */
 static NVINTF_nvFuncts_t *pNV = NULL;
 
+/* New devices not written to NV yet */
+static Llc_deviceListItem_t pendingDevices[CSF_MAX_PENDING_DEVICES];
+static uint8_t numPendingDevices = 0;
+
+/* Delay the NV batch clock was last started with */
+static uint32_t nvBatchDelay = 0;
+
+/* RAM copy of the network snapshot, kept in step with the NV items */
+static Csf_snapshot_t snapshot;
+/* The RAM copy has changes that are not written to NV */
+static bool snapshotDirty = false;
+/* Sequence number of the newest snapshot in NV */
+static uint32_t snapshotSequence = 0;
+
+/* The device filter has changes that are not written to NV */
+static bool devFilterDirty = false;
+
 
 
 static bool started = false;
@@ -193,7 +320,28 @@ static void processPATrickleTimeoutCallback(UArg a0);
 static void processPCTrickleTimeoutCallback(UArg a0);
 static void processJoinTimeoutCallback(UArg a0);
 static void processConfigTimeoutCallback(UArg a0);
+static void processChanMonTimeoutCallback(UArg a0);
+static void processOadTimeoutCallback(UArg a0);
+static void processReportCtrlTimeoutCallback(UArg a0);
+static void processAirtimeTimeoutCallback(UArg a0);
+static void processDeliveryTimeoutCallback(UArg a0);
+static void processRampTimeoutCallback(UArg a0);
+static void processInFlightTimeoutCallback(UArg a0);
+static void processNvBatchTimeoutCallback(UArg a0);
 static bool addDeviceListItem(Llc_deviceListItem_t *pItem);
+static bool queueDeviceListItem(Llc_deviceListItem_t *pItem);
+static Llc_deviceListItem_t *findPendingDevice(ApiMac_sAddr_t *pAddr);
+static void writePendingDevices(void);
+static void startNvBatchClock(uint32_t delay);
+static bool readSnapshot(void);
+static bool buildSnapshot(void);
+static void writeSnapshot(void);
+static void scheduleSnapshot(bool urgent);
+static void snapshotUpdateDevice(Llc_deviceListItem_t *pItem, bool urgent);
+static void snapshotRemoveDevice(ApiMac_sAddrExt_t *pAddr);
+static uint16_t snapshotChecksum(void);
+static void readDevFilter(void);
+static void writeDevFilter(void);
 static void updateDeviceListItem(Llc_deviceListItem_t *pItem);
 static int findDeviceListIndex(ApiMac_sAddrExt_t *pAddr);
 static int findUnusedDeviceListIndex(void);
@@ -237,6 +385,15 @@ void Csf_init(void)
     }
 #endif
 
+    nvBatchClkHandle = Timer_construct(&nvBatchClkStruct,
+                                       processNvBatchTimeoutCallback,
+                                       CSF_NV_BATCH_DELAY,
+                                       0,
+                                       false,
+                                       0);
+
+    /* Load the device admission filter */
+    readDevFilter();
 
     /* Initialize PA/LNA if enabled */
     ApiMac_mlmeSetReqUint8(ApiMac_attribute_rangeExtender,
@@ -262,6 +419,16 @@ void Csf_processEvents(void)
 {
     /* Did a key press occur? */
 
+    /* Write the new devices and the network snapshot to NV */
+    if(Csf_events & CSF_NV_BATCH_EVT)
+    {
+        writePendingDevices();
+        writeSnapshot();
+        writeDevFilter();
+
+        /* Clear the event */
+        Util_clearEvent(&Csf_events, CSF_NV_BATCH_EVT);
+    }
 
 }
 
@@ -291,6 +458,37 @@ bool Csf_getNetworkInformation(Llc_netInfo_t *pInfo)
     return(false);
 }
 
+/*!
+ The application calls this function to retrieve the network
+ information and the device list in one go at restart.
+
+ Public function defined in csf.h
+ */
+bool Csf_getNetworkSnapshot(Llc_netInfo_t *pInfo, uint16_t *pNumDevices,
+                            Llc_deviceListItem_t **ppDevList)
+{
+    if((pNV == NULL) || (pNV->readItem == NULL) || (pInfo == NULL)
+       || (pNumDevices == NULL) || (ppDevList == NULL))
+    {
+        return (false);
+    }
+
+    if(readSnapshot() == false)
+    {
+        /* No usable snapshot, rebuild it from the individual NV items */
+        if(buildSnapshot() == false)
+        {
+            return (false);
+        }
+    }
+
+    memcpy(pInfo, &snapshot.hdr.netInfo, sizeof(Llc_netInfo_t));
+    *pNumDevices = snapshot.hdr.numDevices;
+    *ppDevList = snapshot.devList;
+
+    return (true);
+}
+
 /*!
  The application calls this function to indicate that it has
  started or restored the device in a network
@@ -315,6 +513,9 @@ void Csf_networkUpdate(bool restored, Llc_netInfo_t *pNetworkInfo)
             pNV->writeItem(id, sizeof(Llc_netInfo_t), pNetworkInfo);
         }
 
+        memcpy(&snapshot.hdr.netInfo, pNetworkInfo, sizeof(Llc_netInfo_t));
+        scheduleSnapshot(true);
+
         started = true;
 
         if(restored == false)
@@ -375,11 +576,19 @@ ApiMac_assocStatus_t Csf_deviceUpdate(ApiMac_deviceDescriptor_t *pDevInfo,
         /* Save the device information */
         Llc_deviceListItem_t dev;
 
+        /* A device joining under an address it did not hold before does
+           not inherit the link history of the last owner */
+        if(Csf_getDeviceShort(&pDevInfo->extAddress)
+           != pDevInfo->shortAddress)
+        {
+            LinkStats_remove(pDevInfo->shortAddress);
+        }
+
         memcpy(&dev.devInfo, pDevInfo, sizeof(ApiMac_deviceDescriptor_t));
         memcpy(&dev.capInfo, pCapInfo, sizeof(ApiMac_capabilityInfo_t));
         dev.rxFrameCounter = 0;
 
-        if(addDeviceListItem(&dev) == false)
+        if(queueDeviceListItem(&dev) == false)
         {
 #ifdef NV_RESTORE
             status = ApiMac_assocStatus_panAtCapacity;
@@ -437,10 +646,10 @@ void Csf_deviceConfigUpdate(ApiMac_sAddr_t *pSrcAddr, int8_t rssi,
  Public function defined in csf.h
  */
 void Csf_deviceSensorDataUpdate(ApiMac_sAddr_t *pSrcAddr, int8_t rssi,
-                                Smsgs_sensorMsg_t *pMsg)
+                                uint32_t rxTime, Smsgs_sensorMsg_t *pMsg)
 {
 
-    appsrv_deviceSensorDataUpdate(pSrcAddr, rssi, pMsg);
+    appsrv_deviceSensorDataUpdate(pSrcAddr, rssi, rxTime, pMsg);
     //Board_Led_toggle(board_led_type_LED2);
 
     //LCD_WRITE_STRING_VALUE("Sensor 0x", pSrcAddr->addr.shortAddr, 16, 6);
@@ -672,16 +881,6 @@ void Csf_setBroadcastClock(uint32_t broadcastTime)
  */
 void Csf_setTrickleClock(uint32_t trickleTime, uint8_t frameType)
 {
-    uint16_t randomNum = 0;
-    uint16_t randomTime = 0;
-
-    if(trickleTime > 0)
-    {
-        randomNum = ((ApiMac_randomByte() << 8) + ApiMac_randomByte());
-        randomTime = (trickleTime >> 1) +
-                      (randomNum % (trickleTime >> 1));
-    }
-
     if(frameType == ApiMac_wisunAsyncFrame_advertisement)
     {
         /* Stop the PA trickle timer */
@@ -693,7 +892,7 @@ void Csf_setTrickleClock(uint32_t trickleTime, uint8_t frameType)
         if(trickleTime > 0)
         {
             /* Setup timer */
-            Timer_setTimeout(tricklePAClkHandle, randomTime);
+            Timer_setTimeout(tricklePAClkHandle, trickleTime);
             Timer_start(&tricklePAClkStruct);
         }
     }
@@ -708,7 +907,7 @@ void Csf_setTrickleClock(uint32_t trickleTime, uint8_t frameType)
         if(trickleTime > 0)
         {
             /* Setup timer */
-            Timer_setTimeout(tricklePCClkHandle, randomTime);
+            Timer_setTimeout(tricklePCClkHandle, trickleTime);
             Timer_start(&tricklePCClkStruct);
         }
     }
@@ -756,6 +955,293 @@ void Csf_setConfigClock(uint32_t delay)
     }
 }
 
+/*!
+ Initialize the channel monitor clock
+
+ Public function defined in csf.h
+ */
+void Csf_initializeChanMonClock(void)
+{
+    if(chanMonClkHandle == NULL)
+    {
+        chanMonClkHandle = Timer_construct(&chanMonClkStruct,
+                                           processChanMonTimeoutCallback,
+                                           CONFIG_CHANNEL_MONITOR_INTERVAL,
+                                           0,
+                                           false,
+                                           0);
+    }
+    else if(Timer_isActive(&chanMonClkStruct) == true)
+    {
+        Timer_stop(&chanMonClkStruct);
+    }
+}
+
+/*!
+ Set the channel monitor clock
+
+ Public function defined in csf.h
+ */
+void Csf_setChanMonClock(uint32_t delay)
+{
+    if(Timer_isActive(&chanMonClkStruct) == true)
+    {
+        Timer_stop(&chanMonClkStruct);
+    }
+
+    if(delay != 0)
+    {
+        Timer_setTimeout(chanMonClkHandle, delay);
+        Timer_start(&chanMonClkStruct);
+    }
+}
+
+/*!
+ Initialize the OAD server clock
+
+ Public function defined in csf.h
+ */
+void Csf_initializeOadClock(void)
+{
+    if(oadClkHandle == NULL)
+    {
+        oadClkHandle = Timer_construct(&oadClkStruct,
+                                       processOadTimeoutCallback,
+                                       OAD_TICK_MS,
+                                       0,
+                                       false,
+                                       0);
+    }
+    else if(Timer_isActive(&oadClkStruct) == true)
+    {
+        Timer_stop(&oadClkStruct);
+    }
+}
+
+/*!
+ Set the OAD server clock
+
+ Public function defined in csf.h
+ */
+void Csf_setOadClock(uint32_t delay)
+{
+    if(Timer_isActive(&oadClkStruct) == true)
+    {
+        Timer_stop(&oadClkStruct);
+    }
+
+    if(delay != 0)
+    {
+        Timer_setTimeout(oadClkHandle, delay);
+        Timer_start(&oadClkStruct);
+    }
+}
+
+/*!
+ Initialize the interval controller clock
+
+ Public function defined in csf.h
+ */
+void Csf_initializeReportCtrlClock(void)
+{
+    if(reportCtrlClkHandle == NULL)
+    {
+        reportCtrlClkHandle = Timer_construct(&reportCtrlClkStruct,
+                                              processReportCtrlTimeoutCallback,
+                                              REPORT_CTRL_PERIOD,
+                                              0,
+                                              false,
+                                              0);
+    }
+    else if(Timer_isActive(&reportCtrlClkStruct) == true)
+    {
+        Timer_stop(&reportCtrlClkStruct);
+    }
+}
+
+/*!
+ Set the interval controller clock
+
+ Public function defined in csf.h
+ */
+void Csf_setReportCtrlClock(uint32_t delay)
+{
+    if(Timer_isActive(&reportCtrlClkStruct) == true)
+    {
+        Timer_stop(&reportCtrlClkStruct);
+    }
+
+    if(delay != 0)
+    {
+        Timer_setTimeout(reportCtrlClkHandle, delay);
+        Timer_start(&reportCtrlClkStruct);
+    }
+}
+
+/*!
+ Initialize the duty cycle clock
+
+ Public function defined in csf.h
+ */
+void Csf_initializeAirtimeClock(void)
+{
+    if(airtimeClkHandle == NULL)
+    {
+        airtimeClkHandle = Timer_construct(&airtimeClkStruct,
+                                           processAirtimeTimeoutCallback,
+                                           AIRTIME_BUCKET_TIME,
+                                           0,
+                                           false,
+                                           0);
+    }
+    else if(Timer_isActive(&airtimeClkStruct) == true)
+    {
+        Timer_stop(&airtimeClkStruct);
+    }
+}
+
+/*!
+ Set the duty cycle clock
+
+ Public function defined in csf.h
+ */
+void Csf_setAirtimeClock(uint32_t delay)
+{
+    if(Timer_isActive(&airtimeClkStruct) == true)
+    {
+        Timer_stop(&airtimeClkStruct);
+    }
+
+    if(delay != 0)
+    {
+        Timer_setTimeout(airtimeClkHandle, delay);
+        Timer_start(&airtimeClkStruct);
+    }
+}
+
+/*!
+ Initialize the delivery manager clock
+
+ Public function defined in csf.h
+ */
+void Csf_initializeDeliveryClock(void)
+{
+    if(deliveryClkHandle == NULL)
+    {
+        deliveryClkHandle = Timer_construct(&deliveryClkStruct,
+                                            processDeliveryTimeoutCallback,
+                                            DELIVERY_TICK_MS,
+                                            0,
+                                            false,
+                                            0);
+    }
+    else if(Timer_isActive(&deliveryClkStruct) == true)
+    {
+        Timer_stop(&deliveryClkStruct);
+    }
+}
+
+/*!
+ Set the delivery manager clock
+
+ Public function defined in csf.h
+ */
+void Csf_setDeliveryClock(uint32_t delay)
+{
+    if(Timer_isActive(&deliveryClkStruct) == true)
+    {
+        Timer_stop(&deliveryClkStruct);
+    }
+
+    if(delay != 0)
+    {
+        Timer_setTimeout(deliveryClkHandle, delay);
+        Timer_start(&deliveryClkStruct);
+    }
+}
+
+/*!
+ Initialize the ramp benchmark clock
+
+ Public function defined in csf.h
+ */
+void Csf_initializeRampClock(void)
+{
+    if(rampClkHandle == NULL)
+    {
+        rampClkHandle = Timer_construct(&rampClkStruct,
+                                        processRampTimeoutCallback,
+                                        RAMPBENCH_TICK_MS,
+                                        0,
+                                        false,
+                                        0);
+    }
+    else if(Timer_isActive(&rampClkStruct) == true)
+    {
+        Timer_stop(&rampClkStruct);
+    }
+}
+
+/*!
+ Set the ramp benchmark clock
+
+ Public function defined in csf.h
+ */
+void Csf_setRampClock(uint32_t delay)
+{
+    if(Timer_isActive(&rampClkStruct) == true)
+    {
+        Timer_stop(&rampClkStruct);
+    }
+
+    if(delay != 0)
+    {
+        Timer_setTimeout(rampClkHandle, delay);
+        Timer_start(&rampClkStruct);
+    }
+}
+
+/*!
+ Initialize the in-flight sweep clock
+
+ Public function defined in csf.h
+ */
+void Csf_initializeInFlightClock(void)
+{
+    if(inFlightClkHandle == NULL)
+    {
+        inFlightClkHandle = Timer_construct(&inFlightClkStruct,
+                                            processInFlightTimeoutCallback,
+                                            INFLIGHT_SWEEP_TIME,
+                                            0,
+                                            false,
+                                            0);
+    }
+    else if(Timer_isActive(&inFlightClkStruct) == true)
+    {
+        Timer_stop(&inFlightClkStruct);
+    }
+}
+
+/*!
+ Set the in-flight sweep clock
+
+ Public function defined in csf.h
+ */
+void Csf_setInFlightClock(uint32_t delay)
+{
+    if(Timer_isActive(&inFlightClkStruct) == true)
+    {
+        Timer_stop(&inFlightClkStruct);
+    }
+
+    if(delay != 0)
+    {
+        Timer_setTimeout(inFlightClkHandle, delay);
+        Timer_start(&inFlightClkStruct);
+    }
+}
+
 /*!
  Read the number of device list items stored
 
@@ -817,6 +1303,13 @@ bool Csf_getDevice(ApiMac_sAddr_t *pDevAddr, Llc_deviceListItem_t *pItem)
     if((pNV != NULL) && (pItem != NULL))
     {
         uint16_t numEntries;
+        Llc_deviceListItem_t *pPending = findPendingDevice(pDevAddr);
+
+        if(pPending != NULL)
+        {
+            memcpy(pItem, pPending, sizeof(Llc_deviceListItem_t));
+            return (true);
+        }
 
         numEntries = Csf_getNumDeviceListEntries();
 
@@ -1057,6 +1550,9 @@ bool Csf_getFrameCounter(ApiMac_sAddr_t *pDevAddr, uint32_t *pFrameCntr)
  */
 void Csf_removeDeviceListItem(ApiMac_sAddrExt_t *pAddr)
 {
+    /* The device may not be written to NV yet */
+    writePendingDevices();
+
     if((pNV != NULL) && (pNV->deleteItem != NULL))
     {
         int index;
@@ -1083,9 +1579,13 @@ void Csf_removeDeviceListItem(ApiMac_sAddrExt_t *pAddr)
                     numEntries--;
                     saveNumDeviceListEntries(numEntries);
                 }
+                snapshotRemoveDevice(pAddr);
             }
         }
     }
+
+    /* The gateway drops the device from the network document */
+    appsrv_deviceRemoveUpdate(pAddr);
 }
 
 /*!
@@ -1165,10 +1665,40 @@ void Csf_clearAllNVItems(void)
         id.itemID = CSF_NV_FRAMECOUNTER_ID;
         id.subID = 0;
         pNV->deleteItem(id);
+
+        /* Clear the network snapshot copies */
+        id.systemID = NVINTF_SYSID_APP;
+        id.itemID = CSF_NV_SNAPSHOT_ID;
+        for(entries = 0; entries < CSF_SNAPSHOT_COPIES; entries++)
+        {
+            id.subID = entries;
+            pNV->deleteItem(id);
+        }
+        memset(&snapshot, 0, sizeof(Csf_snapshot_t));
+        snapshotDirty = false;
+
+        /* Clear the device filter */
+        id.systemID = NVINTF_SYSID_APP;
+        id.itemID = CSF_NV_DEV_FILTER_ID;
+        id.subID = 0;
+        pNV->deleteItem(id);
+        DevFilter_init();
+        devFilterDirty = false;
     }
 }
 
 
+/*!
+ The device filter changed, write it to NV later
+
+ Public function defined in csf.h
+ */
+void Csf_devFilterUpdate(void)
+{
+    devFilterDirty = true;
+    startNvBatchClock(CSF_DEV_FILTER_DELAY);
+}
+
 /*!
  Add an entry into the black list
 
@@ -1178,6 +1708,13 @@ bool Csf_addBlackListItem(ApiMac_sAddr_t *pAddr)
 {
     bool retVal = false;
 
+    if((pAddr != NULL) && (pAddr->addrMode == ApiMac_addrType_extended))
+    {
+        /* Reject the device's frames without reading the black list */
+        DevFilter_processCmd(&pAddr->addr.extAddr, INVALID_SHORT_ADDR,
+                             DevFilter_cmd_deny);
+    }
+
     if((pNV != NULL) && (pAddr != NULL)
        && (pAddr->addrMode != ApiMac_addrType_none))
     {
@@ -1287,6 +1824,100 @@ static void processConfigTimeoutCallback(UArg a0)
     triggerCollectorEvt(COLLECTOR_CONFIG_EVT);
 }
 
+/*!
+ * @brief       OAD server timeout handler function.
+ *
+ * @param       a0 - ignored
+ */
+static void processOadTimeoutCallback(UArg a0)
+{
+    (void)a0; /* Parameter is not used */
+
+    triggerCollectorEvt(COLLECTOR_OAD_EVT);
+}
+
+/*!
+ * @brief       Interval controller timeout handler function.
+ *
+ * @param       a0 - ignored
+ */
+static void processReportCtrlTimeoutCallback(UArg a0)
+{
+    (void)a0; /* Parameter is not used */
+
+    triggerCollectorEvt(COLLECTOR_REPORT_CTRL_EVT);
+}
+
+/*!
+ * @brief       Duty cycle timeout handler function.
+ *
+ * @param       a0 - ignored
+ */
+static void processAirtimeTimeoutCallback(UArg a0)
+{
+    (void)a0; /* Parameter is not used */
+
+    triggerCollectorEvt(COLLECTOR_AIRTIME_EVT);
+}
+
+/*!
+ * @brief       Delivery manager timeout handler function.
+ *
+ * @param       a0 - ignored
+ */
+static void processDeliveryTimeoutCallback(UArg a0)
+{
+    (void)a0; /* Parameter is not used */
+
+    triggerCollectorEvt(COLLECTOR_DELIVERY_EVT);
+}
+
+/*!
+ * @brief       Ramp benchmark timeout handler function.
+ *
+ * @param       a0 - ignored
+ */
+static void processRampTimeoutCallback(UArg a0)
+{
+    (void)a0; /* Parameter is not used */
+
+    triggerCollectorEvt(COLLECTOR_RAMP_EVT);
+}
+
+/*!
+ * @brief       In-flight sweep timeout handler function.
+ *
+ * @param       a0 - ignored
+ */
+static void processInFlightTimeoutCallback(UArg a0)
+{
+    (void)a0; /* Parameter is not used */
+
+    triggerCollectorEvt(COLLECTOR_INFLIGHT_EVT);
+}
+
+/*!
+ * @brief       Channel monitor timeout handler function.
+ *
+ * @param       a0 - ignored
+ */
+static void processChanMonTimeoutCallback(UArg a0)
+{
+    (void)a0; /* Parameter is not used */
+    triggerCllcEvt(CLLC_CHAN_MON_EVT);
+}
+
+/*!
+ * @brief       Device list NV batch timeout handler function.
+ *
+ * @param       a0 - ignored
+ */
+static void processNvBatchTimeoutCallback(UArg a0)
+{
+    (void)a0; /* Parameter is not used */
+    triggerCsfEvt(CSF_NV_BATCH_EVT);
+}
+
 /*!
  * @brief       Trickle timeout handler function for PA .
  *
@@ -1350,6 +1981,7 @@ static bool addDeviceListItem(Llc_deviceListItem_t *pItem)
                     /* Update the number of entries */
                     numEntries++;
                     saveNumDeviceListEntries(numEntries);
+                    snapshotUpdateDevice(pItem, true);
                     retVal = true;
                 }
             }
@@ -1359,6 +1991,475 @@ static bool addDeviceListItem(Llc_deviceListItem_t *pItem)
     return (retVal);
 }
 
+/*!
+ * @brief       Queue a new device list entry for the next NV batch. A join
+ *              storm then costs one NV write burst instead of a write per
+ *              association.
+ *
+ * @param       pItem - pointer to the device list entry
+ *
+ * @return      true if queued, added or already existed, false if the
+ *              device list is full
+ */
+static bool queueDeviceListItem(Llc_deviceListItem_t *pItem)
+{
+    ApiMac_sAddr_t devAddr;
+    Llc_deviceListItem_t *pPending;
+
+    if(pNV == NULL)
+    {
+        return (false);
+    }
+
+    devAddr.addrMode = ApiMac_addrType_extended;
+    memcpy(&devAddr.addr.extAddr, &pItem->devInfo.extAddress,
+           sizeof(ApiMac_sAddrExt_t));
+    pPending = findPendingDevice(&devAddr);
+    if(pPending != NULL)
+    {
+        memcpy(pPending, pItem, sizeof(Llc_deviceListItem_t));
+        return (true);
+    }
+
+    if(numPendingDevices == CSF_MAX_PENDING_DEVICES)
+    {
+        writePendingDevices();
+    }
+
+    if((Csf_getNumDeviceListEntries() + numPendingDevices)
+       >= CSF_MAX_DEVICELIST_ENTRIES)
+    {
+        /* Let the NV list decide, the device may already be in it */
+        return (addDeviceListItem(pItem));
+    }
+
+    memcpy(&pendingDevices[numPendingDevices], pItem,
+           sizeof(Llc_deviceListItem_t));
+    numPendingDevices++;
+
+    startNvBatchClock(CSF_NV_BATCH_DELAY);
+    return (true);
+}
+
+/*!
+ * @brief       Find a device list entry waiting for the NV batch
+ *
+ * @param       pAddr - short or extended address of the device
+ *
+ * @return      pointer to the pending entry, NULL if not found
+ */
+static Llc_deviceListItem_t *findPendingDevice(ApiMac_sAddr_t *pAddr)
+{
+    uint8_t i;
+
+    for(i = 0; i < numPendingDevices; i++)
+    {
+        Llc_deviceListItem_t *pItem = &pendingDevices[i];
+
+        if(((pAddr->addrMode == ApiMac_addrType_short)
+            && (pAddr->addr.shortAddr == pItem->devInfo.shortAddress))
+           || ((pAddr->addrMode == ApiMac_addrType_extended)
+               && (memcmp(&pAddr->addr.extAddr, &pItem->devInfo.extAddress,
+                          (APIMAC_SADDR_EXT_LEN)) == 0)))
+        {
+            return (pItem);
+        }
+    }
+    return (NULL);
+}
+
+/*!
+ * @brief       Write the pending device list entries to NV
+ */
+static void writePendingDevices(void)
+{
+    uint8_t i;
+
+    for(i = 0; i < numPendingDevices; i++)
+    {
+        addDeviceListItem(&pendingDevices[i]);
+    }
+    numPendingDevices = 0;
+}
+
+/*!
+ * @brief       Start the NV batch clock, or bring it forward if it is
+ *              already running with a longer delay
+ *
+ * @param       delay - time until the NV batch is written, in msec
+ */
+static void startNvBatchClock(uint32_t delay)
+{
+    if(Timer_isActive(&nvBatchClkStruct) == true)
+    {
+        if(delay >= nvBatchDelay)
+        {
+            return;
+        }
+        Timer_stop(&nvBatchClkStruct);
+    }
+
+    nvBatchDelay = delay;
+    Timer_setTimeout(nvBatchClkHandle, delay);
+    Timer_start(&nvBatchClkStruct);
+}
+
+/*!
+ * @brief       Load the newest valid network snapshot from NV into the
+ *              RAM copy. A copy is only used if its header, size and
+ *              checksum are good and it still agrees with the number of
+ *              device list entries, a mismatch means the device list
+ *              changed after the snapshot was taken.
+ *
+ * @return      true if a snapshot was loaded, false if not
+ */
+static bool readSnapshot(void)
+{
+    NVINTF_itemID_t id;
+    Csf_snapshotHdr_t hdr;
+    bool valid[CSF_SNAPSHOT_COPIES];
+    uint32_t sequence[CSF_SNAPSHOT_COPIES];
+    uint16_t newest = 0;
+    uint16_t i;
+
+    /* Setup NV ID for the snapshot copies */
+    id.systemID = NVINTF_SYSID_APP;
+    id.itemID = CSF_NV_SNAPSHOT_ID;
+
+    /* Read the headers to find the newest copy */
+    for(i = 0; i < CSF_SNAPSHOT_COPIES; i++)
+    {
+        id.subID = i;
+        valid[i] = false;
+        sequence[i] = 0;
+
+        if((pNV->readItem(id, 0, sizeof(Csf_snapshotHdr_t), &hdr)
+            == NVINTF_SUCCESS)
+           && (hdr.magic == CSF_SNAPSHOT_MAGIC)
+           && (hdr.version == CSF_SNAPSHOT_VERSION)
+           && (hdr.size == sizeof(Csf_snapshot_t))
+           && (hdr.numDevices <= CSF_MAX_DEVICELIST_ENTRIES))
+        {
+            valid[i] = true;
+            sequence[i] = hdr.sequence;
+
+            /* Never reuse a sequence number, even of a rejected copy */
+            if((int32_t)(hdr.sequence - snapshotSequence) > 0)
+            {
+                snapshotSequence = hdr.sequence;
+            }
+            if((valid[newest] == false)
+               || ((int32_t)(sequence[i] - sequence[newest]) > 0))
+            {
+                newest = i;
+            }
+        }
+    }
+
+    /* Try the newest copy first, the other one if it is damaged */
+    for(i = 0; i < CSF_SNAPSHOT_COPIES; i++)
+    {
+        uint16_t copy = (newest + i) % CSF_SNAPSHOT_COPIES;
+
+        if(valid[copy] == false)
+        {
+            continue;
+        }
+
+        id.subID = copy;
+        if((pNV->readItem(id, 0, sizeof(Csf_snapshot_t), &snapshot)
+            == NVINTF_SUCCESS)
+           && (snapshot.hdr.sequence == sequence[copy])
+           && (snapshot.hdr.checksum == snapshotChecksum()))
+        {
+            if(snapshot.hdr.numDevices == Csf_getNumDeviceListEntries())
+            {
+                snapshotDirty = false;
+                return (true);
+            }
+
+            /* Out of date, an older copy will be even more so */
+            break;
+        }
+    }
+
+    memset(&snapshot, 0, sizeof(Csf_snapshot_t));
+    return (false);
+}
+
+/*!
+ * @brief       Build the RAM copy of the network snapshot from the
+ *              individual network information and device list NV items,
+ *              then schedule it to be written.
+ *
+ * @return      true if the network information was found, false if not
+ */
+static bool buildSnapshot(void)
+{
+    NVINTF_itemID_t id;
+    uint16_t numEntries;
+    uint16_t numDevices = 0;
+    int subId = 0;
+    int readItems = 0;
+
+    memset(&snapshot, 0, sizeof(Csf_snapshot_t));
+
+    if(Csf_getNetworkInformation(&snapshot.hdr.netInfo) == false)
+    {
+        return (false);
+    }
+
+    numEntries = Csf_getNumDeviceListEntries();
+
+    /* Setup NV ID for the device list records */
+    id.systemID = NVINTF_SYSID_APP;
+    id.itemID = CSF_NV_DEVICELIST_ID;
+
+    /* One pass through the records instead of a search per index */
+    while((readItems < numEntries) && (subId < CSF_MAX_DEVICELIST_IDS)
+          && (numDevices < CSF_MAX_DEVICELIST_ENTRIES))
+    {
+        id.subID = (uint16_t)subId;
+
+        if(pNV->readItem(id, 0, sizeof(Llc_deviceListItem_t),
+                         &snapshot.devList[numDevices]) == NVINTF_SUCCESS)
+        {
+            numDevices++;
+            readItems++;
+        }
+        subId++;
+    }
+    snapshot.hdr.numDevices = numDevices;
+
+    scheduleSnapshot(true);
+
+    return (true);
+}
+
+/*!
+ * @brief       Write the RAM copy of the network snapshot to NV if it
+ *              changed. The copy written is always the older one, so a
+ *              reset during the write leaves the newest good copy intact
+ *              and the damaged one fails its checksum.
+ */
+static void writeSnapshot(void)
+{
+    NVINTF_itemID_t id;
+    uint8_t stat;
+
+    if((snapshotDirty == false) || (pNV == NULL) || (pNV->writeItem == NULL))
+    {
+        return;
+    }
+
+    snapshot.hdr.magic = CSF_SNAPSHOT_MAGIC;
+    snapshot.hdr.version = CSF_SNAPSHOT_VERSION;
+    snapshot.hdr.size = sizeof(Csf_snapshot_t);
+    snapshot.hdr.sequence = snapshotSequence + 1;
+    snapshot.hdr.checksum = snapshotChecksum();
+
+    /* Setup NV ID for the older snapshot copy */
+    id.systemID = NVINTF_SYSID_APP;
+    id.itemID = CSF_NV_SNAPSHOT_ID;
+    id.subID = (uint16_t)(snapshot.hdr.sequence % CSF_SNAPSHOT_COPIES);
+
+    stat = pNV->writeItem(id, sizeof(Csf_snapshot_t), &snapshot);
+    if((stat != NVINTF_SUCCESS) && (pNV->deleteItem != NULL))
+    {
+        /* The item may be left from a build with a different size */
+        pNV->deleteItem(id);
+        stat = pNV->writeItem(id, sizeof(Csf_snapshot_t), &snapshot);
+    }
+
+    if(stat == NVINTF_SUCCESS)
+    {
+        snapshotSequence = snapshot.hdr.sequence;
+        snapshotDirty = false;
+    }
+}
+
+/*!
+ * @brief       Mark the RAM copy of the network snapshot as changed and
+ *              schedule it to be written
+ *
+ * @param       urgent - true for device list and network changes, false
+ *                       for frame counter only changes
+ */
+static void scheduleSnapshot(bool urgent)
+{
+    snapshotDirty = true;
+
+    startNvBatchClock(urgent ? CSF_NV_BATCH_DELAY : CSF_SNAPSHOT_DELAY);
+}
+
+/*!
+ * @brief       Add or update a device in the RAM copy of the network
+ *              snapshot
+ *
+ * @param       pItem - pointer to the device list entry
+ * @param       urgent - true if the device was added to the device list
+ */
+static void snapshotUpdateDevice(Llc_deviceListItem_t *pItem, bool urgent)
+{
+    uint16_t i;
+
+    for(i = 0; i < snapshot.hdr.numDevices; i++)
+    {
+        if(memcmp(&snapshot.devList[i].devInfo.extAddress,
+                  &pItem->devInfo.extAddress, APIMAC_SADDR_EXT_LEN) == 0)
+        {
+            break;
+        }
+    }
+
+    if(i == snapshot.hdr.numDevices)
+    {
+        if(i == CSF_MAX_DEVICELIST_ENTRIES)
+        {
+            return;
+        }
+        snapshot.hdr.numDevices++;
+        urgent = true;
+    }
+
+    memcpy(&snapshot.devList[i], pItem, sizeof(Llc_deviceListItem_t));
+    scheduleSnapshot(urgent);
+}
+
+/*!
+ * @brief       Remove a device from the RAM copy of the network snapshot
+ *
+ * @param       pAddr - extended address of the device
+ */
+static void snapshotRemoveDevice(ApiMac_sAddrExt_t *pAddr)
+{
+    uint16_t i;
+
+    for(i = 0; i < snapshot.hdr.numDevices; i++)
+    {
+        if(memcmp(&snapshot.devList[i].devInfo.extAddress, pAddr,
+                  APIMAC_SADDR_EXT_LEN) == 0)
+        {
+            snapshot.hdr.numDevices--;
+
+            /* Keep the device list order */
+            memmove(&snapshot.devList[i], &snapshot.devList[i + 1],
+                    sizeof(Llc_deviceListItem_t)
+                    * (snapshot.hdr.numDevices - i));
+            memset(&snapshot.devList[snapshot.hdr.numDevices], 0,
+                   sizeof(Llc_deviceListItem_t));
+
+            scheduleSnapshot(true);
+            break;
+        }
+    }
+}
+
+/*!
+ * @brief       Calculate the CRC-16 (CCITT) of the RAM copy of the network
+ *              snapshot, the checksum field must be 0 or hold the value
+ *              being checked
+ *
+ * @return      checksum
+ */
+static uint16_t snapshotChecksum(void)
+{
+    uint16_t saved = snapshot.hdr.checksum;
+    uint8_t *pBuf = (uint8_t *)&snapshot;
+    uint16_t crc = 0xFFFF;
+    uint16_t i;
+    uint8_t bit;
+
+    snapshot.hdr.checksum = 0;
+    for(i = 0; i < sizeof(Csf_snapshot_t); i++)
+    {
+        crc ^= (uint16_t)pBuf[i] << 8;
+        for(bit = 0; bit < 8; bit++)
+        {
+            crc = (crc & 0x8000) ? ((crc << 1) ^ 0x1021) : (crc << 1);
+        }
+    }
+    snapshot.hdr.checksum = saved;
+
+    return (crc);
+}
+
+/*!
+ * @brief       Load the device admission filter from NV
+ */
+static void readDevFilter(void)
+{
+    Csf_devFilterNv_t *pFilter;
+    NVINTF_itemID_t id;
+
+    devFilterDirty = false;
+    if((pNV == NULL) || (pNV->readItem == NULL))
+    {
+        return;
+    }
+
+    pFilter = (Csf_devFilterNv_t *)Csf_malloc(sizeof(Csf_devFilterNv_t));
+    if(pFilter == NULL)
+    {
+        return;
+    }
+
+    /* Setup NV ID for the device filter */
+    id.systemID = NVINTF_SYSID_APP;
+    id.itemID = CSF_NV_DEV_FILTER_ID;
+    id.subID = 0;
+
+    if((pNV->readItem(id, 0, sizeof(Csf_devFilterNv_t), pFilter)
+        == NVINTF_SUCCESS)
+       && (pFilter->numEntries <= DEV_FILTER_MAX_ENTRIES))
+    {
+        DevFilter_load((DevFilter_mode_t)pFilter->mode, pFilter->numEntries,
+                       pFilter->entries);
+    }
+    Csf_free(pFilter);
+}
+
+/*!
+ * @brief       Write the device admission filter to NV if it changed
+ */
+static void writeDevFilter(void)
+{
+    Csf_devFilterNv_t *pFilter;
+    DevFilter_entry_t *pEntries;
+    DevFilter_mode_t mode;
+    NVINTF_itemID_t id;
+
+    if((devFilterDirty == false) || (pNV == NULL)
+       || (pNV->writeItem == NULL))
+    {
+        return;
+    }
+
+    pFilter = (Csf_devFilterNv_t *)Csf_malloc(sizeof(Csf_devFilterNv_t));
+    if(pFilter == NULL)
+    {
+        return;
+    }
+
+    memset(pFilter, 0, sizeof(Csf_devFilterNv_t));
+    pFilter->numEntries = DevFilter_get(&mode, &pEntries);
+    pFilter->mode = (uint16_t)mode;
+    memcpy(pFilter->entries, pEntries,
+           sizeof(DevFilter_entry_t) * pFilter->numEntries);
+
+    /* Setup NV ID for the device filter */
+    id.systemID = NVINTF_SYSID_APP;
+    id.itemID = CSF_NV_DEV_FILTER_ID;
+    id.subID = 0;
+
+    if(pNV->writeItem(id, sizeof(Csf_devFilterNv_t), pFilter)
+       == NVINTF_SUCCESS)
+    {
+        devFilterDirty = false;
+    }
+    Csf_free(pFilter);
+}
+
 /*!
  * @brief       Update an entry in the device list
  *
@@ -1369,6 +2470,19 @@ static void updateDeviceListItem(Llc_deviceListItem_t *pItem)
     if((pNV != NULL) && (pItem != NULL))
     {
         int idx;
+        ApiMac_sAddr_t devAddr;
+        Llc_deviceListItem_t *pPending;
+
+        devAddr.addrMode = ApiMac_addrType_extended;
+        memcpy(&devAddr.addr.extAddr, &pItem->devInfo.extAddress,
+               sizeof(ApiMac_sAddrExt_t));
+        pPending = findPendingDevice(&devAddr);
+        if(pPending != NULL)
+        {
+            /* Not in NV yet, update the pending copy */
+            memcpy(pPending, pItem, sizeof(Llc_deviceListItem_t));
+            return;
+        }
 
         idx = findDeviceListIndex(&pItem->devInfo.extAddress);
         if(idx != DEVICE_INDEX_NOT_FOUND)
@@ -1381,7 +2495,11 @@ static void updateDeviceListItem(Llc_deviceListItem_t *pItem)
             id.subID = (uint16_t)idx;
 
             /* write the device list record */
-            pNV->writeItem(id, sizeof(Llc_deviceListItem_t), pItem);
+            if(pNV->writeItem(id, sizeof(Llc_deviceListItem_t), pItem)
+               == NVINTF_SUCCESS)
+            {
+                snapshotUpdateDevice(pItem, false);
+            }
         }
     }
 }
@@ -69,9 +69,23 @@ extern uint16_t Collector_events;
 /*! Event ID - Generate Configs Event */
 #define COLLECTOR_CONFIG_EVT 0x0004
 #define COLLECTOR_BROADCAST_TIMEOUT_EVT 0x0008
+/*! Event ID - OAD Server Event */
+#define COLLECTOR_OAD_EVT 0x0010
+/*! Event ID - Adapt the reporting and polling intervals */
+#define COLLECTOR_REPORT_CTRL_EVT 0x0020
+/*! Event ID - Retry the frames held back by the duty cycle budget */
+#define COLLECTOR_AIRTIME_EVT 0x0040
+/*! Event ID - Retry or give up the followed downlink commands */
+#define COLLECTOR_DELIVERY_EVT 0x0080
+/*! Event ID - Ramp benchmark tick */
+#define COLLECTOR_RAMP_EVT 0x0100
+/*! Event ID - Take back the in-flight frames whose confirm got lost */
+#define COLLECTOR_INFLIGHT_EVT 0x0200
 
 /*! CSF Events - Key Event */
 #define CSF_KEY_EVENT 0x0001
+/*! CSF Events - Write the new devices to NV */
+#define CSF_NV_BATCH_EVT 0x0002
 
 #define CSF_INVALID_SHORT_ADDR   0xFFFF
 
@@ -113,6 +127,23 @@ extern void Csf_processEvents(void);
  */
 extern bool Csf_getNetworkInformation(Llc_netInfo_t *pInfo);
 
+/*!
+ * @brief       The application calls this function at restart to retrieve
+ *              the network information and the device list. They are
+ *              loaded from the network snapshot with a single item read,
+ *              the snapshot is rebuilt from the individual NV items if it
+ *              is missing, damaged or out of date.
+ *
+ * @param       pInfo - pointer to network information structure
+ * @param       pNumDevices - number of entries in the device list
+ * @param       ppDevList - set to the device list, owned by this module and
+ *                          only valid until the device list changes
+ *
+ * @return      True if the network information is available
+ */
+extern bool Csf_getNetworkSnapshot(Llc_netInfo_t *pInfo, uint16_t *pNumDevices,
+                                   Llc_deviceListItem_t **ppDevList);
+
 /*!
  * @brief       The application calls this function to indicate that it has 
  *              started or restored the device in a network.
@@ -178,9 +209,11 @@ extern void Csf_deviceConfigUpdate(ApiMac_sAddr_t *pSrcAddr, int8_t rssi,
  *
  * @param       pSrcAddr - short address of the device that sent the message
  * @param       rssi - the received packet's signal strength
+ * @param       rxTime - Util_getTimeMs() when the indication arrived
  * @param       pMsg - pointer to the Sensor Data message
  */
 extern void Csf_deviceSensorDataUpdate(ApiMac_sAddr_t *pSrcAddr, int8_t rssi,
+                                       uint32_t rxTime,
                                        Smsgs_sensorMsg_t *pMsg);
 
 /*!
@@ -242,7 +275,8 @@ extern void Csf_initializeConfigClock(void);
 /*!
  * @brief       Set trickle clock
  *
- * @param       trickleTime - duration of trickle timer( in msec)
+ * @param       trickleTime - time until the trickle timer expires( in msec),
+ *                            0 to stop it
  * @param       frameType - type of Async frame
  */
 extern void Csf_setTrickleClock(uint32_t trickleTime, uint8_t frameType);
@@ -261,6 +295,96 @@ extern void Csf_setJoinPermitClock(uint32_t joinDuration);
  */
 extern void Csf_setConfigClock(uint32_t delay);
 
+/*!
+ * @brief       Initialize the channel monitor clock
+ */
+extern void Csf_initializeChanMonClock(void);
+
+/*!
+ * @brief       Set the channel monitor clock
+ *
+ * @param       delay - time until the next channel check( in msec)
+ */
+extern void Csf_setChanMonClock(uint32_t delay);
+
+/*!
+ * @brief       Initialize the OAD server clock
+ */
+extern void Csf_initializeOadClock(void);
+
+/*!
+ * @brief       Set the OAD server clock
+ *
+ * @param       delay - time until the OAD server is processed( in msec),
+ *                      0 to stop the clock
+ */
+extern void Csf_setOadClock(uint32_t delay);
+
+/*!
+ * @brief       Initialize the interval controller clock
+ */
+extern void Csf_initializeReportCtrlClock(void);
+
+/*!
+ * @brief       Set the interval controller clock
+ *
+ * @param       delay - time until the intervals are adapted( in msec),
+ *                      0 to stop the clock
+ */
+extern void Csf_setReportCtrlClock(uint32_t delay);
+
+/*!
+ * @brief       Initialize the duty cycle clock
+ */
+extern void Csf_initializeAirtimeClock(void);
+
+/*!
+ * @brief       Set the duty cycle clock
+ *
+ * @param       delay - time until the held back frames are retried( in msec),
+ *                      0 to stop the clock
+ */
+extern void Csf_setAirtimeClock(uint32_t delay);
+
+/*!
+ * @brief       Initialize the delivery manager clock
+ */
+extern void Csf_initializeDeliveryClock(void);
+
+/*!
+ * @brief       Set the delivery manager clock
+ *
+ * @param       delay - time until the delivery manager is processed( in msec),
+ *                      0 to stop the clock
+ */
+extern void Csf_setDeliveryClock(uint32_t delay);
+
+/*!
+ * @brief       Initialize the ramp benchmark clock
+ */
+extern void Csf_initializeRampClock(void);
+
+/*!
+ * @brief       Set the ramp benchmark clock
+ *
+ * @param       delay - time until the next benchmark tick( in msec),
+ *                      0 to stop the clock
+ */
+extern void Csf_setRampClock(uint32_t delay);
+
+/*!
+ * @brief       Initialize the in-flight sweep clock
+ */
+extern void Csf_initializeInFlightClock(void);
+
+/*!
+ * @brief       Set the in-flight sweep clock
+ *
+ * @param       delay - time until the stale frames are taken back( in msec),
+ *                      0 to stop the clock
+ */
+extern void Csf_setInFlightClock(uint32_t delay);
+
 /*!
  * @brief       Read the number of device list items stored
  *
@@ -356,6 +480,12 @@ extern void Csf_clearAllNVItems(void);
  */
 extern bool Csf_addBlackListItem(ApiMac_sAddr_t *pAddr);
 
+/*!
+ * @brief       The device admission filter changed. It is written to NV
+ *              after a delay, so a burst of updates costs one write.
+ */
+extern void Csf_devFilterUpdate(void);
+
 /*!
  * @brief       Check if config timer is active
  *
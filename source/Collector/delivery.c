@@ -0,0 +1,584 @@
+/******************************************************************************
+
+ @file delivery.c
+
+ @brief Downlink delivery manager
+
+ Group: WCS LPC
+ Target Device: CC13xx CC32xx
+
+ ******************************************************************************
+
+ Copyright (c) 2016-2017, Texas Instruments Incorporated
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions
+ are met:
+
+ *  Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+
+ *  Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+
+ *  Neither the name of Texas Instruments Incorporated nor the names of
+    its contributors may be used to endorse or promote products derived
+    from this software without specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+ ******************************************************************************
+ Release Name:
+ Release Date:
+ *****************************************************************************/
+
+/******************************************************************************
+ Includes
+ *****************************************************************************/
+#include <string.h>
+#include <Utils/util.h>
+#include <API_MAC/api_mac.h>
+#include "smsgs.h"
+#include "delivery.h"
+
+/******************************************************************************
+ Constants and definitions
+ *****************************************************************************/
+
+/* Command classes */
+#define CLASS_STATE     0
+#define CLASS_ACTION    1
+
+/* Entry states */
+typedef enum
+{
+    /* Entry not used */
+    entryState_free,
+    /* Handed to the collector, waiting in the host queue */
+    entryState_queued,
+    /* Held by the CoP, waiting for the data confirm */
+    entryState_held,
+    /* Waiting for the backoff to run out */
+    entryState_backoff,
+    /* Purge requested, waiting for the purge confirm */
+    entryState_purging
+} entryState_t;
+
+/******************************************************************************
+ Structures
+ *****************************************************************************/
+
+/* Retry policy of a command class */
+typedef struct
+{
+    uint8_t attempts;
+    uint16_t backoff;
+    uint32_t lifetime;
+} classPolicy_t;
+
+/* Followed command */
+typedef struct
+{
+    entryState_t state;
+    uint8_t cmdClass;
+    uint8_t msduHandle;
+    uint8_t attempts;
+    ApiMac_status_t lastStatus;
+    /* Outcome reported once the purge is confirmed */
+    Delivery_result_t purgeResult;
+    uint16_t shortAddr;
+    uint16_t cmdType;
+    /* Time of Delivery_send() */
+    uint32_t startTime;
+    /* End of the backoff or of the purge wait */
+    uint32_t nextTime;
+    uint8_t len;
+    uint8_t data[DELIVERY_MAX_FRAME_LEN];
+} entry_t;
+
+/******************************************************************************
+ Local variables
+ *****************************************************************************/
+
+/* Retry policy, indexed by command class */
+static const classPolicy_t classPolicy[] =
+{
+    { DELIVERY_STATE_ATTEMPTS, DELIVERY_STATE_BACKOFF,
+      DELIVERY_STATE_LIFETIME },
+    { DELIVERY_ACTION_ATTEMPTS, DELIVERY_ACTION_BACKOFF,
+      DELIVERY_ACTION_LIFETIME }
+};
+
+static entry_t entries[DELIVERY_MAX_ENTRIES];
+
+static const Delivery_callbacks_t *pDeliveryCbs = NULL;
+
+/******************************************************************************
+ Local function prototypes
+ *****************************************************************************/
+static uint8_t commandClass(uint8_t cmdId);
+static entry_t *findPending(uint16_t shortAddr, uint8_t cmdId);
+static entry_t *findHandle(uint8_t msduHandle);
+static entry_t *allocEntry(void);
+static void attempt(entry_t *pEntry);
+static void retryOrFail(entry_t *pEntry, ApiMac_status_t status);
+static void purge(entry_t *pEntry, Delivery_result_t result);
+static void finish(entry_t *pEntry, Delivery_result_t result);
+static void report(uint16_t shortAddr, uint16_t cmdType, uint8_t cmdId,
+                   Delivery_result_t result, uint8_t attempts,
+                   ApiMac_status_t lastStatus, uint32_t startTime);
+static bool timePassed(uint32_t now, uint32_t time);
+
+/******************************************************************************
+ Public Functions
+ *****************************************************************************/
+
+/*!
+ Initialize the manager and forget all commands
+
+ Public function defined in delivery.h
+ */
+void Delivery_init(const Delivery_callbacks_t *pCallbacks)
+{
+    pDeliveryCbs = pCallbacks;
+    memset(entries, 0, sizeof(entries));
+}
+
+/*!
+ Send a command to a device and follow it
+
+ Public function defined in delivery.h
+ */
+bool Delivery_send(uint16_t shortAddr, uint16_t cmdType, uint16_t len,
+                   uint8_t *pData)
+{
+    entry_t *pOld;
+    entry_t *pEntry;
+
+    if((pDeliveryCbs == NULL) || (len == 0))
+    {
+        return (false);
+    }
+
+    pOld = findPending(shortAddr, pData[0]);
+    if(pData[0] == Smsgs_cmdIds_toggleLedReq)
+    {
+        /* Two toggles leave the LED as it is, unless the first one is
+           already with the CoP */
+        if((pOld != NULL) && (pOld->state != entryState_held))
+        {
+            if(pOld->state == entryState_queued)
+            {
+                /* The host queue drops both frames */
+                pDeliveryCbs->pfnSend(shortAddr, len, pData);
+            }
+            finish(pOld, Delivery_result_superseded);
+            report(shortAddr, cmdType, pData[0], Delivery_result_superseded,
+                   0, ApiMac_status_success, Util_getTimeMs());
+            return (true);
+        }
+    }
+    else if(pOld != NULL)
+    {
+        if(pOld->state == entryState_held)
+        {
+            /* The new command goes out once the CoP let go of the old one */
+            purge(pOld, Delivery_result_superseded);
+        }
+        else
+        {
+            /* A queued frame is replaced in the host queue by the new one */
+            finish(pOld, Delivery_result_superseded);
+        }
+    }
+
+    pEntry = allocEntry();
+    if((pEntry == NULL) || (len > DELIVERY_MAX_FRAME_LEN))
+    {
+        /* Can't follow it, send it the old way */
+        return (pDeliveryCbs->pfnSend(shortAddr, len, pData));
+    }
+
+    pEntry->cmdClass = commandClass(pData[0]);
+    pEntry->shortAddr = shortAddr;
+    pEntry->cmdType = cmdType;
+    pEntry->startTime = Util_getTimeMs();
+    pEntry->lastStatus = ApiMac_status_success;
+    pEntry->len = (uint8_t)len;
+    memcpy(pEntry->data, pData, len);
+
+    attempt(pEntry);
+
+    return (true);
+}
+
+/*!
+ A data request was accepted by the CoP
+
+ Public function defined in delivery.h
+ */
+void Delivery_sent(uint16_t shortAddr, uint8_t cmdId, uint8_t msduHandle)
+{
+    uint8_t i;
+
+    for(i = 0; i < DELIVERY_MAX_ENTRIES; i++)
+    {
+        if((entries[i].state == entryState_queued)
+           && (entries[i].shortAddr == shortAddr)
+           && (entries[i].data[0] == cmdId))
+        {
+            entries[i].state = entryState_held;
+            entries[i].msduHandle = msduHandle;
+            break;
+        }
+    }
+}
+
+/*!
+ Process a data confirm
+
+ Public function defined in delivery.h
+ */
+void Delivery_txDone(uint8_t msduHandle, ApiMac_status_t status)
+{
+    entry_t *pEntry = findHandle(msduHandle);
+
+    if(pEntry == NULL)
+    {
+        return;
+    }
+
+    if(status == ApiMac_status_success)
+    {
+        /* Even a superseded frame counts once the device has it */
+        finish(pEntry, Delivery_result_delivered);
+    }
+    else if(pEntry->state == entryState_purging)
+    {
+        /* The confirm overtook the purge request */
+        pEntry->lastStatus = status;
+        finish(pEntry, pEntry->purgeResult);
+    }
+    else
+    {
+        retryOrFail(pEntry, status);
+    }
+}
+
+/*!
+ Process a purge confirm
+
+ Public function defined in delivery.h
+ */
+void Delivery_purgeCnf(uint8_t msduHandle, ApiMac_status_t status)
+{
+    entry_t *pEntry = findHandle(msduHandle);
+
+    /* If the CoP did not have the frame any more the data confirm follows */
+    if((pEntry != NULL) && (pEntry->state == entryState_purging)
+       && (status == ApiMac_status_success))
+    {
+        finish(pEntry, pEntry->purgeResult);
+    }
+}
+
+/*!
+ Retry the commands whose backoff ran out and give up the expired ones
+
+ Public function defined in delivery.h
+ */
+bool Delivery_process(void)
+{
+    uint32_t now = Util_getTimeMs();
+    bool pending = false;
+    uint8_t i;
+
+    for(i = 0; i < DELIVERY_MAX_ENTRIES; i++)
+    {
+        entry_t *pEntry = &entries[i];
+        bool expired = timePassed(now, pEntry->startTime
+                                  + classPolicy[pEntry->cmdClass].lifetime);
+
+        switch(pEntry->state)
+        {
+            case entryState_queued:
+                if(expired)
+                {
+                    pDeliveryCbs->pfnCancel(pEntry->shortAddr,
+                                            pEntry->data[0]);
+                    finish(pEntry, Delivery_result_expired);
+                }
+                break;
+
+            case entryState_held:
+                if(expired)
+                {
+                    purge(pEntry, Delivery_result_expired);
+                }
+                break;
+
+            case entryState_backoff:
+                if(expired)
+                {
+                    finish(pEntry, Delivery_result_expired);
+                }
+                else if(timePassed(now, pEntry->nextTime))
+                {
+                    attempt(pEntry);
+                }
+                break;
+
+            case entryState_purging:
+                /* Don't wait for a lost purge confirm forever */
+                if(timePassed(now, pEntry->nextTime))
+                {
+                    finish(pEntry, pEntry->purgeResult);
+                }
+                break;
+
+            default:
+                break;
+        }
+
+        if(pEntry->state != entryState_free)
+        {
+            pending = true;
+        }
+    }
+
+    return (pending);
+}
+
+/******************************************************************************
+ Local Functions
+ *****************************************************************************/
+
+/*!
+ * @brief       Get the class of a command
+ *
+ * @param       cmdId - command ID
+ *
+ * @return      CLASS_STATE or CLASS_ACTION
+ */
+static uint8_t commandClass(uint8_t cmdId)
+{
+    if((cmdId == Smsgs_cmdIds_toggleLedReq)
+       || (cmdId == Smsgs_cmdIds_buzzerCtrlReq))
+    {
+        return (CLASS_ACTION);
+    }
+
+    return (CLASS_STATE);
+}
+
+/*!
+ * @brief       Find the command of a type to a device that was not
+ *              delivered yet and is not being purged. A command the CoP
+ *              does not hold yet is preferred.
+ *
+ * @param       shortAddr - short address of the device
+ * @param       cmdId - command ID
+ *
+ * @return      pointer to the entry, NULL if there is none
+ */
+static entry_t *findPending(uint16_t shortAddr, uint8_t cmdId)
+{
+    entry_t *pHeld = NULL;
+    uint8_t i;
+
+    for(i = 0; i < DELIVERY_MAX_ENTRIES; i++)
+    {
+        if((entries[i].state != entryState_free)
+           && (entries[i].state != entryState_purging)
+           && (entries[i].shortAddr == shortAddr)
+           && (entries[i].data[0] == cmdId))
+        {
+            if(entries[i].state != entryState_held)
+            {
+                return (&entries[i]);
+            }
+            pHeld = &entries[i];
+        }
+    }
+
+    return (pHeld);
+}
+
+/*!
+ * @brief       Find the command held by the CoP under an MSDU handle
+ *
+ * @param       msduHandle - MSDU handle
+ *
+ * @return      pointer to the entry, NULL if there is none
+ */
+static entry_t *findHandle(uint8_t msduHandle)
+{
+    uint8_t i;
+
+    for(i = 0; i < DELIVERY_MAX_ENTRIES; i++)
+    {
+        if(((entries[i].state == entryState_held)
+            || (entries[i].state == entryState_purging))
+           && (entries[i].msduHandle == msduHandle))
+        {
+            return (&entries[i]);
+        }
+    }
+
+    return (NULL);
+}
+
+/*!
+ * @brief       Get a free entry
+ *
+ * @return      pointer to the entry, NULL if all are used
+ */
+static entry_t *allocEntry(void)
+{
+    uint8_t i;
+
+    for(i = 0; i < DELIVERY_MAX_ENTRIES; i++)
+    {
+        if(entries[i].state == entryState_free)
+        {
+            return (&entries[i]);
+        }
+    }
+
+    return (NULL);
+}
+
+/*!
+ * @brief       Hand the command to the collector
+ *
+ * @param       pEntry - command
+ */
+static void attempt(entry_t *pEntry)
+{
+    pEntry->attempts++;
+    pEntry->state = entryState_queued;
+
+    /* Delivery_sent() moves the entry on once the CoP accepted the frame */
+    if(pDeliveryCbs->pfnSend(pEntry->shortAddr, pEntry->len, pEntry->data)
+       == false)
+    {
+        retryOrFail(pEntry, pEntry->lastStatus);
+    }
+}
+
+/*!
+ * @brief       Schedule the next attempt of a command that was not
+ *              delivered, or give it up after the last attempt
+ *
+ * @param       pEntry - command
+ * @param       status - status of the failed attempt
+ */
+static void retryOrFail(entry_t *pEntry, ApiMac_status_t status)
+{
+    const classPolicy_t *pPolicy = &classPolicy[pEntry->cmdClass];
+    uint32_t backoff;
+
+    pEntry->lastStatus = status;
+    if(pEntry->attempts >= pPolicy->attempts)
+    {
+        finish(pEntry, Delivery_result_failed);
+        return;
+    }
+
+    backoff = (uint32_t)pPolicy->backoff << (pEntry->attempts - 1);
+    if(backoff > DELIVERY_MAX_BACKOFF)
+    {
+        backoff = DELIVERY_MAX_BACKOFF;
+    }
+
+    pEntry->state = entryState_backoff;
+    pEntry->nextTime = Util_getTimeMs() + backoff;
+}
+
+/*!
+ * @brief       Ask the CoP to drop the frame of a command
+ *
+ * @param       pEntry - command held by the CoP
+ * @param       result - outcome reported once the purge is confirmed
+ */
+static void purge(entry_t *pEntry, Delivery_result_t result)
+{
+    pEntry->state = entryState_purging;
+    pEntry->purgeResult = result;
+    pEntry->nextTime = Util_getTimeMs() + DELIVERY_PURGE_WAIT;
+
+    /* If the request fails the data confirm ends the command */
+    ApiMac_mcpsPurgeReq(pEntry->msduHandle);
+}
+
+/*!
+ * @brief       Report the outcome of a command and free its entry
+ *
+ * @param       pEntry - command
+ * @param       result - outcome
+ */
+static void finish(entry_t *pEntry, Delivery_result_t result)
+{
+    report(pEntry->shortAddr, pEntry->cmdType, pEntry->data[0], result,
+           pEntry->attempts, pEntry->lastStatus, pEntry->startTime);
+    memset(pEntry, 0, sizeof(entry_t));
+}
+
+/*!
+ * @brief       Report the outcome of a command
+ *
+ * @param       shortAddr - short address of the device
+ * @param       cmdType - command type
+ * @param       cmdId - command ID
+ * @param       result - outcome
+ * @param       attempts - frames handed to the CoP
+ * @param       lastStatus - status of the last data confirm
+ * @param       startTime - time the command was sent
+ */
+static void report(uint16_t shortAddr, uint16_t cmdType, uint8_t cmdId,
+                   Delivery_result_t result, uint8_t attempts,
+                   ApiMac_status_t lastStatus, uint32_t startTime)
+{
+    Delivery_outcome_t outcome;
+
+    if(pDeliveryCbs->pfnOutcome == NULL)
+    {
+        return;
+    }
+
+    outcome.shortAddr = shortAddr;
+    outcome.cmdType = cmdType;
+    outcome.cmdId = cmdId;
+    outcome.result = result;
+    outcome.attempts = attempts;
+    outcome.lastStatus = lastStatus;
+    outcome.elapsedMs = Util_getTimeMs() - startTime;
+
+    pDeliveryCbs->pfnOutcome(&outcome);
+}
+
+/*!
+ * @brief       Check if a time has passed, handles the millisecond counter
+ *              wrapping around
+ *
+ * @param       now - current time
+ * @param       time - time to check
+ *
+ * @return      true if time is not after now
+ */
+static bool timePassed(uint32_t now, uint32_t time)
+{
+    return ((int32_t)(now - time) >= 0);
+}
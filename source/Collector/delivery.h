@@ -0,0 +1,236 @@
+/******************************************************************************
+
+ @file delivery.h
+
+ @brief Downlink delivery manager
+
+ Group: WCS LPC
+ Target Device: CC13xx CC32xx
+
+ ******************************************************************************
+
+ Copyright (c) 2016-2017, Texas Instruments Incorporated
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions
+ are met:
+
+ *  Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+
+ *  Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+
+ *  Neither the name of Texas Instruments Incorporated nor the names of
+    its contributors may be used to endorse or promote products derived
+    from this software without specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+ ******************************************************************************
+ Release Name:
+ Release Date:
+ *****************************************************************************/
+
+#ifndef COLLECTOR_DELIVERY_H_
+#define COLLECTOR_DELIVERY_H_
+//*****************************************************************************
+//
+// If building with a C++ compiler, make all of the definitions in this header
+// have a C binding.
+//
+//*****************************************************************************
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <API_MAC/api_mac.h>
+#include "config.h"
+#include "smsgs.h"
+
+/*!
+ \defgroup Delivery Manager
+ <BR>
+ The delivery manager follows each command sent to a device from the time it
+ is handed to the collector until the device acknowledged it or the command
+ was given up. Failed frames are sent again after a backoff, commands that
+ outlived their class lifetime or were superseded by a newer command of the
+ same type are dropped from the host queue or purged from the CoP, and the
+ final outcome is reported once per command.
+ <BR>
+ Commands are put in one of two classes:
+     - State commands (fan speed, door lock, set points) - only the newest
+     value matters, a newer command supersedes an older one
+     - Action commands (LED toggle, buzzer) - each command counts, they get
+     fewer attempts and a shorter lifetime since a late action is worse
+     than none
+ */
+
+/******************************************************************************
+ Constants and definitions
+ *****************************************************************************/
+
+/*! Commands that can be followed at the same time, more are sent untracked */
+#ifndef DELIVERY_MAX_ENTRIES
+#define DELIVERY_MAX_ENTRIES        16
+#endif
+
+/*! Largest command that can be followed */
+#define DELIVERY_MAX_FRAME_LEN      8
+
+/*! Attempts, first backoff and lifetime of state commands. A sleepy device
+    gets the frame with its next poll, the lifetime covers a few polls. */
+#define DELIVERY_STATE_ATTEMPTS     4
+#define DELIVERY_STATE_BACKOFF      1000
+#define DELIVERY_STATE_LIFETIME     (4 * CONFIG_POLLING_INTERVAL)
+
+/*! Attempts, first backoff and lifetime of action commands */
+#define DELIVERY_ACTION_ATTEMPTS    2
+#define DELIVERY_ACTION_BACKOFF     500
+#define DELIVERY_ACTION_LIFETIME    (2 * CONFIG_POLLING_INTERVAL)
+
+/*! Longest backoff, the backoff doubles with each attempt up to this */
+#define DELIVERY_MAX_BACKOFF        30000
+
+/*! Time to wait for the purge confirm before the command is given up */
+#define DELIVERY_PURGE_WAIT         5000
+
+/*! Interval of Delivery_process() while commands are followed */
+#define DELIVERY_TICK_MS            250
+
+/*! Final outcome of a command */
+typedef enum
+{
+    /*! Acknowledged by the device */
+    Delivery_result_delivered,
+    /*! Not acknowledged after the last attempt */
+    Delivery_result_failed,
+    /*! Lifetime ran out before the device acknowledged it */
+    Delivery_result_expired,
+    /*! Replaced by a newer command of the same type */
+    Delivery_result_superseded
+} Delivery_result_t;
+
+/******************************************************************************
+ Structures
+ *****************************************************************************/
+
+/*! Final outcome of a command */
+typedef struct
+{
+    /*! Short address of the device */
+    uint16_t shortAddr;
+    /*! Command type the command came with, CmdTypes */
+    uint16_t cmdType;
+    /*! Message command ID, Smsgs_cmdIds_t */
+    uint8_t cmdId;
+    Delivery_result_t result;
+    /*! Frames handed to the CoP */
+    uint8_t attempts;
+    /*! Status of the last data confirm, success if there was none */
+    ApiMac_status_t lastStatus;
+    /*! Time from Delivery_send() to the outcome, in milliseconds */
+    uint32_t elapsedMs;
+} Delivery_outcome_t;
+
+/*! Callbacks of the delivery manager */
+typedef struct
+{
+    /*! Sends or queues a frame to a device, returns true if sent or
+        queued. The frame starts with the command ID. */
+    bool (*pfnSend)(uint16_t shortAddr, uint16_t len, uint8_t *pData);
+    /*! Drops the frame of a command still waiting in the host queue */
+    void (*pfnCancel)(uint16_t shortAddr, uint8_t cmdId);
+    /*! Reports the final outcome of a command, can be NULL */
+    void (*pfnOutcome)(Delivery_outcome_t *pOutcome);
+} Delivery_callbacks_t;
+
+/******************************************************************************
+ Function Prototypes
+ *****************************************************************************/
+
+/*!
+ * @brief       Initialize the manager and forget all commands
+ *
+ * @param       pCallbacks - manager callbacks, must stay valid
+ */
+extern void Delivery_init(const Delivery_callbacks_t *pCallbacks);
+
+/*!
+ * @brief       Send a command to a device and follow it until its outcome
+ *              is known. An older command of the same type that was not
+ *              delivered yet is superseded, two LED toggles cancel each
+ *              other.
+ *
+ * @param       shortAddr - short address of the device
+ * @param       cmdType - command type reported with the outcome
+ * @param       len - length of the frame
+ * @param       pData - frame, starting with the command ID
+ *
+ * @return      true if sent, queued or waiting for a retry
+ */
+extern bool Delivery_send(uint16_t shortAddr, uint16_t cmdType, uint16_t len,
+                          uint8_t *pData);
+
+/*!
+ * @brief       A data request was accepted by the CoP. Called for every
+ *              data request, frames of commands that are not followed are
+ *              ignored.
+ *
+ * @param       shortAddr - destination short address
+ * @param       cmdId - command ID of the frame
+ * @param       msduHandle - MSDU handle of the data request
+ */
+extern void Delivery_sent(uint16_t shortAddr, uint8_t cmdId,
+                          uint8_t msduHandle);
+
+/*!
+ * @brief       Process a data confirm
+ *
+ * @param       msduHandle - MSDU handle of the confirm
+ * @param       status - status of the confirm
+ */
+extern void Delivery_txDone(uint8_t msduHandle, ApiMac_status_t status);
+
+/*!
+ * @brief       Process a purge confirm
+ *
+ * @param       msduHandle - MSDU handle of the confirm
+ * @param       status - status of the confirm
+ */
+extern void Delivery_purgeCnf(uint8_t msduHandle, ApiMac_status_t status);
+
+/*!
+ * @brief       Retry the commands whose backoff ran out and give up the
+ *              expired ones
+ *
+ * @return      true if commands are still followed, call again after
+ *              DELIVERY_TICK_MS
+ */
+extern bool Delivery_process(void);
+
+//*****************************************************************************
+//
+// Mark the end of the C bindings section for C++ compilers.
+//
+//*****************************************************************************
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* COLLECTOR_DELIVERY_H_ */
@@ -0,0 +1,460 @@
+/******************************************************************************
+
+ @file devFilter.c
+
+ @brief RAM resident device admission filter
+
+ Group: WCS LPC
+ Target Device: CC13xx CC32xx
+
+ ******************************************************************************
+
+ Copyright (c) 2016-2017, Texas Instruments Incorporated
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions
+ are met:
+
+ *  Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+
+ *  Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+
+ *  Neither the name of Texas Instruments Incorporated nor the names of
+    its contributors may be used to endorse or promote products derived
+    from this software without specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+ ******************************************************************************
+ Release Name:
+ Release Date:
+ *****************************************************************************/
+
+/******************************************************************************
+ Includes
+ *****************************************************************************/
+#include <string.h>
+#include <Common/commonDefs.h>
+#include <API_MAC/api_mac.h>
+#include "config.h"
+#include "LinkController/llc.h"
+#include "LinkController/cllc.h"
+#include "smsgs.h"
+#include "csf.h"
+#include "devFilter.h"
+
+/******************************************************************************
+ Constants and definitions
+ *****************************************************************************/
+
+#define DEV_FILTER_HASH_MASK    (DEV_FILTER_HASH_SIZE - 1)
+
+/* Short addresses are handed out sequentially, so the low bits spread well */
+#define DEV_FILTER_HASH_SHORT(addr)    ((addr) & DEV_FILTER_HASH_MASK)
+
+/* Empty hash slot */
+#define DEV_FILTER_SLOT_EMPTY   0
+
+#if (DEV_FILTER_HASH_SIZE < (2 * DEV_FILTER_MAX_ENTRIES))
+#error "DEV_FILTER_HASH_SIZE must be at least twice DEV_FILTER_MAX_ENTRIES"
+#endif
+
+/******************************************************************************
+ Local variables
+ *****************************************************************************/
+
+/*! Filter entries, packed */
+static DevFilter_entry_t filterEntries[DEV_FILTER_MAX_ENTRIES];
+/*! Short address of each entry, INVALID_SHORT_ADDR if not known */
+static uint16_t filterShort[DEV_FILTER_MAX_ENTRIES];
+static uint16_t numFilterEntries = 0;
+
+/*!
+ Hash indexes on the extended and on the short address, open addressing
+ with linear probing. A slot holds the entry index + 1, 0 if empty.
+ */
+static uint8_t extIndex[DEV_FILTER_HASH_SIZE];
+static uint8_t shortIndex[DEV_FILTER_HASH_SIZE];
+
+static DevFilter_mode_t filterMode = DevFilter_mode_deny;
+
+static DevFilter_stats_t filterStats;
+
+/******************************************************************************
+ Local function prototypes
+ *****************************************************************************/
+static uint16_t hashExt(ApiMac_sAddrExt_t *pExtAddr);
+static int findExt(ApiMac_sAddrExt_t *pExtAddr);
+static int findShort(uint16_t shortAddr);
+static void setShort(int idx, uint16_t shortAddr);
+static void rebuildIndex(void);
+static bool admitEntry(int idx);
+
+/******************************************************************************
+ Public Functions
+ *****************************************************************************/
+
+/*!
+ Clear the filter and set deny mode
+
+ Public function defined in devFilter.h
+ */
+void DevFilter_init(void)
+{
+    numFilterEntries = 0;
+    filterMode = DevFilter_mode_deny;
+    memset(&filterStats, 0, sizeof(filterStats));
+    rebuildIndex();
+}
+
+/*!
+ Replace the filter with a persisted copy
+
+ Public function defined in devFilter.h
+ */
+void DevFilter_load(DevFilter_mode_t mode, uint16_t numEntries,
+                    DevFilter_entry_t *pEntries)
+{
+    uint16_t i;
+
+    if(numEntries > DEV_FILTER_MAX_ENTRIES)
+    {
+        numEntries = DEV_FILTER_MAX_ENTRIES;
+    }
+
+    filterMode = mode;
+    memcpy(filterEntries, pEntries, sizeof(DevFilter_entry_t) * numEntries);
+    for(i = 0; i < numEntries; i++)
+    {
+        filterShort[i] = INVALID_SHORT_ADDR;
+    }
+    numFilterEntries = numEntries;
+    rebuildIndex();
+}
+
+/*!
+ Get the filter contents to persist them
+
+ Public function defined in devFilter.h
+ */
+uint16_t DevFilter_get(DevFilter_mode_t *pMode, DevFilter_entry_t **ppEntries)
+{
+    *pMode = filterMode;
+    *ppEntries = filterEntries;
+    return (numFilterEntries);
+}
+
+/*!
+ Apply a filter command
+
+ Public function defined in devFilter.h
+ */
+bool DevFilter_processCmd(ApiMac_sAddrExt_t *pExtAddr, uint16_t shortAddr,
+                          DevFilter_cmd_t cmd)
+{
+    int idx;
+
+    switch(cmd)
+    {
+        case DevFilter_cmd_modeDeny:
+            filterMode = DevFilter_mode_deny;
+            break;
+
+        case DevFilter_cmd_modeAllow:
+            filterMode = DevFilter_mode_allow;
+            break;
+
+        case DevFilter_cmd_remove:
+            idx = findExt(pExtAddr);
+            if(idx < 0)
+            {
+                return (true);
+            }
+
+            /* Move the last entry into the hole */
+            numFilterEntries--;
+            filterEntries[idx] = filterEntries[numFilterEntries];
+            filterShort[idx] = filterShort[numFilterEntries];
+            rebuildIndex();
+            break;
+
+        case DevFilter_cmd_deny:
+        case DevFilter_cmd_allow:
+            idx = findExt(pExtAddr);
+            if(idx < 0)
+            {
+                if(numFilterEntries == DEV_FILTER_MAX_ENTRIES)
+                {
+                    return (false);
+                }
+                idx = numFilterEntries++;
+                memcpy(filterEntries[idx].extAddr, pExtAddr,
+                       sizeof(ApiMac_sAddrExt_t));
+                filterShort[idx] = INVALID_SHORT_ADDR;
+            }
+            filterEntries[idx].verdict = (cmd == DevFilter_cmd_deny) ?
+                            DevFilter_verdict_deny : DevFilter_verdict_allow;
+            if(shortAddr != INVALID_SHORT_ADDR)
+            {
+                setShort(idx, shortAddr);
+            }
+            rebuildIndex();
+            break;
+
+        default:
+            return (false);
+    }
+
+    /* Written to NV later, several updates are written together */
+    Csf_devFilterUpdate();
+
+    return (true);
+}
+
+/*!
+ Record the short address given to a device
+
+ Public function defined in devFilter.h
+ */
+void DevFilter_bindShort(ApiMac_sAddrExt_t *pExtAddr, uint16_t shortAddr)
+{
+    int idx;
+
+    if(numFilterEntries == 0)
+    {
+        return;
+    }
+
+    idx = findExt(pExtAddr);
+    if((idx >= 0) && (filterShort[idx] != shortAddr))
+    {
+        setShort(idx, shortAddr);
+        rebuildIndex();
+    }
+}
+
+/*!
+ Check if a device may associate or realign
+
+ Public function defined in devFilter.h
+ */
+bool DevFilter_admitAssoc(ApiMac_sAddrExt_t *pExtAddr)
+{
+    if((numFilterEntries == 0) && (filterMode == DevFilter_mode_deny))
+    {
+        return (true);
+    }
+
+    if(admitEntry(findExt(pExtAddr)) == false)
+    {
+        filterStats.assocDenied++;
+        return (false);
+    }
+    return (true);
+}
+
+/*!
+ Check if a received frame is admitted
+
+ Public function defined in devFilter.h
+ */
+bool DevFilter_admitFrame(ApiMac_sAddr_t *pSrcAddr)
+{
+    int idx = -1;
+
+    if((numFilterEntries == 0) && (filterMode == DevFilter_mode_deny))
+    {
+        return (true);
+    }
+
+    if(pSrcAddr->addrMode == ApiMac_addrType_short)
+    {
+        idx = findShort(pSrcAddr->addr.shortAddr);
+    }
+    else if(pSrcAddr->addrMode == ApiMac_addrType_extended)
+    {
+        idx = findExt(&pSrcAddr->addr.extAddr);
+    }
+
+    if(admitEntry(idx) == false)
+    {
+        filterStats.framesDropped++;
+        return (false);
+    }
+    return (true);
+}
+
+/*!
+ Get the filter statistics
+
+ Public function defined in devFilter.h
+ */
+void DevFilter_getStats(DevFilter_stats_t *pStats)
+{
+    memcpy(pStats, &filterStats, sizeof(DevFilter_stats_t));
+}
+
+/******************************************************************************
+ Local Functions
+ *****************************************************************************/
+
+/*!
+ * @brief       Hash an extended address
+ *
+ * @param       pExtAddr - extended address
+ *
+ * @return      first hash slot to probe
+ */
+static uint16_t hashExt(ApiMac_sAddrExt_t *pExtAddr)
+{
+    uint8_t *pByte = (uint8_t *)pExtAddr;
+    uint16_t hash = 0;
+    uint8_t i;
+
+    for(i = 0; i < APIMAC_SADDR_EXT_LEN; i++)
+    {
+        hash = (hash * 31) + pByte[i];
+    }
+    return (hash & DEV_FILTER_HASH_MASK);
+}
+
+/*!
+ * @brief       Find the entry of an extended address
+ *
+ * @param       pExtAddr - extended address
+ *
+ * @return      entry index, -1 if not found
+ */
+static int findExt(ApiMac_sAddrExt_t *pExtAddr)
+{
+    uint16_t slot = hashExt(pExtAddr);
+
+    while(extIndex[slot] != DEV_FILTER_SLOT_EMPTY)
+    {
+        int idx = extIndex[slot] - 1;
+
+        if(memcmp(filterEntries[idx].extAddr, pExtAddr,
+                  APIMAC_SADDR_EXT_LEN) == 0)
+        {
+            return (idx);
+        }
+        slot = (slot + 1) & DEV_FILTER_HASH_MASK;
+    }
+    return (-1);
+}
+
+/*!
+ * @brief       Find the entry of a short address
+ *
+ * @param       shortAddr - short address
+ *
+ * @return      entry index, -1 if not found
+ */
+static int findShort(uint16_t shortAddr)
+{
+    uint16_t slot = DEV_FILTER_HASH_SHORT(shortAddr);
+
+    while(shortIndex[slot] != DEV_FILTER_SLOT_EMPTY)
+    {
+        int idx = shortIndex[slot] - 1;
+
+        if(filterShort[idx] == shortAddr)
+        {
+            return (idx);
+        }
+        slot = (slot + 1) & DEV_FILTER_HASH_MASK;
+    }
+    return (-1);
+}
+
+/*!
+ * @brief       Set the short address of an entry. A short address belongs
+ *              to one device only, it is taken away from any other entry.
+ *              The indexes must be rebuilt afterwards.
+ *
+ * @param       idx - entry index
+ * @param       shortAddr - short address
+ */
+static void setShort(int idx, uint16_t shortAddr)
+{
+    uint16_t i;
+
+    for(i = 0; i < numFilterEntries; i++)
+    {
+        if(filterShort[i] == shortAddr)
+        {
+            filterShort[i] = INVALID_SHORT_ADDR;
+        }
+    }
+    filterShort[idx] = shortAddr;
+}
+
+/*!
+ * @brief       Rebuild both hash indexes from the entries. Entries are only
+ *              changed from the gateway, so this is simpler than deleting
+ *              from the open addressing tables.
+ */
+static void rebuildIndex(void)
+{
+    uint16_t i;
+
+    memset(extIndex, DEV_FILTER_SLOT_EMPTY, sizeof(extIndex));
+    memset(shortIndex, DEV_FILTER_SLOT_EMPTY, sizeof(shortIndex));
+
+    for(i = 0; i < numFilterEntries; i++)
+    {
+        uint16_t slot = hashExt(&filterEntries[i].extAddr);
+
+        while(extIndex[slot] != DEV_FILTER_SLOT_EMPTY)
+        {
+            slot = (slot + 1) & DEV_FILTER_HASH_MASK;
+        }
+        extIndex[slot] = (uint8_t)(i + 1);
+
+        if(filterShort[i] != INVALID_SHORT_ADDR)
+        {
+            slot = DEV_FILTER_HASH_SHORT(filterShort[i]);
+            while(shortIndex[slot] != DEV_FILTER_SLOT_EMPTY)
+            {
+                slot = (slot + 1) & DEV_FILTER_HASH_MASK;
+            }
+            shortIndex[slot] = (uint8_t)(i + 1);
+        }
+    }
+}
+
+/*!
+ * @brief       Decide if the device of an entry is admitted
+ *
+ * @param       idx - entry index, -1 for a device not in the filter
+ *
+ * @return      true if admitted, false if not
+ */
+static bool admitEntry(int idx)
+{
+    if((idx >= 0) && (filterEntries[idx].verdict == DevFilter_verdict_deny))
+    {
+        return (false);
+    }
+
+    if(filterMode == DevFilter_mode_allow)
+    {
+        return ((idx >= 0)
+                && (filterEntries[idx].verdict == DevFilter_verdict_allow));
+    }
+    return (true);
+}
@@ -0,0 +1,225 @@
+/******************************************************************************
+
+ @file devFilter.h
+
+ @brief RAM resident device admission filter
+
+ Group: WCS LPC
+ Target Device: CC13xx CC32xx
+
+ ******************************************************************************
+
+ Copyright (c) 2016-2017, Texas Instruments Incorporated
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions
+ are met:
+
+ *  Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+
+ *  Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+
+ *  Neither the name of Texas Instruments Incorporated nor the names of
+    its contributors may be used to endorse or promote products derived
+    from this software without specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+ ******************************************************************************
+ Release Name:
+ Release Date:
+ *****************************************************************************/
+
+#ifndef COLLECTOR_DEVFILTER_H_
+#define COLLECTOR_DEVFILTER_H_
+//*****************************************************************************
+//
+// If building with a C++ compiler, make all of the definitions in this header
+// have a C binding.
+//
+//*****************************************************************************
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <API_MAC/api_mac.h>
+
+/******************************************************************************
+ Constants and definitions
+ *****************************************************************************/
+
+/*! Maximum number of devices in the filter, at most 255 */
+#define DEV_FILTER_MAX_ENTRIES  64
+
+/*! Number of hash slots, must be a power of 2 and twice the entries */
+#define DEV_FILTER_HASH_SIZE    128
+
+/******************************************************************************
+ Typedefs
+ *****************************************************************************/
+
+/*! Filter modes */
+typedef enum
+{
+    /*! Admit every device that is not denied */
+    DevFilter_mode_deny = 0,
+    /*! Admit only the allowed devices */
+    DevFilter_mode_allow = 1
+} DevFilter_mode_t;
+
+/*! Verdict of a filter entry */
+typedef enum
+{
+    /*! The device is never admitted */
+    DevFilter_verdict_deny = 1,
+    /*! The device is admitted in allow mode */
+    DevFilter_verdict_allow = 2
+} DevFilter_verdict_t;
+
+/*! Filter update commands, the data of a filter command from the gateway */
+typedef enum
+{
+    /*! Remove the device from the filter */
+    DevFilter_cmd_remove = 0,
+    /*! Deny the device */
+    DevFilter_cmd_deny = 1,
+    /*! Allow the device */
+    DevFilter_cmd_allow = 2,
+    /*! Switch to deny mode */
+    DevFilter_cmd_modeDeny = 3,
+    /*! Switch to allow mode */
+    DevFilter_cmd_modeAllow = 4
+} DevFilter_cmd_t;
+
+/******************************************************************************
+ Structures
+ *****************************************************************************/
+
+/*! Filter entry, this is also the format persisted in NV */
+typedef struct
+{
+    /*! Extended address of the device */
+    ApiMac_sAddrExt_t extAddr;
+    /*! Verdict, DevFilter_verdict_t */
+    uint8_t verdict;
+} DevFilter_entry_t;
+
+/*! Filter statistics */
+typedef struct
+{
+    /*! Associations and orphan notifications refused */
+    uint32_t assocDenied;
+    /*! Data frames dropped */
+    uint32_t framesDropped;
+} DevFilter_stats_t;
+
+/******************************************************************************
+ Function Prototypes
+ *****************************************************************************/
+
+/*!
+ * @brief       Clear the filter and set deny mode
+ */
+extern void DevFilter_init(void);
+
+/*!
+ * @brief       Replace the filter with a persisted copy. Does not mark the
+ *              filter as changed.
+ *
+ * @param       mode - filter mode
+ * @param       numEntries - number of entries in pEntries
+ * @param       pEntries - filter entries
+ */
+extern void DevFilter_load(DevFilter_mode_t mode, uint16_t numEntries,
+                           DevFilter_entry_t *pEntries);
+
+/*!
+ * @brief       Get the filter contents to persist them
+ *
+ * @param       pMode - filled in with the filter mode
+ * @param       ppEntries - set to the filter entries
+ *
+ * @return      number of entries
+ */
+extern uint16_t DevFilter_get(DevFilter_mode_t *pMode,
+                              DevFilter_entry_t **ppEntries);
+
+/*!
+ * @brief       Apply a filter command. Changes are persisted through
+ *              Csf_devFilterUpdate().
+ *
+ * @param       pExtAddr - extended address of the device, not used by the
+ *                         mode commands
+ * @param       shortAddr - short address of the device if it is already in
+ *                          the network, INVALID_SHORT_ADDR if not known
+ * @param       cmd - filter command
+ *
+ * @return      true if the command was applied, false if the filter is full
+ *              or the command is unknown
+ */
+extern bool DevFilter_processCmd(ApiMac_sAddrExt_t *pExtAddr,
+                                 uint16_t shortAddr, DevFilter_cmd_t cmd);
+
+/*!
+ * @brief       Record the short address given to a device, so that frames
+ *              with a short source address can be checked
+ *
+ * @param       pExtAddr - extended address of the device
+ * @param       shortAddr - short address of the device
+ */
+extern void DevFilter_bindShort(ApiMac_sAddrExt_t *pExtAddr,
+                                uint16_t shortAddr);
+
+/*!
+ * @brief       Check if a device may associate or realign
+ *
+ * @param       pExtAddr - extended address of the device
+ *
+ * @return      true if admitted, false if not
+ */
+extern bool DevFilter_admitAssoc(ApiMac_sAddrExt_t *pExtAddr);
+
+/*!
+ * @brief       Check if a received frame is admitted. Called for every data
+ *              indication before it is processed.
+ *
+ * @param       pSrcAddr - source address of the frame
+ *
+ * @return      true if admitted, false if the frame must be dropped
+ */
+extern bool DevFilter_admitFrame(ApiMac_sAddr_t *pSrcAddr);
+
+/*!
+ * @brief       Get the filter statistics
+ *
+ * @param       pStats - copy of the statistics
+ */
+extern void DevFilter_getStats(DevFilter_stats_t *pStats);
+
+//*****************************************************************************
+//
+// Mark the end of the C bindings section for C++ compilers.
+//
+//*****************************************************************************
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* COLLECTOR_DEVFILTER_H_ */
@@ -0,0 +1,239 @@
+/******************************************************************************
+
+ @file devGroups.c
+
+ @brief Named device groups for group actuator commands
+
+ Group: WCS LPC
+ Target Device: CC13xx CC32xx
+
+ ******************************************************************************
+
+ Copyright (c) 2016-2017, Texas Instruments Incorporated
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions
+ are met:
+
+ *  Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+
+ *  Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+
+ *  Neither the name of Texas Instruments Incorporated nor the names of
+    its contributors may be used to endorse or promote products derived
+    from this software without specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+ ******************************************************************************
+ Release Name:
+ Release Date:
+ *****************************************************************************/
+
+/******************************************************************************
+ Includes
+ *****************************************************************************/
+#include <string.h>
+#include <Common/commonDefs.h>
+#include "config.h"
+#include "devGroups.h"
+
+/******************************************************************************
+ Constants and definitions
+ *****************************************************************************/
+
+/*! Group mask bit of a group ID */
+#define GROUP_BIT(_id) ((uint32_t)1 << (_id))
+
+/******************************************************************************
+ Local variables
+ *****************************************************************************/
+
+/*! Group names, index 0 is group ID 1, empty if unused */
+static char groupNames[DEVGROUPS_MAX_GROUPS][MAX_GROUP_NAME_LEN];
+
+/*! Group masks, indexed like Cllc_associatedDevList */
+static uint32_t devGroupMasks[CONFIG_MAX_DEVICES];
+
+/*! true once the mask was sent to the device in the entry. Group names are
+    not kept over a restart, so a device may hold stale group IDs until it
+    is sent its mask. */
+static bool devGroupSent[CONFIG_MAX_DEVICES];
+
+/******************************************************************************
+ Public Functions
+ *****************************************************************************/
+
+/*!
+ Remove all groups and memberships
+
+ Public function defined in devGroups.h
+ */
+void DevGroups_init(void)
+{
+    uint8_t i;
+
+    memset(groupNames, 0, sizeof(groupNames));
+    for(i = 0; i < CONFIG_MAX_DEVICES; i++)
+    {
+        devGroupMasks[i] = GROUP_BIT(SMSGS_GROUP_ALL);
+        devGroupSent[i] = false;
+    }
+}
+
+/*!
+ Look up a group by name
+
+ Public function defined in devGroups.h
+ */
+uint8_t DevGroups_find(const char *pName, bool create)
+{
+    uint8_t i;
+    uint8_t freeIdx = DEVGROUPS_MAX_GROUPS;
+
+    if((pName == NULL) || (pName[0] == '\0'))
+    {
+        return (DEVGROUPS_INVALID_ID);
+    }
+
+    if(strncmp(pName, DEVGROUPS_ALL_NAME, MAX_GROUP_NAME_LEN) == 0)
+    {
+        return (SMSGS_GROUP_ALL);
+    }
+
+    for(i = 0; i < DEVGROUPS_MAX_GROUPS; i++)
+    {
+        if(groupNames[i][0] == '\0')
+        {
+            if(freeIdx == DEVGROUPS_MAX_GROUPS)
+            {
+                freeIdx = i;
+            }
+        }
+        else if(strncmp(groupNames[i], pName, MAX_GROUP_NAME_LEN) == 0)
+        {
+            return (i + 1);
+        }
+    }
+
+    if(create && (freeIdx < DEVGROUPS_MAX_GROUPS))
+    {
+        strncpy(groupNames[freeIdx], pName, MAX_GROUP_NAME_LEN - 1);
+        groupNames[freeIdx][MAX_GROUP_NAME_LEN - 1] = '\0';
+        return (freeIdx + 1);
+    }
+
+    return (DEVGROUPS_INVALID_ID);
+}
+
+/*!
+ Add a device to or remove it from a group
+
+ Public function defined in devGroups.h
+ */
+uint32_t DevGroups_setMember(uint8_t devIdx, uint8_t groupId, bool member)
+{
+    if(devIdx >= CONFIG_MAX_DEVICES)
+    {
+        return (GROUP_BIT(SMSGS_GROUP_ALL));
+    }
+
+    /* Every device stays in the "all" group */
+    if((groupId != SMSGS_GROUP_ALL) && (groupId <= DEVGROUPS_MAX_GROUPS))
+    {
+        if(member)
+        {
+            devGroupMasks[devIdx] |= GROUP_BIT(groupId);
+        }
+        else
+        {
+            devGroupMasks[devIdx] &= ~GROUP_BIT(groupId);
+        }
+    }
+
+    return (devGroupMasks[devIdx]);
+}
+
+/*!
+ Get the group mask of a device
+
+ Public function defined in devGroups.h
+ */
+uint32_t DevGroups_getMask(uint8_t devIdx)
+{
+    if(devIdx >= CONFIG_MAX_DEVICES)
+    {
+        return (GROUP_BIT(SMSGS_GROUP_ALL));
+    }
+    return (devGroupMasks[devIdx]);
+}
+
+/*!
+ Drop the memberships of a device that left
+
+ Public function defined in devGroups.h
+ */
+void DevGroups_removeDevice(uint8_t devIdx)
+{
+    if(devIdx < CONFIG_MAX_DEVICES)
+    {
+        devGroupMasks[devIdx] = GROUP_BIT(SMSGS_GROUP_ALL);
+        devGroupSent[devIdx] = false;
+    }
+}
+
+/*!
+ Check if the group mask has to be sent to a device
+
+ Public function defined in devGroups.h
+ */
+bool DevGroups_configDue(uint8_t devIdx)
+{
+    if(devIdx >= CONFIG_MAX_DEVICES)
+    {
+        return (false);
+    }
+    return ((devGroupSent[devIdx] == false)
+            || (devGroupMasks[devIdx] != GROUP_BIT(SMSGS_GROUP_ALL)));
+}
+
+/*!
+ Record that the group mask was sent to a device
+
+ Public function defined in devGroups.h
+ */
+void DevGroups_configSent(uint8_t devIdx)
+{
+    if(devIdx < CONFIG_MAX_DEVICES)
+    {
+        devGroupSent[devIdx] = true;
+    }
+}
+
+/*!
+ Check if a device is a member of a group
+
+ Public function defined in devGroups.h
+ */
+bool DevGroups_isMember(uint8_t devIdx, uint8_t groupId)
+{
+    if(groupId > SMSGS_GROUP_MAX_ID)
+    {
+        return (false);
+    }
+    return ((DevGroups_getMask(devIdx) & GROUP_BIT(groupId)) != 0);
+}
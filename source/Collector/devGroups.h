@@ -0,0 +1,170 @@
+/******************************************************************************
+
+ @file devGroups.h
+
+ @brief Named device groups for group actuator commands
+
+ Group: WCS LPC
+ Target Device: CC13xx CC32xx
+
+ ******************************************************************************
+
+ Copyright (c) 2016-2017, Texas Instruments Incorporated
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions
+ are met:
+
+ *  Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+
+ *  Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+
+ *  Neither the name of Texas Instruments Incorporated nor the names of
+    its contributors may be used to endorse or promote products derived
+    from this software without specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+ ******************************************************************************
+ Release Name:
+ Release Date:
+ *****************************************************************************/
+
+#ifndef COLLECTOR_DEVGROUPS_H_
+#define COLLECTOR_DEVGROUPS_H_
+//*****************************************************************************
+//
+// If building with a C++ compiler, make all of the definitions in this header
+// have a C binding.
+//
+//*****************************************************************************
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "smsgs.h"
+
+/******************************************************************************
+ Constants and definitions
+ *****************************************************************************/
+
+/*! Named groups that can be created, IDs 1 .. DEVGROUPS_MAX_GROUPS */
+#define DEVGROUPS_MAX_GROUPS    8
+
+/*! Name of the predefined group every device belongs to */
+#define DEVGROUPS_ALL_NAME      "all"
+
+/*! Returned when a group name is unknown or the table is full */
+#define DEVGROUPS_INVALID_ID    0xFF
+
+#if DEVGROUPS_MAX_GROUPS > SMSGS_GROUP_MAX_ID
+#error "DEVGROUPS_MAX_GROUPS does not fit the over-the-air group mask"
+#endif
+
+/******************************************************************************
+ Function Prototypes
+ *****************************************************************************/
+
+/*!
+ * @brief       Remove all groups and memberships
+ */
+extern void DevGroups_init(void);
+
+/*!
+ * @brief       Look up a group by name
+ *
+ * @param       pName - group name, DEVGROUPS_ALL_NAME for all devices
+ * @param       create - true to create the group if it doesn't exist
+ *
+ * @return      group ID, DEVGROUPS_INVALID_ID if not found or no room left
+ */
+extern uint8_t DevGroups_find(const char *pName, bool create);
+
+/*!
+ * @brief       Add a device to or remove it from a group
+ *
+ * @param       devIdx - index of the device in Cllc_associatedDevList
+ * @param       groupId - group ID returned by DevGroups_find()
+ * @param       member - true to join the group, false to leave it
+ *
+ * @return      new group mask of the device
+ */
+extern uint32_t DevGroups_setMember(uint8_t devIdx, uint8_t groupId,
+                                    bool member);
+
+/*!
+ * @brief       Get the group mask of a device, as sent in the Group
+ *              Configuration Request message
+ *
+ * @param       devIdx - index of the device in Cllc_associatedDevList
+ *
+ * @return      group mask, only SMSGS_GROUP_ALL set if the device is in no
+ *              named group
+ */
+extern uint32_t DevGroups_getMask(uint8_t devIdx);
+
+/*!
+ * @brief       Drop the memberships of a device that left, so the next
+ *              device given its table entry starts in no named group
+ *
+ * @param       devIdx - index of the device in Cllc_associatedDevList
+ */
+extern void DevGroups_removeDevice(uint8_t devIdx);
+
+/*!
+ * @brief       Check if the group mask has to be sent to a device. It has
+ *              to when the device is in a named group, since it may have
+ *              reset, and once after DevGroups_init() or
+ *              DevGroups_removeDevice(), since the device may still hold
+ *              group IDs that were handed out again.
+ *
+ * @param       devIdx - index of the device in Cllc_associatedDevList
+ *
+ * @return      true if the Group Configuration Request has to be sent
+ */
+extern bool DevGroups_configDue(uint8_t devIdx);
+
+/*!
+ * @brief       Record that the group mask was sent to a device
+ *
+ * @param       devIdx - index of the device in Cllc_associatedDevList
+ */
+extern void DevGroups_configSent(uint8_t devIdx);
+
+/*!
+ * @brief       Check if a device is a member of a group
+ *
+ * @param       devIdx - index of the device in Cllc_associatedDevList
+ * @param       groupId - group ID
+ *
+ * @return      true if member
+ */
+extern bool DevGroups_isMember(uint8_t devIdx, uint8_t groupId);
+
+//*****************************************************************************
+//
+// Mark the end of the C bindings section for C++ compilers.
+//
+//*****************************************************************************
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* COLLECTOR_DEVGROUPS_H_ */
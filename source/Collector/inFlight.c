@@ -0,0 +1,438 @@
+/******************************************************************************
+
+ @file inFlight.c
+
+ @brief Table of the frames held by the coprocessor
+
+ Group: WCS LPC
+ Target Device: CC13xx CC32xx
+
+ ******************************************************************************
+
+ Copyright (c) 2016-2017, Texas Instruments Incorporated
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions
+ are met:
+
+ *  Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+
+ *  Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+
+ *  Neither the name of Texas Instruments Incorporated nor the names of
+    its contributors may be used to endorse or promote products derived
+    from this software without specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+ ******************************************************************************
+ Release Name:
+ Release Date:
+ *****************************************************************************/
+
+/******************************************************************************
+ Includes
+ *****************************************************************************/
+#include <string.h>
+#include <pthread.h>
+#include <Common/commonDefs.h>
+#include <Utils/util.h>
+#include "config.h"
+#include "LinkController/cllc.h"
+#include "inFlight.h"
+
+/******************************************************************************
+ Structures
+ *****************************************************************************/
+
+/* Latency statistics of a device */
+typedef struct
+{
+    /* Short address the statistics belong to */
+    uint16_t shortAddr;
+    InFlight_latency_t latency;
+} devLatency_t;
+
+/******************************************************************************
+ Local variables
+ *****************************************************************************/
+
+/* Frames, indexed by handle */
+static InFlight_frame_t frames[INFLIGHT_NUM_HANDLES];
+
+/* true for the handles in flight */
+static bool inUse[INFLIGHT_NUM_HANDLES];
+
+/* Frames in flight */
+static uint8_t numInFlight = 0;
+
+/* Handle the search for a free handle starts at */
+static uint8_t nextHandle = 0;
+
+/* Latency of each message type */
+static InFlight_latency_t typeLatency[INFLIGHT_NUM_TYPES];
+
+/* Latency of each device, indexed like Cllc_associatedDevList */
+static devLatency_t devLatency[CONFIG_MAX_DEVICES];
+
+/* Owner callback of the frames taken back */
+static InFlight_reclaimFp_t pfnReclaimCb = NULL;
+
+/* Protects the statistics read by other tasks */
+static pthread_mutex_t latencyMutex;
+static bool latencyMutexInit = false;
+
+/******************************************************************************
+ Local function prototypes
+ *****************************************************************************/
+static void reclaimFrame(uint8_t handle);
+static void record(InFlight_frame_t *pFrame, ApiMac_status_t status,
+                   bool lost);
+static void addLatency(InFlight_latency_t *pStats, uint32_t latency,
+                       ApiMac_status_t status, bool lost);
+
+/******************************************************************************
+ Public Functions
+ *****************************************************************************/
+
+/*!
+ Forget all frames and clear the statistics
+
+ Public function defined in inFlight.h
+ */
+void InFlight_init(InFlight_reclaimFp_t pfnReclaim)
+{
+    uint8_t i;
+
+    if(!latencyMutexInit)
+    {
+        pthread_mutex_init(&latencyMutex, NULL);
+        latencyMutexInit = true;
+    }
+
+    pfnReclaimCb = pfnReclaim;
+    InFlight_flush();
+
+    pthread_mutex_lock(&latencyMutex);
+    memset(typeLatency, 0, sizeof(typeLatency));
+    memset(devLatency, 0, sizeof(devLatency));
+    for(i = 0; i < CONFIG_MAX_DEVICES; i++)
+    {
+        devLatency[i].shortAddr = INVALID_SHORT_ADDR;
+    }
+    pthread_mutex_unlock(&latencyMutex);
+}
+
+/*!
+ Forget all frames
+
+ Public function defined in inFlight.h
+ */
+void InFlight_flush(void)
+{
+    uint8_t handle;
+
+    for(handle = 0; handle < INFLIGHT_NUM_HANDLES; handle++)
+    {
+        if(inUse[handle])
+        {
+            reclaimFrame(handle);
+        }
+    }
+}
+
+/*!
+ Take back the frames that did not get a data confirm
+
+ Public function defined in inFlight.h
+ */
+uint8_t InFlight_reclaim(void)
+{
+    uint32_t now = Util_getTimeMs();
+    uint8_t reclaimed = 0;
+    uint8_t handle;
+
+    for(handle = 0; handle < INFLIGHT_NUM_HANDLES; handle++)
+    {
+        if(inUse[handle]
+           && ((now - frames[handle].enqueueTime) >= INFLIGHT_STALE_TIME))
+        {
+            record(&frames[handle], ApiMac_status_success, true);
+            reclaimFrame(handle);
+            reclaimed++;
+        }
+    }
+
+    return (reclaimed);
+}
+
+/*!
+ Add a frame handed to the CoP
+
+ Public function defined in inFlight.h
+ */
+uint8_t InFlight_alloc(uint16_t dstAddr, uint8_t devIdx, uint8_t msgType,
+                       uint32_t airTime)
+{
+    uint32_t now = Util_getTimeMs();
+    uint8_t handle = nextHandle;
+    uint8_t n;
+
+    /* The owners of lost frames are told by InFlight_reclaim(), not from
+       here, where the caller may be in the middle of sending */
+    if(numInFlight >= INFLIGHT_MAX_FRAMES)
+    {
+        return (INFLIGHT_NO_HANDLE);
+    }
+
+    /* Going round keeps a freed handle unused for as long as possible, a
+       late confirm can't be taken for the one of a newer frame */
+    for(n = 0; n < INFLIGHT_NUM_HANDLES; n++)
+    {
+        handle = (uint8_t)((nextHandle + n) % INFLIGHT_NUM_HANDLES);
+        if(inUse[handle] == false)
+        {
+            break;
+        }
+    }
+
+    inUse[handle] = true;
+    numInFlight++;
+    nextHandle = (uint8_t)((handle + 1) % INFLIGHT_NUM_HANDLES);
+
+    frames[handle].dstAddr = dstAddr;
+    frames[handle].devIdx = devIdx;
+    frames[handle].msgType = msgType;
+    frames[handle].enqueueTime = now;
+    frames[handle].airTime = airTime;
+
+    return (handle);
+}
+
+/*!
+ Get a frame in flight
+
+ Public function defined in inFlight.h
+ */
+InFlight_frame_t *InFlight_get(uint8_t handle)
+{
+    if((handle >= INFLIGHT_NUM_HANDLES) || (inUse[handle] == false))
+    {
+        return (NULL);
+    }
+
+    return (&frames[handle]);
+}
+
+/*!
+ Process the data confirm of a frame
+
+ Public function defined in inFlight.h
+ */
+bool InFlight_txDone(uint8_t handle, ApiMac_status_t status,
+                     InFlight_frame_t *pFrame)
+{
+    if(InFlight_get(handle) == NULL)
+    {
+        return (false);
+    }
+
+    record(&frames[handle], status, false);
+    memcpy(pFrame, &frames[handle], sizeof(InFlight_frame_t));
+    InFlight_free(handle);
+
+    return (true);
+}
+
+/*!
+ Free the handle of a frame that gets no data confirm
+
+ Public function defined in inFlight.h
+ */
+void InFlight_free(uint8_t handle)
+{
+    if(InFlight_get(handle) != NULL)
+    {
+        inUse[handle] = false;
+        numInFlight--;
+    }
+}
+
+/*!
+ Get the number of frames in flight
+
+ Public function defined in inFlight.h
+ */
+uint8_t InFlight_count(void)
+{
+    return (numInFlight);
+}
+
+/*!
+ Get a copy of the latency statistics of a message type
+
+ Public function defined in inFlight.h
+ */
+bool InFlight_getTypeStats(uint8_t msgType, InFlight_latency_t *pStats)
+{
+    if(msgType >= INFLIGHT_NUM_TYPES)
+    {
+        return (false);
+    }
+
+    pthread_mutex_lock(&latencyMutex);
+    memcpy(pStats, &typeLatency[msgType], sizeof(InFlight_latency_t));
+    pthread_mutex_unlock(&latencyMutex);
+
+    return (true);
+}
+
+/*!
+ Get a copy of the latency statistics of a device
+
+ Public function defined in inFlight.h
+ */
+bool InFlight_getDeviceStats(uint16_t shortAddr, InFlight_latency_t *pStats)
+{
+    bool found = false;
+    uint8_t i;
+
+    pthread_mutex_lock(&latencyMutex);
+    for(i = 0; i < CONFIG_MAX_DEVICES; i++)
+    {
+        if(devLatency[i].shortAddr == shortAddr)
+        {
+            memcpy(pStats, &devLatency[i].latency,
+                   sizeof(InFlight_latency_t));
+            found = true;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&latencyMutex);
+
+    return (found);
+}
+
+/******************************************************************************
+ Local Functions
+ *****************************************************************************/
+
+/*!
+ * @brief       Free the handle of a frame that gets no data confirm and tell
+ *              its owner
+ *
+ * @param       handle - handle in flight
+ */
+static void reclaimFrame(uint8_t handle)
+{
+    InFlight_frame_t frame;
+
+    memcpy(&frame, &frames[handle], sizeof(InFlight_frame_t));
+    InFlight_free(handle);
+
+    if(pfnReclaimCb != NULL)
+    {
+        pfnReclaimCb(handle, &frame);
+    }
+}
+
+/*!
+ * @brief       Add the latency of a frame to the statistics of its message
+ *              type and device
+ *
+ * @param       pFrame - frame
+ * @param       status - status of the confirm
+ * @param       lost - true if the frame never got a confirm
+ */
+static void record(InFlight_frame_t *pFrame, ApiMac_status_t status,
+                   bool lost)
+{
+    uint32_t latency = Util_getTimeMs() - pFrame->enqueueTime;
+
+    pthread_mutex_lock(&latencyMutex);
+    if(pFrame->msgType < INFLIGHT_NUM_TYPES)
+    {
+        addLatency(&typeLatency[pFrame->msgType], latency, status, lost);
+    }
+
+    if(pFrame->devIdx < CONFIG_MAX_DEVICES)
+    {
+        devLatency_t *pDev = &devLatency[pFrame->devIdx];
+
+        /* The table entry was given to another device, start over */
+        if(pDev->shortAddr != pFrame->dstAddr)
+        {
+            memset(pDev, 0, sizeof(devLatency_t));
+            pDev->shortAddr = pFrame->dstAddr;
+        }
+        addLatency(&pDev->latency, latency, status, lost);
+    }
+    pthread_mutex_unlock(&latencyMutex);
+}
+
+/*!
+ * @brief       Add a latency to a histogram
+ *
+ * @param       pStats - statistics to update
+ * @param       latency - data request to confirm time, in milliseconds
+ * @param       status - status of the confirm
+ * @param       lost - true if the frame never got a confirm
+ */
+static void addLatency(InFlight_latency_t *pStats, uint32_t latency,
+                       ApiMac_status_t status, bool lost)
+{
+    uint32_t limit = INFLIGHT_FIRST_BIN;
+    uint8_t bin = 0;
+
+    if(lost)
+    {
+        pStats->lost++;
+        return;
+    }
+
+    pStats->confirmed++;
+    if(status != ApiMac_status_success)
+    {
+        pStats->failed++;
+    }
+
+    if(pStats->confirmed == 1)
+    {
+        pStats->avgLatency = latency;
+    }
+    else
+    {
+        pStats->avgLatency = pStats->avgLatency - (pStats->avgLatency / 8)
+                             + (latency / 8);
+    }
+    if(latency > pStats->maxLatency)
+    {
+        pStats->maxLatency = latency;
+    }
+
+    while((bin < (INFLIGHT_NUM_BINS - 1)) && (latency >= limit))
+    {
+        bin++;
+        limit <<= 1;
+    }
+
+    /* Saturate rather than wrap around */
+    if(pStats->bins[bin] < UINT16_MAX)
+    {
+        pStats->bins[bin]++;
+    }
+}
@@ -0,0 +1,260 @@
+/******************************************************************************
+
+ @file inFlight.h
+
+ @brief Table of the frames held by the coprocessor
+
+ Group: WCS LPC
+ Target Device: CC13xx CC32xx
+
+ ******************************************************************************
+
+ Copyright (c) 2016-2017, Texas Instruments Incorporated
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions
+ are met:
+
+ *  Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+
+ *  Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+
+ *  Neither the name of Texas Instruments Incorporated nor the names of
+    its contributors may be used to endorse or promote products derived
+    from this software without specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+ ******************************************************************************
+ Release Name:
+ Release Date:
+ *****************************************************************************/
+
+#ifndef COLLECTOR_INFLIGHT_H_
+#define COLLECTOR_INFLIGHT_H_
+//*****************************************************************************
+//
+// If building with a C++ compiler, make all of the definitions in this header
+// have a C binding.
+//
+//*****************************************************************************
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <API_MAC/api_mac.h>
+#include "config.h"
+#include "smsgs.h"
+
+/******************************************************************************
+ Constants and definitions
+ *****************************************************************************/
+
+/*! Number of MSDU handles, the low bits of the application MSDU handle */
+#define INFLIGHT_NUM_HANDLES    64
+
+/*! Frames the CoP may hold at the same time. A handle is only reused after
+    at least INFLIGHT_NUM_HANDLES - INFLIGHT_MAX_FRAMES other frames. */
+#ifndef INFLIGHT_MAX_FRAMES
+#define INFLIGHT_MAX_FRAMES     32
+#endif
+
+/*! A frame without a confirm for this long is taken as lost, well above the
+    indirect transaction persistence time */
+#define INFLIGHT_STALE_TIME     60000
+
+/*! Period the stale frames are looked for while any frame is in flight, a
+    lost confirm is noticed at most this long after INFLIGHT_STALE_TIME */
+#ifndef INFLIGHT_SWEEP_TIME
+#define INFLIGHT_SWEEP_TIME     (INFLIGHT_STALE_TIME / 4)
+#endif
+
+/*! Returned by InFlight_alloc() if no frame can be added */
+#define INFLIGHT_NO_HANDLE      0xFF
+
+/*! Device index of frames that are not sent to a known device */
+#define INFLIGHT_NO_DEVICE      0xFF
+
+/*! Message types with their own latency histogram, Smsgs_cmdIds_t */
+#define INFLIGHT_NUM_TYPES      (Smsgs_cmdIds_groupCmd + 1)
+
+/*! Latency bins, bin n counts latencies below (16 << n) milliseconds, the
+    last bin counts everything above */
+#define INFLIGHT_NUM_BINS       12
+
+/*! Upper limit of the first latency bin, in milliseconds */
+#define INFLIGHT_FIRST_BIN      16
+
+/******************************************************************************
+ Structures
+ *****************************************************************************/
+
+/*! Frame held by the CoP */
+typedef struct
+{
+    /*! Destination short address */
+    uint16_t dstAddr;
+    /*! Index of the device in Cllc_associatedDevList, INFLIGHT_NO_DEVICE */
+    uint8_t devIdx;
+    /*! Message command ID, Smsgs_cmdIds_t */
+    uint8_t msgType;
+    /*! Time the frame was handed to the CoP, in milliseconds */
+    uint32_t enqueueTime;
+    /*! On-air time of one transmission, in microseconds */
+    uint32_t airTime;
+} InFlight_frame_t;
+
+/*! Data request to confirm latency of a message type or device */
+typedef struct
+{
+    /*! Data confirms received */
+    uint32_t confirmed;
+    /*! Data confirms with a failure status */
+    uint32_t failed;
+    /*! Frames that never got a data confirm */
+    uint32_t lost;
+    /*! Average latency (EWMA 1/8), in milliseconds */
+    uint32_t avgLatency;
+    /*! Highest latency, in milliseconds */
+    uint32_t maxLatency;
+    /*! Latency histogram */
+    uint16_t bins[INFLIGHT_NUM_BINS];
+} InFlight_latency_t;
+
+/*!
+ Reclaim callback - the frame will get no data confirm, it was taken back
+ by InFlight_flush() or InFlight_reclaim(). The owner of the frame fails it
+ and clears its own state. The handle is already free.
+ */
+typedef void (*InFlight_reclaimFp_t)(uint8_t handle, InFlight_frame_t *pFrame);
+
+/******************************************************************************
+ Function Prototypes
+ *****************************************************************************/
+
+/*!
+ * @brief       Forget all frames and clear the statistics
+ *
+ * @param       pfnReclaim - called for each frame taken back, can be NULL
+ */
+extern void InFlight_init(InFlight_reclaimFp_t pfnReclaim);
+
+/*!
+ * @brief       Forget all frames, the CoP was reset. The statistics are
+ *              kept.
+ */
+extern void InFlight_flush(void);
+
+/*!
+ * @brief       Take back the frames that did not get a data confirm within
+ *              INFLIGHT_STALE_TIME, they are counted as lost
+ *
+ * @return      number of frames taken back
+ */
+extern uint8_t InFlight_reclaim(void);
+
+/*!
+ * @brief       Add a frame handed to the CoP. Only a handle that is not in
+ *              flight is given out, starting after the last one given out.
+ *              A lost confirm holds its handle until InFlight_reclaim().
+ *
+ * @param       dstAddr - destination short address
+ * @param       devIdx - index of the device in Cllc_associatedDevList,
+ *                       INFLIGHT_NO_DEVICE for broadcast frames
+ * @param       msgType - message command ID
+ * @param       airTime - on-air time of one transmission in microseconds
+ *
+ * @return      handle, 0 to INFLIGHT_NUM_HANDLES - 1, INFLIGHT_NO_HANDLE if
+ *              INFLIGHT_MAX_FRAMES frames are in flight
+ */
+extern uint8_t InFlight_alloc(uint16_t dstAddr, uint8_t devIdx,
+                              uint8_t msgType, uint32_t airTime);
+
+/*!
+ * @brief       Get a frame in flight
+ *
+ * @param       handle - handle returned by InFlight_alloc()
+ *
+ * @return      pointer to the frame, NULL if the handle is not in flight
+ */
+extern InFlight_frame_t *InFlight_get(uint8_t handle);
+
+/*!
+ * @brief       Process the data confirm of a frame, its latency is added to
+ *              the statistics of its message type and device and the handle
+ *              is freed
+ *
+ * @param       handle - handle returned by InFlight_alloc()
+ * @param       status - status of the confirm
+ * @param       pFrame - copy of the frame
+ *
+ * @return      true if the handle was in flight
+ */
+extern bool InFlight_txDone(uint8_t handle, ApiMac_status_t status,
+                            InFlight_frame_t *pFrame);
+
+/*!
+ * @brief       Free the handle of a frame that gets no data confirm, it was
+ *              refused or purged
+ *
+ * @param       handle - handle returned by InFlight_alloc()
+ */
+extern void InFlight_free(uint8_t handle);
+
+/*!
+ * @brief       Get the number of frames in flight
+ *
+ * @return      frames held by the CoP
+ */
+extern uint8_t InFlight_count(void);
+
+/*!
+ * @brief       Get a copy of the latency statistics of a message type. Can
+ *              be called from any task.
+ *
+ * @param       msgType - message command ID
+ * @param       pStats - copy of the statistics
+ *
+ * @return      true if the message type is valid
+ */
+extern bool InFlight_getTypeStats(uint8_t msgType, InFlight_latency_t *pStats);
+
+/*!
+ * @brief       Get a copy of the latency statistics of a device. Can be
+ *              called from any task.
+ *
+ * @param       shortAddr - short address of the device
+ * @param       pStats - copy of the statistics
+ *
+ * @return      true if frames were sent to the device
+ */
+extern bool InFlight_getDeviceStats(uint16_t shortAddr,
+                                    InFlight_latency_t *pStats);
+
+//*****************************************************************************
+//
+// Mark the end of the C bindings section for C++ compilers.
+//
+//*****************************************************************************
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* COLLECTOR_INFLIGHT_H_ */
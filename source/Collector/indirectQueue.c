@@ -0,0 +1,445 @@
+/******************************************************************************
+
+ @file indirectQueue.c
+
+ @brief Host side downlink queue for sleepy devices
+
+ Group: WCS LPC
+ Target Device: CC13xx CC32xx
+
+ ******************************************************************************
+
+ Copyright (c) 2016-2017, Texas Instruments Incorporated
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions
+ are met:
+
+ *  Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+
+ *  Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+
+ *  Neither the name of Texas Instruments Incorporated nor the names of
+    its contributors may be used to endorse or promote products derived
+    from this software without specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+ ******************************************************************************
+ Release Name:
+ Release Date:
+ *****************************************************************************/
+
+/******************************************************************************
+ Includes
+ *****************************************************************************/
+#include <string.h>
+#include <pthread.h>
+#include <Common/commonDefs.h>
+#include <Utils/util.h>
+#include "config.h"
+#include "LinkController/cllc.h"
+#include "indirectQueue.h"
+
+/******************************************************************************
+ Constants and definitions
+ *****************************************************************************/
+
+/*! Downlink queue of one device */
+typedef struct
+{
+    /*! Short address the queue belongs to */
+    uint16_t shortAddr;
+    /*! Number of queued frames, oldest first */
+    uint8_t count;
+    /*! true while a frame of this device is held by the CoP */
+    bool inFlight;
+    /*! MSDU handle of the frame held by the CoP */
+    uint8_t inFlightHandle;
+    /*! Time the frame held by the CoP was queued */
+    uint32_t inFlightTime;
+    IndQueue_frame_t frames[INDQ_MAX_FRAMES];
+    IndQueue_stats_t stats;
+} devQueue_t;
+
+/******************************************************************************
+ Local variables
+ *****************************************************************************/
+
+/*! Queues, indexed like Cllc_associatedDevList */
+static devQueue_t devQueues[CONFIG_MAX_DEVICES];
+
+/*! Protects the statistics read by other tasks */
+static pthread_mutex_t devQueueMutex;
+static bool devQueueMutexInit = false;
+
+/******************************************************************************
+ Local function prototypes
+ *****************************************************************************/
+static void removeFrame(devQueue_t *pQueue, uint8_t n);
+
+/******************************************************************************
+ Public Functions
+ *****************************************************************************/
+
+/*!
+ Clear all device queues
+
+ Public function defined in indirectQueue.h
+ */
+void IndQueue_init(void)
+{
+    uint8_t i;
+
+    if(!devQueueMutexInit)
+    {
+        pthread_mutex_init(&devQueueMutex, NULL);
+        devQueueMutexInit = true;
+    }
+
+    pthread_mutex_lock(&devQueueMutex);
+    memset(devQueues, 0, sizeof(devQueues));
+    for(i = 0; i < CONFIG_MAX_DEVICES; i++)
+    {
+        devQueues[i].shortAddr = INVALID_SHORT_ADDR;
+    }
+    pthread_mutex_unlock(&devQueueMutex);
+}
+
+/*!
+ Forget the frames held by the CoP
+
+ Public function defined in indirectQueue.h
+ */
+void IndQueue_flush(void)
+{
+    uint8_t i;
+
+    pthread_mutex_lock(&devQueueMutex);
+    for(i = 0; i < CONFIG_MAX_DEVICES; i++)
+    {
+        if(devQueues[i].inFlight)
+        {
+            devQueues[i].inFlight = false;
+            devQueues[i].stats.failed++;
+        }
+    }
+    pthread_mutex_unlock(&devQueueMutex);
+}
+
+/*!
+ Drop all frames of a device
+
+ Public function defined in indirectQueue.h
+ */
+void IndQueue_reset(uint8_t devIdx)
+{
+    devQueue_t *pQueue;
+
+    if(devIdx >= CONFIG_MAX_DEVICES)
+    {
+        return;
+    }
+
+    pthread_mutex_lock(&devQueueMutex);
+    pQueue = &devQueues[devIdx];
+    if(pQueue->inFlight)
+    {
+        pQueue->inFlight = false;
+        pQueue->stats.failed++;
+    }
+    pQueue->stats.dropped += pQueue->count;
+    pQueue->count = 0;
+    pQueue->stats.depth = 0;
+    pthread_mutex_unlock(&devQueueMutex);
+}
+
+/*!
+ Queue a frame for a sleepy device
+
+ Public function defined in indirectQueue.h
+ */
+bool IndQueue_push(uint8_t devIdx, uint16_t shortAddr, uint16_t len,
+                   uint8_t *pData)
+{
+    devQueue_t *pQueue;
+    IndQueue_frame_t *pFrame = NULL;
+    uint8_t n;
+
+    if((devIdx >= CONFIG_MAX_DEVICES) || (len == 0)
+       || (len > INDQ_MAX_FRAME_LEN))
+    {
+        return (false);
+    }
+
+    pthread_mutex_lock(&devQueueMutex);
+    pQueue = &devQueues[devIdx];
+
+    /* The table entry was given to another device, start over */
+    if(pQueue->shortAddr != shortAddr)
+    {
+        memset(pQueue, 0, sizeof(devQueue_t));
+        pQueue->shortAddr = shortAddr;
+    }
+
+    pQueue->stats.queued++;
+
+    /* Look for a waiting frame this one supersedes */
+    for(n = 0; n < pQueue->count; n++)
+    {
+        if(pQueue->frames[n].cmdId == pData[0])
+        {
+            pFrame = &pQueue->frames[n];
+            break;
+        }
+    }
+
+    if(pFrame != NULL)
+    {
+        pQueue->stats.coalesced++;
+        if(pData[0] == Smsgs_cmdIds_toggleLedReq)
+        {
+            /* Two toggles leave the LED as it is */
+            removeFrame(pQueue, n);
+            pQueue->stats.coalesced++;
+            pQueue->stats.depth = pQueue->count;
+            pthread_mutex_unlock(&devQueueMutex);
+            return (true);
+        }
+        /* Keep the queue position and age of the superseded frame */
+    }
+    else
+    {
+        if(pQueue->count == INDQ_MAX_FRAMES)
+        {
+            /* Make room by dropping the oldest frame */
+            removeFrame(pQueue, 0);
+            pQueue->stats.dropped++;
+        }
+        pFrame = &pQueue->frames[pQueue->count];
+        pFrame->enqueueTime = Util_getTimeMs();
+        pQueue->count++;
+    }
+
+    pFrame->cmdId = pData[0];
+    pFrame->len = (uint8_t)len;
+    memcpy(pFrame->data, pData, len);
+
+    pQueue->stats.depth = pQueue->count;
+    if(pQueue->count > pQueue->stats.maxDepth)
+    {
+        pQueue->stats.maxDepth = pQueue->count;
+    }
+    pthread_mutex_unlock(&devQueueMutex);
+
+    return (true);
+}
+
+/*!
+ Get the next frame to hand to the CoP
+
+ Public function defined in indirectQueue.h
+ */
+IndQueue_frame_t *IndQueue_peek(uint8_t devIdx)
+{
+    IndQueue_frame_t *pFrame = NULL;
+    devQueue_t *pQueue;
+
+    if(devIdx >= CONFIG_MAX_DEVICES)
+    {
+        return (NULL);
+    }
+
+    pthread_mutex_lock(&devQueueMutex);
+    pQueue = &devQueues[devIdx];
+    if((pQueue->inFlight == false) && (pQueue->count != 0))
+    {
+        pFrame = &pQueue->frames[0];
+    }
+    pthread_mutex_unlock(&devQueueMutex);
+
+    return (pFrame);
+}
+
+/*!
+ Mark the frame returned by IndQueue_peek() as handed to the CoP
+
+ Public function defined in indirectQueue.h
+ */
+void IndQueue_released(uint8_t devIdx, uint8_t msduHandle)
+{
+    devQueue_t *pQueue = &devQueues[devIdx];
+
+    pthread_mutex_lock(&devQueueMutex);
+    pQueue->inFlight = true;
+    pQueue->inFlightHandle = msduHandle;
+    pQueue->inFlightTime = pQueue->frames[0].enqueueTime;
+    removeFrame(pQueue, 0);
+    pQueue->stats.depth = pQueue->count;
+    pthread_mutex_unlock(&devQueueMutex);
+}
+
+/*!
+ Drop the frame returned by IndQueue_peek()
+
+ Public function defined in indirectQueue.h
+ */
+void IndQueue_discard(uint8_t devIdx)
+{
+    devQueue_t *pQueue = &devQueues[devIdx];
+
+    pthread_mutex_lock(&devQueueMutex);
+    removeFrame(pQueue, 0);
+    pQueue->stats.failed++;
+    pQueue->stats.depth = pQueue->count;
+    pthread_mutex_unlock(&devQueueMutex);
+}
+
+/*!
+ Drop the waiting frame of a command
+
+ Public function defined in indirectQueue.h
+ */
+bool IndQueue_cancel(uint8_t devIdx, uint8_t cmdId)
+{
+    devQueue_t *pQueue;
+    bool found = false;
+    uint8_t n;
+
+    if(devIdx >= CONFIG_MAX_DEVICES)
+    {
+        return (false);
+    }
+
+    pthread_mutex_lock(&devQueueMutex);
+    pQueue = &devQueues[devIdx];
+    for(n = 0; n < pQueue->count; n++)
+    {
+        if(pQueue->frames[n].cmdId == cmdId)
+        {
+            removeFrame(pQueue, n);
+            pQueue->stats.dropped++;
+            pQueue->stats.depth = pQueue->count;
+            found = true;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&devQueueMutex);
+
+    return (found);
+}
+
+/*!
+ Process the data confirm of a frame held by the CoP
+
+ Public function defined in indirectQueue.h
+ */
+bool IndQueue_txDone(uint8_t devIdx, uint8_t msduHandle,
+                     ApiMac_status_t status)
+{
+    devQueue_t *pQueue;
+    IndQueue_stats_t *pStats;
+
+    if(devIdx >= CONFIG_MAX_DEVICES)
+    {
+        return (false);
+    }
+
+    pthread_mutex_lock(&devQueueMutex);
+    pQueue = &devQueues[devIdx];
+    if((pQueue->inFlight == false) || (pQueue->inFlightHandle != msduHandle))
+    {
+        pthread_mutex_unlock(&devQueueMutex);
+        return (false);
+    }
+
+    pStats = &pQueue->stats;
+    pQueue->inFlight = false;
+    if(status == ApiMac_status_success)
+    {
+        uint32_t latency = Util_getTimeMs() - pQueue->inFlightTime;
+
+        pStats->delivered++;
+        pStats->lastLatency = latency;
+        if(pStats->delivered == 1)
+        {
+            pStats->avgLatency = latency;
+        }
+        else
+        {
+            pStats->avgLatency = pStats->avgLatency - (pStats->avgLatency / 8)
+                                 + (latency / 8);
+        }
+        if(latency > pStats->maxLatency)
+        {
+            pStats->maxLatency = latency;
+        }
+    }
+    else
+    {
+        pStats->failed++;
+    }
+    pthread_mutex_unlock(&devQueueMutex);
+
+    return (true);
+}
+
+/*!
+ Get a copy of the downlink statistics of a device
+
+ Public function defined in indirectQueue.h
+ */
+bool IndQueue_getStats(uint16_t shortAddr, IndQueue_stats_t *pStats)
+{
+    bool found = false;
+    uint8_t i;
+
+    pthread_mutex_lock(&devQueueMutex);
+    for(i = 0; i < CONFIG_MAX_DEVICES; i++)
+    {
+        if(devQueues[i].shortAddr == shortAddr)
+        {
+            memcpy(pStats, &devQueues[i].stats, sizeof(IndQueue_stats_t));
+            found = true;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&devQueueMutex);
+
+    return (found);
+}
+
+/******************************************************************************
+ Local Functions
+ *****************************************************************************/
+
+/*!
+ * @brief       Remove a frame from a device queue, the lock must be held
+ *
+ * @param       pQueue - device queue
+ * @param       n - position of the frame, 0 is the oldest
+ */
+static void removeFrame(devQueue_t *pQueue, uint8_t n)
+{
+    /* Close the gap by moving the newer frames up */
+    for(; (n + 1) < pQueue->count; n++)
+    {
+        memcpy(&pQueue->frames[n], &pQueue->frames[n + 1],
+               sizeof(IndQueue_frame_t));
+    }
+    pQueue->count--;
+}
@@ -0,0 +1,227 @@
+/******************************************************************************
+
+ @file indirectQueue.h
+
+ @brief Host side downlink queue for sleepy devices
+
+ Group: WCS LPC
+ Target Device: CC13xx CC32xx
+
+ ******************************************************************************
+
+ Copyright (c) 2016-2017, Texas Instruments Incorporated
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions
+ are met:
+
+ *  Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+
+ *  Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+
+ *  Neither the name of Texas Instruments Incorporated nor the names of
+    its contributors may be used to endorse or promote products derived
+    from this software without specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+ ******************************************************************************
+ Release Name:
+ Release Date:
+ *****************************************************************************/
+
+#ifndef COLLECTOR_INDIRECTQUEUE_H_
+#define COLLECTOR_INDIRECTQUEUE_H_
+//*****************************************************************************
+//
+// If building with a C++ compiler, make all of the definitions in this header
+// have a C binding.
+//
+//*****************************************************************************
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <API_MAC/api_mac.h>
+#include "smsgs.h"
+
+/******************************************************************************
+ Constants and definitions
+ *****************************************************************************/
+
+/*! Frames that can be queued per device */
+#define INDQ_MAX_FRAMES         4
+
+/*! Largest frame that can be queued, bigger frames are sent directly */
+#define INDQ_MAX_FRAME_LEN      SMSGS_CONFIG_REQUEST_MSG_LENGTH
+
+/******************************************************************************
+ Structures
+ *****************************************************************************/
+
+/*! Queued downlink frame */
+typedef struct
+{
+    /*! Message command ID, Smsgs_cmdIds_t */
+    uint8_t cmdId;
+    /*! Length of the frame */
+    uint8_t len;
+    /*! Frame, starting with the command ID */
+    uint8_t data[INDQ_MAX_FRAME_LEN];
+    /*! Time the frame was queued, in milliseconds */
+    uint32_t enqueueTime;
+} IndQueue_frame_t;
+
+/*! Downlink statistics of a device */
+typedef struct
+{
+    /*! Frames waiting in the host queue */
+    uint8_t depth;
+    /*! Highest number of frames that were waiting */
+    uint8_t maxDepth;
+    /*! Frames queued for the device */
+    uint32_t queued;
+    /*! Frames superseded by a newer frame of the same command */
+    uint32_t coalesced;
+    /*! Frames dropped because the queue was full */
+    uint32_t dropped;
+    /*! Frames delivered to the device */
+    uint32_t delivered;
+    /*! Frames released to the CoP that were not delivered */
+    uint32_t failed;
+    /*! Queue to delivery latency of the last frame, in milliseconds */
+    uint32_t lastLatency;
+    /*! Average queue to delivery latency (EWMA 1/8), in milliseconds */
+    uint32_t avgLatency;
+    /*! Highest queue to delivery latency, in milliseconds */
+    uint32_t maxLatency;
+} IndQueue_stats_t;
+
+/******************************************************************************
+ Function Prototypes
+ *****************************************************************************/
+
+/*!
+ * @brief       Clear all device queues
+ */
+extern void IndQueue_init(void);
+
+/*!
+ * @brief       Forget the frames held by the CoP, it was reset. They are
+ *              counted as failed, the waiting frames are kept and handed to
+ *              the new CoP when their devices poll.
+ */
+extern void IndQueue_flush(void);
+
+/*!
+ * @brief       Drop all frames of a device, including the one held by the
+ *              CoP. Called when the device left or its table entry is
+ *              given to another device.
+ *
+ * @param       devIdx - index of the device in Cllc_associatedDevList
+ */
+extern void IndQueue_reset(uint8_t devIdx);
+
+/*!
+ * @brief       Queue a frame for a sleepy device. A frame with the same
+ *              command ID that is still waiting is replaced, two pending
+ *              LED toggles cancel each other.
+ *
+ * @param       devIdx - index of the device in Cllc_associatedDevList
+ * @param       shortAddr - short address of the device
+ * @param       len - length of the frame
+ * @param       pData - frame, starting with the command ID
+ *
+ * @return      true if queued, false if the frame is too big to be queued
+ */
+extern bool IndQueue_push(uint8_t devIdx, uint16_t shortAddr, uint16_t len,
+                          uint8_t *pData);
+
+/*!
+ * @brief       Get the next frame to hand to the CoP
+ *
+ * @param       devIdx - index of the device in Cllc_associatedDevList
+ *
+ * @return      pointer to the frame, NULL if the queue is empty or a frame
+ *              of this device is still held by the CoP
+ */
+extern IndQueue_frame_t *IndQueue_peek(uint8_t devIdx);
+
+/*!
+ * @brief       Mark the frame returned by IndQueue_peek() as handed to the
+ *              CoP and remove it from the queue
+ *
+ * @param       devIdx - index of the device in Cllc_associatedDevList
+ * @param       msduHandle - MSDU handle used for the data request
+ */
+extern void IndQueue_released(uint8_t devIdx, uint8_t msduHandle);
+
+/*!
+ * @brief       Drop the frame returned by IndQueue_peek(), the CoP refused
+ *              it
+ *
+ * @param       devIdx - index of the device in Cllc_associatedDevList
+ */
+extern void IndQueue_discard(uint8_t devIdx);
+
+/*!
+ * @brief       Drop the waiting frame of a command, the frame held by the
+ *              CoP is not affected
+ *
+ * @param       devIdx - index of the device in Cllc_associatedDevList
+ * @param       cmdId - command ID of the frame
+ *
+ * @return      true if a frame was dropped
+ */
+extern bool IndQueue_cancel(uint8_t devIdx, uint8_t cmdId);
+
+/*!
+ * @brief       Process the data confirm of a frame held by the CoP
+ *
+ * @param       devIdx - index of the device in Cllc_associatedDevList
+ * @param       msduHandle - MSDU handle of the confirm
+ * @param       status - status of the confirm
+ *
+ * @return      true if the confirm belongs to the released frame
+ */
+extern bool IndQueue_txDone(uint8_t devIdx, uint8_t msduHandle,
+                            ApiMac_status_t status);
+
+/*!
+ * @brief       Get a copy of the downlink statistics of a device. Can be
+ *              called from any task.
+ *
+ * @param       shortAddr - short address of the device
+ * @param       pStats - copy of the statistics
+ *
+ * @return      true if the device has a queue
+ */
+extern bool IndQueue_getStats(uint16_t shortAddr, IndQueue_stats_t *pStats);
+
+//*****************************************************************************
+//
+// Mark the end of the C bindings section for C++ compilers.
+//
+//*****************************************************************************
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* COLLECTOR_INDIRECTQUEUE_H_ */
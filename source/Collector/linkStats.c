@@ -0,0 +1,354 @@
+/******************************************************************************
+
+ @file linkStats.c
+
+ @brief Per device link quality and reliability table
+
+ Group: WCS LPC
+ Target Device: CC13xx CC32xx
+
+ ******************************************************************************
+
+ Copyright (c) 2016-2017, Texas Instruments Incorporated
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions
+ are met:
+
+ *  Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+
+ *  Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+
+ *  Neither the name of Texas Instruments Incorporated nor the names of
+    its contributors may be used to endorse or promote products derived
+    from this software without specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+ ******************************************************************************
+ Release Name:
+ Release Date:
+ *****************************************************************************/
+
+/******************************************************************************
+ Includes
+ *****************************************************************************/
+#include <string.h>
+#include <pthread.h>
+#include <Common/commonDefs.h>
+#include <Utils/util.h>
+#include "LinkController/cllc.h"
+#include "linkStats.h"
+
+/******************************************************************************
+ Constants and definitions
+ *****************************************************************************/
+
+#define LINKSTATS_TABLE_MASK    (LINKSTATS_TABLE_SIZE - 1)
+
+/* Short addresses are handed out sequentially, so the low bits spread well */
+#define LINKSTATS_HASH(addr)    ((addr) & LINKSTATS_TABLE_MASK)
+
+/******************************************************************************
+ Local variables
+ *****************************************************************************/
+
+/*! Link table, open addressing with linear probing on the short address */
+static LinkStats_entry_t linkTable[LINKSTATS_TABLE_SIZE];
+
+/*! Protects the table, it is written by the collector and read by others */
+static pthread_mutex_t linkTableMutex;
+static bool linkTableMutexInit = false;
+
+/******************************************************************************
+ Local function prototypes
+ *****************************************************************************/
+static LinkStats_entry_t *findEntry(uint16_t shortAddr, bool add);
+static uint16_t counterDelta(uint16_t newVal, uint16_t oldVal, bool restarted);
+
+/******************************************************************************
+ Public Functions
+ *****************************************************************************/
+
+/*!
+ Clear the link table
+
+ Public function defined in linkStats.h
+ */
+void LinkStats_init(void)
+{
+    int i;
+
+    if(!linkTableMutexInit)
+    {
+        pthread_mutex_init(&linkTableMutex, NULL);
+        linkTableMutexInit = true;
+    }
+
+    pthread_mutex_lock(&linkTableMutex);
+    memset(linkTable, 0, sizeof(linkTable));
+    for(i = 0; i < LINKSTATS_TABLE_SIZE; i++)
+    {
+        linkTable[i].shortAddr = INVALID_SHORT_ADDR;
+    }
+    pthread_mutex_unlock(&linkTableMutex);
+}
+
+/*!
+ Record a frame received from a device
+
+ Public function defined in linkStats.h
+ */
+void LinkStats_rxFrame(uint16_t shortAddr, int8_t rssi, uint8_t lqi)
+{
+    LinkStats_entry_t *pEntry;
+
+    pthread_mutex_lock(&linkTableMutex);
+    pEntry = findEntry(shortAddr, true);
+    if(pEntry != NULL)
+    {
+        if(pEntry->rxFrames == 0)
+        {
+            pEntry->rssiAvg = (int16_t)rssi * 16;
+            pEntry->lqiAvg = (uint16_t)lqi * 16;
+        }
+        else
+        {
+            pEntry->rssiAvg += (((int16_t)rssi * 16) - pEntry->rssiAvg)
+                            / (1 << LINKSTATS_EWMA_SHIFT);
+            pEntry->lqiAvg = (uint16_t)((int32_t)pEntry->lqiAvg
+                            + ((((int32_t)lqi * 16) - pEntry->lqiAvg)
+                            / (1 << LINKSTATS_EWMA_SHIFT)));
+        }
+        pEntry->lastRssi = rssi;
+        pEntry->lastSeen = Util_getTimeMs();
+        pEntry->rxFrames++;
+    }
+    pthread_mutex_unlock(&linkTableMutex);
+}
+
+/*!
+ Record the outcome of a frame sent to a device
+
+ Public function defined in linkStats.h
+ */
+void LinkStats_txResult(uint16_t shortAddr, ApiMac_status_t status)
+{
+    LinkStats_entry_t *pEntry;
+
+    pthread_mutex_lock(&linkTableMutex);
+    pEntry = findEntry(shortAddr, true);
+    if(pEntry != NULL)
+    {
+        pEntry->txAttempts++;
+        if(status == ApiMac_status_success)
+        {
+            pEntry->txSuccess++;
+        }
+        else if(status == ApiMac_status_channelAccessFailure)
+        {
+            pEntry->txChannelAccessFailures++;
+        }
+        else if(status == ApiMac_status_noAck)
+        {
+            pEntry->txAckFailures++;
+        }
+        else if(status == ApiMac_status_transactionExpired)
+        {
+            pEntry->txExpired++;
+        }
+        else
+        {
+            pEntry->txOtherFailures++;
+        }
+    }
+    pthread_mutex_unlock(&linkTableMutex);
+}
+
+/*!
+ Record the message statistics reported by a device
+
+ Public function defined in linkStats.h
+ */
+void LinkStats_msgStats(uint16_t shortAddr, Smsgs_msgStatsField_t *pStats)
+{
+    LinkStats_entry_t *pEntry;
+
+    pthread_mutex_lock(&linkTableMutex);
+    pEntry = findEntry(shortAddr, true);
+    if(pEntry != NULL)
+    {
+        Smsgs_msgStatsField_t *pLast = &pEntry->lastMsgStats;
+        bool restarted = true;
+
+        if(pEntry->msgStatsValid)
+        {
+            /* The counters of the device start over after a reset */
+            restarted = (pStats->resetCount != pLast->resetCount)
+                        || (pStats->msgsAttempted < pLast->msgsAttempted);
+        }
+
+        pEntry->devMsgsAttempted += counterDelta(pStats->msgsAttempted,
+                                                 pLast->msgsAttempted,
+                                                 restarted);
+        pEntry->devMsgsSent += counterDelta(pStats->msgsSent,
+                                            pLast->msgsSent, restarted);
+        pEntry->devChannelAccessFailures += counterDelta(
+                        pStats->channelAccessFailures,
+                        pLast->channelAccessFailures, restarted);
+        pEntry->devMacAckFailures += counterDelta(pStats->macAckFailures,
+                                                  pLast->macAckFailures,
+                                                  restarted);
+
+        memcpy(pLast, pStats, sizeof(Smsgs_msgStatsField_t));
+        pEntry->msgStatsValid = true;
+    }
+    pthread_mutex_unlock(&linkTableMutex);
+}
+
+/*!
+ Remove a device from the link table
+
+ Public function defined in linkStats.h
+ */
+void LinkStats_remove(uint16_t shortAddr)
+{
+    LinkStats_entry_t *pEntry;
+    uint16_t hole;
+    uint16_t idx;
+
+    pthread_mutex_lock(&linkTableMutex);
+    pEntry = findEntry(shortAddr, false);
+    if(pEntry != NULL)
+    {
+        /* Backward shift the following entries so probing stays intact */
+        hole = (uint16_t)(pEntry - linkTable);
+        idx = (hole + 1) & LINKSTATS_TABLE_MASK;
+        while(linkTable[idx].shortAddr != INVALID_SHORT_ADDR)
+        {
+            uint16_t home = LINKSTATS_HASH(linkTable[idx].shortAddr);
+
+            if(((idx - home) & LINKSTATS_TABLE_MASK)
+               >= ((idx - hole) & LINKSTATS_TABLE_MASK))
+            {
+                memcpy(&linkTable[hole], &linkTable[idx],
+                       sizeof(LinkStats_entry_t));
+                hole = idx;
+            }
+            idx = (idx + 1) & LINKSTATS_TABLE_MASK;
+        }
+        memset(&linkTable[hole], 0, sizeof(LinkStats_entry_t));
+        linkTable[hole].shortAddr = INVALID_SHORT_ADDR;
+    }
+    pthread_mutex_unlock(&linkTableMutex);
+}
+
+/*!
+ Get a copy of the link statistics of a device
+
+ Public function defined in linkStats.h
+ */
+bool LinkStats_get(uint16_t shortAddr, LinkStats_entry_t *pEntry)
+{
+    LinkStats_entry_t *pItem;
+
+    pthread_mutex_lock(&linkTableMutex);
+    pItem = findEntry(shortAddr, false);
+    if(pItem != NULL)
+    {
+        memcpy(pEntry, pItem, sizeof(LinkStats_entry_t));
+    }
+    pthread_mutex_unlock(&linkTableMutex);
+
+    return (pItem != NULL);
+}
+
+/*!
+ Get the delivery ratio of frames sent to a device
+
+ Public function defined in linkStats.h
+ */
+uint8_t LinkStats_deliveryRatio(LinkStats_entry_t *pEntry)
+{
+    if(pEntry->txAttempts == 0)
+    {
+        return (100);
+    }
+    return ((uint8_t)(((uint64_t)pEntry->txSuccess * 100)
+                    / pEntry->txAttempts));
+}
+
+/******************************************************************************
+ Local Functions
+ *****************************************************************************/
+
+/*!
+ * @brief       Find the table entry of a device, the table lock must be held
+ *
+ * @param       shortAddr - short address of the device
+ * @param       add - true to add the device if it isn't in the table
+ *
+ * @return      pointer to the entry, NULL if not found or the table is full
+ */
+static LinkStats_entry_t *findEntry(uint16_t shortAddr, bool add)
+{
+    uint16_t idx = LINKSTATS_HASH(shortAddr);
+    uint16_t probes;
+
+    if(shortAddr == INVALID_SHORT_ADDR)
+    {
+        return (NULL);
+    }
+
+    for(probes = 0; probes < LINKSTATS_TABLE_SIZE; probes++)
+    {
+        if(linkTable[idx].shortAddr == shortAddr)
+        {
+            return (&linkTable[idx]);
+        }
+        if(linkTable[idx].shortAddr == INVALID_SHORT_ADDR)
+        {
+            if(add)
+            {
+                linkTable[idx].shortAddr = shortAddr;
+                return (&linkTable[idx]);
+            }
+            break;
+        }
+        idx = (idx + 1) & LINKSTATS_TABLE_MASK;
+    }
+
+    return (NULL);
+}
+
+/*!
+ * @brief       Difference of a device counter since the last report
+ *
+ * @param       newVal - reported value
+ * @param       oldVal - previously reported value
+ * @param       restarted - true if the device counters started over
+ *
+ * @return      counter increment
+ */
+static uint16_t counterDelta(uint16_t newVal, uint16_t oldVal, bool restarted)
+{
+    if(restarted)
+    {
+        return (newVal);
+    }
+    return ((uint16_t)(newVal - oldVal));
+}
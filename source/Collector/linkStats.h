@@ -0,0 +1,193 @@
+/******************************************************************************
+
+ @file linkStats.h
+
+ @brief Per device link quality and reliability table
+
+ Group: WCS LPC
+ Target Device: CC13xx CC32xx
+
+ ******************************************************************************
+
+ Copyright (c) 2016-2017, Texas Instruments Incorporated
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions
+ are met:
+
+ *  Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+
+ *  Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+
+ *  Neither the name of Texas Instruments Incorporated nor the names of
+    its contributors may be used to endorse or promote products derived
+    from this software without specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+ ******************************************************************************
+ Release Name:
+ Release Date:
+ *****************************************************************************/
+
+#ifndef COLLECTOR_LINKSTATS_H_
+#define COLLECTOR_LINKSTATS_H_
+//*****************************************************************************
+//
+// If building with a C++ compiler, make all of the definitions in this header
+// have a C binding.
+//
+//*****************************************************************************
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <API_MAC/api_mac.h>
+#include "smsgs.h"
+
+/******************************************************************************
+ Constants and definitions
+ *****************************************************************************/
+
+/*! Number of entries in the link table, must be a power of 2 */
+#define LINKSTATS_TABLE_SIZE    128
+
+/*! EWMA weight of a new RSSI/LQI sample, as a shift (1/8) */
+#define LINKSTATS_EWMA_SHIFT    3
+
+/******************************************************************************
+ Structures
+ *****************************************************************************/
+
+/*! Link statistics of one device */
+typedef struct
+{
+    /*! Short address of the device, INVALID_SHORT_ADDR if unused */
+    uint16_t shortAddr;
+    /*! RSSI average in dBm, scaled by 16 */
+    int16_t rssiAvg;
+    /*! Link quality average, scaled by 16 */
+    uint16_t lqiAvg;
+    /*! RSSI of the last received frame */
+    int8_t lastRssi;
+    /*! Time the last frame was received, in milliseconds */
+    uint32_t lastSeen;
+    /*! Total number of frames received from the device */
+    uint32_t rxFrames;
+    /*! Total number of frames sent to the device (data confirms) */
+    uint32_t txAttempts;
+    /*! Total number of frames delivered to the device */
+    uint32_t txSuccess;
+    /*! Frames to the device failed because of channel access failure */
+    uint32_t txChannelAccessFailures;
+    /*! Frames to the device failed because the ACK was not received */
+    uint32_t txAckFailures;
+    /*! Indirect frames to the device that expired before being polled */
+    uint32_t txExpired;
+    /*! Frames to the device failed for any other reason */
+    uint32_t txOtherFailures;
+    /*! Messages the device reported as attempted, accumulated deltas */
+    uint32_t devMsgsAttempted;
+    /*! Messages the device reported as sent, accumulated deltas */
+    uint32_t devMsgsSent;
+    /*! Channel access failures reported by the device, accumulated deltas */
+    uint32_t devChannelAccessFailures;
+    /*! MAC ACK failures reported by the device, accumulated deltas */
+    uint32_t devMacAckFailures;
+    /*! true if lastMsgStats holds a report from the device */
+    bool msgStatsValid;
+    /*! Last message statistics reported by the device */
+    Smsgs_msgStatsField_t lastMsgStats;
+} LinkStats_entry_t;
+
+/******************************************************************************
+ Function Prototypes
+ *****************************************************************************/
+
+/*!
+ * @brief       Clear the link table
+ */
+extern void LinkStats_init(void);
+
+/*!
+ * @brief       Record a frame received from a device
+ *
+ * @param       shortAddr - short address of the device
+ * @param       rssi - RSSI of the frame in dBm
+ * @param       lqi - link quality of the frame
+ */
+extern void LinkStats_rxFrame(uint16_t shortAddr, int8_t rssi, uint8_t lqi);
+
+/*!
+ * @brief       Record the outcome of a frame sent to a device
+ *
+ * @param       shortAddr - short address of the device
+ * @param       status - status of the data confirm
+ */
+extern void LinkStats_txResult(uint16_t shortAddr, ApiMac_status_t status);
+
+/*!
+ * @brief       Record the message statistics reported by a device. The
+ *              difference to the previous report is accumulated, a restart
+ *              of the device counters is detected.
+ *
+ * @param       shortAddr - short address of the device
+ * @param       pStats - message statistics field of the sensor data
+ */
+extern void LinkStats_msgStats(uint16_t shortAddr,
+                               Smsgs_msgStatsField_t *pStats);
+
+/*!
+ * @brief       Remove a device from the link table
+ *
+ * @param       shortAddr - short address of the device
+ */
+extern void LinkStats_remove(uint16_t shortAddr);
+
+/*!
+ * @brief       Get a copy of the link statistics of a device. Can be called
+ *              from any task.
+ *
+ * @param       shortAddr - short address of the device
+ * @param       pEntry - copy of the entry
+ *
+ * @return      true if the device is in the table
+ */
+extern bool LinkStats_get(uint16_t shortAddr, LinkStats_entry_t *pEntry);
+
+/*!
+ * @brief       Get the delivery ratio of frames sent to a device
+ *
+ * @param       pEntry - link table entry
+ *
+ * @return      delivered frames in percent, 100 if nothing was sent yet
+ */
+extern uint8_t LinkStats_deliveryRatio(LinkStats_entry_t *pEntry);
+
+//*****************************************************************************
+//
+// Mark the end of the C bindings section for C++ compilers.
+//
+//*****************************************************************************
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* COLLECTOR_LINKSTATS_H_ */
@@ -0,0 +1,218 @@
+/******************************************************************************
+
+ @file oadImage.c
+
+ @brief Sensor firmware image stored on the gateway file system
+
+ Group: WCS LPC
+ Target Device: CC13xx CC32xx
+
+ ******************************************************************************
+
+ Copyright (c) 2016-2017, Texas Instruments Incorporated
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions
+ are met:
+
+ *  Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+
+ *  Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+
+ *  Neither the name of Texas Instruments Incorporated nor the names of
+    its contributors may be used to endorse or promote products derived
+    from this software without specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+ ******************************************************************************
+ Release Name:
+ Release Date:
+ *****************************************************************************/
+
+/******************************************************************************
+ Includes
+ *****************************************************************************/
+#include <stdint.h>
+#include <stdbool.h>
+#include <ti/drivers/net/wifi/simplelink.h>
+#include "oadImage.h"
+
+/******************************************************************************
+ Constants and definitions
+ *****************************************************************************/
+
+/*! Bytes read at a time while computing the checksum */
+#define OAD_IMAGE_CHUNK         256
+
+/******************************************************************************
+ Local function prototypes
+ *****************************************************************************/
+static uint32_t imageLength(void);
+static uint32_t imageChecksum(void);
+static int32_t imageRead(uint32_t offset, uint8_t *pBuf, uint16_t len);
+static void imageClose(void);
+
+/******************************************************************************
+ Local variables
+ *****************************************************************************/
+
+/*! Checksum of the image, valid while the file keeps its length and
+    write counter */
+static bool checksumValid = false;
+static uint32_t checksumLen = 0;
+static uint32_t checksumWrites = 0;
+static uint32_t checksum = 0;
+
+/*! File handle kept open while downloads read the image */
+static long readHandle = -1;
+
+/******************************************************************************
+ Global Variables
+ *****************************************************************************/
+
+const OadServer_image_t OadImage_file =
+{
+    OAD_IMAGE_ID,
+    imageLength,
+    imageChecksum,
+    imageRead,
+    imageClose
+};
+
+/******************************************************************************
+ Local Functions
+ *****************************************************************************/
+
+/*!
+ * @brief       Get the length of the image file
+ *
+ * @return      length in bytes, 0 if the file doesn't exist
+ */
+static uint32_t imageLength(void)
+{
+    SlFsFileInfo_t fsFileInfo;
+
+    if(sl_FsGetInfo((unsigned char *)OAD_IMAGE_FILE, 0, &fsFileInfo) < 0)
+    {
+        return (0);
+    }
+    return (fsFileInfo.Len);
+}
+
+/*!
+ * @brief       Get the 32 bit sum of all image bytes. Reading the whole
+ *              file takes a while, so it is only done when the file was
+ *              written since the last sum.
+ *
+ * @return      checksum
+ */
+static uint32_t imageChecksum(void)
+{
+    uint8_t buffer[OAD_IMAGE_CHUNK];
+    SlFsFileInfo_t fsFileInfo;
+    unsigned long token;
+    long fsHandle;
+    uint32_t offset = 0;
+    uint32_t sum = 0;
+    int32_t bytesRead;
+    int32_t i;
+
+    if(sl_FsGetInfo((unsigned char *)OAD_IMAGE_FILE, 0, &fsFileInfo) < 0)
+    {
+        return (checksum);
+    }
+    if(checksumValid && (fsFileInfo.Len == checksumLen)
+       && (fsFileInfo.WriteCounter == checksumWrites))
+    {
+        return (checksum);
+    }
+
+    fsHandle = sl_FsOpen((unsigned char *)OAD_IMAGE_FILE, SL_FS_READ, &token);
+    if(fsHandle < 0)
+    {
+        return (checksum);
+    }
+
+    while(offset < fsFileInfo.Len)
+    {
+        bytesRead = sl_FsRead(fsHandle, offset, buffer, OAD_IMAGE_CHUNK);
+        if(bytesRead <= 0)
+        {
+            break;
+        }
+        for(i = 0; i < bytesRead; i++)
+        {
+            sum += buffer[i];
+        }
+        offset += bytesRead;
+    }
+    sl_FsClose(fsHandle, NULL, 0, 0);
+
+    checksumValid = (offset == fsFileInfo.Len);
+    checksumLen = fsFileInfo.Len;
+    checksumWrites = fsFileInfo.WriteCounter;
+    checksum = sum;
+    return (checksum);
+}
+
+/*!
+ * @brief       Read a part of the image. The file is opened by the first
+ *              read and stays open until imageClose().
+ *
+ * @param       offset - offset in the image
+ * @param       pBuf - buffer of len bytes
+ * @param       len - number of bytes to read
+ *
+ * @return      number of bytes read, negative on error
+ */
+static int32_t imageRead(uint32_t offset, uint8_t *pBuf, uint16_t len)
+{
+    unsigned long token;
+    int32_t bytesRead;
+
+    if(readHandle < 0)
+    {
+        readHandle = sl_FsOpen((unsigned char *)OAD_IMAGE_FILE, SL_FS_READ,
+                               &token);
+        if(readHandle < 0)
+        {
+            return (readHandle);
+        }
+    }
+
+    bytesRead = sl_FsRead(readHandle, offset, pBuf, len);
+    if(bytesRead < 0)
+    {
+        /* Open again on the next read */
+        imageClose();
+    }
+    return (bytesRead);
+}
+
+/*!
+ * @brief       Close the file kept open by imageRead(), so it can be
+ *              replaced while no download is running
+ */
+static void imageClose(void)
+{
+    if(readHandle >= 0)
+    {
+        sl_FsClose(readHandle, NULL, 0, 0);
+        readHandle = -1;
+    }
+}
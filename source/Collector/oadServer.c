@@ -0,0 +1,839 @@
+/******************************************************************************
+
+ @file oadServer.c
+
+ @brief Over-the-air firmware download server
+
+ Group: WCS LPC
+ Target Device: CC13xx CC32xx
+
+ ******************************************************************************
+
+ Copyright (c) 2016-2017, Texas Instruments Incorporated
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions
+ are met:
+
+ *  Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+
+ *  Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+
+ *  Neither the name of Texas Instruments Incorporated nor the names of
+    its contributors may be used to endorse or promote products derived
+    from this software without specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+ ******************************************************************************
+ Release Name:
+ Release Date:
+ *****************************************************************************/
+
+/******************************************************************************
+ Includes
+ *****************************************************************************/
+#include <string.h>
+#include <pthread.h>
+#include <Utils/util.h>
+#include "smsgs.h"
+#include "linkStats.h"
+#include "oadServer.h"
+
+/******************************************************************************
+ Constants and definitions
+ *****************************************************************************/
+
+/*! No block waiting to be served */
+#define OAD_NO_BLOCK                0xFFFF
+
+/*! Image Identify Request is repeated until the device answers */
+#define OAD_IDENTIFY_RETRY_MS       5000
+
+/*! Download of one device */
+typedef struct
+{
+    /*! true if the entry is in use */
+    bool used;
+    /*! true if the device doesn't sleep */
+    bool rxOnIdle;
+    /*! true if the progress has to be reported */
+    bool reportDue;
+    /*! Percentage that was reported last */
+    uint8_t reportedPct;
+    /*! Requested block waiting for its pacing gap or a poll */
+    uint16_t pendingBlock;
+    /*! Time the last message was sent to the device */
+    uint32_t lastTxTime;
+    /*! Time the last message was received from the device */
+    uint32_t lastRxTime;
+    /*! Start of the current run, elapsedMs excludes suspended time */
+    uint32_t runStart;
+    /*! Time of all previous runs */
+    uint32_t runElapsed;
+    /*! Start request order, waiting devices are started first come first
+        served */
+    uint32_t seq;
+    /*! Length and checksum of the image announced to the device */
+    uint32_t imgLen;
+    uint32_t imgChecksum;
+    OadServer_progress_t progress;
+} oadDevice_t;
+
+/******************************************************************************
+ Local variables
+ *****************************************************************************/
+
+static const OadServer_callbacks_t *pOadCallbacks = NULL;
+static const OadServer_image_t *pOadImage = NULL;
+
+static oadDevice_t oadDevices[OAD_MAX_DEVICES];
+static uint32_t oadSeq = 0;
+
+/*! Protects the progress read by other tasks */
+static pthread_mutex_t oadMutex;
+static bool oadMutexInit = false;
+
+/******************************************************************************
+ Local function prototypes
+ *****************************************************************************/
+static oadDevice_t *findDevice(uint16_t shortAddr);
+static oadDevice_t *allocDevice(uint16_t shortAddr);
+static uint8_t activeSessions(void);
+static bool isRunning(oadDevice_t *pDev);
+static void sendIdentify(oadDevice_t *pDev);
+static void processIdentifyRsp(oadDevice_t *pDev, uint8_t *pBuf);
+static void processBlockReq(oadDevice_t *pDev, uint8_t *pBuf);
+static void processDoneInd(oadDevice_t *pDev, uint8_t *pBuf);
+static void serveBlock(oadDevice_t *pDev);
+static uint32_t blockGap(uint16_t shortAddr);
+static void stopRun(oadDevice_t *pDev, OadServer_state_t state);
+static void updateProgress(oadDevice_t *pDev, bool force);
+static void startWaiting(void);
+static void flushReports(void);
+
+/******************************************************************************
+ Public Functions
+ *****************************************************************************/
+
+/*!
+ Initialize the server
+
+ Public function defined in oadServer.h
+ */
+void OadServer_init(const OadServer_callbacks_t *pCallbacks)
+{
+    if(!oadMutexInit)
+    {
+        pthread_mutex_init(&oadMutex, NULL);
+        oadMutexInit = true;
+    }
+
+    pthread_mutex_lock(&oadMutex);
+    pOadCallbacks = pCallbacks;
+    memset(oadDevices, 0, sizeof(oadDevices));
+    pthread_mutex_unlock(&oadMutex);
+}
+
+/*!
+ Set the firmware image
+
+ Public function defined in oadServer.h
+ */
+void OadServer_setImage(const OadServer_image_t *pImage)
+{
+    pOadImage = pImage;
+}
+
+/*!
+ Start the download of the image to a device
+
+ Public function defined in oadServer.h
+ */
+OadServer_status_t OadServer_start(uint16_t shortAddr, bool rxOnIdle)
+{
+    OadServer_status_t status;
+    oadDevice_t *pDev;
+    uint32_t imgLen;
+    uint32_t imgChecksum;
+
+    if((pOadImage == NULL) || (pOadCallbacks == NULL)
+       || ((imgLen = pOadImage->pfnLength()) == 0))
+    {
+        return (OadServer_status_noImage);
+    }
+    /* Summing a new image reads the whole file, keep it out of the lock */
+    imgChecksum = pOadImage->pfnChecksum();
+
+    pthread_mutex_lock(&oadMutex);
+    pDev = findDevice(shortAddr);
+    if(pDev == NULL)
+    {
+        pDev = allocDevice(shortAddr);
+    }
+
+    if(pDev == NULL)
+    {
+        status = OadServer_status_noRoom;
+    }
+    else if(isRunning(pDev))
+    {
+        /* Already downloading, nothing to do */
+        status = OadServer_status_started;
+    }
+    else
+    {
+        pDev->rxOnIdle = rxOnIdle;
+        pDev->pendingBlock = OAD_NO_BLOCK;
+        pDev->runElapsed = 0;
+        pDev->reportedPct = 0;
+        pDev->seq = oadSeq++;
+        pDev->imgLen = imgLen;
+        pDev->imgChecksum = imgChecksum;
+        memset(&pDev->progress, 0, sizeof(OadServer_progress_t));
+        pDev->progress.shortAddr = shortAddr;
+        pDev->progress.imgId = pOadImage->imgId;
+        pDev->progress.totalBlocks = (uint16_t)((imgLen + OAD_BLOCK_SIZE - 1)
+                                                / OAD_BLOCK_SIZE);
+        pDev->progress.state = OadServer_state_waiting;
+
+        if(activeSessions() < OAD_MAX_SESSIONS)
+        {
+            sendIdentify(pDev);
+            status = OadServer_status_started;
+        }
+        else
+        {
+            status = OadServer_status_waiting;
+        }
+        updateProgress(pDev, true);
+    }
+    pthread_mutex_unlock(&oadMutex);
+
+    flushReports();
+    return (status);
+}
+
+/*!
+ Process an OAD message received from a device
+
+ Public function defined in oadServer.h
+ */
+void OadServer_processMsg(uint16_t shortAddr, uint16_t len, uint8_t *pData)
+{
+    oadDevice_t *pDev;
+
+    if((len < (OAD_HDR_LEN + 1)) || (pOadImage == NULL))
+    {
+        return;
+    }
+
+    pthread_mutex_lock(&oadMutex);
+    pDev = findDevice(shortAddr);
+    /* Ignore devices that were not started and other images */
+    if((pDev != NULL) && (pData[OAD_HDR_LEN] == pDev->progress.imgId))
+    {
+        pDev->lastRxTime = Util_getTimeMs();
+
+        switch(pData[1])
+        {
+            case OadServer_cmd_imgIdentifyRsp:
+                if(len >= OAD_IMG_IDENTIFY_RSP_LEN)
+                {
+                    processIdentifyRsp(pDev, &pData[OAD_HDR_LEN + 1]);
+                }
+                break;
+
+            case OadServer_cmd_blockReq:
+                if(len >= OAD_BLOCK_REQ_LEN)
+                {
+                    processBlockReq(pDev, &pData[OAD_HDR_LEN + 1]);
+                }
+                break;
+
+            case OadServer_cmd_imgDoneInd:
+                if(len >= OAD_IMG_DONE_IND_LEN)
+                {
+                    processDoneInd(pDev, &pData[OAD_HDR_LEN + 1]);
+                }
+                break;
+
+            default:
+                break;
+        }
+    }
+    pthread_mutex_unlock(&oadMutex);
+
+    flushReports();
+}
+
+/*!
+ Serve the pending block of a sleepy device
+
+ Public function defined in oadServer.h
+ */
+void OadServer_poll(uint16_t shortAddr)
+{
+    oadDevice_t *pDev;
+
+    pthread_mutex_lock(&oadMutex);
+    pDev = findDevice(shortAddr);
+    if((pDev != NULL) && (pDev->rxOnIdle == false)
+       && (pDev->progress.state == OadServer_state_active))
+    {
+        serveBlock(pDev);
+    }
+    pthread_mutex_unlock(&oadMutex);
+
+    flushReports();
+}
+
+/*!
+ A message to a device did not get through
+
+ Public function defined in oadServer.h
+ */
+void OadServer_txFailed(uint16_t shortAddr)
+{
+    oadDevice_t *pDev;
+
+    pthread_mutex_lock(&oadMutex);
+    pDev = findDevice(shortAddr);
+    if((pDev != NULL) && (pDev->progress.state == OadServer_state_identify))
+    {
+        /* Don't wait for the retry time */
+        pDev->lastTxTime = Util_getTimeMs() - OAD_IDENTIFY_RETRY_MS - 1;
+    }
+    pthread_mutex_unlock(&oadMutex);
+}
+
+/*!
+ Serve paced blocks, suspend stale downloads and start waiting ones
+
+ Public function defined in oadServer.h
+ */
+bool OadServer_process(void)
+{
+    uint32_t now = Util_getTimeMs();
+    bool running = false;
+    uint8_t i;
+
+    pthread_mutex_lock(&oadMutex);
+    for(i = 0; i < OAD_MAX_DEVICES; i++)
+    {
+        oadDevice_t *pDev = &oadDevices[i];
+
+        if(!pDev->used || !isRunning(pDev))
+        {
+            continue;
+        }
+
+        if((now - pDev->lastRxTime) > OAD_SESSION_TIMEOUT_MS)
+        {
+            /* Free the session, the device resumes with its next request */
+            stopRun(pDev, OadServer_state_suspended);
+        }
+        else if(pDev->progress.state == OadServer_state_identify)
+        {
+            if((now - pDev->lastTxTime) > OAD_IDENTIFY_RETRY_MS)
+            {
+                sendIdentify(pDev);
+            }
+        }
+        else if(pDev->rxOnIdle)
+        {
+            serveBlock(pDev);
+        }
+    }
+
+    startWaiting();
+
+    for(i = 0; i < OAD_MAX_DEVICES; i++)
+    {
+        if(oadDevices[i].used
+           && (isRunning(&oadDevices[i])
+               || (oadDevices[i].progress.state == OadServer_state_waiting)))
+        {
+            running = true;
+        }
+    }
+    if(!running && (pOadImage != NULL) && (pOadImage->pfnClose != NULL))
+    {
+        pOadImage->pfnClose();
+    }
+    pthread_mutex_unlock(&oadMutex);
+
+    flushReports();
+    return (running);
+}
+
+/*!
+ Get a copy of the download progress of a device
+
+ Public function defined in oadServer.h
+ */
+bool OadServer_getProgress(uint16_t shortAddr, OadServer_progress_t *pProgress)
+{
+    oadDevice_t *pDev;
+
+    if(!oadMutexInit)
+    {
+        return (false);
+    }
+
+    pthread_mutex_lock(&oadMutex);
+    pDev = findDevice(shortAddr);
+    if(pDev != NULL)
+    {
+        updateProgress(pDev, false);
+        *pProgress = pDev->progress;
+    }
+    pthread_mutex_unlock(&oadMutex);
+
+    return (pDev != NULL);
+}
+
+/******************************************************************************
+ Local Functions
+ *****************************************************************************/
+
+/*!
+ * @brief       Find the download of a device, the lock must be held
+ *
+ * @param       shortAddr - short address of the device
+ *
+ * @return      pointer to the entry, NULL if not found
+ */
+static oadDevice_t *findDevice(uint16_t shortAddr)
+{
+    uint8_t i;
+
+    for(i = 0; i < OAD_MAX_DEVICES; i++)
+    {
+        if(oadDevices[i].used && (oadDevices[i].progress.shortAddr == shortAddr))
+        {
+            return (&oadDevices[i]);
+        }
+    }
+    return (NULL);
+}
+
+/*!
+ * @brief       Get a free entry, reusing the oldest finished or suspended
+ *              download if the table is full. The lock must be held.
+ *
+ * @param       shortAddr - short address of the device
+ *
+ * @return      pointer to the entry, NULL if all entries are in use
+ */
+static oadDevice_t *allocDevice(uint16_t shortAddr)
+{
+    oadDevice_t *pFree = NULL;
+    uint8_t i;
+
+    for(i = 0; i < OAD_MAX_DEVICES; i++)
+    {
+        oadDevice_t *pDev = &oadDevices[i];
+
+        if(!pDev->used)
+        {
+            pFree = pDev;
+            break;
+        }
+        if(!isRunning(pDev)
+           && (pDev->progress.state != OadServer_state_waiting)
+           && ((pFree == NULL) || ((int32_t)(pDev->seq - pFree->seq) < 0)))
+        {
+            pFree = pDev;
+        }
+    }
+
+    if(pFree != NULL)
+    {
+        memset(pFree, 0, sizeof(oadDevice_t));
+        pFree->used = true;
+        pFree->progress.shortAddr = shortAddr;
+    }
+    return (pFree);
+}
+
+/*!
+ * @brief       Count the downloads holding a session
+ *
+ * @return      number of running downloads
+ */
+static uint8_t activeSessions(void)
+{
+    uint8_t i;
+    uint8_t count = 0;
+
+    for(i = 0; i < OAD_MAX_DEVICES; i++)
+    {
+        if(oadDevices[i].used && isRunning(&oadDevices[i]))
+        {
+            count++;
+        }
+    }
+    return (count);
+}
+
+/*!
+ * @brief       Check if a download holds a session
+ *
+ * @param       pDev - download entry
+ *
+ * @return      true if identifying or serving blocks
+ */
+static bool isRunning(oadDevice_t *pDev)
+{
+    return ((pDev->progress.state == OadServer_state_identify)
+            || (pDev->progress.state == OadServer_state_active));
+}
+
+/*!
+ * @brief       Send the Image Identify Request and take a session
+ *
+ * @param       pDev - download entry
+ */
+static void sendIdentify(oadDevice_t *pDev)
+{
+    uint8_t buffer[OAD_IMG_IDENTIFY_REQ_LEN];
+    uint8_t *pBuf = buffer;
+    uint32_t now = Util_getTimeMs();
+
+    *pBuf++ = (uint8_t)Smsgs_cmdIds_oad;
+    *pBuf++ = (uint8_t)OadServer_cmd_imgIdentifyReq;
+    *pBuf++ = pOadImage->imgId;
+    pBuf = Util_bufferUint32(pBuf, pDev->imgLen);
+    *pBuf++ = OAD_BLOCK_SIZE;
+    Util_bufferUint32(pBuf, pDev->imgChecksum);
+
+    if(pDev->progress.state != OadServer_state_identify)
+    {
+        pDev->progress.state = OadServer_state_identify;
+        pDev->runStart = now;
+        pDev->lastRxTime = now;
+    }
+    pDev->lastTxTime = now;
+
+    pOadCallbacks->pfnSend(pDev->progress.shortAddr, pDev->rxOnIdle,
+                           OAD_IMG_IDENTIFY_REQ_LEN, buffer);
+}
+
+/*!
+ * @brief       Process an Image Identify Response
+ *
+ * @param       pDev - download entry
+ * @param       pBuf - message, after the image ID
+ */
+static void processIdentifyRsp(oadDevice_t *pDev, uint8_t *pBuf)
+{
+    uint16_t nextBlock = Util_buildUint16(pBuf[1], pBuf[2]);
+
+    if(pDev->progress.state != OadServer_state_identify)
+    {
+        return;
+    }
+
+    if(pBuf[0] != 0)
+    {
+        /* The device doesn't want the image */
+        stopRun(pDev, OadServer_state_failed);
+        return;
+    }
+
+    pDev->progress.state = OadServer_state_active;
+    if(nextBlock != 0)
+    {
+        pDev->progress.resumes++;
+    }
+    pDev->progress.nextBlock = nextBlock;
+    updateProgress(pDev, true);
+}
+
+/*!
+ * @brief       Process a Block Request. The block is served right away if
+ *              the pacing allows, else by OadServer_process() or, for a
+ *              sleepy device, on its next poll.
+ *
+ * @param       pDev - download entry
+ * @param       pBuf - message, after the image ID
+ */
+static void processBlockReq(oadDevice_t *pDev, uint8_t *pBuf)
+{
+    uint16_t blockNum = Util_buildUint16(pBuf[0], pBuf[1]);
+
+    if(blockNum >= pDev->progress.totalBlocks)
+    {
+        return;
+    }
+
+    switch(pDev->progress.state)
+    {
+        case OadServer_state_identify:
+            /* The Image Identify Response was lost */
+            pDev->progress.state = OadServer_state_active;
+            break;
+
+        case OadServer_state_suspended:
+            if(activeSessions() >= OAD_MAX_SESSIONS)
+            {
+                /* The device asks again later */
+                return;
+            }
+            pDev->progress.state = OadServer_state_active;
+            pDev->progress.resumes++;
+            pDev->runStart = Util_getTimeMs();
+            updateProgress(pDev, true);
+            break;
+
+        case OadServer_state_active:
+            break;
+
+        default:
+            return;
+    }
+
+    if(blockNum < pDev->progress.nextBlock)
+    {
+        pDev->progress.blocksRepeated++;
+    }
+    else
+    {
+        pDev->progress.nextBlock = blockNum + 1;
+    }
+    pDev->pendingBlock = blockNum;
+
+    if(pDev->rxOnIdle)
+    {
+        serveBlock(pDev);
+    }
+}
+
+/*!
+ * @brief       Process an Image Done Indication
+ *
+ * @param       pDev - download entry
+ * @param       pBuf - message, after the image ID
+ */
+static void processDoneInd(oadDevice_t *pDev, uint8_t *pBuf)
+{
+    if(isRunning(pDev))
+    {
+        stopRun(pDev, (pBuf[0] == 0) ? OadServer_state_done :
+                                       OadServer_state_failed);
+        startWaiting();
+    }
+}
+
+/*!
+ * @brief       Send the pending block if the pacing gap has passed
+ *
+ * @param       pDev - download entry
+ */
+static void serveBlock(oadDevice_t *pDev)
+{
+    uint8_t buffer[OAD_BLOCK_RSP_HDR_LEN + OAD_BLOCK_SIZE];
+    uint8_t *pBuf = buffer;
+    uint32_t now = Util_getTimeMs();
+    int32_t dataLen;
+
+    if((pDev->pendingBlock == OAD_NO_BLOCK)
+       || ((now - pDev->lastTxTime) < blockGap(pDev->progress.shortAddr)))
+    {
+        return;
+    }
+
+    *pBuf++ = (uint8_t)Smsgs_cmdIds_oad;
+    *pBuf++ = (uint8_t)OadServer_cmd_blockRsp;
+    *pBuf++ = pDev->progress.imgId;
+    pBuf = Util_bufferUint16(pBuf, pDev->pendingBlock);
+
+    dataLen = pOadImage->pfnRead((uint32_t)pDev->pendingBlock * OAD_BLOCK_SIZE,
+                                 pBuf, OAD_BLOCK_SIZE);
+    if(dataLen <= 0)
+    {
+        /* The image went away */
+        stopRun(pDev, OadServer_state_failed);
+        return;
+    }
+
+    if(pOadCallbacks->pfnSend(pDev->progress.shortAddr, pDev->rxOnIdle,
+                              (uint16_t)(OAD_BLOCK_RSP_HDR_LEN + dataLen),
+                              buffer))
+    {
+        pDev->pendingBlock = OAD_NO_BLOCK;
+        pDev->lastTxTime = now;
+        pDev->progress.blocksSent++;
+        updateProgress(pDev, false);
+    }
+}
+
+/*!
+ * @brief       Get the minimum time between two blocks to a device,
+ *              doubled for each sign of a bad link
+ *
+ * @param       shortAddr - short address of the device
+ *
+ * @return      gap in milliseconds
+ */
+static uint32_t blockGap(uint16_t shortAddr)
+{
+    LinkStats_entry_t link;
+    uint32_t gap = OAD_BLOCK_GAP_MS;
+
+    if(LinkStats_get(shortAddr, &link))
+    {
+        uint8_t ratio = LinkStats_deliveryRatio(&link);
+
+        if(ratio < OAD_GOOD_DELIVERY_RATIO)
+        {
+            gap <<= 1;
+        }
+        if(ratio < (OAD_GOOD_DELIVERY_RATIO / 2))
+        {
+            gap <<= 1;
+        }
+        if((link.rxFrames != 0) && ((link.lqiAvg / 16) < OAD_POOR_LQI))
+        {
+            gap <<= 1;
+        }
+    }
+    return (gap);
+}
+
+/*!
+ * @brief       End the current run of a download and free its session
+ *
+ * @param       pDev - download entry
+ * @param       state - new state
+ */
+static void stopRun(oadDevice_t *pDev, OadServer_state_t state)
+{
+    updateProgress(pDev, false);
+    if(state == OadServer_state_suspended)
+    {
+        /* Don't count the silence that led to the suspension */
+        pDev->progress.elapsedMs = pDev->runElapsed
+                        + (pDev->lastRxTime - pDev->runStart);
+    }
+    pDev->runElapsed = pDev->progress.elapsedMs;
+    pDev->pendingBlock = OAD_NO_BLOCK;
+    pDev->progress.state = state;
+    pDev->reportDue = true;
+}
+
+/*!
+ * @brief       Update the elapsed time and throughput of a download and
+ *              flag a report each OAD_PROGRESS_STEP percent
+ *
+ * @param       pDev - download entry
+ * @param       force - true to report in any case
+ */
+static void updateProgress(oadDevice_t *pDev, bool force)
+{
+    OadServer_progress_t *pProgress = &pDev->progress;
+    uint32_t bytes;
+    uint8_t pct = 0;
+
+    if(isRunning(pDev))
+    {
+        pProgress->elapsedMs = pDev->runElapsed
+                        + (Util_getTimeMs() - pDev->runStart);
+    }
+
+    bytes = (uint32_t)pProgress->nextBlock * OAD_BLOCK_SIZE;
+    if(pProgress->elapsedMs != 0)
+    {
+        pProgress->throughput = (uint32_t)(((uint64_t)bytes * 1000)
+                                           / pProgress->elapsedMs);
+    }
+
+    if(pProgress->totalBlocks != 0)
+    {
+        pct = (uint8_t)(((uint32_t)pProgress->nextBlock * 100)
+                        / pProgress->totalBlocks);
+    }
+    if(force || (pct >= (pDev->reportedPct + OAD_PROGRESS_STEP)))
+    {
+        pDev->reportedPct = pct - (pct % OAD_PROGRESS_STEP);
+        pDev->reportDue = true;
+    }
+}
+
+/*!
+ * @brief       Start waiting downloads while sessions are free, first come
+ *              first served
+ */
+static void startWaiting(void)
+{
+    while(activeSessions() < OAD_MAX_SESSIONS)
+    {
+        oadDevice_t *pNext = NULL;
+        uint8_t i;
+
+        for(i = 0; i < OAD_MAX_DEVICES; i++)
+        {
+            oadDevice_t *pDev = &oadDevices[i];
+
+            if(pDev->used && (pDev->progress.state == OadServer_state_waiting)
+               && ((pNext == NULL) || ((int32_t)(pDev->seq - pNext->seq) < 0)))
+            {
+                pNext = pDev;
+            }
+        }
+
+        if(pNext == NULL)
+        {
+            break;
+        }
+        sendIdentify(pNext);
+        updateProgress(pNext, true);
+    }
+}
+
+/*!
+ * @brief       Hand flagged progress reports to the progress callback,
+ *              outside the lock
+ */
+static void flushReports(void)
+{
+    OadServer_progress_t reports[OAD_MAX_DEVICES];
+    uint8_t numReports = 0;
+    uint8_t i;
+
+    if((pOadCallbacks == NULL) || (pOadCallbacks->pfnProgress == NULL))
+    {
+        return;
+    }
+
+    pthread_mutex_lock(&oadMutex);
+    for(i = 0; i < OAD_MAX_DEVICES; i++)
+    {
+        if(oadDevices[i].used && oadDevices[i].reportDue)
+        {
+            oadDevices[i].reportDue = false;
+            reports[numReports++] = oadDevices[i].progress;
+        }
+    }
+    pthread_mutex_unlock(&oadMutex);
+
+    for(i = 0; i < numReports; i++)
+    {
+        pOadCallbacks->pfnProgress(&reports[i]);
+    }
+}
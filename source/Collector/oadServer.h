@@ -0,0 +1,314 @@
+/******************************************************************************
+
+ @file oadServer.h
+
+ @brief Over-the-air firmware download server
+
+ Group: WCS LPC
+ Target Device: CC13xx CC32xx
+
+ ******************************************************************************
+
+ Copyright (c) 2016-2017, Texas Instruments Incorporated
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions
+ are met:
+
+ *  Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+
+ *  Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+
+ *  Neither the name of Texas Instruments Incorporated nor the names of
+    its contributors may be used to endorse or promote products derived
+    from this software without specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+ ******************************************************************************
+ Release Name:
+ Release Date:
+ *****************************************************************************/
+
+#ifndef COLLECTOR_OADSERVER_H_
+#define COLLECTOR_OADSERVER_H_
+//*****************************************************************************
+//
+// If building with a C++ compiler, make all of the definitions in this header
+// have a C binding.
+//
+//*****************************************************************************
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/*!
+ \defgroup OAD Server
+ <BR>
+ The OAD server hands a firmware image to sensors block by block. All OAD
+ messages use the [Smsgs_cmdIds_oad](@ref Smsgs_cmdIds) command ID, followed
+ by the OAD command (@ref OadServer_cmds). Multi byte fields are sent low
+ byte first.
+ <BR>
+ The <b>Image Identify Request</b> (collector to sensor) is defined as:
+     - Image ID - (1 byte)
+     - Image Length - (32 bits) - in bytes
+     - Block Size - (1 byte) - payload bytes of each Block Response
+     - Image Checksum - (32 bits) - sum of all image bytes
+ <BR>
+ The <b>Image Identify Response</b> (sensor to collector) is defined as:
+     - Image ID - (1 byte)
+     - Status - (1 byte) - 0 if the sensor accepts the image
+     - Next Block - (16 bits) - first block the sensor needs, non zero when
+     an interrupted download is resumed
+ <BR>
+ The <b>Block Request</b> (sensor to collector) is defined as:
+     - Image ID - (1 byte)
+     - Block Number - (16 bits)
+ <BR>
+ The <b>Block Response</b> (collector to sensor) is defined as:
+     - Image ID - (1 byte)
+     - Block Number - (16 bits)
+     - Data - up to Block Size bytes, less for the last block
+ <BR>
+ The <b>Image Done Indication</b> (sensor to collector) is defined as:
+     - Image ID - (1 byte)
+     - Status - (1 byte) - 0 if the image was received and verified
+ <BR>
+ The server only depends on the callbacks given to OadServer_init() and on
+ the link statistics, so it can be run against simulated sensors on a host.
+ */
+
+/******************************************************************************
+ Constants and definitions
+ *****************************************************************************/
+
+/*! Image data bytes in a Block Response */
+#ifndef OAD_BLOCK_SIZE
+#define OAD_BLOCK_SIZE              64
+#endif
+
+/*! Devices that can download at the same time */
+#ifndef OAD_MAX_SESSIONS
+#define OAD_MAX_SESSIONS            4
+#endif
+
+/*! Devices the server keeps track of, including waiting, finished and
+    suspended downloads */
+#define OAD_MAX_DEVICES             (OAD_MAX_SESSIONS * 2)
+
+/*! Minimum time between two blocks to a device on a good link */
+#define OAD_BLOCK_GAP_MS            20
+
+/*! Delivery ratio (%) and LQI below which the block gap is doubled */
+#define OAD_GOOD_DELIVERY_RATIO     95
+#define OAD_POOR_LQI                80
+
+/*! A download without a request for this long is suspended */
+#define OAD_SESSION_TIMEOUT_MS      60000
+
+/*! Interval of OadServer_process() while downloads are running */
+#define OAD_TICK_MS                 50
+
+/*! Progress is reported each time this many percent are done */
+#define OAD_PROGRESS_STEP           10
+
+/*! OAD message header: Smsgs command ID and OAD command */
+#define OAD_HDR_LEN                 2
+#define OAD_IMG_IDENTIFY_REQ_LEN    (OAD_HDR_LEN + 10)
+#define OAD_IMG_IDENTIFY_RSP_LEN    (OAD_HDR_LEN + 4)
+#define OAD_BLOCK_REQ_LEN           (OAD_HDR_LEN + 3)
+#define OAD_BLOCK_RSP_HDR_LEN       (OAD_HDR_LEN + 3)
+#define OAD_IMG_DONE_IND_LEN        (OAD_HDR_LEN + 2)
+
+/*! OAD commands, second byte of a Smsgs_cmdIds_oad message */
+typedef enum
+{
+    OadServer_cmd_imgIdentifyReq = 2,
+    OadServer_cmd_imgIdentifyRsp = 3,
+    OadServer_cmd_blockReq = 4,
+    OadServer_cmd_blockRsp = 5,
+    OadServer_cmd_imgDoneInd = 6
+} OadServer_cmds;
+
+/*! Download states */
+typedef enum
+{
+    /*! Waiting for a free session */
+    OadServer_state_waiting,
+    /*! Image Identify Request sent */
+    OadServer_state_identify,
+    /*! Blocks are being served */
+    OadServer_state_active,
+    /*! No request for OAD_SESSION_TIMEOUT_MS, resumes on the next request */
+    OadServer_state_suspended,
+    /*! Image received and verified by the device */
+    OadServer_state_done,
+    /*! Device refused or failed the image */
+    OadServer_state_failed
+} OadServer_state_t;
+
+/*! Return values of OadServer_start() */
+typedef enum
+{
+    OadServer_status_started,
+    OadServer_status_waiting,
+    OadServer_status_noImage,
+    OadServer_status_noRoom
+} OadServer_status_t;
+
+/******************************************************************************
+ Structures
+ *****************************************************************************/
+
+/*! Download progress of one device */
+typedef struct
+{
+    uint16_t shortAddr;
+    OadServer_state_t state;
+    uint8_t imgId;
+    /*! Blocks in the image */
+    uint16_t totalBlocks;
+    /*! Highest block requested so far, how far the device got */
+    uint16_t nextBlock;
+    /*! Block Responses sent, including repeated blocks */
+    uint32_t blocksSent;
+    /*! Blocks the device requested more than once */
+    uint32_t blocksRepeated;
+    /*! Times the download was resumed */
+    uint16_t resumes;
+    /*! Time spent downloading, in milliseconds */
+    uint32_t elapsedMs;
+    /*! Image bytes per second */
+    uint32_t throughput;
+} OadServer_progress_t;
+
+/*! Firmware image the server hands out */
+typedef struct
+{
+    uint8_t imgId;
+    /*! Returns the image length in bytes, 0 if there is no image */
+    uint32_t (*pfnLength)(void);
+    /*! Returns the 32 bit sum of all image bytes */
+    uint32_t (*pfnChecksum)(void);
+    /*! Reads len bytes at offset, returns the number of bytes read */
+    int32_t (*pfnRead)(uint32_t offset, uint8_t *pBuf, uint16_t len);
+    /*! Releases the image while no download is running, can be NULL */
+    void (*pfnClose)(void);
+} OadServer_image_t;
+
+/*! Callbacks of the server */
+typedef struct
+{
+    /*! Sends an OAD message to a device, returns true if sent */
+    bool (*pfnSend)(uint16_t shortAddr, bool rxOnIdle, uint16_t len,
+                    uint8_t *pData);
+    /*! Reports the progress of a download, can be NULL */
+    void (*pfnProgress)(OadServer_progress_t *pProgress);
+} OadServer_callbacks_t;
+
+/******************************************************************************
+ Function Prototypes
+ *****************************************************************************/
+
+/*!
+ * @brief       Initialize the server and drop all downloads
+ *
+ * @param       pCallbacks - server callbacks, must stay valid
+ */
+extern void OadServer_init(const OadServer_callbacks_t *pCallbacks);
+
+/*!
+ * @brief       Set the firmware image to hand out
+ *
+ * @param       pImage - image access functions, must stay valid
+ */
+extern void OadServer_setImage(const OadServer_image_t *pImage);
+
+/*!
+ * @brief       Start the download of the image to a device. The device
+ *              waits if OAD_MAX_SESSIONS downloads are running.
+ *
+ * @param       shortAddr - short address of the device
+ * @param       rxOnIdle - true if not a sleepy device
+ *
+ * @return      see OadServer_status_t
+ */
+extern OadServer_status_t OadServer_start(uint16_t shortAddr, bool rxOnIdle);
+
+/*!
+ * @brief       Process an OAD message received from a device
+ *
+ * @param       shortAddr - short address of the device
+ * @param       len - length of the message
+ * @param       pData - message, starting with Smsgs_cmdIds_oad
+ */
+extern void OadServer_processMsg(uint16_t shortAddr, uint16_t len,
+                                 uint8_t *pData);
+
+/*!
+ * @brief       Serve the pending block of a sleepy device that polled
+ *
+ * @param       shortAddr - short address of the device
+ */
+extern void OadServer_poll(uint16_t shortAddr);
+
+/*!
+ * @brief       A message to a device did not get through. A lost Image
+ *              Identify Request is repeated by the next OadServer_process()
+ *              call, a lost Block Response is requested again by the
+ *              device.
+ *
+ * @param       shortAddr - short address of the device
+ */
+extern void OadServer_txFailed(uint16_t shortAddr);
+
+/*!
+ * @brief       Serve paced blocks, suspend stale downloads and start
+ *              waiting ones
+ *
+ * @return      true while downloads are running, call again after
+ *              OAD_TICK_MS
+ */
+extern bool OadServer_process(void);
+
+/*!
+ * @brief       Get a copy of the download progress of a device. Can be
+ *              called from any task.
+ *
+ * @param       shortAddr - short address of the device
+ * @param       pProgress - copy of the progress
+ *
+ * @return      true if the device has a download
+ */
+extern bool OadServer_getProgress(uint16_t shortAddr,
+                                  OadServer_progress_t *pProgress);
+
+//*****************************************************************************
+//
+// Mark the end of the C bindings section for C++ compilers.
+//
+//*****************************************************************************
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* COLLECTOR_OADSERVER_H_ */
@@ -0,0 +1,547 @@
+/******************************************************************************
+
+ @file rampBench.c
+
+ @brief Ramp benchmark of the sensor data path
+
+ Group: WCS LPC
+ Target Device: CC13xx CC32xx
+
+ ******************************************************************************
+
+ Copyright (c) 2016-2017, Texas Instruments Incorporated
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions
+ are met:
+
+ *  Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+
+ *  Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+
+ *  Neither the name of Texas Instruments Incorporated nor the names of
+    its contributors may be used to endorse or promote products derived
+    from this software without specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+ ******************************************************************************
+ Release Name:
+ Release Date:
+ *****************************************************************************/
+
+/******************************************************************************
+ Includes
+ *****************************************************************************/
+#include <string.h>
+#include <pthread.h>
+#include <Utils/util.h>
+#include "rampBench.h"
+
+/******************************************************************************
+ Constants and definitions
+ *****************************************************************************/
+
+/* Histogram bins below this hold a single millisecond each */
+#define LINEAR_BINS     4
+
+/******************************************************************************
+ Structures
+ *****************************************************************************/
+
+/* Benchmark states */
+typedef enum
+{
+    /* Not running */
+    rampState_idle,
+    /* Frames are generated or accepted for the current step */
+    rampState_collecting,
+    /* Waiting for the last frames of the step to get through */
+    rampState_draining
+} rampState_t;
+
+/* Timing of the current step at one stage */
+typedef struct
+{
+    /* Frames of the step that reached the stage */
+    uint32_t received;
+    /* Time the last of them reached it */
+    uint32_t lastTime;
+    /* Largest latency */
+    uint32_t max;
+    /* Latency histogram, 4 bins per doubling */
+    uint32_t bins[RAMPBENCH_NUM_BINS];
+} stageTiming_t;
+
+/* Sensor sending rampdata frames */
+typedef struct
+{
+    /* true if the entry is in use */
+    bool used;
+    /* Short address of the sensor */
+    uint16_t shortAddr;
+    /* Last sequence number received */
+    uint16_t lastSeq;
+    /* Smallest reception time less send time seen, maps the sensor's
+       clock to the collector's */
+    uint32_t offset;
+} rampSender_t;
+
+/******************************************************************************
+ Local variables
+ *****************************************************************************/
+
+/* Callbacks */
+static const RampBench_callbacks_t *pRampCallbacks = NULL;
+
+/* Current state */
+static rampState_t rampState = rampState_idle;
+
+/* true if the frames are generated, false if received frames are timed */
+static bool generating = false;
+
+/* Current step, its rate and the time it started */
+static uint16_t stepNum = 0;
+static uint32_t stepRate = 0;
+static uint32_t stepStart = 0;
+
+/* Sequence number of the first frame of the step and of the next frame */
+static uint32_t firstSeq = 0;
+static uint32_t nextSeq = 0;
+
+/* Timing of the current step at each stage */
+static stageTiming_t stageTiming[RAMPBENCH_NUM_STAGES];
+
+/* Sensors timed when accepting, and the frames of the step they sent
+   that never reached the collector */
+static rampSender_t rampSenders[RAMPBENCH_MAX_SENDERS];
+static uint32_t stepMissed = 0;
+
+/* Protects the timing, stamped by the gateway and cloud service tasks */
+static pthread_mutex_t rampMutex;
+static bool rampMutexInit = false;
+
+/******************************************************************************
+ Local function prototypes
+ *****************************************************************************/
+static void startStep(uint32_t rate, uint32_t now);
+static void generateDue(uint32_t elapsed);
+static void closeStep(RampBench_report_t *pReport);
+static uint32_t percentile(stageTiming_t *pTiming, uint8_t pct);
+static uint8_t binOf(uint32_t latency);
+static uint32_t binUpper(uint8_t bin);
+static rampSender_t *findSender(uint16_t shortAddr);
+
+/******************************************************************************
+ Public Functions
+ *****************************************************************************/
+
+/*!
+ Initialize the benchmark
+
+ Public function defined in rampBench.h
+ */
+void RampBench_init(const RampBench_callbacks_t *pCallbacks)
+{
+    if(!rampMutexInit)
+    {
+        pthread_mutex_init(&rampMutex, NULL);
+        rampMutexInit = true;
+    }
+
+    pRampCallbacks = pCallbacks;
+    rampState = rampState_idle;
+    stepNum = 0;
+}
+
+/*!
+ Start the benchmark
+
+ Public function defined in rampBench.h
+ */
+void RampBench_start(bool generate)
+{
+    pthread_mutex_lock(&rampMutex);
+    generating = generate;
+    stepNum = 0;
+    memset(rampSenders, 0, sizeof(rampSenders));
+    startStep((generate == true) ? RAMPBENCH_FIRST_RATE : 0,
+              Util_getTimeMs());
+    pthread_mutex_unlock(&rampMutex);
+}
+
+/*!
+ Stop the benchmark
+
+ Public function defined in rampBench.h
+ */
+void RampBench_stop(void)
+{
+    pthread_mutex_lock(&rampMutex);
+    rampState = rampState_idle;
+    pthread_mutex_unlock(&rampMutex);
+}
+
+/*!
+ Generate the frames due and close the steps that are over
+
+ Public function defined in rampBench.h
+ */
+bool RampBench_process(void)
+{
+    uint32_t now = Util_getTimeMs();
+    uint32_t elapsed;
+
+    if(rampState == rampState_idle)
+    {
+        return false;
+    }
+
+    elapsed = now - stepStart;
+    if(rampState == rampState_collecting)
+    {
+        if(generating == true)
+        {
+            generateDue((elapsed < RAMPBENCH_STEP_TIME) ?
+                        elapsed : RAMPBENCH_STEP_TIME);
+        }
+        if(elapsed >= RAMPBENCH_STEP_TIME)
+        {
+            rampState = rampState_draining;
+        }
+    }
+
+    if((rampState == rampState_draining) &&
+       (elapsed >= (RAMPBENCH_STEP_TIME + RAMPBENCH_DRAIN_TIME)))
+    {
+        RampBench_report_t report;
+
+        pthread_mutex_lock(&rampMutex);
+        closeStep(&report);
+        if(report.done == true)
+        {
+            rampState = rampState_idle;
+        }
+        else
+        {
+            startStep((generating == true) ?
+                      (stepRate + RAMPBENCH_RATE_STEP) : 0, now);
+        }
+        pthread_mutex_unlock(&rampMutex);
+
+        if(pRampCallbacks && pRampCallbacks->pfnReport)
+        {
+            pRampCallbacks->pfnReport(&report);
+        }
+    }
+
+    return (rampState != rampState_idle);
+}
+
+/*!
+ Number a rampdata frame received from a sensor
+
+ Public function defined in rampBench.h
+ */
+bool RampBench_accept(uint16_t shortAddr, uint16_t senderSeq,
+                      uint32_t senderTime, RampBench_frame_t *pFrame)
+{
+    uint32_t now = Util_getTimeMs();
+    uint32_t delay = now - senderTime;
+    rampSender_t *pSender;
+    bool timed = false;
+
+    pthread_mutex_lock(&rampMutex);
+    /* Received frames are not mixed in with generated ones */
+    if((rampState == rampState_collecting) && (generating == false)
+       && ((pSender = findSender(shortAddr)) != NULL))
+    {
+        uint16_t gap = (uint16_t)(senderSeq - pSender->lastSeq);
+
+        if(pSender->used == false)
+        {
+            pSender->used = true;
+            pSender->shortAddr = shortAddr;
+            pSender->offset = delay;
+            timed = true;
+        }
+        else if((gap != 0) && (gap < 0x8000))
+        {
+            /* Frames skipped by the sequence were lost on the way */
+            stepMissed += gap - 1;
+            if((int32_t)(delay - pSender->offset) < 0)
+            {
+                pSender->offset = delay;
+            }
+            timed = true;
+        }
+
+        if(timed == true)
+        {
+            pSender->lastSeq = senderSeq;
+            pFrame->seqNum = nextSeq++;
+            pFrame->timestamp = senderTime + pSender->offset;
+        }
+    }
+    pthread_mutex_unlock(&rampMutex);
+
+    return timed;
+}
+
+/*!
+ Record a frame reaching a stage
+
+ Public function defined in rampBench.h
+ */
+void RampBench_stamp(RampBench_stage_t stage, RampBench_frame_t *pFrame)
+{
+    uint32_t now = Util_getTimeMs();
+
+    if(stage >= RAMPBENCH_NUM_STAGES)
+    {
+        return;
+    }
+
+    pthread_mutex_lock(&rampMutex);
+    /* Frames of earlier steps were already counted as lost */
+    if((rampState != rampState_idle) &&
+       ((pFrame->seqNum - firstSeq) < (nextSeq - firstSeq)))
+    {
+        stageTiming_t *pTiming = &stageTiming[stage];
+        uint32_t latency = now - pFrame->timestamp;
+
+        pTiming->received++;
+        pTiming->lastTime = now;
+        if(latency > pTiming->max)
+        {
+            pTiming->max = latency;
+        }
+        pTiming->bins[binOf(latency)]++;
+    }
+    pthread_mutex_unlock(&rampMutex);
+}
+
+/******************************************************************************
+ Local Functions
+ *****************************************************************************/
+
+/*!
+ * @brief       Start a step, called with the mutex held
+ *
+ * @param       rate - frames per second to generate, 0 when accepting
+ * @param       now - current time
+ */
+static void startStep(uint32_t rate, uint32_t now)
+{
+    memset(stageTiming, 0, sizeof(stageTiming));
+    stepMissed = 0;
+    firstSeq = nextSeq;
+    stepRate = rate;
+    stepStart = now;
+    stepNum++;
+    rampState = rampState_collecting;
+}
+
+/*!
+ * @brief       Generate the frames of the step due by now
+ *
+ * @param       elapsed - time since the step started
+ */
+static void generateDue(uint32_t elapsed)
+{
+    uint32_t due = (elapsed * stepRate) / 1000;
+
+    while((nextSeq - firstSeq) < due)
+    {
+        RampBench_frame_t frame;
+
+        pthread_mutex_lock(&rampMutex);
+        frame.seqNum = nextSeq++;
+        pthread_mutex_unlock(&rampMutex);
+        frame.timestamp = Util_getTimeMs();
+
+        if(pRampCallbacks && pRampCallbacks->pfnGenerate)
+        {
+            pRampCallbacks->pfnGenerate(&frame);
+        }
+    }
+}
+
+/*!
+ * @brief       Build the report of the step, called with the mutex held
+ *
+ * @param       pReport - filled in
+ */
+static void closeStep(RampBench_report_t *pReport)
+{
+    RampBench_stageStats_t *pCloud;
+    uint32_t offered = nextSeq - firstSeq + stepMissed;
+    uint8_t stage;
+
+    pReport->step = stepNum;
+    pReport->offered = offered;
+    pReport->rate = (generating == true) ? stepRate :
+                    ((offered * 1000) / RAMPBENCH_STEP_TIME);
+
+    for(stage = 0; stage < RAMPBENCH_NUM_STAGES; stage++)
+    {
+        stageTiming_t *pTiming = &stageTiming[stage];
+        RampBench_stageStats_t *pStats = &pReport->stage[stage];
+        uint32_t span = pTiming->lastTime - stepStart;
+
+        pStats->received = pTiming->received;
+        pStats->loss = 0;
+        if((offered > 0) && (pTiming->received < offered))
+        {
+            pStats->loss = (uint8_t)(((offered - pTiming->received) * 100)
+                                     / offered);
+        }
+        /* A stage that keeps up gets the last frame about a step after the
+           first one, one that falls behind spreads them over more time */
+        pStats->goodput = 0;
+        if((pTiming->received > 0) && (span > 0))
+        {
+            pStats->goodput = (pTiming->received * 1000) / span;
+        }
+        pStats->p50 = percentile(pTiming, 50);
+        pStats->p90 = percentile(pTiming, 90);
+        pStats->p99 = percentile(pTiming, 99);
+        pStats->max = pTiming->max;
+    }
+
+    pCloud = &pReport->stage[RampBench_stage_cloud];
+    pReport->saturated = (generating == true) &&
+                    ((pCloud->loss > RAMPBENCH_SATURATION_LOSS) ||
+                     ((pCloud->goodput * 100) <
+                      (stepRate * (100 - RAMPBENCH_SATURATION_LOSS))) ||
+                     (pCloud->p99 > RAMPBENCH_SATURATION_LATENCY));
+    pReport->done = (pReport->saturated == true) ||
+                    ((generating == true) && (stepRate >= RAMPBENCH_MAX_RATE));
+}
+
+/*!
+ * @brief       Latency below which a percentage of the frames of a stage
+ *              arrived, rounded up to the end of a histogram bin
+ *
+ * @param       pTiming - timing of the stage
+ * @param       pct - percentage
+ *
+ * @return      latency in milliseconds
+ */
+static uint32_t percentile(stageTiming_t *pTiming, uint8_t pct)
+{
+    uint32_t target = ((pTiming->received * pct) + 99) / 100;
+    uint32_t count = 0;
+    uint8_t bin;
+
+    if(pTiming->received == 0)
+    {
+        return 0;
+    }
+
+    for(bin = 0; bin < RAMPBENCH_NUM_BINS; bin++)
+    {
+        count += pTiming->bins[bin];
+        if(count >= target)
+        {
+            break;
+        }
+    }
+
+    if((bin == RAMPBENCH_NUM_BINS) || (binUpper(bin) > pTiming->max))
+    {
+        return pTiming->max;
+    }
+    return binUpper(bin);
+}
+
+/*!
+ * @brief       Histogram bin of a latency. Latencies under LINEAR_BINS get
+ *              a bin each, then every doubling is split in 4 bins.
+ *
+ * @param       latency - latency in milliseconds
+ *
+ * @return      bin
+ */
+static uint8_t binOf(uint32_t latency)
+{
+    uint8_t exp = 0;
+    uint32_t bin;
+
+    if(latency < LINEAR_BINS)
+    {
+        return (uint8_t)latency;
+    }
+
+    while((latency >> (exp + 1)) != 0)
+    {
+        exp++;
+    }
+    bin = ((exp - 1) * 4) + ((latency >> (exp - 2)) & 3);
+
+    return (bin < RAMPBENCH_NUM_BINS) ? (uint8_t)bin : (RAMPBENCH_NUM_BINS - 1);
+}
+
+/*!
+ * @brief       Largest latency of a histogram bin
+ *
+ * @param       bin - bin
+ *
+ * @return      latency in milliseconds
+ */
+static uint32_t binUpper(uint8_t bin)
+{
+    uint8_t exp;
+
+    if(bin < LINEAR_BINS)
+    {
+        return bin;
+    }
+
+    exp = (bin / 4) + 1;
+    return ((uint32_t)(4 + (bin & 3) + 1) << (exp - 2)) - 1;
+}
+
+/*!
+ * @brief       Find the entry of a sensor, called with the mutex held
+ *
+ * @param       shortAddr - short address of the sensor
+ *
+ * @return      entry of the sensor, a free entry if it is not known yet,
+ *              NULL if the table is full
+ */
+static rampSender_t *findSender(uint16_t shortAddr)
+{
+    rampSender_t *pFree = NULL;
+    uint8_t i;
+
+    for(i = 0; i < RAMPBENCH_MAX_SENDERS; i++)
+    {
+        if(rampSenders[i].used == false)
+        {
+            if(pFree == NULL)
+            {
+                pFree = &rampSenders[i];
+            }
+        }
+        else if(rampSenders[i].shortAddr == shortAddr)
+        {
+            return (&rampSenders[i]);
+        }
+    }
+    return (pFree);
+}
@@ -0,0 +1,263 @@
+/******************************************************************************
+
+ @file rampBench.h
+
+ @brief Ramp benchmark of the sensor data path
+
+ Group: WCS LPC
+ Target Device: CC13xx CC32xx
+
+ ******************************************************************************
+
+ Copyright (c) 2016-2017, Texas Instruments Incorporated
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions
+ are met:
+
+ *  Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+
+ *  Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+
+ *  Neither the name of Texas Instruments Incorporated nor the names of
+    its contributors may be used to endorse or promote products derived
+    from this software without specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+ ******************************************************************************
+ Release Name:
+ Release Date:
+ *****************************************************************************/
+
+#ifndef COLLECTOR_RAMPBENCH_H_
+#define COLLECTOR_RAMPBENCH_H_
+//*****************************************************************************
+//
+// If building with a C++ compiler, make all of the definitions in this header
+// have a C binding.
+//
+//*****************************************************************************
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/******************************************************************************
+ Constants and definitions
+ *****************************************************************************/
+
+/*! Rate of the first step, in frames per second */
+#define RAMPBENCH_FIRST_RATE        10
+
+/*! Rate added at each step, in frames per second */
+#define RAMPBENCH_RATE_STEP         10
+
+/*! The ramp stops after the step at this rate */
+#define RAMPBENCH_MAX_RATE          1000
+
+/*! Time frames are generated at the rate of a step, in milliseconds */
+#define RAMPBENCH_STEP_TIME         5000
+
+/*! Time left after a step for its frames to get through, in milliseconds.
+    Frames that did not reach a stage by then count as lost there. */
+#define RAMPBENCH_DRAIN_TIME        2000
+
+/*! Generation tick, in milliseconds */
+#define RAMPBENCH_TICK_MS           50
+
+/*! The path is saturated when more than this percentage of the frames of a
+    step do not reach the cloud queue, or the goodput there falls short of
+    the offered rate by more than this percentage */
+#define RAMPBENCH_SATURATION_LOSS   5
+
+/*! The path is saturated when the 99th percentile latency to the cloud queue
+    goes above this, in milliseconds */
+#define RAMPBENCH_SATURATION_LATENCY 1000
+
+/*! Latency histogram bins, 4 per doubling: up to about 16 seconds */
+#define RAMPBENCH_NUM_BINS          52
+
+/*! Number of stages timed */
+#define RAMPBENCH_NUM_STAGES        4
+
+/*! Sensors whose rampdata frames are timed at the same time */
+#ifndef RAMPBENCH_MAX_SENDERS
+#define RAMPBENCH_MAX_SENDERS       8
+#endif
+
+/*! Set to true for the cloud service to time the frames and drop them
+    instead of handing them to the cloud client. The cloud stage then times
+    the cloud service queue alone, without a broker or a cloud connection.
+    Otherwise the frames are timed once the IBM client has published them,
+    and only taken from the queue with the AWS client or while the IBM
+    client is not connected. */
+#ifndef RAMPBENCH_CLOUD_SINK
+#define RAMPBENCH_CLOUD_SINK        false
+#endif
+
+/******************************************************************************
+ Structures
+ *****************************************************************************/
+
+/*! Stages of the sensor data path a frame is timed at */
+typedef enum
+{
+    /*! Processed by the collector */
+    RampBench_stage_collector = 0,
+    /*! Received by the gateway task */
+    RampBench_stage_gateway = 1,
+    /*! Formatted as JSON */
+    RampBench_stage_json = 2,
+    /*! Taken from the cloud service queue and published, or dropped if
+        RAMPBENCH_CLOUD_SINK is set */
+    RampBench_stage_cloud = 3
+} RampBench_stage_t;
+
+/*! Benchmark frame, carried along the path with the data */
+typedef struct
+{
+    /*! Sequence number, given by the collector */
+    uint32_t seqNum;
+    /*! Time the frame was generated or sent by the sensor, in the
+        collector's milliseconds */
+    uint32_t timestamp;
+} RampBench_frame_t;
+
+/*! Results of a step at one stage */
+typedef struct
+{
+    /*! Frames of the step that reached the stage */
+    uint32_t received;
+    /*! Frames per second that reached the stage */
+    uint32_t goodput;
+    /*! Percentage of the frames of the step that did not reach the stage */
+    uint8_t loss;
+    /*! Latency percentiles since the frame was sent, in ms */
+    uint32_t p50;
+    uint32_t p90;
+    uint32_t p99;
+    uint32_t max;
+} RampBench_stageStats_t;
+
+/*! Results of one step */
+typedef struct
+{
+    /*! Step number, starting from 1 */
+    uint16_t step;
+    /*! Frames per second offered, measured when accepting received frames */
+    uint32_t rate;
+    /*! Frames generated during the step, or sent by the sensors including
+        the ones lost before reaching the collector */
+    uint32_t offered;
+    /*! true if the path saturated, the last report of a generated ramp */
+    bool saturated;
+    /*! true if this is the last report */
+    bool done;
+    RampBench_stageStats_t stage[RAMPBENCH_NUM_STAGES];
+} RampBench_report_t;
+
+/*! Generate a frame and send it down the path */
+typedef void (*RampBench_generateFp_t)(RampBench_frame_t *pFrame);
+
+/*! Results of a step */
+typedef void (*RampBench_reportFp_t)(RampBench_report_t *pReport);
+
+/*! Benchmark callbacks */
+typedef struct
+{
+    /*! Generate a frame */
+    RampBench_generateFp_t pfnGenerate;
+    /*! Report the results of a step */
+    RampBench_reportFp_t pfnReport;
+} RampBench_callbacks_t;
+
+/******************************************************************************
+ Function Prototypes
+ *****************************************************************************/
+
+/*!
+ * @brief       Initialize the benchmark, nothing runs until RampBench_start
+ *
+ * @param       pCallbacks - callbacks, must stay valid
+ */
+extern void RampBench_init(const RampBench_callbacks_t *pCallbacks);
+
+/*!
+ * @brief       Start the benchmark
+ *
+ * @param       generate - true to generate frames at increasing rates until
+ *                         the path saturates, false to time the rampdata
+ *                         frames received from sensors in steps of
+ *                         RAMPBENCH_STEP_TIME
+ */
+extern void RampBench_start(bool generate);
+
+/*!
+ * @brief       Stop the benchmark, the current step is not reported
+ */
+extern void RampBench_stop(void);
+
+/*!
+ * @brief       Generate the frames due and close the steps that are over.
+ *              Called every RAMPBENCH_TICK_MS while it returns true.
+ *
+ * @return      true while the benchmark runs
+ */
+extern bool RampBench_process(void);
+
+/*!
+ * @brief       Number a rampdata frame received from a sensor. Gaps in the
+ *              sensor's sequence numbers count as frames lost before the
+ *              collector stage. The sensor's send time is moved to the
+ *              collector's clock with the smallest reception delay seen
+ *              from that sensor, so latencies are measured from the
+ *              sensor, less the air time of its fastest frame.
+ *
+ * @param       shortAddr - short address of the sensor
+ * @param       senderSeq - sequence number given by the sensor
+ * @param       senderTime - send time, in the sensor's milliseconds
+ * @param       pFrame - filled in with the sequence number and time
+ *
+ * @return      true if the frame is timed, false if no step is collecting,
+ *              the frame is a repeat or arrived out of order, or
+ *              RAMPBENCH_MAX_SENDERS other sensors are being timed
+ */
+extern bool RampBench_accept(uint16_t shortAddr, uint16_t senderSeq,
+                             uint32_t senderTime, RampBench_frame_t *pFrame);
+
+/*!
+ * @brief       Record a frame reaching a stage. Can be called from any task.
+ *
+ * @param       stage - stage reached
+ * @param       pFrame - frame
+ */
+extern void RampBench_stamp(RampBench_stage_t stage, RampBench_frame_t *pFrame);
+
+//*****************************************************************************
+//
+// Mark the end of the C bindings section for C++ compilers.
+//
+//*****************************************************************************
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* COLLECTOR_RAMPBENCH_H_ */
@@ -0,0 +1,583 @@
+/******************************************************************************
+
+ @file reportCtrl.c
+
+ @brief Adaptive reporting and polling interval controller
+
+ Group: WCS LPC
+ Target Device: CC13xx CC32xx
+
+ ******************************************************************************
+
+ Copyright (c) 2016-2017, Texas Instruments Incorporated
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions
+ are met:
+
+ *  Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+
+ *  Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+
+ *  Neither the name of Texas Instruments Incorporated nor the names of
+    its contributors may be used to endorse or promote products derived
+    from this software without specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+ ******************************************************************************
+ Release Name:
+ Release Date:
+ *****************************************************************************/
+
+/******************************************************************************
+ Includes
+ *****************************************************************************/
+#include <string.h>
+#include <Common/commonDefs.h>
+#include <API_MAC/api_mac.h>
+#include "config.h"
+#include "LinkController/llc.h"
+#include "LinkController/cllc.h"
+#include "smsgs.h"
+#include "linkStats.h"
+#include "reportCtrl.h"
+
+/******************************************************************************
+ Constants and definitions
+ *****************************************************************************/
+
+/* Sensor data fields of each sensor type */
+#define REPORT_CTRL_ACTUATOR_FIELDS (Smsgs_dataFields_fanSensor | \
+                                     Smsgs_dataFields_doorLockSensor)
+#define REPORT_CTRL_EVENT_FIELDS    (Smsgs_dataFields_motionSensor | \
+                                     Smsgs_dataFields_hallEffectSensor | \
+                                     Smsgs_dataFields_waterleakSensor)
+#define REPORT_CTRL_ENV_FIELDS      (Smsgs_dataFields_tempSensor | \
+                                     Smsgs_dataFields_lightSensor | \
+                                     Smsgs_dataFields_humiditySensor | \
+                                     Smsgs_dataFields_pressureSensor | \
+                                     Smsgs_dataFields_batterySensor)
+
+/* Delivery ratio to a device below which its own intervals stop growing */
+#define REPORT_CTRL_MIN_LINK_RATIO  50
+
+/******************************************************************************
+ Structures
+ *****************************************************************************/
+
+/* Interval state of one device */
+typedef struct
+{
+    /* Short address the entry belongs to, detects a reused table slot */
+    uint16_t shortAddr;
+    /* ReportCtrl_sensorType_t */
+    uint8_t type;
+    /* Intervals reported by the device, 0 if not known */
+    uint32_t reporting;
+    uint32_t polling;
+    /* Intervals last sent to the device, 0 if none */
+    uint32_t reqReporting;
+    uint32_t reqPolling;
+} devIntervals_t;
+
+/******************************************************************************
+ Local variables
+ *****************************************************************************/
+
+/* Default bounds, the network wide intervals are the starting point */
+static const ReportCtrl_bounds_t defaultBounds[ReportCtrl_type_num] =
+{
+    /* generic: never faster than the configured intervals */
+    {
+        CONFIG_REPORTING_INTERVAL, 4 * CONFIG_REPORTING_INTERVAL,
+        CONFIG_POLLING_INTERVAL, 4 * CONFIG_POLLING_INTERVAL
+    },
+    /* environment: readings change slowly, can be stretched the most */
+    {
+        CONFIG_REPORTING_INTERVAL / 3, 8 * CONFIG_REPORTING_INTERVAL,
+        CONFIG_POLLING_INTERVAL, 4 * CONFIG_POLLING_INTERVAL
+    },
+    /* event: a late report is a late alarm */
+    {
+        CONFIG_REPORTING_INTERVAL / 3, 2 * CONFIG_REPORTING_INTERVAL,
+        CONFIG_POLLING_INTERVAL, 2 * CONFIG_POLLING_INTERVAL
+    },
+    /* actuator: the polling interval is the command latency */
+    {
+        CONFIG_REPORTING_INTERVAL / 3, 4 * CONFIG_REPORTING_INTERVAL,
+        CONFIG_POLLING_INTERVAL, CONFIG_POLLING_INTERVAL
+    }
+};
+
+static ReportCtrl_bounds_t typeBounds[ReportCtrl_type_num];
+
+static devIntervals_t devIntervals[CONFIG_MAX_DEVICES];
+
+/* Interval scale and its limits, beyond them no bound can be reached */
+static uint32_t intervalScale = REPORT_CTRL_SCALE_ONE;
+static uint32_t minScale = REPORT_CTRL_SCALE_ONE;
+static uint32_t maxScale = REPORT_CTRL_SCALE_ONE;
+
+/* Channel monitor window at the end of the last period */
+static Cllc_txWindow_t lastWindow;
+
+static ReportCtrl_stats_t ctrlStats;
+
+/******************************************************************************
+ Local function prototypes
+ *****************************************************************************/
+static devIntervals_t *getEntry(uint8_t devIdx);
+static void updateScaleLimits(void);
+static uint32_t scaleInterval(uint32_t base, uint32_t scale, uint32_t min,
+                              uint32_t max);
+static bool changed(uint32_t current, uint32_t target);
+
+/******************************************************************************
+ Public Functions
+ *****************************************************************************/
+
+/*!
+ Reset the controller
+
+ Public function defined in reportCtrl.h
+ */
+void ReportCtrl_init(void)
+{
+    uint8_t i;
+
+    memcpy(typeBounds, defaultBounds, sizeof(typeBounds));
+    memset(devIntervals, 0, sizeof(devIntervals));
+    for(i = 0; i < CONFIG_MAX_DEVICES; i++)
+    {
+        devIntervals[i].shortAddr = INVALID_SHORT_ADDR;
+    }
+    memset(&lastWindow, 0, sizeof(lastWindow));
+    memset(&ctrlStats, 0, sizeof(ctrlStats));
+
+    intervalScale = REPORT_CTRL_SCALE_ONE;
+    updateScaleLimits();
+    ctrlStats.scale = (uint16_t)intervalScale;
+}
+
+/*!
+ Set the interval bounds of a sensor type
+
+ Public function defined in reportCtrl.h
+ */
+bool ReportCtrl_setBounds(ReportCtrl_sensorType_t type,
+                          ReportCtrl_bounds_t *pBounds)
+{
+    if((type >= ReportCtrl_type_num) || (pBounds->minReporting == 0)
+       || (pBounds->minPolling == 0)
+       || (pBounds->minReporting > pBounds->maxReporting)
+       || (pBounds->minPolling > pBounds->maxPolling))
+    {
+        return (false);
+    }
+
+    memcpy(&typeBounds[type], pBounds, sizeof(ReportCtrl_bounds_t));
+    updateScaleLimits();
+    return (true);
+}
+
+/*!
+ Measure the last period and adjust the interval scale
+
+ Public function defined in reportCtrl.h
+ */
+void ReportCtrl_process(void)
+{
+    Cllc_chanMonStats_t chanStats;
+    Cllc_txWindow_t *pWindow = &chanStats.current;
+    Cllc_txWindow_t period;
+    uint32_t airTime;
+    uint32_t onAir;
+    bool congested;
+    bool spare;
+
+    Cllc_getChanMonStats(&chanStats);
+
+    if((pWindow->duration < lastWindow.duration)
+       || (pWindow->txFrames < lastWindow.txFrames))
+    {
+        /* The channel moved, the window started again */
+        memset(&lastWindow, 0, sizeof(lastWindow));
+    }
+
+    period.duration = pWindow->duration - lastWindow.duration;
+    period.txFrames = pWindow->txFrames - lastWindow.txFrames;
+    period.txSuccess = pWindow->txSuccess - lastWindow.txSuccess;
+    period.retries = pWindow->retries - lastWindow.retries;
+    period.channelAccessFailures = pWindow->channelAccessFailures
+                    - lastWindow.channelAccessFailures;
+    period.ackFailures = pWindow->ackFailures - lastWindow.ackFailures;
+    period.rxFrames = pWindow->rxFrames - lastWindow.rxFrames;
+    memcpy(&lastWindow, pWindow, sizeof(lastWindow));
+
+    if(period.duration == 0)
+    {
+        return;
+    }
+
+    /* Every transmission, retry and reception occupies the channel */
+    airTime = (period.txFrames + period.retries + period.rxFrames)
+                    * REPORT_CTRL_FRAME_AIRTIME;
+    ctrlStats.load = (uint8_t)(((uint64_t)airTime * 100) / period.duration);
+    if(airTime > period.duration)
+    {
+        ctrlStats.load = 100;
+    }
+
+    /*
+     Only the radio outcomes count for the delivery ratio, an indirect frame
+     that expired waiting for a poll says nothing about the channel.
+     */
+    onAir = period.txSuccess + period.ackFailures
+            + period.channelAccessFailures;
+    if(onAir >= REPORT_CTRL_MIN_FRAMES)
+    {
+        ctrlStats.ccaFailures = (uint8_t)((period.channelAccessFailures * 100)
+                                          / onAir);
+        ctrlStats.delivery = (uint8_t)((period.txSuccess * 100) / onAir);
+    }
+    else
+    {
+        /* Too few frames to tell, the channel is quiet */
+        ctrlStats.ccaFailures = 0;
+        ctrlStats.delivery = 100;
+    }
+
+    congested = (ctrlStats.load > REPORT_CTRL_TARGET_LOAD)
+                || (ctrlStats.ccaFailures > REPORT_CTRL_CCA_FAIL_PCT)
+                || (ctrlStats.delivery < REPORT_CTRL_MIN_DELIVERY);
+    spare = (ctrlStats.load < (REPORT_CTRL_TARGET_LOAD / 2))
+            && (congested == false);
+
+    if(congested == true)
+    {
+        /* Back off quickly */
+        intervalScale += intervalScale / 2;
+        ctrlStats.numBackoffs++;
+    }
+    else if(spare == true)
+    {
+        /* Tighten slowly, a step back costs less than a congested channel */
+        intervalScale -= (intervalScale >> 3) + 1;
+        ctrlStats.numTightens++;
+    }
+
+    if(intervalScale > maxScale)
+    {
+        intervalScale = maxScale;
+    }
+    else if(intervalScale < minScale)
+    {
+        intervalScale = minScale;
+    }
+    ctrlStats.scale = (uint16_t)intervalScale;
+}
+
+/*!
+ Get the intervals a device should use now
+
+ Public function defined in reportCtrl.h
+ */
+void ReportCtrl_getIntervals(uint8_t devIdx, uint32_t *pReporting,
+                             uint32_t *pPolling)
+{
+    ReportCtrl_bounds_t *pBounds = &typeBounds[ReportCtrl_type_generic];
+    uint32_t scale = intervalScale;
+    devIntervals_t *pEntry = getEntry(devIdx);
+
+    if(pEntry != NULL)
+    {
+        LinkStats_entry_t link;
+
+        pBounds = &typeBounds[pEntry->type];
+
+        /*
+         A device that needs retries uses more air time per message, it
+         backs off further than the rest of the network.
+         */
+        if(LinkStats_get(pEntry->shortAddr, &link) == true)
+        {
+            uint32_t onAir = link.txSuccess + link.txAckFailures
+                            + link.txChannelAccessFailures;
+            uint32_t ratio = 100;
+
+            if(onAir >= REPORT_CTRL_MIN_FRAMES)
+            {
+                ratio = (link.txSuccess * 100) / onAir;
+            }
+            if(ratio < REPORT_CTRL_MIN_LINK_RATIO)
+            {
+                ratio = REPORT_CTRL_MIN_LINK_RATIO;
+            }
+            scale = (scale * 100) / ratio;
+        }
+    }
+
+    *pReporting = scaleInterval(CONFIG_REPORTING_INTERVAL, scale,
+                                pBounds->minReporting, pBounds->maxReporting);
+    *pPolling = scaleInterval(CONFIG_POLLING_INTERVAL, scale,
+                              pBounds->minPolling, pBounds->maxPolling);
+}
+
+/*!
+ Check if a device must be sent new intervals
+
+ Public function defined in reportCtrl.h
+ */
+bool ReportCtrl_needsUpdate(uint8_t devIdx)
+{
+    devIntervals_t *pEntry = getEntry(devIdx);
+    uint32_t reporting;
+    uint32_t polling;
+
+    if((pEntry == NULL) || (pEntry->reporting == 0))
+    {
+        /* The device has not answered its first config request yet */
+        return (false);
+    }
+
+    ReportCtrl_getIntervals(devIdx, &reporting, &polling);
+
+    if((reporting == pEntry->reqReporting) && (polling == pEntry->reqPolling))
+    {
+        /* Already asked, the device chose its own values */
+        return (false);
+    }
+
+    return (changed(pEntry->reporting, reporting)
+            || changed(pEntry->polling, polling));
+}
+
+/*!
+ Record the intervals sent to a device
+
+ Public function defined in reportCtrl.h
+ */
+void ReportCtrl_requested(uint8_t devIdx, uint32_t reporting, uint32_t polling)
+{
+    devIntervals_t *pEntry = getEntry(devIdx);
+
+    if(pEntry != NULL)
+    {
+        if(pEntry->reqReporting != 0)
+        {
+            ctrlStats.numUpdates++;
+        }
+        pEntry->reqReporting = reporting;
+        pEntry->reqPolling = polling;
+    }
+}
+
+/*!
+ Record the intervals a device reported
+
+ Public function defined in reportCtrl.h
+ */
+void ReportCtrl_configured(uint8_t devIdx, uint32_t reporting,
+                           uint32_t polling)
+{
+    devIntervals_t *pEntry = getEntry(devIdx);
+
+    if(pEntry != NULL)
+    {
+        pEntry->reporting = reporting;
+        pEntry->polling = polling;
+    }
+}
+
+/*!
+ Learn the sensor type of a device
+
+ Public function defined in reportCtrl.h
+ */
+void ReportCtrl_sensorData(uint8_t devIdx, uint16_t frameControl)
+{
+    devIntervals_t *pEntry = getEntry(devIdx);
+
+    if(pEntry != NULL)
+    {
+        if(frameControl & REPORT_CTRL_ACTUATOR_FIELDS)
+        {
+            pEntry->type = ReportCtrl_type_actuator;
+        }
+        else if(frameControl & REPORT_CTRL_EVENT_FIELDS)
+        {
+            pEntry->type = ReportCtrl_type_event;
+        }
+        else if(frameControl & REPORT_CTRL_ENV_FIELDS)
+        {
+            pEntry->type = ReportCtrl_type_environment;
+        }
+    }
+}
+
+/*!
+ Get the controller statistics
+
+ Public function defined in reportCtrl.h
+ */
+void ReportCtrl_getStats(ReportCtrl_stats_t *pStats)
+{
+    memcpy(pStats, &ctrlStats, sizeof(ReportCtrl_stats_t));
+}
+
+/******************************************************************************
+ Local Functions
+ *****************************************************************************/
+
+/*!
+ * @brief       Get the interval state of a device, a reused association
+ *              table slot starts again from the defaults
+ *
+ * @param       devIdx - index in the association table
+ *
+ * @return      pointer to the entry, NULL if the index is not valid
+ */
+static devIntervals_t *getEntry(uint8_t devIdx)
+{
+    devIntervals_t *pEntry;
+    uint16_t shortAddr;
+
+    if(devIdx >= CONFIG_MAX_DEVICES)
+    {
+        return (NULL);
+    }
+
+    shortAddr = Cllc_associatedDevList[devIdx].shortAddr;
+    if(shortAddr == INVALID_SHORT_ADDR)
+    {
+        return (NULL);
+    }
+
+    pEntry = &devIntervals[devIdx];
+    if(pEntry->shortAddr != shortAddr)
+    {
+        memset(pEntry, 0, sizeof(devIntervals_t));
+        pEntry->shortAddr = shortAddr;
+        pEntry->type = ReportCtrl_type_generic;
+    }
+    return (pEntry);
+}
+
+/*!
+ * @brief       Limit the interval scale to the range where it still changes
+ *              the interval of at least one sensor type
+ */
+static void updateScaleLimits(void)
+{
+    uint8_t type;
+
+    minScale = REPORT_CTRL_SCALE_ONE;
+    maxScale = REPORT_CTRL_SCALE_ONE;
+
+    for(type = 0; type < ReportCtrl_type_num; type++)
+    {
+        ReportCtrl_bounds_t *pBounds = &typeBounds[type];
+        uint32_t scale;
+
+        scale = (uint32_t)(((uint64_t)pBounds->minReporting
+                    << REPORT_CTRL_SCALE_SHIFT) / CONFIG_REPORTING_INTERVAL);
+        if(scale < minScale)
+        {
+            minScale = scale;
+        }
+        scale = (uint32_t)(((uint64_t)pBounds->minPolling
+                    << REPORT_CTRL_SCALE_SHIFT) / CONFIG_POLLING_INTERVAL);
+        if(scale < minScale)
+        {
+            minScale = scale;
+        }
+
+        scale = (uint32_t)(((uint64_t)pBounds->maxReporting
+                    << REPORT_CTRL_SCALE_SHIFT) / CONFIG_REPORTING_INTERVAL);
+        if(scale > maxScale)
+        {
+            maxScale = scale;
+        }
+        scale = (uint32_t)(((uint64_t)pBounds->maxPolling
+                    << REPORT_CTRL_SCALE_SHIFT) / CONFIG_POLLING_INTERVAL);
+        if(scale > maxScale)
+        {
+            maxScale = scale;
+        }
+    }
+
+    if(minScale == 0)
+    {
+        minScale = 1;
+    }
+    if(maxScale > UINT16_MAX)
+    {
+        maxScale = UINT16_MAX;
+    }
+
+    if(intervalScale > maxScale)
+    {
+        intervalScale = maxScale;
+    }
+    else if(intervalScale < minScale)
+    {
+        intervalScale = minScale;
+    }
+}
+
+/*!
+ * @brief       Scale an interval and keep it within its bounds
+ *
+ * @param       base - default interval
+ * @param       scale - interval scale
+ * @param       min - shortest interval
+ * @param       max - longest interval
+ *
+ * @return      interval in milliseconds
+ */
+static uint32_t scaleInterval(uint32_t base, uint32_t scale, uint32_t min,
+                              uint32_t max)
+{
+    uint64_t interval = ((uint64_t)base * scale) >> REPORT_CTRL_SCALE_SHIFT;
+
+    if(interval < min)
+    {
+        interval = min;
+    }
+    else if(interval > max)
+    {
+        interval = max;
+    }
+    return ((uint32_t)interval);
+}
+
+/*!
+ * @brief       Check if an interval moved far enough to be sent again
+ *
+ * @param       current - interval the device uses
+ * @param       target - interval it should use
+ *
+ * @return      true if the difference is larger than the hysteresis
+ */
+static bool changed(uint32_t current, uint32_t target)
+{
+    uint32_t diff = (current > target) ? (current - target) :
+                    (target - current);
+
+    return (diff > (current >> REPORT_CTRL_HYSTERESIS_SHIFT));
+}
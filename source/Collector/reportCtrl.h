@@ -0,0 +1,250 @@
+/******************************************************************************
+
+ @file reportCtrl.h
+
+ @brief Adaptive reporting and polling interval controller
+
+ Group: WCS LPC
+ Target Device: CC13xx CC32xx
+
+ ******************************************************************************
+
+ Copyright (c) 2016-2017, Texas Instruments Incorporated
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions
+ are met:
+
+ *  Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+
+ *  Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+
+ *  Neither the name of Texas Instruments Incorporated nor the names of
+    its contributors may be used to endorse or promote products derived
+    from this software without specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+ ******************************************************************************
+ Release Name:
+ Release Date:
+ *****************************************************************************/
+
+#ifndef COLLECTOR_REPORTCTRL_H_
+#define COLLECTOR_REPORTCTRL_H_
+//*****************************************************************************
+//
+// If building with a C++ compiler, make all of the definitions in this header
+// have a C binding.
+//
+//*****************************************************************************
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "smsgs.h"
+
+/******************************************************************************
+ Constants and definitions
+ *****************************************************************************/
+
+/*! Control period, in milliseconds */
+#define REPORT_CTRL_PERIOD          60000
+
+/*! Channel load the controller keeps the network under, in percent */
+#define REPORT_CTRL_TARGET_LOAD     10
+
+/*!
+ Air time of one frame exchange (frame, ACK and backoff) in milliseconds,
+ used to turn the frame counts into a channel load. About 10 ms for a
+ sensor report at 50 kbps.
+ */
+#if !defined(REPORT_CTRL_FRAME_AIRTIME)
+#define REPORT_CTRL_FRAME_AIRTIME   10
+#endif
+
+/*! Channel access failures, in percent of the frames sent, for congestion */
+#define REPORT_CTRL_CCA_FAIL_PCT    10
+
+/*! Delivery ratio in percent below which the channel is congested */
+#define REPORT_CTRL_MIN_DELIVERY    90
+
+/*! Frames needed in a period before the ratios are used */
+#define REPORT_CTRL_MIN_FRAMES      20
+
+/*! Config requests started in one control period at most */
+#define REPORT_CTRL_MAX_UPDATES     8
+
+/*! Intervals are pushed when they change by more than 1/8 */
+#define REPORT_CTRL_HYSTERESIS_SHIFT    3
+
+/*! Scale of the intervals, fixed point with 8 fractional bits */
+#define REPORT_CTRL_SCALE_SHIFT     8
+#define REPORT_CTRL_SCALE_ONE       (1 << REPORT_CTRL_SCALE_SHIFT)
+
+/*! Device index used before a device is in the association table */
+#define REPORT_CTRL_NO_DEVICE       0xFF
+
+/******************************************************************************
+ Typedefs
+ *****************************************************************************/
+
+/*! Sensor types, each one has its own interval bounds */
+typedef enum
+{
+    /*! Not known yet, no sensor data was received */
+    ReportCtrl_type_generic = 0,
+    /*! Slow changing readings: temperature, light, humidity, ... */
+    ReportCtrl_type_environment = 1,
+    /*! Event sensors: motion, hall effect, water leak */
+    ReportCtrl_type_event = 2,
+    /*! Devices that are controlled from the cloud: fan, door lock */
+    ReportCtrl_type_actuator = 3,
+    ReportCtrl_type_num
+} ReportCtrl_sensorType_t;
+
+/******************************************************************************
+ Structures
+ *****************************************************************************/
+
+/*! Interval bounds of a sensor type, in milliseconds */
+typedef struct
+{
+    /*! Shortest reporting interval */
+    uint32_t minReporting;
+    /*! Longest reporting interval */
+    uint32_t maxReporting;
+    /*! Shortest polling interval */
+    uint32_t minPolling;
+    /*! Longest polling interval */
+    uint32_t maxPolling;
+} ReportCtrl_bounds_t;
+
+/*! Controller statistics */
+typedef struct
+{
+    /*! Current interval scale, REPORT_CTRL_SCALE_ONE is the default */
+    uint16_t scale;
+    /*! Channel load of the last period, in percent */
+    uint8_t load;
+    /*! Channel access failures of the last period, in percent */
+    uint8_t ccaFailures;
+    /*! Delivery ratio of the last period, in percent */
+    uint8_t delivery;
+    /*! Periods that made the intervals longer */
+    uint32_t numBackoffs;
+    /*! Periods that made the intervals shorter */
+    uint32_t numTightens;
+    /*! Devices given new intervals */
+    uint32_t numUpdates;
+} ReportCtrl_stats_t;
+
+/******************************************************************************
+ Function Prototypes
+ *****************************************************************************/
+
+/*!
+ * @brief       Reset the controller to the default intervals and bounds
+ */
+extern void ReportCtrl_init(void);
+
+/*!
+ * @brief       Set the interval bounds of a sensor type
+ *
+ * @param       type - sensor type
+ * @param       pBounds - new bounds
+ *
+ * @return      true if set, false if the type or the bounds are invalid
+ */
+extern bool ReportCtrl_setBounds(ReportCtrl_sensorType_t type,
+                                 ReportCtrl_bounds_t *pBounds);
+
+/*!
+ * @brief       Measure the channel over the last period and adjust the
+ *              interval scale. Called every REPORT_CTRL_PERIOD.
+ */
+extern void ReportCtrl_process(void);
+
+/*!
+ * @brief       Get the intervals a device should use now
+ *
+ * @param       devIdx - index in the association table,
+ *                       REPORT_CTRL_NO_DEVICE for a joining device
+ * @param       pReporting - reporting interval in milliseconds
+ * @param       pPolling - polling interval in milliseconds
+ */
+extern void ReportCtrl_getIntervals(uint8_t devIdx, uint32_t *pReporting,
+                                    uint32_t *pPolling);
+
+/*!
+ * @brief       Check if a device must be sent new intervals
+ *
+ * @param       devIdx - index in the association table
+ *
+ * @return      true if the intervals changed enough to send a config request
+ */
+extern bool ReportCtrl_needsUpdate(uint8_t devIdx);
+
+/*!
+ * @brief       Record the intervals sent to a device in a config request
+ *
+ * @param       devIdx - index in the association table
+ * @param       reporting - reporting interval in milliseconds
+ * @param       polling - polling interval in milliseconds
+ */
+extern void ReportCtrl_requested(uint8_t devIdx, uint32_t reporting,
+                                 uint32_t polling);
+
+/*!
+ * @brief       Record the intervals a device reported in a config response
+ *
+ * @param       devIdx - index in the association table
+ * @param       reporting - reporting interval in milliseconds
+ * @param       polling - polling interval in milliseconds
+ */
+extern void ReportCtrl_configured(uint8_t devIdx, uint32_t reporting,
+                                  uint32_t polling);
+
+/*!
+ * @brief       Learn the sensor type of a device from its sensor data
+ *
+ * @param       devIdx - index in the association table
+ * @param       frameControl - frame control of the sensor data,
+ *                             Smsgs_dataFields_t bits
+ */
+extern void ReportCtrl_sensorData(uint8_t devIdx, uint16_t frameControl);
+
+/*!
+ * @brief       Get the controller statistics
+ *
+ * @param       pStats - copy of the statistics
+ */
+extern void ReportCtrl_getStats(ReportCtrl_stats_t *pStats);
+
+//*****************************************************************************
+//
+// Mark the end of the C bindings section for C++ compilers.
+//
+//*****************************************************************************
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* COLLECTOR_REPORTCTRL_H_ */
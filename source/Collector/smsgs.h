@@ -159,6 +159,29 @@ extern "C"
      - Polling Interval - in millseconds (32 bits) - If the sensor device is
      a sleep device, this states how often the device polls its parent for
      data. This field is 0 if the device doesn't sleep.
+ <BR>
+ The <b>Group Configuration Request Message</b> is sent to each member of a
+ device group (unicast) whenever its membership changes:
+     - Command ID - [Smsgs_cmdIds_groupCfgReq](@ref Smsgs_cmdIds) (1 byte)
+     - Group Mask - (32 bits) - bit n set if the device belongs to group n.
+     Bit 0 (@ref SMSGS_GROUP_ALL) is always set.
+ <BR>
+ The <b>Group Command Message</b> is sent once to the broadcast address and
+ carries a command for all members of a group:
+     - Command ID - [Smsgs_cmdIds_groupCmd](@ref Smsgs_cmdIds) (1 byte)
+     - Group ID - (1 byte) - the device only processes the embedded command
+     if bit Group ID is set in its Group Mask, and drops the frame otherwise.
+     - Embedded Command - the complete unicast command message (starting with
+     its own Command ID), for example a Fan Speed Change message.
+ <BR>
+ The <b>Ramp Data Message</b> is sent by a sensor (or an emulated
+ coprocessor) to load the data path for the ramp benchmark:
+     - Command ID - [Smsgs_cmdIds_rampdata](@ref Smsgs_cmdIds) (1 byte)
+     - Sequence Number - (16 bits) - incremented for each frame sent
+     - Timestamp - (32 bits) - time the frame was sent, in the sender's
+     milliseconds. The collector counts gaps in the sequence as frames lost
+     and times the frame from this time, moved to its own clock with the
+     smallest delay seen from the sender.
  */
 
 /******************************************************************************
@@ -210,6 +233,17 @@ extern "C"
 #define SMSGS_BUZZER_CTRL_REQUEST_MSG_LEN 1
 /*! Control Buzzer Response message length (over-the-air length) */
 #define SMSGS_BUZZER_CTRL_RESPONSE_MSG_LEN 1
+/*! Group Configuration Request message length (over-the-air length) */
+#define SMSGS_GROUP_CONFIG_REQUEST_MSG_LEN 5
+/*! Length of the Group Command header preceding the embedded command */
+#define SMSGS_GROUP_CMD_HDR_LEN 2
+/*! Ramp Data message length (over-the-air length) */
+#define SMSGS_RAMP_DATA_MSG_LEN 7
+
+/*! Group ID every device is a member of */
+#define SMSGS_GROUP_ALL 0
+/*! Highest group ID that fits the Group Mask */
+#define SMSGS_GROUP_MAX_ID 31
 
 /*!
  Message IDs for Sensor data messages.  When sent over-the-air in a message,
@@ -242,7 +276,11 @@ extern "C"
     /* Control the Buzzer, sent from the collector to the sensor */
     Smsgs_cmdIds_buzzerCtrlReq = 12,
     /* Control the Buzzer response msg, sent from the sensor to the collector */
-    Smsgs_cmdIds_buzzerCtrlRsp = 13
+    Smsgs_cmdIds_buzzerCtrlRsp = 13,
+    /*! Group membership, sent from the collector to the sensor */
+    Smsgs_cmdIds_groupCfgReq = 14,
+    /*! Group command, broadcast from the collector to the sensors */
+    Smsgs_cmdIds_groupCmd = 15
  } Smsgs_cmdIds_t;
 
 /*!
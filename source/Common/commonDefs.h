@@ -66,8 +66,11 @@ extern "C"
 
 
 //USER DEFS
+#ifndef MAX_NUM_OF_DEVICES
 #define MAX_NUM_OF_DEVICES      25
+#endif
 #define MAX_NUM_OF_OBJECTS      15
+#define MAX_GROUP_NAME_LEN      16
 
 #define SL_TASK_PRI             6
 #define GTWAY_TASK_PRI          5
@@ -75,6 +78,22 @@ extern "C"
 #define COLLECTOR_TASK_PRI      3
 #define CLOUDSRV_TASK_PRI       3
 #define CLOUDRX_TASK_PRI        6
+#define NTP_TASK_PRI            2
+#define LOG_TASK_PRI            1
+
+/* Encodings of device and network updates. IBM takes either, AWS shadows
+ * and the local web server take JSON only.                                  */
+#define PAYLOAD_FORMAT_JSON     0
+#define PAYLOAD_FORMAT_CBOR     1
+#ifndef IBM_PAYLOAD_FORMAT
+#define IBM_PAYLOAD_FORMAT      PAYLOAD_FORMAT_JSON
+#endif
+/* The gateway formats CBOR updates as well when a sink takes them */
+#if defined(USE_IBM_CLOUD) && (IBM_PAYLOAD_FORMAT == PAYLOAD_FORMAT_CBOR)
+#define CBOR_UPDATES            true
+#else
+#define CBOR_UPDATES            false
+#endif
 #define HIGHEST_PRI             6
 
 //IPSO DEFS
@@ -175,9 +194,17 @@ typedef enum
     GatewayEvent_DEV_NOT_ACTIVE,
     GatewayEvent_SENSOR_DATA_UPDATE,
     GatewayEvent_NWK_STATE_CHANGE,
+    GatewayEvent_OAD_UPDATE,
+    GatewayEvent_DELIVERY_UPDATE,
+    GatewayEvent_RAMP_DATA,
+    GatewayEvent_RAMP_REPORT,
+    GatewayEvent_DEV_REMOVED,
+    // Time service to Gateway event
+    GatewayEvent_TIME_UPDATE,
     // Cloud Service to Gateway Event
     GatewayEvent_PERMIT_JOIN,
     GatewayEvent_DEVICE_CMD,
+    GatewayEvent_NWK_SNAPSHOT,
 
 }GatewayEvent;
 
@@ -191,7 +218,17 @@ typedef enum
     CloudServiceEvt_DEV_UPDATE,
     CloudServiceEvt_STATE_CNF_EVT,
     CloudServiceEvt_CLOUD_IN_MQTT,
-    CloudServiceEvt_LOCAL_SERVR_HTTP
+    CloudServiceEvt_LOCAL_SERVR_HTTP,
+    CloudServiceEvt_CMD_DELIVERY,
+    CloudServiceEvt_RAMP_DATA,
+    CloudServiceEvt_NWK_DELTA,
+    //CBOR encodings of the updates above, sent along with them when
+    //CBOR_UPDATES is set
+    CloudServiceEvt_NWK_UPDATE_CBOR,
+    CloudServiceEvt_DEV_UPDATE_CBOR,
+    CloudServiceEvt_NWK_DELTA_CBOR,
+    //Cloud command in CBOR
+    CloudServiceEvt_CLOUD_IN_CBOR
 
 }CloudServiceEvt;
 
@@ -201,6 +238,8 @@ typedef struct
     uint8_t     event;
     void        *msgPtr;
     int32_t     msgPtrLen;
+    /* Time the message was queued in milliseconds, set by MqStats */
+    uint32_t    enqueueTime;
 }msgQueue_t;
 
 typedef struct nwk_t
@@ -234,6 +273,7 @@ typedef struct dev_t
     bool active;
     smartObject_t object[MAX_NUM_OF_OBJECTS];
     uint8_t objectCount;
+    uint32_t rxTime; //Util_getTimeMs() when the update was received
 }dev_t;
 
 typedef struct
@@ -249,7 +289,10 @@ typedef enum
     CmdType_FAN_DATA,
     CmdType_DOORLOCK_DATA,
     CmdType_LED_DATA,
-    CmdType_LEAK_DATA
+    CmdType_LEAK_DATA,
+    CmdType_GROUP_CFG,
+    CmdType_OAD_START,
+    CmdType_FILTER_CFG
 }CmdTypes;
 
 typedef struct
@@ -258,6 +301,7 @@ typedef struct
     uint16_t shortAddr;
     uint8_t  extAddr[8];
     uint32_t data;
+    char     groupName[MAX_GROUP_NAME_LEN]; //empty for a single device
 }deviceCmd_t;
 
 
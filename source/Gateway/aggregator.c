@@ -0,0 +1,412 @@
+/******************************************************************************
+
+ @file aggregator.c
+
+ @brief Windowed aggregation of sensor values before they are published
+
+ Group: WCS LPC
+ Target Device: CC13xx CC32xx
+
+ ******************************************************************************
+
+ Copyright (c) 2016-2017, Texas Instruments Incorporated
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions
+ are met:
+
+ *  Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+
+ *  Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+
+ *  Neither the name of Texas Instruments Incorporated nor the names of
+    its contributors may be used to endorse or promote products derived
+    from this software without specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+ ******************************************************************************
+ Release Name:
+ Release Date:
+ *****************************************************************************/
+
+/******************************************************************************
+ Includes
+ *****************************************************************************/
+#include <string.h>
+#include <pthread.h>
+#include <Common/commonDefs.h>
+#include <Utils/util.h>
+#include "devRegistry.h"
+#include "aggregator.h"
+
+/******************************************************************************
+ Constants and definitions
+ *****************************************************************************/
+
+/*! Per device accumulators of the current window */
+typedef struct
+{
+    /*! Start of the window in ms, only valid if count is non zero */
+    uint32_t windowStart;
+    /*! Number of updates folded into the window */
+    uint16_t count;
+    /*! Number of objects the accumulators were set up for */
+    uint8_t objectCount;
+    aggrStats_t stats[MAX_NUM_OF_OBJECTS];
+} aggrDev_t;
+
+/******************************************************************************
+ Local variables
+ *****************************************************************************/
+static aggrDev_t aggrDevs[MAX_NUM_OF_DEVICES];
+static uint32_t aggrWindowMs = AGGR_WINDOW_MS;
+
+/*! Object types that are aggregated, see AGGR_TYPES */
+static char aggrTypes[AGGR_MAX_TYPES][MAX_TYPE_CHAR_LEN];
+static uint8_t aggrNumTypes = 0;
+
+/*! Replaced updates not yet folded into the window of their device */
+static aggrDev_t aggrSuperseded[MAX_NUM_OF_DEVICES];
+
+/*! Protects aggrSuperseded, written by the senders of the gateway lane */
+static pthread_mutex_t supersededMutex;
+static bool supersededMutexInit = false;
+
+/******************************************************************************
+ Local function prototypes
+ *****************************************************************************/
+static void foldValue(aggrStats_t *pStats, int32_t val);
+static void foldStats(aggrStats_t *pStats, const aggrStats_t *pOther);
+
+/******************************************************************************
+ Public Functions
+ *****************************************************************************/
+
+/*!
+ Reset all accumulators and set the aggregation window
+
+ Public function defined in aggregator.h
+ */
+void Aggr_init(uint32_t windowMs)
+{
+    if(!supersededMutexInit)
+    {
+        pthread_mutex_init(&supersededMutex, NULL);
+        supersededMutexInit = true;
+    }
+
+    aggrWindowMs = windowMs;
+    Aggr_setTypes(AGGR_TYPES);
+
+    pthread_mutex_lock(&supersededMutex);
+    memset(aggrSuperseded, 0, sizeof(aggrSuperseded));
+    pthread_mutex_unlock(&supersededMutex);
+}
+
+/*!
+ Check if objects of the given type are aggregated
+
+ Public function defined in aggregator.h
+ */
+bool Aggr_isAggregatedType(const char *type)
+{
+    for(uint8_t i = 0; i < aggrNumTypes; i++)
+    {
+        if(strncmp(type, aggrTypes[i], MAX_TYPE_CHAR_LEN) == 0)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+/*!
+ Set the object types that are aggregated
+
+ Public function defined in aggregator.h
+ */
+uint8_t Aggr_setTypes(const char *pTypes)
+{
+    const char *pEnd;
+    size_t len;
+
+    /* Windows folded with the old types would mix both */
+    memset(aggrDevs, 0, sizeof(aggrDevs));
+    aggrNumTypes = 0;
+
+    while((*pTypes != '\0') && (aggrNumTypes < AGGR_MAX_TYPES))
+    {
+        pEnd = strchr(pTypes, ',');
+        len = (pEnd != NULL) ? (size_t)(pEnd - pTypes) : strlen(pTypes);
+        if((len != 0) && (len < MAX_TYPE_CHAR_LEN))
+        {
+            memcpy(aggrTypes[aggrNumTypes], pTypes, len);
+            aggrTypes[aggrNumTypes][len] = '\0';
+            aggrNumTypes++;
+        }
+        if(pEnd == NULL)
+        {
+            break;
+        }
+        pTypes = pEnd + 1;
+    }
+
+    return aggrNumTypes;
+}
+
+/*!
+ Fold the objects of a sensor data update into the window of the device
+
+ Public function defined in aggregator.h
+ */
+bool Aggr_addSample(int devIdx, dev_t *device)
+{
+    aggrDev_t *pAggr;
+    aggrDev_t *pOld;
+    bool publish = false;
+    uint32_t now = Util_getTimeMs();
+
+    if((devIdx < 0) || (devIdx >= MAX_NUM_OF_DEVICES))
+    {
+        return true;
+    }
+
+    pAggr = &aggrDevs[devIdx];
+
+    /* The object layout of the device changed, restart the window */
+    if((pAggr->count != 0) && (pAggr->objectCount != device->objectCount))
+    {
+        Aggr_reset(devIdx);
+    }
+
+    if(pAggr->count == 0)
+    {
+        pAggr->windowStart = now;
+        pAggr->objectCount = device->objectCount;
+    }
+    pAggr->count++;
+
+    /* Take the updates this one replaced in the lane first */
+    pthread_mutex_lock(&supersededMutex);
+    pOld = &aggrSuperseded[devIdx];
+    if((pOld->count != 0) && (pOld->objectCount == device->objectCount))
+    {
+        pAggr->count += pOld->count;
+        for(uint8_t objIdx = 0; objIdx < device->objectCount; objIdx++)
+        {
+            if(Aggr_isAggregatedType(device->object[objIdx].type))
+            {
+                foldStats(&pAggr->stats[objIdx], &pOld->stats[objIdx]);
+            }
+        }
+    }
+    memset(pOld, 0, sizeof(aggrDev_t));
+    pthread_mutex_unlock(&supersededMutex);
+
+    for(uint8_t objIdx = 0; objIdx < device->objectCount; objIdx++)
+    {
+        if(Aggr_isAggregatedType(device->object[objIdx].type))
+        {
+            foldValue(&pAggr->stats[objIdx],
+                      device->object[objIdx].sensorVal);
+        }
+        else
+        {
+            /* A state change, published with its own value */
+            publish = true;
+        }
+    }
+
+    if((aggrWindowMs == 0) || ((now - pAggr->windowStart) >= aggrWindowMs))
+    {
+        publish = true;
+    }
+
+    return publish;
+}
+
+/*!
+ Keep a sensor data update that was replaced by a newer one
+
+ Public function defined in aggregator.h
+ */
+void Aggr_addSuperseded(dev_t *device)
+{
+    aggrDev_t *pOld;
+    int devIdx = DevReg_findExt(device->extAddr);
+
+    /* A device the gateway task doesn't know yet has no window */
+    if((devIdx < 0) || (devIdx >= MAX_NUM_OF_DEVICES))
+    {
+        return;
+    }
+
+    pthread_mutex_lock(&supersededMutex);
+    pOld = &aggrSuperseded[devIdx];
+    if((pOld->count != 0) && (pOld->objectCount != device->objectCount))
+    {
+        memset(pOld, 0, sizeof(aggrDev_t));
+    }
+    pOld->objectCount = device->objectCount;
+    pOld->count++;
+    for(uint8_t objIdx = 0; objIdx < device->objectCount; objIdx++)
+    {
+        foldValue(&pOld->stats[objIdx], device->object[objIdx].sensorVal);
+    }
+    pthread_mutex_unlock(&supersededMutex);
+}
+
+/*!
+ Get the accumulated statistics of an object
+
+ Public function defined in aggregator.h
+ */
+aggrStats_t *Aggr_getStats(int devIdx, int objIdx)
+{
+    if((devIdx < 0) || (devIdx >= MAX_NUM_OF_DEVICES) ||
+       (objIdx < 0) || (objIdx >= aggrDevs[devIdx].objectCount) ||
+       (aggrDevs[devIdx].stats[objIdx].count == 0))
+    {
+        return NULL;
+    }
+    return &aggrDevs[devIdx].stats[objIdx];
+}
+
+/*!
+ Check if a device has samples in its current window
+
+ Public function defined in aggregator.h
+ */
+bool Aggr_isPending(int devIdx)
+{
+    if((devIdx < 0) || (devIdx >= MAX_NUM_OF_DEVICES))
+    {
+        return false;
+    }
+    return (aggrDevs[devIdx].count != 0);
+}
+
+/*!
+ Close the window of a device and clear its accumulators
+
+ Public function defined in aggregator.h
+ */
+void Aggr_reset(int devIdx)
+{
+    if((devIdx >= 0) && (devIdx < MAX_NUM_OF_DEVICES))
+    {
+        memset(&aggrDevs[devIdx], 0, sizeof(aggrDev_t));
+    }
+}
+
+/*!
+ Find a device whose window has expired with pending samples
+
+ Public function defined in aggregator.h
+ */
+int Aggr_nextExpired(void)
+{
+    uint32_t now = Util_getTimeMs();
+
+    for(int devIdx = 0; devIdx < MAX_NUM_OF_DEVICES; devIdx++)
+    {
+        if((aggrDevs[devIdx].count != 0) &&
+           ((now - aggrDevs[devIdx].windowStart) >= aggrWindowMs))
+        {
+            return devIdx;
+        }
+    }
+    return -1;
+}
+
+/******************************************************************************
+ Local Functions
+ *****************************************************************************/
+
+/*!
+ * @brief       Add a value to the statistics of an object
+ *
+ * @param       pStats - statistics
+ * @param       val - sensor value
+ */
+static void foldValue(aggrStats_t *pStats, int32_t val)
+{
+    if(pStats->count == 0)
+    {
+        pStats->min = val;
+        pStats->max = val;
+        pStats->sum = 0;
+    }
+    else
+    {
+        if(val < pStats->min)
+        {
+            pStats->min = val;
+        }
+        if(val > pStats->max)
+        {
+            pStats->max = val;
+        }
+    }
+    pStats->last = val;
+    /* sum and count stop together, so the mean stays right */
+    if(pStats->count < UINT16_MAX)
+    {
+        pStats->sum += val;
+        pStats->count++;
+    }
+}
+
+/*!
+ * @brief       Add the statistics of older values of an object
+ *
+ * @param       pStats - statistics, the last value is kept
+ * @param       pOther - statistics of the older values
+ */
+static void foldStats(aggrStats_t *pStats, const aggrStats_t *pOther)
+{
+    if(pOther->count == 0)
+    {
+        return;
+    }
+    if(pStats->count == 0)
+    {
+        memcpy(pStats, pOther, sizeof(aggrStats_t));
+        return;
+    }
+    if(pOther->min < pStats->min)
+    {
+        pStats->min = pOther->min;
+    }
+    if(pOther->max > pStats->max)
+    {
+        pStats->max = pOther->max;
+    }
+    if((UINT16_MAX - pStats->count) < pOther->count)
+    {
+        /* Only the values that fit, at the mean of the older ones */
+        pStats->sum += (pOther->sum / pOther->count)
+                       * (UINT16_MAX - pStats->count);
+        pStats->count = UINT16_MAX;
+    }
+    else
+    {
+        pStats->sum += pOther->sum;
+        pStats->count += pOther->count;
+    }
+}
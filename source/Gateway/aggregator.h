@@ -0,0 +1,205 @@
+/******************************************************************************
+
+ @file aggregator.h
+
+ @brief Windowed aggregation of sensor values before they are published
+
+ Group: WCS LPC
+ Target Device: CC13xx CC32xx
+
+ ******************************************************************************
+
+ Copyright (c) 2016-2017, Texas Instruments Incorporated
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions
+ are met:
+
+ *  Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+
+ *  Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+
+ *  Neither the name of Texas Instruments Incorporated nor the names of
+    its contributors may be used to endorse or promote products derived
+    from this software without specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+ ******************************************************************************
+ Release Name:
+ Release Date:
+ *****************************************************************************/
+
+#ifndef GATEWAY_AGGREGATOR_H_
+#define GATEWAY_AGGREGATOR_H_
+
+//*****************************************************************************
+//
+// If building with a C++ compiler, make all of the definitions in this header
+// have a C binding.
+//
+//*****************************************************************************
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <Common/commonDefs.h>
+
+/*!
+ Length of the aggregation window in milliseconds. Sensor data updates for
+ aggregated types are folded into one document per device per window.
+ 0, the default, publishes every update as it arrives. A window only pays
+ off when it spans several reports, so set it to a few times
+ CONFIG_REPORTING_INTERVAL (90 s or more by default), or lower the
+ reporting interval.
+ */
+#ifndef AGGR_WINDOW_MS
+#define AGGR_WINDOW_MS          0
+#endif
+
+/*!
+ Object types that are aggregated, a comma separated list of IPSO type
+ strings. Types that are not listed (motion, door lock, water leak,
+ actuators, ...) are state changes and are published as soon as they are
+ reported. Can be changed at run time with Aggr_setTypes().
+ */
+#ifndef AGGR_TYPES
+#define AGGR_TYPES              TEMP_TYPE "," HUM_TYPE "," PRESS_TYPE "," \
+                                LIGHT_TYPE "," VOLTAGE_TYPE
+#endif
+
+/*! Maximum number of aggregated object types */
+#define AGGR_MAX_TYPES          8
+
+/*!
+ Maximum time in seconds the gateway task blocks on its queue before it
+ checks for expired aggregation windows.
+ */
+#define AGGR_FLUSH_POLL_SEC     1
+
+/*! Accumulated statistics of one object over the current window */
+typedef struct
+{
+    int32_t min;
+    int32_t max;
+    int32_t last;
+    int64_t sum;
+    uint16_t count;
+} aggrStats_t;
+
+/*!
+ * @brief       Reset all accumulators, set the aggregation window and the
+ *              AGGR_TYPES object types
+ *
+ * @param       windowMs - window length in milliseconds, 0 disables
+ *                         aggregation
+ */
+extern void Aggr_init(uint32_t windowMs);
+
+/*!
+ * @brief       Check if objects of the given type are aggregated
+ *
+ * @param       type - IPSO type string of the smart object
+ *
+ * @return      true if the type is aggregated, false if it is published
+ *              on every update
+ */
+extern bool Aggr_isAggregatedType(const char *type);
+
+/*!
+ * @brief       Set the object types that are aggregated. The windows of
+ *              all devices are closed. Must be called from the gateway
+ *              task.
+ *
+ * @param       pTypes - comma separated list of IPSO type strings, empty
+ *                       to publish every update as it arrives
+ *
+ * @return      number of types set, at most AGGR_MAX_TYPES
+ */
+extern uint8_t Aggr_setTypes(const char *pTypes);
+
+/*!
+ * @brief       Fold the objects of a sensor data update into the window
+ *              of the device, objects of other than the aggregated types
+ *              are not folded
+ *
+ * @param       devIdx - index of the device in the gateway device list
+ * @param       device - device holding the updated object values
+ *
+ * @return      true if a document has to be published now, either because
+ *              the window expired or the update carries an object type that
+ *              is not aggregated
+ */
+extern bool Aggr_addSample(int devIdx, dev_t *device);
+
+/*!
+ * @brief       Keep a sensor data update that was replaced by a newer one
+ *              before the gateway task got it. It is folded into the window
+ *              of the device with the next Aggr_addSample(). Can be called
+ *              from any task.
+ *
+ * @param       device - the replaced update
+ */
+extern void Aggr_addSuperseded(dev_t *device);
+
+/*!
+ * @brief       Get the accumulated statistics of an object
+ *
+ * @param       devIdx - index of the device in the gateway device list
+ * @param       objIdx - index of the object in the device
+ *
+ * @return      pointer to the statistics, NULL if the object has no
+ *              samples in the current window
+ */
+extern aggrStats_t *Aggr_getStats(int devIdx, int objIdx);
+
+/*!
+ * @brief       Check if a device has samples in its current window
+ *
+ * @param       devIdx - index of the device in the gateway device list
+ *
+ * @return      true if there are pending samples
+ */
+extern bool Aggr_isPending(int devIdx);
+
+/*!
+ * @brief       Close the window of a device and clear its accumulators
+ *
+ * @param       devIdx - index of the device in the gateway device list
+ */
+extern void Aggr_reset(int devIdx);
+
+/*!
+ * @brief       Find a device whose window has expired with pending samples
+ *
+ * @return      index of the device, -1 if there is none
+ */
+extern int Aggr_nextExpired(void);
+
+//*****************************************************************************
+//
+// Mark the end of the C bindings section for C++ compilers.
+//
+//*****************************************************************************
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* GATEWAY_AGGREGATOR_H_ */
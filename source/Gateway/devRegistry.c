@@ -0,0 +1,449 @@
+/******************************************************************************
+
+ @file devRegistry.c
+
+ @brief Gateway device registry indexed by short and extended address
+
+ Group: WCS LPC
+ Target Device: CC13xx CC32xx
+
+ ******************************************************************************
+
+ Copyright (c) 2016-2017, Texas Instruments Incorporated
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions
+ are met:
+
+ *  Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+
+ *  Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+
+ *  Neither the name of Texas Instruments Incorporated nor the names of
+    its contributors may be used to endorse or promote products derived
+    from this software without specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+ ******************************************************************************
+ Release Name:
+ Release Date:
+ *****************************************************************************/
+
+/******************************************************************************
+ Includes
+ *****************************************************************************/
+#include <string.h>
+#include <pthread.h>
+#include <Common/commonDefs.h>
+#include "devRegistry.h"
+
+/******************************************************************************
+ Constants and definitions
+ *****************************************************************************/
+
+/* Index slot that holds no device, slots hold the handle + 1 */
+#define EMPTY_SLOT      0
+
+/* Fibonacci hashing constant */
+#define HASH_MULT       0x9E3779B1u
+
+/* FNV-1a constants */
+#define FNV_OFFSET      0x811C9DC5u
+#define FNV_PRIME       0x01000193u
+
+/******************************************************************************
+ Local variables
+ *****************************************************************************/
+
+/* Devices, indexed by handle */
+static dev_t devices[MAX_NUM_OF_DEVICES];
+static uint8_t numDevices = 0;
+
+/* Handles of removed devices, given to the next new devices */
+static bool freed[MAX_NUM_OF_DEVICES];
+static uint8_t numFree = 0;
+
+/* Open addressing indexes with linear probing */
+static uint8_t shortIndex[DEVREG_HASH_SIZE];
+static uint8_t extIndex[DEVREG_HASH_SIZE];
+
+/* Protects the indexes, looked up by other tasks */
+static pthread_mutex_t regMutex;
+static bool regMutexInit = false;
+
+/******************************************************************************
+ Local function prototypes
+ *****************************************************************************/
+static uint16_t hashShort(uint16_t shortAddr);
+static uint16_t hashExt(const uint8_t *pExtAddr);
+static int findShort(uint16_t shortAddr);
+static int findExt(const uint8_t *pExtAddr);
+static void insert(uint8_t *pIndex, uint16_t slot, int handle);
+static void claimShort(int handle, uint16_t shortAddr, bool newDevice);
+static void rebuildShortIndex(void);
+static void rebuildExtIndex(void);
+
+/******************************************************************************
+ Public Functions
+ *****************************************************************************/
+
+/*!
+ Clear the registry
+
+ Public function defined in devRegistry.h
+ */
+void DevReg_init(void)
+{
+    if(!regMutexInit)
+    {
+        pthread_mutex_init(&regMutex, NULL);
+        regMutexInit = true;
+    }
+
+    pthread_mutex_lock(&regMutex);
+    memset(devices, 0, sizeof(devices));
+    memset(shortIndex, EMPTY_SLOT, sizeof(shortIndex));
+    memset(extIndex, EMPTY_SLOT, sizeof(extIndex));
+    memset(freed, 0, sizeof(freed));
+    numDevices = 0;
+    numFree = 0;
+    pthread_mutex_unlock(&regMutex);
+}
+
+/*!
+ Add a device or update it in place
+
+ Public function defined in devRegistry.h
+ */
+int DevReg_update(dev_t *pNewDev)
+{
+    dev_t *pDev;
+    int handle;
+
+    pthread_mutex_lock(&regMutex);
+    handle = findExt(pNewDev->extAddr);
+    if(handle == -1)
+    {
+        if(numFree > 0)
+        {
+            for(handle = 0; !freed[handle]; handle++);
+            freed[handle] = false;
+            numFree--;
+        }
+        else if(numDevices < MAX_NUM_OF_DEVICES)
+        {
+            handle = numDevices++;
+        }
+        else
+        {
+            pthread_mutex_unlock(&regMutex);
+            return -1;
+        }
+
+        /* The only time the whole device is copied */
+        memcpy(&devices[handle], pNewDev, sizeof(dev_t));
+        insert(extIndex, hashExt(pNewDev->extAddr), handle);
+        claimShort(handle, pNewDev->shortAddr, true);
+    }
+    else
+    {
+        pDev = &devices[handle];
+        if(pDev->shortAddr != pNewDev->shortAddr)
+        {
+            /* The device rejoined with another address */
+            memcpy(pDev->name, pNewDev->name, sizeof(pDev->name));
+            claimShort(handle, pNewDev->shortAddr, false);
+        }
+        pDev->active = pNewDev->active;
+        pDev->rssi = pNewDev->rssi;
+        pDev->rxTime = pNewDev->rxTime;
+        memcpy(pDev->object, pNewDev->object,
+               sizeof(smartObject_t) * pNewDev->objectCount);
+        pDev->objectCount = pNewDev->objectCount;
+    }
+    pthread_mutex_unlock(&regMutex);
+
+    return handle;
+}
+
+/*!
+ Remove a device
+
+ Public function defined in devRegistry.h
+ */
+int DevReg_remove(const uint8_t *pExtAddr)
+{
+    int handle;
+
+    pthread_mutex_lock(&regMutex);
+    handle = findExt(pExtAddr);
+    if(handle != -1)
+    {
+        memset(&devices[handle], 0, sizeof(dev_t));
+        devices[handle].shortAddr = DEVREG_NO_SHORT_ADDR;
+        freed[handle] = true;
+        numFree++;
+        rebuildExtIndex();
+        rebuildShortIndex();
+    }
+    pthread_mutex_unlock(&regMutex);
+
+    return handle;
+}
+
+/*!
+ Find a device by short address
+
+ Public function defined in devRegistry.h
+ */
+int DevReg_findShort(uint16_t shortAddr)
+{
+    int handle;
+
+    pthread_mutex_lock(&regMutex);
+    handle = findShort(shortAddr);
+    pthread_mutex_unlock(&regMutex);
+
+    return handle;
+}
+
+/*!
+ Find a device by extended address
+
+ Public function defined in devRegistry.h
+ */
+int DevReg_findExt(const uint8_t *pExtAddr)
+{
+    int handle;
+
+    pthread_mutex_lock(&regMutex);
+    handle = findExt(pExtAddr);
+    pthread_mutex_unlock(&regMutex);
+
+    return handle;
+}
+
+/*!
+ Get a device
+
+ Public function defined in devRegistry.h
+ */
+dev_t *DevReg_get(int handle)
+{
+    if((handle < 0) || (handle >= numDevices) || freed[handle])
+    {
+        return NULL;
+    }
+    return &devices[handle];
+}
+
+/*!
+ Walk the devices
+
+ Public function defined in devRegistry.h
+ */
+int DevReg_next(int handle)
+{
+    for(handle++; handle < numDevices; handle++)
+    {
+        if(!freed[handle])
+        {
+            return handle;
+        }
+    }
+    return -1;
+}
+
+/*!
+ Number of devices in the registry
+
+ Public function defined in devRegistry.h
+ */
+uint8_t DevReg_count(void)
+{
+    return numDevices - numFree;
+}
+
+/******************************************************************************
+ Local Functions
+ *****************************************************************************/
+
+/*!
+ * @brief       Index slot a short address hashes to
+ *
+ * @param       shortAddr - short address
+ *
+ * @return      slot
+ */
+static uint16_t hashShort(uint16_t shortAddr)
+{
+    return (uint16_t)((((uint32_t)shortAddr * HASH_MULT) >> 16) &
+                     (DEVREG_HASH_SIZE - 1));
+}
+
+/*!
+ * @brief       Index slot an extended address hashes to
+ *
+ * @param       pExtAddr - extended address
+ *
+ * @return      slot
+ */
+static uint16_t hashExt(const uint8_t *pExtAddr)
+{
+    uint32_t hash = FNV_OFFSET;
+    uint8_t i;
+
+    for(i = 0; i < APIMAC_SADDR_EXT_LEN; i++)
+    {
+        hash = (hash ^ pExtAddr[i]) * FNV_PRIME;
+    }
+    return (uint16_t)(hash & (DEVREG_HASH_SIZE - 1));
+}
+
+/*!
+ * @brief       Look up a short address, called with the mutex held
+ *
+ * @param       shortAddr - short address
+ *
+ * @return      handle of the device, -1 if not found
+ */
+static int findShort(uint16_t shortAddr)
+{
+    uint16_t slot = hashShort(shortAddr);
+
+    while(shortIndex[slot] != EMPTY_SLOT)
+    {
+        int handle = shortIndex[slot] - 1;
+        if(devices[handle].shortAddr == shortAddr)
+        {
+            return handle;
+        }
+        slot = (slot + 1) & (DEVREG_HASH_SIZE - 1);
+    }
+    return -1;
+}
+
+/*!
+ * @brief       Look up an extended address, called with the mutex held
+ *
+ * @param       pExtAddr - extended address
+ *
+ * @return      handle of the device, -1 if not found
+ */
+static int findExt(const uint8_t *pExtAddr)
+{
+    uint16_t slot = hashExt(pExtAddr);
+
+    while(extIndex[slot] != EMPTY_SLOT)
+    {
+        int handle = extIndex[slot] - 1;
+        if(memcmp(devices[handle].extAddr, pExtAddr,
+                  APIMAC_SADDR_EXT_LEN) == 0)
+        {
+            return handle;
+        }
+        slot = (slot + 1) & (DEVREG_HASH_SIZE - 1);
+    }
+    return -1;
+}
+
+/*!
+ * @brief       Put a device in the first free slot from its hash slot on.
+ *              The indexes are at most half full, there always is one.
+ *
+ * @param       pIndex - index
+ * @param       slot - hash slot
+ * @param       handle - handle of the device
+ */
+static void insert(uint8_t *pIndex, uint16_t slot, int handle)
+{
+    while(pIndex[slot] != EMPTY_SLOT)
+    {
+        slot = (slot + 1) & (DEVREG_HASH_SIZE - 1);
+    }
+    pIndex[slot] = (uint8_t)(handle + 1);
+}
+
+/*!
+ * @brief       Give a short address to a device, called with the mutex held
+ *
+ * @param       handle - handle of the device
+ * @param       shortAddr - its new short address
+ * @param       newDevice - true if the device was just added
+ */
+static void claimShort(int handle, uint16_t shortAddr, bool newDevice)
+{
+    int owner = findShort(shortAddr);
+
+    /* The coordinator reassigned the address of a device that left */
+    if((owner != -1) && (owner != handle))
+    {
+        devices[owner].shortAddr = DEVREG_NO_SHORT_ADDR;
+        newDevice = false;
+    }
+    devices[handle].shortAddr = shortAddr;
+
+    if(newDevice == true)
+    {
+        if(shortAddr != DEVREG_NO_SHORT_ADDR)
+        {
+            insert(shortIndex, hashShort(shortAddr), handle);
+        }
+    }
+    else
+    {
+        /* Entries can't simply be cleared from a linear probing index */
+        rebuildShortIndex();
+    }
+}
+
+/*!
+ * @brief       Index the short address of every device again, called with
+ *              the mutex held
+ */
+static void rebuildShortIndex(void)
+{
+    uint8_t handle;
+
+    memset(shortIndex, EMPTY_SLOT, sizeof(shortIndex));
+    for(handle = 0; handle < numDevices; handle++)
+    {
+        if(devices[handle].shortAddr != DEVREG_NO_SHORT_ADDR)
+        {
+            insert(shortIndex, hashShort(devices[handle].shortAddr), handle);
+        }
+    }
+}
+
+/*!
+ * @brief       Index the extended address of every device again, called
+ *              with the mutex held
+ */
+static void rebuildExtIndex(void)
+{
+    uint8_t handle;
+
+    memset(extIndex, EMPTY_SLOT, sizeof(extIndex));
+    for(handle = 0; handle < numDevices; handle++)
+    {
+        if(!freed[handle])
+        {
+            insert(extIndex, hashExt(devices[handle].extAddr), handle);
+        }
+    }
+}
@@ -0,0 +1,167 @@
+/******************************************************************************
+
+ @file devRegistry.h
+
+ @brief Gateway device registry indexed by short and extended address
+
+ Group: WCS LPC
+ Target Device: CC13xx CC32xx
+
+ ******************************************************************************
+
+ Copyright (c) 2016-2017, Texas Instruments Incorporated
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions
+ are met:
+
+ *  Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+
+ *  Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+
+ *  Neither the name of Texas Instruments Incorporated nor the names of
+    its contributors may be used to endorse or promote products derived
+    from this software without specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+ ******************************************************************************
+ Release Name:
+ Release Date:
+ *****************************************************************************/
+
+#ifndef GATEWAY_DEVREGISTRY_H_
+#define GATEWAY_DEVREGISTRY_H_
+
+//*****************************************************************************
+//
+// If building with a C++ compiler, make all of the definitions in this header
+// have a C binding.
+//
+//*****************************************************************************
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <Common/commonDefs.h>
+
+/*!
+ Slots of each address index, a power of 2 of at least twice
+ MAX_NUM_OF_DEVICES so that probe sequences stay short. Set it with
+ MAX_NUM_OF_DEVICES, e.g. 512 for 250 devices.
+ */
+#ifndef DEVREG_HASH_SIZE
+#define DEVREG_HASH_SIZE        64
+#endif
+
+#if (DEVREG_HASH_SIZE < (2 * MAX_NUM_OF_DEVICES)) || \
+    ((DEVREG_HASH_SIZE & (DEVREG_HASH_SIZE - 1)) != 0)
+#error "DEVREG_HASH_SIZE must be a power of 2 of at least 2 * MAX_NUM_OF_DEVICES"
+#endif
+
+#if (MAX_NUM_OF_DEVICES > 254)
+#error "The device registry holds at most 254 devices"
+#endif
+
+/*! Short address of a device that no longer owns one */
+#define DEVREG_NO_SHORT_ADDR    0xFFFF
+
+/*!
+ * @brief       Clear the registry
+ */
+extern void DevReg_init(void);
+
+/*!
+ * @brief       Add a device or update it in place. The device is identified
+ *              by its extended address, a short address taken over from
+ *              another device is removed from that device.
+ *
+ * @param       pNewDev - device as reported by the collector
+ *
+ * @return      handle of the device, -1 if the registry is full. A handle
+ *              is the index of the device and stays valid until the device
+ *              is removed or DevReg_init is called, devices are never moved.
+ *              The handle of a removed device goes to the next new device.
+ */
+extern int DevReg_update(dev_t *pNewDev);
+
+/*!
+ * @brief       Remove a device that left the network
+ *
+ * @param       pExtAddr - extended address, APIMAC_SADDR_EXT_LEN bytes
+ *
+ * @return      handle the device had, -1 if not found
+ */
+extern int DevReg_remove(const uint8_t *pExtAddr);
+
+/*!
+ * @brief       Find a device by short address. Can be called from any task.
+ *
+ * @param       shortAddr - short address
+ *
+ * @return      handle of the device, -1 if not found
+ */
+extern int DevReg_findShort(uint16_t shortAddr);
+
+/*!
+ * @brief       Find a device by extended address. Can be called from any
+ *              task.
+ *
+ * @param       pExtAddr - extended address, APIMAC_SADDR_EXT_LEN bytes
+ *
+ * @return      handle of the device, -1 if not found
+ */
+extern int DevReg_findExt(const uint8_t *pExtAddr);
+
+/*!
+ * @brief       Get a device. The entry is only written by the gateway task.
+ *
+ * @param       handle - handle of the device
+ *
+ * @return      pointer to the device, NULL if the handle is not valid
+ */
+extern dev_t *DevReg_get(int handle);
+
+/*!
+ * @brief       Walk the devices in handle order
+ *
+ * @param       handle - handle of the previous device, -1 to start
+ *
+ * @return      handle of the next device, -1 if there is none
+ */
+extern int DevReg_next(int handle);
+
+/*!
+ * @brief       Number of devices in the registry
+ *
+ * @return      number of devices
+ */
+extern uint8_t DevReg_count(void);
+
+//*****************************************************************************
+//
+// Mark the end of the C bindings section for C++ compilers.
+//
+//*****************************************************************************
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* GATEWAY_DEVREGISTRY_H_ */
@@ -48,18 +48,35 @@
 #include <unistd.h>
 #include <pthread.h>
 #include <mqueue.h>
+#include <time.h>
 #include <ti/drivers/GPIO.h>
 #include <ti/drivers/SPI.h>
 #include <ti/drivers/net/wifi/simplelink.h>
 #include <Common/commonDefs.h>
 #include <Utils/util.h>
 #include <Board.h>
+#define LOG_MODULE LogModule_GATEWAY
 #include <Utils/uart_term.h>
+#include <Utils/msgLane.h>
+#include <Utils/mqStats.h>
 #include <CloudService/cloud_service.h>
 #include <NPI/npi.h>
 #include <Collector/collector.h>
+#include <Collector/LinkController/cllc.h>
+#include <Collector/linkStats.h>
+#include <Collector/indirectQueue.h>
+#include <Collector/inFlight.h>
+#include <Collector/oadServer.h>
+#include <Collector/delivery.h>
+#include <Collector/rampBench.h>
+#include "aggregator.h"
+#include "devRegistry.h"
 #include "gtwayJson.h"
+#include "gtwayCbor.h"
+#include "jsonBench.h"
+#include "regBench.h"
 #include "provisioning.h"
+#include "startsntp.h"
 #include "gateway.h"
 
 
@@ -71,40 +88,71 @@ char lineBreak[]                = "\n\r";
 
 #define APPLICATION_NAME        "TI-15.4 Stack Sensor to Cloud Gateway"
 #define APPLICATION_VERSION     "1.0"
-#define DEF_TIME                "Mon Jan 01 00:00:00 2018"
 
 #define SPAWN_TASK_PRIORITY     9
 
 void gatewayStartSlTask(void);
-int listDevUpdate(dev_t *newDev);
-
-
-static mqd_t gatewayMq;
+void publishDevUpdate(int devIdx);
+void publishNwkSnapshot(void);
+void publishNwkDelta(NwkDelta_op_t op, dev_t *pDev);
+void publishCbor(uint8_t event, uint8_t *pBuf, uint16_t len);
+void publishExpiredAggr(void);
+void publishDelivery(Delivery_outcome_t *pOutcome);
+void publishRamp(RampBench_frame_t *pFrame);
+void printRampReport(RampBench_report_t *pReport);
+void printJsonBench(void);
+void printRegBench(void);
+void printLaneStats(void);
+void printQueueStats(void);
+void printAdmitStats(void);
+static MsgLane_class_t gatewayMsgClass(const msgQueue_t *pMsg);
+static uint32_t gatewayMsgKey(const msgQueue_t *pMsg);
+static void gatewayMsgSuperseded(const msgQueue_t *pMsg);
+char *timeStr(void);
+
+
+static MsgLane_t *gatewayMq;
 static mqd_t gatewayCollectorMq;
-static mqd_t gatewayCloudMq;
+static MsgLane_t *gatewayCloudMq;
+/* Commands and WLAN events keep their room during a burst of sensor data.
+ * Only sensor data is ever lost, the data of a device still queued is
+ * replaced by its next data, the aggregator still counts the replaced
+ * values. The senders of everything else wait for room, the provisioning
+ * events this task sends itself take a spare place.                       */
+static const MsgLane_config_t gatewayLaneConfig =
+{
+    .bound = {6, 5, 4, 6},
+    .policy = {MsgLane_policy_coalesce, MsgLane_policy_block,
+               MsgLane_policy_block, MsgLane_policy_block},
+    .congestedPct = 75,
+    .pfnClass = gatewayMsgClass,
+    .pfnKey = gatewayMsgKey,
+    .pfnSuperseded = gatewayMsgSuperseded
+};
 SlWlanSecParams_t SecurityParams = { 0 };
-bool ntpStarted = false;
-char *currentTimeStr;
+/* The cloud is told about the WLAN once the clock is set, as needed for
+ * SSL authentication                                                        */
+static bool wlanConnected = false;
+static bool timeReady = false;
 static nwk_t nwkInfo;
-static dev_t devList[MAX_NUM_OF_DEVICES];
+/* Version of the network document, bumped with every delta so that the
+ * consumers can tell when they missed one                                   */
+static uint32_t nwkVersion = 0;
 
 void gatewayInit()
 {
     UART_Handle tUartHndl;
-    mq_attr attr;
-    unsigned mode = 0;
 
-    // create mqueue for gateway
-    attr.mq_curmsgs = 0;
-    attr.mq_flags = 0;
-    attr.mq_maxmsg = 19;
-    attr.mq_msgsize = sizeof(msgQueue_t);
-    gatewayMq = mq_open(GATEWAY_MQ, O_CREAT, mode, &attr);
+    /* before any queue is opened */
+    MqStats_init();
+    // create lane for gateway
+    gatewayMq = MsgLane_create(GATEWAY_MQ, &gatewayLaneConfig);
 
     nwkInfo.mode = true;
     nwkInfo.security_enable = false;
     nwkInfo.state = Cllc_states_joiningNotAllowed;
     nwkInfo.devCount = 0;
+    DevReg_init();
 
     Board_initSPI();
     /* Configure the UART                                                     */
@@ -112,9 +160,20 @@ void gatewayInit()
     tUartHndl = InitTerm();
     /* remove uart receive from LPDS dependency                               */
     UART_control(tUartHndl, UART_CMD_RXDISABLE, NULL);
+    /* Lines logged from here on are printed by the log task               */
+    LogRing_init();
+#if GTWAY_JSON_BENCH
+    printJsonBench();
+#endif
+#if GTWAY_REG_BENCH
+    printRegBench();
+#endif
 
     gatewayStartSlTask();
 
+    Aggr_init(AGGR_WINDOW_MS);
+    Ntp_init(GATEWAY_MQ);
+
     /* Run MQTT Main Thread (it will open the Client and Server)          */
 
     provisioningInit(GATEWAY_MQ);
@@ -126,8 +185,8 @@ void gatewayInit()
     npiCliMqReg(COLLECTOR_MQ);
     collectorClientRegister(NPI_MQ, GATEWAY_MQ);
 
-    gatewayCollectorMq = mq_open(COLLECTOR_MQ, O_WRONLY);
-    gatewayCloudMq = mq_open(CLOUDSERVICE_MQ, O_WRONLY);
+    gatewayCollectorMq = MqStats_open(COLLECTOR_MQ, O_WRONLY, NULL);
+    gatewayCloudMq = MsgLane_open(CLOUDSERVICE_MQ);
 
 }
 
@@ -148,6 +207,7 @@ void gatewayStartSlTask()
     if (retc != 0)
     {
         UART_PRINT("[Gateway Task] could not create simplelink task\n\r");
+        LogRing_flush();
         while (1);
     }
 }
@@ -160,43 +220,58 @@ void printExtAddr(uint8_t *extA)
     UART_PRINT("0x%08X%08X", hiBytes, loBytes);
 }
 
-bool extAddrCmp(uint8_t *extA, uint8_t *extB)
+void printLinkStats(uint16_t shortAddr)
 {
-    bool extCmp = (memcmp(extA, extB, APIMAC_SADDR_EXT_LEN) == 0);
-    return extCmp;
-}
+    LinkStats_entry_t link;
+    IndQueue_stats_t downlink;
+    InFlight_latency_t latency;
 
-int devSearchExt(uint8_t *pAddr)
-{
-    for(int i = 0; i < nwkInfo.devCount; i++)
+    if(LinkStats_get(shortAddr, &link))
     {
-        if(extAddrCmp(devList[i].extAddr, pAddr))
-        {
-            printExtAddr(pAddr);
-            UART_PRINT("[Gateway Task] Extended address found in device list\n\r");
-            return i;
-        }
+        UART_PRINT("[Gateway Task] Link 0x%04x: RSSI avg:%d LQI avg:%d delivery:%d%% "
+                   "tx:%d CCA fail:%d no ACK:%d expired:%d other:%d rx:%d\n\r",
+                   shortAddr, link.rssiAvg / 16, link.lqiAvg / 16,
+                   LinkStats_deliveryRatio(&link), link.txAttempts,
+                   link.txChannelAccessFailures, link.txAckFailures,
+                   link.txExpired, link.txOtherFailures, link.rxFrames);
+        UART_PRINT("[Gateway Task] Link 0x%04x: device reported msgs attempted:%d "
+                   "sent:%d CCA fail:%d no ACK:%d\n\r",
+                   shortAddr, link.devMsgsAttempted, link.devMsgsSent,
+                   link.devChannelAccessFailures, link.devMacAckFailures);
     }
-    UART_PRINT("[Gateway Task] Extended address NOT found in device list\n\r");
-    return -1;
-}
-int devSearchShort(uint16_t sAddr)
-{
-    for(int i = 0; i < nwkInfo.devCount; i++)
+    if(IndQueue_getStats(shortAddr, &downlink))
+    {
+        UART_PRINT("[Gateway Task] Downlink 0x%04x: depth:%d max depth:%d queued:%d "
+                   "coalesced:%d dropped:%d delivered:%d failed:%d "
+                   "latency last:%dms avg:%dms max:%dms\n\r",
+                   shortAddr, downlink.depth, downlink.maxDepth,
+                   downlink.queued, downlink.coalesced, downlink.dropped,
+                   downlink.delivered, downlink.failed, downlink.lastLatency,
+                   downlink.avgLatency, downlink.maxLatency);
+    }
+    if(InFlight_getDeviceStats(shortAddr, &latency))
     {
-        if(devList[i].shortAddr == sAddr)
+        UART_PRINT("[Gateway Task] TX latency 0x%04x: confirmed:%d failed:%d "
+                   "lost:%d avg:%dms max:%dms\n\r[Gateway Task] TX latency "
+                   "0x%04x: <16ms", shortAddr, latency.confirmed,
+                   latency.failed, latency.lost, latency.avgLatency,
+                   latency.maxLatency, shortAddr);
+        for(int bin = 0; bin < INFLIGHT_NUM_BINS; bin++)
         {
-            return i;
+            UART_PRINT(" %d", latency.bins[bin]);
         }
+        UART_PRINT(" >%dms\n\r",
+                   INFLIGHT_FIRST_BIN << (INFLIGHT_NUM_BINS - 2));
     }
-    return -1;
 }
 
 int objSearch(int index, int typeId)
 {
-    for(int i = 0; i < devList[index].objectCount; i++)
+    dev_t *pDev = DevReg_get(index);
+
+    for(int i = 0; (pDev != NULL) && (i < pDev->objectCount); i++)
     {
-        if(devList[index].object[i].typeId == typeId)
+        if(pDev->object[i].typeId == typeId)
         {
             return i;
         }
@@ -217,24 +292,28 @@ void *gatewayMainThread(void *pvParameters)
 
     deviceCmd_t *tempDevCmd;
     permitJoinCmd_t *tempPermitJoinCmd;
-    time_t ts;
+    struct timespec waitTime;
 
     gatewayInit();
-    currentTimeStr = DEF_TIME;
 
     for (;;)
     {
         incomingMsg.event = CommonEvent_INVALID_EVENT;
         incomingMsg.msgPtr = NULL;
         incomingMsg.msgPtrLen = 0;
-        /* waiting for signals                                                */
-        mq_receive(gatewayMq, (char*) &incomingMsg, sizeof(msgQueue_t), NULL);
-
-        //if(ntpStarted)
+        /* waiting for signals, wake up periodically to close expired
+         * aggregation windows of devices that stopped reporting              */
+        clock_gettime(CLOCK_REALTIME, &waitTime);
+        waitTime.tv_sec += AGGR_FLUSH_POLL_SEC;
+        if(!MsgLane_receive(gatewayMq, &incomingMsg, &waitTime))
         {
-            ts = time(NULL);
-            currentTimeStr = ctime(&ts);
+            publishExpiredAggr();
+            printLaneStats();
+            printQueueStats();
+            printAdmitStats();
+            continue;
         }
+        printQueueStats();
 
         if(incomingMsg.event <= GatewayEvent_MAX)
         {
@@ -248,33 +327,37 @@ void *gatewayMainThread(void *pvParameters)
             queueElementSend.event = CollectorEvent_START_COP;
             queueElementSend.msgPtr = NULL;
             queueElementSend.msgPtrLen = 0;
-            mq_send(gatewayCollectorMq, (char*)&queueElementSend, sizeof(msgQueue_t), MQ_LOW_PRIOR);
+            MqStats_send(gatewayCollectorMq, &queueElementSend, MQ_LOW_PRIOR);
         break;
         case CommonEvent_WLAN_CONNECTED:
-            /* Use NTP to get the current time, as needed for SSL authentication */
-            startNTP();
-            ntpStarted = true;
-            ts = time(NULL);
-            currentTimeStr = ctime(&ts);
-            queueElementSend.event = CommonEvent_WLAN_CONNECTED;
-            queueElementSend.msgPtr = NULL;
-            queueElementSend.msgPtrLen = 0;
-            mq_send(gatewayCloudMq, (char*) &queueElementSend, sizeof(msgQueue_t), 0);
+            /* The time service syncs in the background, the collector
+             * does not have to wait for it                                */
+            Ntp_start();
+            wlanConnected = true;
+            if(timeReady)
+            {
+                queueElementSend.event = CommonEvent_WLAN_CONNECTED;
+                queueElementSend.msgPtr = NULL;
+                queueElementSend.msgPtrLen = 0;
+                MsgLane_send(gatewayCloudMq, &queueElementSend);
+            }
             queueElementSend.event = CollectorEvent_START_COP;
             queueElementSend.msgPtr = NULL;
             queueElementSend.msgPtrLen = 0;
-            mq_send(gatewayCollectorMq, (char*)&queueElementSend, sizeof(msgQueue_t), MQ_LOW_PRIOR);
+            MqStats_send(gatewayCollectorMq, &queueElementSend, MQ_LOW_PRIOR);
             break;
         case CommonEvent_WLAN_DISCONNECTED:
+            Ntp_stop();
+            wlanConnected = false;
             queueElementSend.event = CommonEvent_WLAN_DISCONNECTED;
             queueElementSend.msgPtr = NULL;
             queueElementSend.msgPtrLen = 0;
-            mq_send(gatewayCloudMq, (char*) &queueElementSend, sizeof(msgQueue_t), 0);
+            MsgLane_send(gatewayCloudMq, &queueElementSend);
             break;
         case GatewayEvent_NWK_UPDATE:
         {
             tempNwk = (nwk_t*) incomingMsg.msgPtr;
-            UART_PRINT("\n\r%s\r[Gateway Task] GatewayEvent_NWK_UPDATE Received\n\r", currentTimeStr);
+            UART_PRINT("\n\r%s\r[Gateway Task] GatewayEvent_NWK_UPDATE Received\n\r", timeStr());
             UART_PRINT("[Gateway Task] Data: Channel: %d, PanID: %04x, shortAddr:%04x, extAddr:",
                        tempNwk->channel, tempNwk->panId, tempNwk->shortAddr);
             printExtAddr(tempNwk->extAddr);
@@ -298,13 +381,10 @@ void *gatewayMainThread(void *pvParameters)
             }
             if(isValid)
             {
-                tmpBuff = formatNwkJson(&nwkInfo, devList);
-
-                 //SEND DATA TO CLOUD SERVICE TASK
-                queueElementSend.event = CloudServiceEvt_NWK_UPDATE;
-                queueElementSend.msgPtr = tmpBuff;
-                queueElementSend.msgPtrLen = strlen(tmpBuff) + 1;
-                mq_send(gatewayCloudMq, (char*) &queueElementSend, sizeof(msgQueue_t), 0);
+                /* The network (re)started, the consumers resync from a
+                 * snapshot                                                  */
+                nwkVersion++;
+                publishNwkSnapshot();
             }
         }
 
@@ -313,9 +393,15 @@ void *gatewayMainThread(void *pvParameters)
         case GatewayEvent_SENSOR_DATA_UPDATE:
         case GatewayEvent_DEV_NOT_ACTIVE:
         case GatewayEvent_DEV_UPDATE:
+        {
+            int devIdx;
+            int oldIdx;
+            int ownerIdx;
+            uint16_t oldShortAddr = DEVREG_NO_SHORT_ADDR;
+            bool oldActive = false;
             tempDev = (dev_t*) incomingMsg.msgPtr;
 
-            UART_PRINT("\n\r%s\r[Gateway Task] GatewayEvent_DEV_UPDATE Received\n\r", currentTimeStr);
+            UART_PRINT("\n\r[Gateway Task] GatewayEvent_DEV_UPDATE Received\n\r");
             UART_PRINT("[Gateway Task] Data: ShortAddr:%d, EXTAddr:", tempDev->shortAddr);
             printExtAddr(tempDev->extAddr);
             UART_PRINT("  ObjectCount: %d", tempDev->objectCount);
@@ -327,19 +413,71 @@ void *gatewayMainThread(void *pvParameters)
                              tempDev->object[objIdx].sensorVal, tempDev->object[objIdx].unit);
             }
             UART_PRINT("\n\r");
+            if(incomingMsg.event == GatewayEvent_DEV_NOT_ACTIVE)
+            {
+                /* Show why the device may have dropped out */
+                printLinkStats(tempDev->shortAddr);
+            }
             sprintf(tempDev->name, "0x%04x", tempDev->shortAddr);
 
-            tmpBuff =  formatDevJson(&devList[listDevUpdate(tempDev)], currentTimeStr);
-            //SEND DATA TO CLOUD TASK
-            queueElementSend.event = CloudServiceEvt_DEV_UPDATE;
-            queueElementSend.msgPtr = tmpBuff;
-            queueElementSend.msgPtrLen = strlen(tmpBuff) + 1;
-            mq_send(gatewayCloudMq, (char*) &queueElementSend, sizeof(msgQueue_t), 0);
+            /* Remember what the network document holds for the device and
+             * for the current owner of its short address                    */
+            oldIdx = DevReg_findExt(tempDev->extAddr);
+            if(oldIdx != -1)
+            {
+                oldShortAddr = DevReg_get(oldIdx)->shortAddr;
+                oldActive = DevReg_get(oldIdx)->active;
+                if((incomingMsg.event == GatewayEvent_SENSOR_DATA_UPDATE) &&
+                   ((int32_t)(DevReg_get(oldIdx)->rxTime - tempDev->rxTime) > 0))
+                {
+                    /* A state change received after this data overtook it
+                     * in the lane, the data must not undo it                */
+                    tempDev->shortAddr = oldShortAddr;
+                    tempDev->active = oldActive;
+                }
+            }
+            ownerIdx = DevReg_findShort(tempDev->shortAddr);
+
+            devIdx = DevReg_update(tempDev);
+            if(devIdx == -1)
+            {
+                UART_PRINT("[Gateway Task] Device list full, update dropped\n\r");
+                break;
+            }
+            nwkInfo.devCount = DevReg_count();
+            if(oldIdx == -1)
+            {
+                publishNwkDelta(NwkDelta_add, DevReg_get(devIdx));
+            }
+            else if((oldShortAddr != DevReg_get(devIdx)->shortAddr) ||
+                    (oldActive != DevReg_get(devIdx)->active))
+            {
+                publishNwkDelta(NwkDelta_update, DevReg_get(devIdx));
+            }
+            if((ownerIdx != -1) && (ownerIdx != devIdx))
+            {
+                /* The device took over the short address of another one */
+                publishNwkDelta(NwkDelta_update, DevReg_get(ownerIdx));
+            }
+            /* Sensor data is held back until the aggregation window of the
+             * device closes, state changes are published right away. While
+             * the cloud service is behind, the window stays open.           */
+            if(incomingMsg.event != GatewayEvent_SENSOR_DATA_UPDATE)
+            {
+                publishDevUpdate(devIdx);
+            }
+            else if(Aggr_addSample(devIdx, DevReg_get(devIdx)) &&
+                    !(Aggr_isPending(devIdx) &&
+                      MsgLane_congested(gatewayCloudMq, MsgLane_class_telemetry)))
+            {
+                publishDevUpdate(devIdx);
+            }
+        }
             break;
 
         case GatewayEvent_DEV_CNF_UPDATE:
             tempDev = (dev_t*) incomingMsg.msgPtr;
-            UART_PRINT("\n\r%s\r[Gateway Task] GatewayEvent_DEV_CNF_UPDATE Received\n\r", currentTimeStr);
+            UART_PRINT("\n\r%s\r[Gateway Task] GatewayEvent_DEV_CNF_UPDATE Received\n\r", timeStr());
             UART_PRINT("[Gateway Task] Data: ShortAddr: 0x%04X", tempDev->shortAddr);
             UART_PRINT("\n\r");
 
@@ -348,7 +486,7 @@ void *gatewayMainThread(void *pvParameters)
         case GatewayEvent_NWK_STATE_CHANGE:
         {
             tempNwk = (nwk_t*) incomingMsg.msgPtr;
-            UART_PRINT("\n\r%s\r[Gateway Task] GatewayEvent_NWK_STATE_CHANGE Received\n\r",currentTimeStr);
+            UART_PRINT("\n\r%s\r[Gateway Task] GatewayEvent_NWK_STATE_CHANGE Received\n\r",timeStr());
             nwkInfo.state = tempNwk->state;
             UART_PRINT("[Gateway Task] New State:      0x%02X\n\r", tempNwk->state);
             uint8_t isValid = 0;
@@ -362,17 +500,95 @@ void *gatewayMainThread(void *pvParameters)
             }
             if(isValid)
             {
-                tmpBuff = formatNwkJson(&nwkInfo, devList);
-                //SEND DATA TO CLOUD TASK
-                queueElementSend.event = CloudServiceEvt_STATE_CNF_EVT;
-                queueElementSend.msgPtr = tmpBuff;
-                queueElementSend.msgPtrLen = strlen(tmpBuff) + 1;
+                publishNwkDelta(NwkDelta_nwk, NULL);
+            }
+        }
+            break;
+
+        case GatewayEvent_OAD_UPDATE:
+        {
+            OadServer_progress_t *pOad = (OadServer_progress_t*) incomingMsg.msgPtr;
+            UART_PRINT("[Gateway Task] OAD 0x%04x: state:%d image:%d block %d/%d "
+                       "sent:%d repeated:%d resumes:%d %dms %dB/s\n\r",
+                       pOad->shortAddr, pOad->state, pOad->imgId,
+                       pOad->nextBlock, pOad->totalBlocks, pOad->blocksSent,
+                       pOad->blocksRepeated, pOad->resumes, pOad->elapsedMs,
+                       pOad->throughput);
+        }
+            break;
 
-                mq_send(gatewayCloudMq, (char*) &queueElementSend, sizeof(msgQueue_t), 0);
+        case GatewayEvent_DELIVERY_UPDATE:
+        {
+            Delivery_outcome_t *pDelivery = (Delivery_outcome_t*) incomingMsg.msgPtr;
+            UART_PRINT("[Gateway Task] Command 0x%04x: type:%d result:%d "
+                       "attempts:%d status:0x%02x %dms\n\r",
+                       pDelivery->shortAddr, pDelivery->cmdType,
+                       pDelivery->result, pDelivery->attempts,
+                       pDelivery->lastStatus, pDelivery->elapsedMs);
+            publishDelivery(pDelivery);
+        }
+            break;
+
+        case GatewayEvent_RAMP_DATA:
+            /* Not printed, the terminal would be the bottleneck */
+            publishRamp((RampBench_frame_t*) incomingMsg.msgPtr);
+            break;
+
+        case GatewayEvent_RAMP_REPORT:
+            printRampReport((RampBench_report_t*) incomingMsg.msgPtr);
+            break;
+
+        case GatewayEvent_DEV_REMOVED:
+        {
+            int devIdx;
+            tempDev = (dev_t*) incomingMsg.msgPtr;
+
+            UART_PRINT("\n\r%s\r[Gateway Task] GatewayEvent_DEV_REMOVED Received\n\r", timeStr());
+            UART_PRINT("[Gateway Task] Data: EXTAddr:");
+            printExtAddr(tempDev->extAddr);
+            UART_PRINT("\n\r");
+
+            devIdx = DevReg_findExt(tempDev->extAddr);
+            if(devIdx == -1)
+            {
+                break;
             }
+            /* The delta names the device by the entry it had */
+            tempDev->shortAddr = DevReg_get(devIdx)->shortAddr;
+            strcpy(tempDev->name, DevReg_get(devIdx)->name);
+
+            DevReg_remove(tempDev->extAddr);
+            Aggr_reset(devIdx);
+            nwkInfo.devCount = DevReg_count();
+            publishNwkDelta(NwkDelta_remove, tempDev);
         }
             break;
 
+        case GatewayEvent_TIME_UPDATE:
+        {
+            Ntp_status_t ntpStatus;
+
+            Ntp_getStatus(&ntpStatus);
+            if(ntpStatus.state == Ntp_state_unsynced)
+            {
+                UART_PRINT("\n\r[Gateway Task] Time not synced, going on without it\n\r");
+            }
+            else
+            {
+                UART_PRINT("\n\r%s\r[Gateway Task] Time synced, error %u us\n\r",
+                           timeStr(), ntpStatus.errorUs);
+            }
+            if(wlanConnected && !timeReady)
+            {
+                queueElementSend.event = CommonEvent_WLAN_CONNECTED;
+                queueElementSend.msgPtr = NULL;
+                queueElementSend.msgPtrLen = 0;
+                MsgLane_send(gatewayCloudMq, &queueElementSend);
+            }
+            timeReady = true;
+        }
+        break;
+
         case GatewayEvent_PERMIT_JOIN:
             tempPermitJoinCmd= (permitJoinCmd_t*) malloc(sizeof(permitJoinCmd_t));
             if(((deviceCmd_t*)incomingMsg.msgPtr)->data)
@@ -386,7 +602,8 @@ void *gatewayMainThread(void *pvParameters)
 
             queueElementSend.event = CollectorEvent_PERMIT_JOIN;
             queueElementSend.msgPtr = tempPermitJoinCmd;
-            mq_send(gatewayCollectorMq, (char*) &queueElementSend, sizeof(msgQueue_t), 0);
+            /* Ahead of the NPI frames queued for the collector */
+            MqStats_send(gatewayCollectorMq, &queueElementSend, MQ_HIGH_PRIOR);
 
             break;
 
@@ -394,20 +611,35 @@ void *gatewayMainThread(void *pvParameters)
             tempDevCmd = (deviceCmd_t*) malloc(sizeof(deviceCmd_t));
 
             tempDevCmd->shortAddr = ((deviceCmd_t*)incomingMsg.msgPtr)->shortAddr;
-            if(tempDevCmd->shortAddr == 0xFFFF)
+            memcpy(tempDevCmd->extAddr,
+                   ((deviceCmd_t*)incomingMsg.msgPtr)->extAddr,
+                   sizeof(tempDevCmd->extAddr));
+            strncpy(tempDevCmd->groupName,
+                    ((deviceCmd_t*)incomingMsg.msgPtr)->groupName,
+                    MAX_GROUP_NAME_LEN);
+            /* a group command has no device address, only the group name */
+            if((tempDevCmd->shortAddr == 0xFFFF) &&
+               ((tempDevCmd->groupName[0] == '\0') ||
+                (((deviceCmd_t*)incomingMsg.msgPtr)->cmdType == CmdType_GROUP_CFG)))
             {
-                int devIdx = devSearchExt(((deviceCmd_t*)incomingMsg.msgPtr)->extAddr);
-                if(devIdx != -1)
+                dev_t *pDev = DevReg_get(DevReg_findExt(
+                            ((deviceCmd_t*)incomingMsg.msgPtr)->extAddr));
+                if(pDev != NULL)
                 {
-                    tempDevCmd->shortAddr = devList[devIdx].shortAddr;
+                    tempDevCmd->shortAddr = pDev->shortAddr;
                 }
             }
             tempDevCmd->data = ((deviceCmd_t*)incomingMsg.msgPtr)->data;
             tempDevCmd->cmdType = ((deviceCmd_t*)incomingMsg.msgPtr)->cmdType;
             queueElementSend.event = CollectorEvent_SEND_SNSR_CMD;
             queueElementSend.msgPtr = tempDevCmd;
-            mq_send(gatewayCollectorMq, (char*) &queueElementSend, sizeof(msgQueue_t), 0);
+            MqStats_send(gatewayCollectorMq, &queueElementSend, MQ_HIGH_PRIOR);
+
+            break;
 
+        case GatewayEvent_NWK_SNAPSHOT:
+            /* A consumer missed a delta or just (re)connected */
+            publishNwkSnapshot();
             break;
         default:
 
@@ -418,28 +650,389 @@ void *gatewayMainThread(void *pvParameters)
         {
             free(incomingMsg.msgPtr);
         }
+
+        publishExpiredAggr();
+    }
+}
+
+void publishDevUpdate(int devIdx)
+{
+    msgQueue_t queueElementSend;
+    char *tmpBuff;
+#if CBOR_UPDATES
+    uint8_t *cborBuff;
+    uint16_t cborLen;
+#endif
+
+    if(Aggr_isPending(devIdx))
+    {
+#if CBOR_UPDATES
+        cborBuff = formatDevCbor(DevReg_get(devIdx), devIdx, &cborLen);
+        publishCbor(CloudServiceEvt_DEV_UPDATE_CBOR, cborBuff, cborLen);
+#endif
+        tmpBuff = formatDevAggrJson(DevReg_get(devIdx), devIdx);
+        Aggr_reset(devIdx);
+    }
+    else
+    {
+#if CBOR_UPDATES
+        cborBuff = formatDevCbor(DevReg_get(devIdx), -1, &cborLen);
+        publishCbor(CloudServiceEvt_DEV_UPDATE_CBOR, cborBuff, cborLen);
+#endif
+        tmpBuff = formatDevJson(DevReg_get(devIdx));
+    }
+    if(tmpBuff == NULL)
+    {
+        UART_PRINT("[Gateway Task] Update of device %d too large, dropped\n\r", devIdx);
+        return;
+    }
+    //SEND DATA TO CLOUD TASK
+    queueElementSend.event = CloudServiceEvt_DEV_UPDATE;
+    queueElementSend.msgPtr = tmpBuff;
+    queueElementSend.msgPtrLen = strlen(tmpBuff) + 1;
+    MsgLane_send(gatewayCloudMq, &queueElementSend);
+}
+
+void publishNwkSnapshot(void)
+{
+    msgQueue_t queueElementSend;
+    char *tmpBuff;
+    uint8_t extIdx;
+#if CBOR_UPDATES
+    uint8_t *cborBuff;
+    uint16_t cborLen;
+#endif
+
+    /* Nothing to describe until the collector reported the network */
+    for(extIdx = 0; extIdx < 8; extIdx++)
+    {
+        if(nwkInfo.extAddr[extIdx] != 0)
+        {
+            break;
+        }
+    }
+    if(extIdx == 8)
+    {
+        return;
+    }
+
+#if CBOR_UPDATES
+    cborBuff = formatNwkCbor(&nwkInfo, nwkVersion, &cborLen);
+    publishCbor(CloudServiceEvt_NWK_UPDATE_CBOR, cborBuff, cborLen);
+#endif
+    tmpBuff = formatNwkJson(&nwkInfo, nwkVersion);
+    //SEND DATA TO CLOUD TASK
+    queueElementSend.event = CloudServiceEvt_NWK_UPDATE;
+    queueElementSend.msgPtr = tmpBuff;
+    queueElementSend.msgPtrLen = strlen(tmpBuff) + 1;
+    MsgLane_send(gatewayCloudMq, &queueElementSend);
+}
+
+void publishNwkDelta(NwkDelta_op_t op, dev_t *pDev)
+{
+    msgQueue_t queueElementSend;
+    char *tmpBuff;
+#if CBOR_UPDATES
+    uint8_t *cborBuff;
+    uint16_t cborLen;
+#endif
+
+    /* A delta lost on the way shows up as a gap in the versions, the
+     * consumer then asks for a snapshot                                     */
+    nwkVersion++;
+#if CBOR_UPDATES
+    cborBuff = formatNwkDeltaCbor(&nwkInfo, pDev, op, nwkVersion, &cborLen);
+    publishCbor(CloudServiceEvt_NWK_DELTA_CBOR, cborBuff, cborLen);
+#endif
+    tmpBuff = formatNwkDeltaJson(&nwkInfo, pDev, op, nwkVersion);
+    //SEND DATA TO CLOUD TASK
+    queueElementSend.event = CloudServiceEvt_NWK_DELTA;
+    queueElementSend.msgPtr = tmpBuff;
+    queueElementSend.msgPtrLen = strlen(tmpBuff) + 1;
+    MsgLane_send(gatewayCloudMq, &queueElementSend);
+}
+
+void publishCbor(uint8_t event, uint8_t *pBuf, uint16_t len)
+{
+    msgQueue_t queueElementSend;
+
+    if(pBuf == NULL)
+    {
+        UART_PRINT("[Gateway Task] CBOR update 0x%02x too large, dropped\n\r", event);
+        return;
+    }
+    /* Binary payload, the length is carried by the message */
+    queueElementSend.event = event;
+    queueElementSend.msgPtr = pBuf;
+    queueElementSend.msgPtrLen = len;
+    MsgLane_send(gatewayCloudMq, &queueElementSend);
+}
+
+void publishExpiredAggr(void)
+{
+    int devIdx;
+
+    /* What is left is published on a later poll */
+    while(!MsgLane_congested(gatewayCloudMq, MsgLane_class_telemetry) &&
+          ((devIdx = Aggr_nextExpired()) != -1))
+    {
+        if(DevReg_get(devIdx) != NULL)
+        {
+            publishDevUpdate(devIdx);
+        }
+        else
+        {
+            Aggr_reset(devIdx);
+        }
+    }
+}
+
+void publishDelivery(Delivery_outcome_t *pOutcome)
+{
+    msgQueue_t queueElementSend;
+    char *tmpBuff;
+    dev_t *pDev = DevReg_get(DevReg_findShort(pOutcome->shortAddr));
+
+    /* The cloud files the outcome under the device it was sent to */
+    if(pDev == NULL)
+    {
+        return;
+    }
+
+    tmpBuff = formatDeliveryJson(pOutcome, pDev, Util_getTimeMs());
+    //SEND DATA TO CLOUD TASK
+    queueElementSend.event = CloudServiceEvt_CMD_DELIVERY;
+    queueElementSend.msgPtr = tmpBuff;
+    queueElementSend.msgPtrLen = strlen(tmpBuff) + 1;
+    MsgLane_send(gatewayCloudMq, &queueElementSend);
+}
+
+void publishRamp(RampBench_frame_t *pFrame)
+{
+    msgQueue_t queueElementSend;
+    char *tmpBuff;
+
+    RampBench_stamp(RampBench_stage_gateway, pFrame);
+    tmpBuff = formatRampJson(pFrame, Util_getTimeMs());
+    RampBench_stamp(RampBench_stage_json, pFrame);
+    //SEND DATA TO CLOUD TASK
+    queueElementSend.event = CloudServiceEvt_RAMP_DATA;
+    queueElementSend.msgPtr = tmpBuff;
+    queueElementSend.msgPtrLen = strlen(tmpBuff) + 1;
+    MsgLane_send(gatewayCloudMq, &queueElementSend);
+}
+
+void printRampReport(RampBench_report_t *pReport)
+{
+    static const char *stageStrs[RAMPBENCH_NUM_STAGES] =
+        {"collector", "gateway", "json", "cloud"};
+
+    UART_PRINT("\n\r[Gateway Task] Ramp step %d: %d frames/s offered:%d%s\n\r",
+               pReport->step, pReport->rate, pReport->offered,
+               pReport->saturated ? " SATURATED" : "");
+    for(int stage = 0; stage < RAMPBENCH_NUM_STAGES; stage++)
+    {
+        RampBench_stageStats_t *pStats = &pReport->stage[stage];
+        UART_PRINT("[Gateway Task] Ramp %-9s received:%d goodput:%d/s loss:%d%% "
+                   "latency p50:%dms p90:%dms p99:%dms max:%dms\n\r",
+                   stageStrs[stage], pStats->received, pStats->goodput,
+                   pStats->loss, pStats->p50, pStats->p90, pStats->p99,
+                   pStats->max);
+    }
+    if(pReport->done)
+    {
+        UART_PRINT("[Gateway Task] Ramp benchmark done\n\r");
+    }
+}
+
+void printJsonBench(void)
+{
+    static const uint8_t objectCounts[3] = {1, 3, MAX_NUM_OF_OBJECTS};
+    JsonBench_result_t result;
+
+    for(int run = 0; run < 3; run++)
+    {
+        JsonBench_run(JSONBENCH_ITERATIONS, objectCounts[run], &result);
+        UART_PRINT("[Gateway Task] JSON %d objects %dB: sprintf:%dns writer:%dns "
+                   "writer to buffer:%dns%s\n\r",
+                   result.objectCount, result.len, result.sprintfNs,
+                   result.writerNs, result.bufferNs,
+                   result.same ? "" : " OUTPUT DIFFERS");
+        UART_PRINT("[Gateway Task] CBOR %d objects %dB: writer:%dns\n\r",
+                   result.objectCount, result.cborLen, result.cborNs);
+    }
+}
+
+void printRegBench(void)
+{
+    static const uint8_t deviceCounts[3] = {25, 100, 250};
+    RegBench_result_t result;
+
+    for(int run = 0; run < 3; run++)
+    {
+        if(!RegBench_run(REGBENCH_ITERATIONS, deviceCounts[run], &result))
+        {
+            UART_PRINT("[Gateway Task] Registry benchmark: no memory\n\r");
+            break;
+        }
+        UART_PRINT("[Gateway Task] Registry %d devices: lookup hash:%dns "
+                   "linear:%dns update hash:%dns linear:%dns\n\r",
+                   result.numDevices, result.hashLookupNs,
+                   result.linearLookupNs, result.hashUpdateNs,
+                   result.linearUpdateNs);
+        /* Larger counts need MAX_NUM_OF_DEVICES raised */
+        if(result.numDevices < deviceCounts[run])
+        {
+            break;
+        }
+    }
+}
+
+void printLaneStats(void)
+{
+    static const char *classNames[MsgLane_class_NUM] =
+    {
+        "telemetry", "state", "actuator", "control"
+    };
+    /* Losses and waits printed so far, per lane and class */
+    static uint32_t reported[2][MsgLane_class_NUM];
+    MsgLane_t *lanes[2] = {gatewayMq, gatewayCloudMq};
+    MsgLane_stats_t stats;
+
+    for(int laneIdx = 0; laneIdx < 2; laneIdx++)
+    {
+        for(int msgClass = 0; msgClass < MsgLane_class_NUM; msgClass++)
+        {
+            MsgLane_getStats(lanes[laneIdx], (MsgLane_class_t)msgClass, &stats);
+            if(stats.dropped + stats.coalesced + stats.blocked +
+               stats.spared == reported[laneIdx][msgClass])
+            {
+                continue;
+            }
+            reported[laneIdx][msgClass] = stats.dropped + stats.coalesced +
+                                          stats.blocked + stats.spared;
+            UART_PRINT("[Gateway Task] Lane %s %s: sent:%d dropped:%d "
+                       "coalesced:%d blocked:%d spared:%d peak:%d\n\r",
+                       MsgLane_name(lanes[laneIdx]), classNames[msgClass],
+                       stats.sent, stats.dropped, stats.coalesced,
+                       stats.blocked, stats.spared, stats.peak);
+        }
+    }
+}
+
+void printQueueStats(void)
+{
+    static uint32_t printedWindow = 0;
+    static MqStats_snapshot_t snapshot[MQSTATS_MAX_QUEUES];
+    uint32_t window = MqStats_tick();
+    uint8_t count;
+
+    /* Once per window, for the queues that were used in it */
+    if(window == printedWindow)
+    {
+        return;
+    }
+    printedWindow = window;
+    count = MqStats_snapshot(snapshot, MQSTATS_MAX_QUEUES);
+    for(uint8_t queueIdx = 0; queueIdx < count; queueIdx++)
+    {
+        if((snapshot[queueIdx].rate == 0) && (snapshot[queueIdx].depth == 0))
+        {
+            continue;
+        }
+        DBG_PRINT("[Gateway Task] Queue %s: depth:%d/%d peak:%d/%d sent:%d "
+                  "recv:%d fail:%d rate:%d.%d/s wait p50:%d p90:%d p99:%d "
+                  "max:%dms\n\r", snapshot[queueIdx].pName,
+                  snapshot[queueIdx].depth, snapshot[queueIdx].capacity,
+                  snapshot[queueIdx].windowPeak, snapshot[queueIdx].peak,
+                  snapshot[queueIdx].sent, snapshot[queueIdx].received,
+                  snapshot[queueIdx].sendFailed, snapshot[queueIdx].rate / 10,
+                  snapshot[queueIdx].rate % 10, snapshot[queueIdx].waitP50,
+                  snapshot[queueIdx].waitP90, snapshot[queueIdx].waitP99,
+                  snapshot[queueIdx].waitMax);
+    }
+}
+
+void printAdmitStats(void)
+{
+    /* Admission counters and returned devices printed so far */
+    static uint32_t reported = 0;
+    static uint32_t reportedRecovery = 0;
+    Cllc_admitStats_t stats;
+    uint32_t total;
+    bool recovered;
+
+    Cllc_getAdmitStats(&stats);
+    total = stats.numKnown + stats.numAdmitted + stats.numDeferred +
+            stats.numAtCapacity + stats.numReturned;
+    if((total == reported) && (stats.recoveryTime == reportedRecovery))
+    {
+        return;
+    }
+    recovered = (stats.recoveryTime != reportedRecovery);
+    reported = total;
+    reportedRecovery = stats.recoveryTime;
+
+    UART_PRINT("[Gateway Task] Admission known:%d admitted:%d deferred:%d "
+               "at capacity:%d returned:%d/%d\n\r", stats.numKnown,
+               stats.numAdmitted, stats.numDeferred, stats.numAtCapacity,
+               stats.numReturned, stats.numRestored);
+    if(recovered && (stats.recoveryTime != 0))
+    {
+        UART_PRINT("[Gateway Task] Network recovered in %dms\n\r",
+                   stats.recoveryTime);
     }
 }
 
-int listDevUpdate(dev_t *newDev)
+static MsgLane_class_t gatewayMsgClass(const msgQueue_t *pMsg)
 {
-    int devIdx = devSearchShort(newDev->shortAddr);
-    if(devIdx != -1)
+    switch(pMsg->event)
     {
-        devList[devIdx].active = newDev->active;
-        memcpy(devList[devIdx].object, newDev->object, sizeof(smartObject_t)*newDev->objectCount);
-        devList[devIdx].objectCount = newDev->objectCount;
-        devList[devIdx].rssi = newDev->rssi;
-        return devIdx;
+    case GatewayEvent_SENSOR_DATA_UPDATE:
+    case GatewayEvent_RAMP_DATA:
+        return MsgLane_class_telemetry;
+    case GatewayEvent_NWK_UPDATE:
+    case GatewayEvent_DEV_UPDATE:
+    case GatewayEvent_DEV_CNF_UPDATE:
+    case GatewayEvent_DEV_NOT_ACTIVE:
+    case GatewayEvent_NWK_STATE_CHANGE:
+    case GatewayEvent_OAD_UPDATE:
+    case GatewayEvent_DELIVERY_UPDATE:
+    case GatewayEvent_RAMP_REPORT:
+    case GatewayEvent_DEV_REMOVED:
+        return MsgLane_class_state;
+    case GatewayEvent_PERMIT_JOIN:
+    case GatewayEvent_DEVICE_CMD:
+        return MsgLane_class_actuator;
+    default:
+        /* Provisioning, WLAN, time and snapshot requests */
+        return MsgLane_class_control;
     }
-    devIdx = devSearchExt(newDev->extAddr);
-    if(devIdx != -1)
+}
+
+static uint32_t gatewayMsgKey(const msgQueue_t *pMsg)
+{
+    /* Only the latest data of a device matters, ramp frames are counted */
+    if(pMsg->event == GatewayEvent_SENSOR_DATA_UPDATE)
     {
-        memcpy(&devList[devIdx], newDev, sizeof(dev_t));
-        return devIdx;
+        return ((dev_t*) pMsg->msgPtr)->shortAddr;
     }
-    devIdx = nwkInfo.devCount++;
-    memcpy(&devList[devIdx], newDev, sizeof(dev_t));
-    return devIdx;
+    return MSGLANE_NO_KEY;
 }
 
+static void gatewayMsgSuperseded(const msgQueue_t *pMsg)
+{
+    /* The aggregator sees every sample, also those never published */
+    if(pMsg->event == GatewayEvent_SENSOR_DATA_UPDATE)
+    {
+        Aggr_addSuperseded((dev_t*) pMsg->msgPtr);
+    }
+}
+
+/* Documents carry the time their data were received, the wall clock is
+ * only formatted for the log where it is printed                            */
+char *timeStr(void)
+{
+    time_t ts = time(NULL);
+    return ctime(&ts);
+}
@@ -67,8 +67,6 @@ extern "C"
  */
 extern void *gatewayMainThread(void *pvParameters);
 
-extern void startNTP(void);
-
 //*****************************************************************************
 //
 // Mark the end of the C bindings section for C++ compilers.
@@ -0,0 +1,313 @@
+/******************************************************************************
+
+ @file gtwayCbor.c
+
+ @brief CBOR encoding of device and network updates
+
+ Group: WCS LPC
+ Target Device: CC13xx CC32xx
+
+ ******************************************************************************
+
+ Copyright (c) 2016-2017, Texas Instruments Incorporated
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions
+ are met:
+
+ *  Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+
+ *  Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+
+ *  Neither the name of Texas Instruments Incorporated nor the names of
+    its contributors may be used to endorse or promote products derived
+    from this software without specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+ ******************************************************************************
+ Release Name:
+ Release Date:
+ *****************************************************************************/
+
+/******************************************************************************
+ Includes
+ *****************************************************************************/
+#include <string.h>
+#include <stdlib.h>
+#include <Common/commonDefs.h>
+#include <Utils/cbor.h>
+#include <Collector/delivery.h>
+#include <Collector/linkStats.h>
+#include <Collector/rampBench.h>
+#include "aggregator.h"
+#include "devRegistry.h"
+#include "startsntp.h"
+#include "gtwayJson.h"
+#include "gtwayCbor.h"
+
+/******************************************************************************
+ Constants and definitions
+ *****************************************************************************/
+
+/* Largest encodings: device update without objects, object with aggregated
+ * samples, network members, and a device of the network document */
+#define DEV_UPDT_CBOR_LEN   70
+#define DEV_OBJ_CBOR_LEN    45
+#define NWK_UPDT_CBOR_LEN   50
+#define DEV_LIST_CBOR_LEN   20
+
+/******************************************************************************
+ Local function prototypes
+ *****************************************************************************/
+static void putExtAddr(CborWriter_t *pWriter, const uint8_t *pExtAddr);
+static void putNwkFields(CborWriter_t *pWriter, nwk_t *nwkInfo);
+static void putDevListItem(CborWriter_t *pWriter, dev_t *device);
+static uint8_t *finish(CborWriter_t *pWriter, uint16_t *pLen);
+
+/******************************************************************************
+ Public Functions
+ *****************************************************************************/
+
+/*!
+ Encode a device update
+
+ Public function defined in gtwayCbor.h
+ */
+uint8_t* formatDevCbor(dev_t *device, int devIdx, uint16_t *pLen)
+{
+    uint16_t size = DEV_UPDT_CBOR_LEN + (device->objectCount * DEV_OBJ_CBOR_LEN);
+    CborWriter_t writer;
+
+    CborWriter_init(&writer, (uint8_t*) malloc(size), size);
+    formatDevCborTo(&writer, device, devIdx);
+
+    return finish(&writer, pLen);
+}
+
+/*!
+ Encode a device update with a CBOR writer
+
+ Public function defined in gtwayCbor.h
+ */
+bool formatDevCborTo(CborWriter_t *pWriter, dev_t *device, int devIdx)
+{
+    aggrStats_t *stats = NULL;
+    LinkStats_entry_t link;
+    bool hasLink = LinkStats_get(device->shortAddr, &link);
+
+    CborWriter_map(pWriter, hasLink ? 7 : 6);
+    CborWriter_uint(pWriter, CborKey_active);
+    CborWriter_bool(pWriter, device->active);
+    CborWriter_uint(pWriter, CborKey_shortAddr);
+    CborWriter_uint(pWriter, device->shortAddr);
+    CborWriter_uint(pWriter, CborKey_extAddr);
+    putExtAddr(pWriter, device->extAddr);
+    CborWriter_uint(pWriter, CborKey_rssi);
+    CborWriter_int(pWriter, device->rssi);
+    if(hasLink)
+    {
+        CborWriter_uint(pWriter, CborKey_link);
+        CborWriter_map(pWriter, 5);
+        CborWriter_uint(pWriter, CborKey_rssi);
+        CborWriter_int(pWriter, link.rssiAvg / 16);
+        CborWriter_uint(pWriter, CborKey_lqi);
+        CborWriter_uint(pWriter, link.lqiAvg / 16);
+        CborWriter_uint(pWriter, CborKey_delivery);
+        CborWriter_uint(pWriter, LinkStats_deliveryRatio(&link));
+        CborWriter_uint(pWriter, CborKey_txFrames);
+        CborWriter_uint(pWriter, link.txAttempts);
+        CborWriter_uint(pWriter, CborKey_rxFrames);
+        CborWriter_uint(pWriter, link.rxFrames);
+    }
+    CborWriter_uint(pWriter, CborKey_objects);
+    CborWriter_array(pWriter, device->objectCount);
+    for(int objIdx = 0; objIdx < device->objectCount; objIdx++)
+    {
+        smartObject_t *pObj = &device->object[objIdx];
+
+        if(devIdx != -1)
+        {
+            stats = Aggr_getStats(devIdx, objIdx);
+        }
+        CborWriter_map(pWriter, stats ? 7 : 3);
+        CborWriter_uint(pWriter, CborKey_typeId);
+        CborWriter_uint(pWriter, pObj->typeId);
+        CborWriter_uint(pWriter, CborKey_value);
+        CborWriter_int(pWriter, stats ? stats->last : pObj->sensorVal);
+        CborWriter_uint(pWriter, CborKey_unit);
+        CborWriter_text(pWriter, pObj->unit);
+        if(stats)
+        {
+            CborWriter_uint(pWriter, CborKey_min);
+            CborWriter_int(pWriter, stats->min);
+            CborWriter_uint(pWriter, CborKey_max);
+            CborWriter_int(pWriter, stats->max);
+            CborWriter_uint(pWriter, CborKey_mean);
+            CborWriter_int(pWriter, stats->sum / stats->count);
+            CborWriter_uint(pWriter, CborKey_count);
+            CborWriter_uint(pWriter, stats->count);
+        }
+    }
+    CborWriter_uint(pWriter, CborKey_time);
+    CborWriter_uint(pWriter, Ntp_toUtcMs(device->rxTime));
+
+    return (CborWriter_finish(pWriter) >= 0);
+}
+
+/*!
+ Encode a snapshot of the network document
+
+ Public function defined in gtwayCbor.h
+ */
+uint8_t* formatNwkCbor(nwk_t *nwkInfo, uint32_t version, uint16_t *pLen)
+{
+    uint16_t size = NWK_UPDT_CBOR_LEN + (DevReg_count() * DEV_LIST_CBOR_LEN);
+    CborWriter_t writer;
+    int handle = -1;
+
+    CborWriter_init(&writer, (uint8_t*) malloc(size), size);
+    CborWriter_map(&writer, 9);
+    CborWriter_uint(&writer, CborKey_version);
+    CborWriter_uint(&writer, version);
+    putNwkFields(&writer, nwkInfo);
+    CborWriter_uint(&writer, CborKey_devices);
+    CborWriter_array(&writer, DevReg_count());
+    while((handle = DevReg_next(handle)) != -1)
+    {
+        putDevListItem(&writer, DevReg_get(handle));
+    }
+
+    return finish(&writer, pLen);
+}
+
+/*!
+ Encode a change to the network document
+
+ Public function defined in gtwayCbor.h
+ */
+uint8_t* formatNwkDeltaCbor(nwk_t *nwkInfo, dev_t *device, NwkDelta_op_t op,
+                            uint32_t version, uint16_t *pLen)
+{
+    uint16_t size = NWK_UPDT_CBOR_LEN + DEV_LIST_CBOR_LEN;
+    CborWriter_t writer;
+
+    CborWriter_init(&writer, (uint8_t*) malloc(size), size);
+    CborWriter_map(&writer, 3);
+    CborWriter_uint(&writer, CborKey_version);
+    CborWriter_uint(&writer, version);
+    CborWriter_uint(&writer, CborKey_op);
+    CborWriter_uint(&writer, op);
+    if(op == NwkDelta_nwk)
+    {
+        CborWriter_uint(&writer, CborKey_nwk);
+        CborWriter_map(&writer, 7);
+        putNwkFields(&writer, nwkInfo);
+    }
+    else
+    {
+        CborWriter_uint(&writer, CborKey_device);
+        putDevListItem(&writer, device);
+    }
+
+    return finish(&writer, pLen);
+}
+
+/******************************************************************************
+ Local Functions
+ *****************************************************************************/
+
+/*!
+ * @brief       Write an extended address, most significant byte first as
+ *              it is shown in the JSON documents
+ *
+ * @param       pWriter - writer
+ * @param       pExtAddr - extended address, least significant byte first
+ */
+static void putExtAddr(CborWriter_t *pWriter, const uint8_t *pExtAddr)
+{
+    uint8_t extAddr[APIMAC_SADDR_EXT_LEN];
+
+    for(int idx = 0; idx < APIMAC_SADDR_EXT_LEN; idx++)
+    {
+        extAddr[idx] = pExtAddr[APIMAC_SADDR_EXT_LEN - 1 - idx];
+    }
+    CborWriter_bytes(pWriter, extAddr, APIMAC_SADDR_EXT_LEN);
+}
+
+/*!
+ * @brief       Write the 7 pairs describing the network itself
+ *
+ * @param       pWriter - writer
+ * @param       nwkInfo - network
+ */
+static void putNwkFields(CborWriter_t *pWriter, nwk_t *nwkInfo)
+{
+    CborWriter_uint(pWriter, CborKey_channel);
+    CborWriter_uint(pWriter, nwkInfo->channel);
+    CborWriter_uint(pWriter, CborKey_panId);
+    CborWriter_uint(pWriter, nwkInfo->panId);
+    CborWriter_uint(pWriter, CborKey_shortAddr);
+    CborWriter_uint(pWriter, nwkInfo->shortAddr);
+    CborWriter_uint(pWriter, CborKey_extAddr);
+    putExtAddr(pWriter, nwkInfo->extAddr);
+    CborWriter_uint(pWriter, CborKey_security);
+    CborWriter_bool(pWriter, nwkInfo->security_enable);
+    CborWriter_uint(pWriter, CborKey_mode);
+    CborWriter_bool(pWriter, nwkInfo->mode);
+    CborWriter_uint(pWriter, CborKey_state);
+    CborWriter_uint(pWriter, nwkInfo->state);
+}
+
+/*!
+ * @brief       Write the entry of a device in the device list
+ *
+ * @param       pWriter - writer
+ * @param       device - device
+ */
+static void putDevListItem(CborWriter_t *pWriter, dev_t *device)
+{
+    CborWriter_map(pWriter, 3);
+    CborWriter_uint(pWriter, CborKey_active);
+    CborWriter_bool(pWriter, device->active);
+    CborWriter_uint(pWriter, CborKey_shortAddr);
+    CborWriter_uint(pWriter, device->shortAddr);
+    CborWriter_uint(pWriter, CborKey_extAddr);
+    putExtAddr(pWriter, device->extAddr);
+}
+
+/*!
+ * @brief       End an encoding made in an allocated buffer
+ *
+ * @param       pWriter - writer
+ * @param       pLen - length of the encoding
+ *
+ * @return      the buffer, NULL if the encoding did not fit or the buffer
+ *              could not be allocated
+ */
+static uint8_t *finish(CborWriter_t *pWriter, uint16_t *pLen)
+{
+    int32_t len = CborWriter_finish(pWriter);
+
+    if(len < 0)
+    {
+        free(pWriter->pBuf);
+        return NULL;
+    }
+    *pLen = (uint16_t)len;
+    return pWriter->pBuf;
+}
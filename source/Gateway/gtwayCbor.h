@@ -0,0 +1,176 @@
+/******************************************************************************
+
+ @file gtwayCbor.h
+
+ @brief CBOR encoding of device and network updates
+
+ Group: WCS LPC
+ Target Device: CC13xx CC32xx
+
+ ******************************************************************************
+
+ Copyright (c) 2016-2017, Texas Instruments Incorporated
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions
+ are met:
+
+ *  Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+
+ *  Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+
+ *  Neither the name of Texas Instruments Incorporated nor the names of
+    its contributors may be used to endorse or promote products derived
+    from this software without specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+ ******************************************************************************
+ Release Name:
+ Release Date:
+ *****************************************************************************/
+
+#ifndef GATEWAY_GTWAYCBOR_H_
+#define GATEWAY_GTWAYCBOR_H_
+
+//*****************************************************************************
+//
+// If building with a C++ compiler, make all of the definitions in this header
+// have a C binding.
+//
+//*****************************************************************************
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#include <Utils/cbor.h>
+
+/*!
+ Keys of the CBOR updates. The documents are maps with these integer keys
+ in place of the JSON member names, so each key below 24 takes one byte.
+
+ Device update: active, shortAddr, extAddr (8 bytes, most significant
+ first), rssi, link when the collector has link statistics of the device,
+ objects, time. Link is a map with rssi and lqi averages, delivery (percent
+ of frames to the device acknowledged), txFrames and rxFrames. Objects is an array of maps with typeId (IPSO
+ object ID), value and unit, plus min, max, mean and count for an
+ aggregation window. Time is in milliseconds since 1970, or since the
+ gateway started when the clock is not set.
+
+ Network snapshot: version, channel, panId, shortAddr, extAddr, security,
+ mode (true for frequency hopping), state (Cllc_states_t) and devices, an
+ array of maps with active, shortAddr and extAddr.
+
+ Network delta: version, op (NwkDelta_op_t) and either device, a map as in
+ the devices array, or nwk, a map with the network members of a snapshot.
+ */
+typedef enum
+{
+    CborKey_active = 0,
+    CborKey_shortAddr = 1,
+    CborKey_extAddr = 2,
+    CborKey_rssi = 3,
+    CborKey_objects = 4,
+    CborKey_typeId = 5,
+    CborKey_value = 6,
+    CborKey_unit = 7,
+    CborKey_min = 8,
+    CborKey_max = 9,
+    CborKey_mean = 10,
+    CborKey_count = 11,
+    CborKey_time = 12,
+    CborKey_version = 13,
+    CborKey_channel = 14,
+    CborKey_panId = 15,
+    CborKey_security = 16,
+    CborKey_mode = 17,
+    CborKey_state = 18,
+    CborKey_devices = 19,
+    CborKey_op = 20,
+    CborKey_device = 21,
+    CborKey_nwk = 22,
+    CborKey_link = 23,
+    CborKey_lqi = 24,
+    CborKey_delivery = 25,
+    CborKey_txFrames = 26,
+    CborKey_rxFrames = 27
+} CborKey_t;
+
+/*!
+ * @brief       Encode a device update, with the aggregated samples of the
+ *              device if it has any
+ *
+ * @param       device - device to encode
+ * @param       devIdx - index of the device in the gateway device list, -1
+ *                       for the last values only
+ * @param       pLen - length of the encoding
+ *
+ * @return      allocated encoding, to be freed by the caller, NULL if the
+ *              update did not fit
+ */
+uint8_t* formatDevCbor(dev_t *device, int devIdx, uint16_t *pLen);
+
+/*!
+ * @brief       Encode a device update with a CBOR writer, e.g. straight
+ *              into a transport buffer
+ *
+ * @param       pWriter - writer, initialized by the caller
+ * @param       device - device to encode
+ * @param       devIdx - as for formatDevCbor
+ *
+ * @return      false if the encoding was truncated
+ */
+bool formatDevCborTo(CborWriter_t *pWriter, dev_t *device, int devIdx);
+
+/*!
+ * @brief       Encode a snapshot of the network document
+ *
+ * @param       nwkInfo - network
+ * @param       version - version of the document
+ * @param       pLen - length of the encoding
+ *
+ * @return      allocated encoding, to be freed by the caller, NULL if the
+ *              snapshot did not fit
+ */
+uint8_t* formatNwkCbor(nwk_t *nwkInfo, uint32_t version, uint16_t *pLen);
+
+/*!
+ * @brief       Encode a change to the network document
+ *
+ * @param       nwkInfo - network, used by NwkDelta_nwk
+ * @param       device - device added, updated or removed
+ * @param       op - kind of change
+ * @param       version - version of the document after the change
+ * @param       pLen - length of the encoding
+ *
+ * @return      allocated encoding, to be freed by the caller, NULL if the
+ *              delta did not fit
+ */
+uint8_t* formatNwkDeltaCbor(nwk_t *nwkInfo, dev_t *device, NwkDelta_op_t op,
+                            uint32_t version, uint16_t *pLen);
+
+//*****************************************************************************
+//
+// Mark the end of the C bindings section for C++ compilers.
+//
+//*****************************************************************************
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* GATEWAY_GTWAYCBOR_H_ */
@@ -48,12 +48,24 @@
 #include <stdio.h>
 #include <Common/commonDefs.h>
 #include <Utils/util.h>
+#include <Utils/jsonWriter.h>
+#include <Collector/delivery.h>
+#include <Collector/linkStats.h>
+#include <Collector/rampBench.h>
+#include "aggregator.h"
+#include "devRegistry.h"
+#include "startsntp.h"
+#include "gtwayJson.h"
 
 #define DEV_LIST_CHAR_LEN   285
 #define NWK_UPDT_CHAR_LEN   270
 #define DEV_OBJ_CHAR_LEN    100
-#define DEV_UPDT_CHAR_LEN   130
-#define TIMESTAMP_CHAR_LEN  18 + 26 // "last_reported": 18 chars, + 26 of actual date and time info
+#define TIME_VALUE_CHAR_LEN 26
+#define DEV_AGGR_OBJ_CHAR_LEN 170
+#define DEV_UPDT_CHAR_LEN   220
+#define DELIVERY_UPDT_CHAR_LEN 180
+#define RAMP_DATA_CHAR_LEN  50
+#define DAYS_0000_TO_1970   719468  // days from 0000-03-01 to 1970-01-01
 
 //*****************************************************************************
 //                 Constant VARIABLES
@@ -62,89 +74,285 @@ const char *secStrs[2] = {"0", "1"};
 const char *modeStrs[2] = {"beacon", "frequency hopping"};
 const char *stateStrs[7] = {"waiting", "starting", "restoring", "started", "restored", "open", "close"};
 const char *activeStrs[2] = {"false", "true"};
+const char *deliveryStrs[4] = {"delivered", "failed", "expired", "superseded"};
+const char *deltaOpStrs[4] = {"add", "update", "remove", "nwk"};
 
-const char jsonDevList[] = "{\"name\":\"%s\",\"active\":\"true\",\"rssi\":-30,\"short_addr\":\"0x%04X\",\"ext_addr\":\"0x%x%08x\"}";
+const char jsonDevList[] = "{\"name\":\"%s\",\"active\":\"%s\",\"rssi\":-30,\"short_addr\":\"0x%04X\",\"ext_addr\":\"0x%x%08x\"}";
 //#if defined(USE_IBM_CLOUD)
 //const char *jsonNwkUpdateCmd ="{\"d\":{\"name\":\"%s\",\"channels\":\"%d\",\"pan_id\":\"0x%04X\",\"short_addr\":\"0x%04X\",\"ext_addr\":\"0x%08X%08X\",\"security_enabled\":\"%s\",\"mode\":\"%s\",\"state\":\"%s\",\"devices\":[%s]}}";
 //const char *jsonDevUpdateCmd ="{\"d\":{\"active\":\"%s\",\"ext_addr\":\"0x%08X%08X\",\"rssi\":\"%d\",\"smart_objects\":{%s}}}";
 //#elif defined(USE_AWS_CLOUD)
-const char *jsonNwkUpdateCmd ="{\"name\":\"%s\",\"channels\":\"%d\",\"pan_id\":\"0x%04X\",\"short_addr\":\"0x%04X\",\"ext_addr\":\"0x%x%08x\",\"security_enabled\":%s,\"mode\":\"%s\",\"state\":\"%s\",\"devices\":[%s]}";
+const char *jsonNwkFields ="\"name\":\"%s\",\"channels\":\"%d\",\"pan_id\":\"0x%04X\",\"short_addr\":\"0x%04X\",\"ext_addr\":\"0x%x%08x\",\"security_enabled\":%s,\"mode\":\"%s\",\"state\":\"%s\"";
+const char *jsonNwkVersion ="{\"version\":%u,";
+const char *jsonNwkDelta ="{\"version\":%u,\"op\":\"%s\",";
 const char *jsonDevUpdateCmd ="{\"active\":\"%s\",\"short_addr\":\"0x%04X\",\"ext_addr\":\"0x%x%08x\",\"rssi\":\"%d\",\"smart_objects\":{%s}}";
 //#endif
 const char *jsonDevObjects = "\"%s\":{\"%d\":{\"oid\":\"%s\",\"iid\":\"0\",\"sensorValue\":%d,\"units\":\"%s\"}}";
-const char *jsonTimeStamp = "\"%s\":\"%.24s\"";
+const char *jsonDevAggrObjects = "\"%s\":{\"%d\":{\"oid\":\"%s\",\"iid\":\"0\",\"sensorValue\":%d,\"units\":\"%s\",\"min\":%d,\"max\":%d,\"mean\":%d,\"count\":%d}}";
+const char *jsonIsoTimeStamp = "\"%04d-%02d-%02dT%02d:%02d:%02d.%03dZ\"";
+const char *jsonEpochTimeStamp = "%lu%03u";
+const char *jsonRampData = "{\"ramp\":{\"seq\":%u,\"ts\":%u},%s}";
+const char *jsonDeliveryUpdate = "{\"short_addr\":\"0x%04X\",\"ext_addr\":\"0x%x%08x\",\"cmd_delivery\":{\"cmd_type\":%d,\"result\":\"%s\",\"attempts\":%d,\"mac_status\":%d,\"elapsed_ms\":%d,%s}}";
 
-char* formatNwkJson(nwk_t *nwkInfo, dev_t *devList)
+/*!
+ * @brief       Format the value of the last_reported member. The time is
+ *              only turned into a date here, when the document is built.
+ *
+ * @param       pStr - buffer of at least TIME_VALUE_CHAR_LEN + 1 bytes
+ * @param       monoMs - Util_getTimeMs() of the event
+ *
+ * @return      number of characters written
+ */
+static int formatTimeValue(char *pStr, uint32_t monoMs)
 {
-    int devListStrLen = (nwkInfo->devCount*DEV_LIST_CHAR_LEN * sizeof(char)) + 1;
-    int nwkUpdtStrLen = devListStrLen + (NWK_UPDT_CHAR_LEN * sizeof(char));
-    uint32_t loBytes, hiBytes, nwkLoBytes, nwkHiBytes;
-    uint8_t *tempExtAddr;
+    uint64_t utcMs = Ntp_toUtcMs(monoMs);
+    uint32_t secs = (uint32_t)(utcMs / 1000);
+    uint32_t ms = (uint32_t)(utcMs % 1000);
+#if (JSON_TIME_FORMAT == JSON_TIME_EPOCH_MS)
+    if(secs == 0)
+    {
+        return sprintf(pStr, "%u", (unsigned int)ms);
+    }
+    return sprintf(pStr, jsonEpochTimeStamp, (unsigned long)secs, (unsigned int)ms);
+#else
+    /* civil date from days since 1970, eras of 400 years starting March 1st */
+    uint32_t days = (secs / 86400) + DAYS_0000_TO_1970;
+    uint32_t daySecs = secs % 86400;
+    uint32_t era = days / 146097;
+    uint32_t doe = days - (era * 146097);
+    uint32_t yoe = (doe - (doe / 1460) + (doe / 36524) - (doe / 146096)) / 365;
+    uint32_t doy = doe - ((365 * yoe) + (yoe / 4) - (yoe / 100));
+    uint32_t mp = ((5 * doy) + 2) / 153;
+    int day = (int)(doy - (((153 * mp) + 2) / 5) + 1);
+    int month = (int)((mp < 10) ? (mp + 3) : (mp - 9));
+    int year = (int)(yoe + (era * 400)) + ((month <= 2) ? 1 : 0);
+
+    return sprintf(pStr, jsonIsoTimeStamp, year, month, day, (int)(daySecs / 3600),
+                   (int)((daySecs / 60) % 60), (int)(daySecs % 60), (int)ms);
+#endif
+}
+
+void formatTimeStamp(char *pStr, uint32_t monoMs)
+{
+    pStr += sprintf(pStr, "\"%s\":", TIME_STAMP);
+    formatTimeValue(pStr, monoMs);
+}
+
+/*!
+ * @brief       Format the members describing the network itself
+ *
+ * @param       pStr - buffer of at least NWK_UPDT_CHAR_LEN bytes
+ * @param       nwkInfo - network
+ *
+ * @return      number of characters written
+ */
+static int formatNwkFields(char *pStr, nwk_t *nwkInfo)
+{
+    uint8_t *pExt = nwkInfo->extAddr;
+
+    return sprintf(pStr, jsonNwkFields, nwkInfo->name, nwkInfo->channel, nwkInfo->panId,
+                   nwkInfo->shortAddr, Util_buildUint32(pExt[4], pExt[5], pExt[6], pExt[7]),
+                   Util_buildUint32(pExt[0], pExt[1], pExt[2], pExt[3]),
+                   secStrs[(int)nwkInfo->security_enable], modeStrs[(int)nwkInfo->mode],
+                   stateStrs[(int)nwkInfo->state]);
+}
+
+/*!
+ * @brief       Format the entry of a device in the device list
+ *
+ * @param       pStr - buffer of at least DEV_LIST_CHAR_LEN bytes
+ * @param       device - device
+ *
+ * @return      number of characters written
+ */
+static int formatDevListItem(char *pStr, dev_t *device)
+{
+    uint8_t *pExt = device->extAddr;
+
+    return sprintf(pStr, jsonDevList, device->name, activeStrs[(int)device->active],
+                   device->shortAddr, Util_buildUint32(pExt[4], pExt[5], pExt[6], pExt[7]),
+                   Util_buildUint32(pExt[0], pExt[1], pExt[2], pExt[3]));
+}
+
+char* formatNwkJson(nwk_t *nwkInfo, uint32_t version)
+{
+    int nwkUpdtStrLen = (DevReg_count() * DEV_LIST_CHAR_LEN) + NWK_UPDT_CHAR_LEN;
+    int handle = -1;
     char *nwkString;
-    char *devListString;
     char *tempPtr;
+
+    /* Written in place, the device list is not built separately */
     nwkString = (char*) malloc(nwkUpdtStrLen);
-    devListString = (char*) malloc(devListStrLen);
-    devListString[0] = '\0';
-    tempPtr = devListString;
-
-    tempExtAddr = nwkInfo->extAddr;
-    nwkLoBytes = Util_buildUint32(*tempExtAddr++, *tempExtAddr++,*tempExtAddr++,*tempExtAddr++);
-    nwkHiBytes = Util_buildUint32(*tempExtAddr++, *tempExtAddr++,*tempExtAddr++,*tempExtAddr);
-    for(int devIdx = 0; devIdx < nwkInfo->devCount; devIdx++)
+    tempPtr = nwkString;
+    tempPtr += sprintf(tempPtr, jsonNwkVersion, (unsigned int)version);
+    tempPtr += formatNwkFields(tempPtr, nwkInfo);
+    tempPtr += sprintf(tempPtr, ",\"devices\":[");
+    while((handle = DevReg_next(handle)) != -1)
     {
-        tempExtAddr = devList[devIdx].extAddr;
-        loBytes = Util_buildUint32(*tempExtAddr++, *tempExtAddr++,*tempExtAddr++,*tempExtAddr++);
-        hiBytes = Util_buildUint32(*tempExtAddr++, *tempExtAddr++,*tempExtAddr++,*tempExtAddr);
-        sprintf(tempPtr, jsonDevList, devList[devIdx].name, devList[devIdx].shortAddr, hiBytes, loBytes);
-        if(devIdx < (nwkInfo->devCount - 1))
+        if(tempPtr[-1] != '[')
         {
-            strcat(tempPtr, ",");
+            *tempPtr++ = ',';
         }
-        tempPtr += strlen(tempPtr);
+        tempPtr += formatDevListItem(tempPtr, DevReg_get(handle));
     }
+    strcpy(tempPtr, "]}");
 
+    return nwkString;
+}
 
-    sprintf(nwkString, jsonNwkUpdateCmd, nwkInfo->name, nwkInfo->channel, nwkInfo->panId,
-            nwkInfo->shortAddr, nwkHiBytes, nwkLoBytes,
-            secStrs[(int)nwkInfo->security_enable], modeStrs[(int)nwkInfo->mode], stateStrs[(int)nwkInfo->state], devListString);
+char* formatNwkDeltaJson(nwk_t *nwkInfo, dev_t *device, NwkDelta_op_t op, uint32_t version)
+{
+    char *deltaString;
+    char *tempPtr;
 
-    free(devListString);
-    return nwkString;
+    deltaString = (char*) malloc(NWK_UPDT_CHAR_LEN + DEV_LIST_CHAR_LEN);
+    tempPtr = deltaString;
+    tempPtr += sprintf(tempPtr, jsonNwkDelta, (unsigned int)version, deltaOpStrs[(int)op]);
+    if(op == NwkDelta_nwk)
+    {
+        tempPtr += sprintf(tempPtr, "\"nwk\":{");
+        tempPtr += formatNwkFields(tempPtr, nwkInfo);
+        strcpy(tempPtr, "}}");
+    }
+    else
+    {
+        tempPtr += sprintf(tempPtr, "\"device\":");
+        tempPtr += formatDevListItem(tempPtr, device);
+        strcpy(tempPtr, "}");
+    }
+
+    return deltaString;
 }
 
-char* formatDevJson(dev_t *device, char *timeStamp)
+bool formatDevJsonTo(JsonWriter_t *pWriter, dev_t *device, int devIdx)
 {
-    int objListStrLen = TIMESTAMP_CHAR_LEN + (device->objectCount*DEV_OBJ_CHAR_LEN * sizeof(char)) + 1;
-    int devUpdtStrLen = objListStrLen + (DEV_UPDT_CHAR_LEN * sizeof(char));
-    char *devString;
-    char *objListString;
-    char *tempPtrStr;
-    uint32_t loBytes, hiBytes;
-    uint8_t *tempExtAddr;
-    devString = (char*) malloc(devUpdtStrLen);
-    objListString = (char*) malloc(objListStrLen);
-    tempPtrStr = objListString;
-    objListString[0] = '\0';
+    char timeValue[TIME_VALUE_CHAR_LEN + 1];
+    uint8_t *pExt = device->extAddr;
+    aggrStats_t *stats = NULL;
+    LinkStats_entry_t link;
+
+    JsonWriter_beginObject(pWriter, NULL);
+    JsonWriter_string(pWriter, "active", activeStrs[(int)device->active]);
+    JsonWriter_hex(pWriter, "short_addr", device->shortAddr, 4, true);
+    /* Same digits as "0x%x%08x" of the high and low words */
+    JsonWriter_hex(pWriter, "ext_addr",
+                   ((uint64_t)Util_buildUint32(pExt[4], pExt[5], pExt[6], pExt[7]) << 32) |
+                   Util_buildUint32(pExt[0], pExt[1], pExt[2], pExt[3]), 9, false);
+    JsonWriter_intString(pWriter, "rssi", device->rssi);
+    if(LinkStats_get(device->shortAddr, &link))
+    {
+        /* Link quality as seen by the collector since the device joined */
+        JsonWriter_beginObject(pWriter, "link");
+        JsonWriter_int(pWriter, "rssi", link.rssiAvg / 16);
+        JsonWriter_int(pWriter, "lqi", link.lqiAvg / 16);
+        JsonWriter_int(pWriter, "delivery", LinkStats_deliveryRatio(&link));
+        JsonWriter_int(pWriter, "tx", link.txAttempts);
+        JsonWriter_int(pWriter, "rx", link.rxFrames);
+        JsonWriter_endObject(pWriter);
+    }
+    JsonWriter_beginObject(pWriter, "smart_objects");
     for(int objIdx = 0; objIdx < device->objectCount; objIdx++)
     {
-        //sprintf(tempPtrStr, jsonDevObjects, device->object[objIdx].type, objIdx, device->object[objIdx].sensorVal);
-        sprintf(tempPtrStr, jsonDevObjects, device->object[objIdx].type, 0, device->object[objIdx].type, device->object[objIdx].sensorVal, device->object[objIdx].unit);
-        //if(objIdx < (device->objectCount - 1))
+        smartObject_t *pObj = &device->object[objIdx];
+
+        if(devIdx != -1)
+        {
+            stats = Aggr_getStats(devIdx, objIdx);
+        }
+        JsonWriter_beginObject(pWriter, pObj->type);
+        JsonWriter_beginObject(pWriter, "0");
+        JsonWriter_string(pWriter, "oid", pObj->type);
+        JsonWriter_string(pWriter, "iid", "0");
+        if(stats)
+        {
+            /* sensorValue keeps the last value so existing consumers are not affected */
+            JsonWriter_int(pWriter, "sensorValue", stats->last);
+            JsonWriter_string(pWriter, "units", pObj->unit);
+            JsonWriter_int(pWriter, "min", stats->min);
+            JsonWriter_int(pWriter, "max", stats->max);
+            JsonWriter_int(pWriter, "mean", (int32_t)(stats->sum / stats->count));
+            JsonWriter_int(pWriter, "count", stats->count);
+        }
+        else
         {
-            strcat(tempPtrStr, ",");
+            JsonWriter_int(pWriter, "sensorValue", pObj->sensorVal);
+            JsonWriter_string(pWriter, "units", pObj->unit);
         }
-        tempPtrStr += strlen(tempPtrStr);
+        JsonWriter_endObject(pWriter);
+        JsonWriter_endObject(pWriter);
+    }
+    /* time of the update, or of the last sample of the window */
+    JsonWriter_raw(pWriter, TIME_STAMP, timeValue,
+                   formatTimeValue(timeValue, device->rxTime));
+    JsonWriter_endObject(pWriter);
+    JsonWriter_endObject(pWriter);
+
+    return (JsonWriter_finish(pWriter) >= 0);
+}
+
+char* formatDevJson(dev_t *device)
+{
+    int devUpdtStrLen = DEV_UPDT_CHAR_LEN + TIMESTAMP_CHAR_LEN +
+                        (device->objectCount * DEV_OBJ_CHAR_LEN) + 1;
+    char *devString;
+    JsonWriter_t writer;
+
+    /* Written once, straight into the string handed to the cloud task */
+    devString = (char*) malloc(devUpdtStrLen);
+    JsonWriter_init(&writer, devString, devUpdtStrLen);
+    if(!formatDevJsonTo(&writer, device, -1))
+    {
+        free(devString);
+        return NULL;
     }
-    sprintf(tempPtrStr, jsonTimeStamp, TIME_STAMP, timeStamp);
+
+    return devString;
+}
+
+char* formatDevAggrJson(dev_t *device, int devIdx)
+{
+    int devUpdtStrLen = DEV_UPDT_CHAR_LEN + TIMESTAMP_CHAR_LEN +
+                        (device->objectCount * DEV_AGGR_OBJ_CHAR_LEN) + 1;
+    char *devString;
+    JsonWriter_t writer;
+
+    devString = (char*) malloc(devUpdtStrLen);
+    JsonWriter_init(&writer, devString, devUpdtStrLen);
+    if(!formatDevJsonTo(&writer, device, devIdx))
+    {
+        free(devString);
+        return NULL;
+    }
+
+    return devString;
+}
+
+char* formatDeliveryJson(Delivery_outcome_t *pOutcome, dev_t *device, uint32_t timeStamp)
+{
+    char *deliveryString;
+    char timeStampString[TIMESTAMP_CHAR_LEN + 1];
+    uint32_t loBytes, hiBytes;
+    uint8_t *tempExtAddr;
+    deliveryString = (char*) malloc(DELIVERY_UPDT_CHAR_LEN + TIMESTAMP_CHAR_LEN + 1);
+    formatTimeStamp(timeStampString, timeStamp);
     tempExtAddr = device->extAddr;
     loBytes = Util_buildUint32(*tempExtAddr++, *tempExtAddr++,*tempExtAddr++,*tempExtAddr++);
     hiBytes = Util_buildUint32(*tempExtAddr++, *tempExtAddr++,*tempExtAddr++,*tempExtAddr);
-    sprintf(devString, jsonDevUpdateCmd, activeStrs[(int)device->active], device->shortAddr, hiBytes, loBytes, device->rssi, objListString);
-    free(objListString);
+    sprintf(deliveryString, jsonDeliveryUpdate, pOutcome->shortAddr, hiBytes, loBytes, pOutcome->cmdType,
+            deliveryStrs[(int)pOutcome->result], pOutcome->attempts, pOutcome->lastStatus,
+            pOutcome->elapsedMs, timeStampString);
 
-    return devString;
+    return deliveryString;
 }
 
+char* formatRampJson(RampBench_frame_t *pFrame, uint32_t timeStamp)
+{
+    char *rampString;
+    char timeStampString[TIMESTAMP_CHAR_LEN + 1];
+    rampString = (char*) malloc(RAMP_DATA_CHAR_LEN + TIMESTAMP_CHAR_LEN + 1);
+    formatTimeStamp(timeStampString, timeStamp);
+    sprintf(rampString, jsonRampData, (unsigned int)pFrame->seqNum,
+            (unsigned int)pFrame->timestamp, timeStampString);
 
-
+    return rampString;
+}
@@ -58,25 +58,125 @@ extern "C"
 {
 #endif
 
+#include <Utils/jsonWriter.h>
+
+/*! Length of the last_reported member: 18 characters for the name and 26
+ * for the date and time                                                      */
+#define TIMESTAMP_CHAR_LEN  (18 + 26)
+
+/*! Formats of the last_reported member */
+#define JSON_TIME_ISO8601       0   /* "2018-01-01T00:00:00.000Z" */
+#define JSON_TIME_EPOCH_MS      1   /* milliseconds since 1970 as a number */
+
+#ifndef JSON_TIME_FORMAT
+#define JSON_TIME_FORMAT        JSON_TIME_ISO8601
+#endif
+
+/*! Change carried by a network document delta */
+typedef enum
+{
+    /*! A device joined */
+    NwkDelta_add,
+    /*! A device changed short address or became (in)active */
+    NwkDelta_update,
+    /*! A device left */
+    NwkDelta_remove,
+    /*! The network itself changed, e.g. its state */
+    NwkDelta_nwk
+} NwkDelta_op_t;
+
+/*!
+ * @brief       Format a snapshot of the network document: the network and
+ *              all devices of the registry
+ *
+ * @param       nwkInfo - network
+ * @param       version - version of the document
+ *
+ * @return      allocated JSON string, to be freed by the caller
+ */
+char* formatNwkJson(nwk_t *nwkInfo, uint32_t version);
+
+/*!
+ * @brief       Format a change to the network document. Each change bumps
+ *              the version by one, a consumer seeing a gap asks for a
+ *              snapshot.
+ *
+ * @param       nwkInfo - network, used by NwkDelta_nwk
+ * @param       device - device added, updated or removed
+ * @param       op - kind of change
+ * @param       version - version of the document after the change
+ *
+ * @return      allocated JSON string, to be freed by the caller
+ */
+char* formatNwkDeltaJson(nwk_t *nwkInfo, dev_t *device, NwkDelta_op_t op, uint32_t version);
+
 /*!
- * @brief
+ * @brief       Format a device update with the last value of each object
  *
+ * @param       device - device to format
  *
- * @param
+ * @return      allocated JSON string, to be freed by the caller, NULL if
+ *              the update did not fit
+ */
+char* formatDevJson(dev_t *device);
+
+/*!
+ * @brief       Format a device update carrying the min, max, mean, last
+ *              and sample count of each object aggregated in the current
+ *              window. Objects without samples use the formatDevJson layout.
+ *
+ * @param       device - device to format
+ * @param       devIdx - index of the device in the gateway device list
+ *
+ * @return      allocated JSON string, to be freed by the caller, NULL if
+ *              the update did not fit
+ */
+char* formatDevAggrJson(dev_t *device, int devIdx);
+
+/*!
+ * @brief       Write a device update with a JSON writer, e.g. straight into
+ *              a transport buffer or through a sink. The document is ended
+ *              with JsonWriter_finish().
+ *
+ * @param       pWriter - writer, initialized by the caller
+ * @param       device - device to format
+ * @param       devIdx - index of the device in the gateway device list to
+ *                       add its aggregated samples, -1 for the
+ *                       formatDevJson layout
  *
- * @return
+ * @return      false if the document was truncated
  */
-char* formatNwkJson(nwk_t *nwkInfo, dev_t *devList);
+bool formatDevJsonTo(JsonWriter_t *pWriter, dev_t *device, int devIdx);
 
 /*!
- * @brief
+ * @brief       Format the last_reported member of a document
  *
+ * @param       pStr - buffer of at least TIMESTAMP_CHAR_LEN + 1 bytes
+ * @param       monoMs - Util_getTimeMs() of the event
+ */
+void formatTimeStamp(char *pStr, uint32_t monoMs);
+
+/*!
+ * @brief       Format the final delivery outcome of a command sent to a
+ *              device
+ *
+ * @param       pOutcome - outcome reported by the delivery manager
+ * @param       device - device the command was sent to
+ * @param       timeStamp - Util_getTimeMs() of the update
+ *
+ * @return      allocated JSON string, to be freed by the caller
+ */
+char* formatDeliveryJson(Delivery_outcome_t *pOutcome, dev_t *device, uint32_t timeStamp);
+
+/*!
+ * @brief       Format a ramp benchmark frame
  *
- * @param
+ * @param       pFrame - benchmark frame
+ * @param       timeStamp - Util_getTimeMs() of the update
  *
- * @return
+ * @return      allocated JSON string, to be freed by the caller
  */
-char* formatDevJson(dev_t *device, char *timeStamp);
+char* formatRampJson(RampBench_frame_t *pFrame, uint32_t timeStamp);
 
 
 
@@ -0,0 +1,208 @@
+/******************************************************************************
+
+ @file jsonBench.c
+
+ @brief Microbenchmark of the device update formatting
+
+ Group: WCS LPC
+ Target Device: CC13xx CC32xx
+
+ ******************************************************************************
+
+ Copyright (c) 2016-2017, Texas Instruments Incorporated
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions
+ are met:
+
+ *  Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+
+ *  Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+
+ *  Neither the name of Texas Instruments Incorporated nor the names of
+    its contributors may be used to endorse or promote products derived
+    from this software without specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+ ******************************************************************************
+ Release Name:
+ Release Date:
+ *****************************************************************************/
+
+/******************************************************************************
+ Includes
+ *****************************************************************************/
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <Common/commonDefs.h>
+#include <Utils/util.h>
+#include <Utils/jsonWriter.h>
+#include <Utils/cbor.h>
+#include <Collector/delivery.h>
+#include <Collector/rampBench.h>
+#include "gtwayJson.h"
+#include "gtwayCbor.h"
+#include "jsonBench.h"
+
+/******************************************************************************
+ Constants and definitions
+ *****************************************************************************/
+
+/* Sizes and layouts of formatDevJson before the JSON writer */
+#define DEV_OBJ_CHAR_LEN    100
+#define DEV_UPDT_CHAR_LEN   220
+
+static const char *jsonDevUpdateCmd ="{\"active\":\"%s\",\"short_addr\":\"0x%04X\",\"ext_addr\":\"0x%x%08x\",\"rssi\":\"%d\",\"smart_objects\":{%s}}";
+static const char *jsonDevObjects = "\"%s\":{\"%d\":{\"oid\":\"%s\",\"iid\":\"0\",\"sensorValue\":%d,\"units\":\"%s\"}}";
+#define NUM_BENCH_TYPES     4
+
+static const char *benchTypes[NUM_BENCH_TYPES] = {TEMP_TYPE, LIGHT_TYPE, HUM_TYPE, PRESS_TYPE};
+static const char *benchUnits[NUM_BENCH_TYPES] = {"C", "Lumen", "%RH", "hPa"};
+static const uint16_t benchTypeIds[NUM_BENCH_TYPES] = {3303, 3301, 3304, 3315};
+
+/******************************************************************************
+ Local function prototypes
+ *****************************************************************************/
+static char *sprintfDevJson(dev_t *device);
+
+/******************************************************************************
+ Public Functions
+ *****************************************************************************/
+
+/*!
+ Format the same device update with each variant
+
+ Public function defined in jsonBench.h
+ */
+void JsonBench_run(uint16_t iterations, uint8_t objectCount,
+                   JsonBench_result_t *pResult)
+{
+    static dev_t device;
+    static char buffer[DEV_UPDT_CHAR_LEN + TIMESTAMP_CHAR_LEN +
+                       (MAX_NUM_OF_OBJECTS * DEV_OBJ_CHAR_LEN) + 1];
+    JsonWriter_t writer;
+    char *pOld;
+    char *pNew;
+    uint8_t *pCbor;
+    uint32_t startMs;
+
+    if(objectCount > MAX_NUM_OF_OBJECTS)
+    {
+        objectCount = MAX_NUM_OF_OBJECTS;
+    }
+    memset(&device, 0, sizeof(dev_t));
+    device.shortAddr = 0x0001;
+    memcpy(device.extAddr, "\x01\x02\x03\x04\x05\x06\x07\x08", 8);
+    device.rssi = -42;
+    device.active = true;
+    device.rxTime = Util_getTimeMs();
+    device.objectCount = objectCount;
+    for(uint8_t objIdx = 0; objIdx < objectCount; objIdx++)
+    {
+        /* The names of the members must differ */
+        snprintf(device.object[objIdx].type, MAX_TYPE_CHAR_LEN, "%s%d",
+                 benchTypes[objIdx % NUM_BENCH_TYPES], objIdx / NUM_BENCH_TYPES);
+        strcpy(device.object[objIdx].unit, benchUnits[objIdx % NUM_BENCH_TYPES]);
+        device.object[objIdx].typeId = benchTypeIds[objIdx % NUM_BENCH_TYPES];
+        device.object[objIdx].sensorVal = (objIdx * 1234) - 567;
+    }
+
+    pOld = sprintfDevJson(&device);
+    pNew = formatDevJson(&device);
+    pResult->objectCount = objectCount;
+    pResult->len = (uint16_t)strlen(pOld);
+    pResult->same = ((pNew != NULL) && (strcmp(pOld, pNew) == 0));
+    free(pOld);
+    free(pNew);
+    pResult->cborLen = 0;
+    pCbor = formatDevCbor(&device, -1, &pResult->cborLen);
+    free(pCbor);
+
+    startMs = Util_getTimeMs();
+    for(uint16_t iter = 0; iter < iterations; iter++)
+    {
+        free(sprintfDevJson(&device));
+    }
+    pResult->sprintfNs = ((Util_getTimeMs() - startMs) * 1000000) / iterations;
+
+    startMs = Util_getTimeMs();
+    for(uint16_t iter = 0; iter < iterations; iter++)
+    {
+        free(formatDevJson(&device));
+    }
+    pResult->writerNs = ((Util_getTimeMs() - startMs) * 1000000) / iterations;
+
+    startMs = Util_getTimeMs();
+    for(uint16_t iter = 0; iter < iterations; iter++)
+    {
+        JsonWriter_init(&writer, buffer, sizeof(buffer));
+        formatDevJsonTo(&writer, &device, -1);
+    }
+    pResult->bufferNs = ((Util_getTimeMs() - startMs) * 1000000) / iterations;
+
+    startMs = Util_getTimeMs();
+    for(uint16_t iter = 0; iter < iterations; iter++)
+    {
+        uint16_t cborLen;
+        free(formatDevCbor(&device, -1, &cborLen));
+    }
+    pResult->cborNs = ((Util_getTimeMs() - startMs) * 1000000) / iterations;
+}
+
+/******************************************************************************
+ Local Functions
+ *****************************************************************************/
+
+/*!
+ * @brief       formatDevJson as it was before the JSON writer: objects
+ *              formatted into a scratch string, then the whole update
+ *              formatted again around it
+ *
+ * @param       device - device to format
+ *
+ * @return      allocated JSON string
+ */
+static char *sprintfDevJson(dev_t *device)
+{
+    int objListStrLen = TIMESTAMP_CHAR_LEN + (device->objectCount*DEV_OBJ_CHAR_LEN * sizeof(char)) + 1;
+    int devUpdtStrLen = objListStrLen + (DEV_UPDT_CHAR_LEN * sizeof(char));
+    char *devString;
+    char *objListString;
+    char *tempPtrStr;
+    uint32_t loBytes, hiBytes;
+    uint8_t *tempExtAddr;
+    devString = (char*) malloc(devUpdtStrLen);
+    objListString = (char*) malloc(objListStrLen);
+    tempPtrStr = objListString;
+    objListString[0] = '\0';
+    for(int objIdx = 0; objIdx < device->objectCount; objIdx++)
+    {
+        sprintf(tempPtrStr, jsonDevObjects, device->object[objIdx].type, 0, device->object[objIdx].type, device->object[objIdx].sensorVal, device->object[objIdx].unit);
+        strcat(tempPtrStr, ",");
+        tempPtrStr += strlen(tempPtrStr);
+    }
+    formatTimeStamp(tempPtrStr, device->rxTime);
+    tempExtAddr = device->extAddr;
+    loBytes = Util_buildUint32(tempExtAddr[0], tempExtAddr[1], tempExtAddr[2], tempExtAddr[3]);
+    hiBytes = Util_buildUint32(tempExtAddr[4], tempExtAddr[5], tempExtAddr[6], tempExtAddr[7]);
+    sprintf(devString, jsonDevUpdateCmd, "true", device->shortAddr, hiBytes, loBytes, device->rssi, objListString);
+    free(objListString);
+
+    return devString;
+}
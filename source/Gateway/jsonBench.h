@@ -0,0 +1,112 @@
+/******************************************************************************
+
+ @file jsonBench.h
+
+ @brief Microbenchmark of the device update formatting
+
+ Group: WCS LPC
+ Target Device: CC13xx CC32xx
+
+ ******************************************************************************
+
+ Copyright (c) 2016-2017, Texas Instruments Incorporated
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions
+ are met:
+
+ *  Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+
+ *  Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+
+ *  Neither the name of Texas Instruments Incorporated nor the names of
+    its contributors may be used to endorse or promote products derived
+    from this software without specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+ ******************************************************************************
+ Release Name:
+ Release Date:
+ *****************************************************************************/
+
+#ifndef GATEWAY_JSONBENCH_H_
+#define GATEWAY_JSONBENCH_H_
+
+//*****************************************************************************
+//
+// If building with a C++ compiler, make all of the definitions in this header
+// have a C binding.
+//
+//*****************************************************************************
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/*! Run the benchmark when the gateway starts, before any task is busy */
+#ifndef GTWAY_JSON_BENCH
+#define GTWAY_JSON_BENCH        false
+#endif
+
+/*! Documents formatted per variant, the time is measured in milliseconds */
+#define JSONBENCH_ITERATIONS    2000
+
+/*! Time per document of each way of formatting a device update */
+typedef struct
+{
+    /*! Objects of the device */
+    uint8_t objectCount;
+    /*! Length of the document */
+    uint16_t len;
+    /*! Scratch string, sprintf and strcat, as formatDevJson used to */
+    uint32_t sprintfNs;
+    /*! formatDevJson, JSON writer into an allocated string */
+    uint32_t writerNs;
+    /*! JSON writer into a buffer that is already there */
+    uint32_t bufferNs;
+    /*! Both produced the same document */
+    bool same;
+    /*! Length of the same update in CBOR, formatDevCbor */
+    uint16_t cborLen;
+    /*! formatDevCbor, CBOR writer into an allocated buffer */
+    uint32_t cborNs;
+} JsonBench_result_t;
+
+/*!
+ * @brief       Format the same device update with each variant
+ *
+ * @param       iterations - documents formatted per variant
+ * @param       objectCount - objects of the device, up to MAX_NUM_OF_OBJECTS
+ * @param       pResult - filled with the time per document
+ */
+extern void JsonBench_run(uint16_t iterations, uint8_t objectCount,
+                          JsonBench_result_t *pResult);
+
+//*****************************************************************************
+//
+// Mark the end of the C bindings section for C++ compilers.
+//
+//*****************************************************************************
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* GATEWAY_JSONBENCH_H_ */
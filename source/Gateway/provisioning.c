@@ -58,7 +58,9 @@
 #include <ti/devices/cc32xx/driverlib/prcm.h>
 #include <ti/devices/cc32xx/driverlib/rom_map.h>
 
+#define LOG_MODULE LogModule_PROVISIONING
 #include <Utils/uart_term.h>
+#include <Utils/msgLane.h>
 #include <Common/commonDefs.h>
 
 #include <pthread.h>
@@ -184,7 +186,7 @@ uint32_t gPingSuccess = 0;
 uint8_t  gRole = ROLE_STA;
 uint8_t gIsWlanConnected = 0;
 
-mqd_t    provSrvrMq;
+MsgLane_t *provSrvrMq;
 
 uint16_t gLedCount = 0;
 uint8_t  gLedState = 0;
@@ -1165,7 +1167,7 @@ int16_t SignalEvent(GatewayEvent event)
     //signal provisioning task about SL Event
     //
     msgQueue_t mqEvt = {event, NULL, 0};
-    mq_send(provSrvrMq, (char*)&mqEvt, sizeof(msgQueue_t), MQ_LOW_PRIOR);
+    MsgLane_send(provSrvrMq, &mqEvt);
 
     return 0;
 }
@@ -1186,6 +1188,7 @@ void SimpleLinkInitCallback(uint32_t status, SlDeviceInitInfo_t *DeviceInitInfo)
     {
         UART_PRINT("\r\n**********************************\r\nReturn to Factory Default been Completed\r\nPlease RESET the Board\r\n**********************************\r\n");
         gLedDisplayState = LedState_FACTORY_DEFAULT;
+        LogRing_flush();
         while(1);
     }
 
@@ -1271,7 +1274,7 @@ int32_t returnToFactoryDefault(void)
             incomingMsg.event = CommonEvent_INVALID_EVENT;
             incomingMsg.msgPtr = NULL;
             incomingMsg.msgPtrLen = 0;
-            mq_receive(provSrvrMq, (char*) &incomingMsg, sizeof(msgQueue_t), NULL);
+            MsgLane_receive(provSrvrMq, &incomingMsg, NULL);
 
             event = (unsigned char)incomingMsg.event;
 
@@ -1285,6 +1288,7 @@ int32_t returnToFactoryDefault(void)
                 if (pEntry->p_evtHndl() < 0)
                 {
                     UART_PRINT("Event handler failed..!! \n\r");
+                    LogRing_flush();
                     while(1);
                 }
             }
@@ -1443,6 +1447,7 @@ void provisioning_processQMsg(msgQueue_t *incomingMsg)
         if (pEntry->p_evtHndl() < 0)
         {
             UART_PRINT("Event handler failed..!! \n\r");
+            LogRing_flush();
             while(1);
         }
     }
@@ -1470,7 +1475,7 @@ void provisioningInit(const char *provSrvrMqName)
     int32_t            iRetVal = 0;
     sigevent           sev;
     pthread_attr_t     timerThreadAttr;
-    provSrvrMq = mq_open(provSrvrMqName, O_WRONLY | O_NONBLOCK);
+    provSrvrMq = MsgLane_open(provSrvrMqName);
 
     if (provSrvrMq == NULL)
     {
@@ -1497,6 +1502,7 @@ void provisioningInit(const char *provSrvrMqName)
             UART_PRINT("\r\n**********************************\r\nReturn to Factory Default has been Completed\r\nPlease RESET the Board\r\n**********************************\r\n");
             gLedDisplayState = LedState_FACTORY_DEFAULT;
         }
+        LogRing_flush();
         while(1);
     }
 }
@@ -1520,7 +1526,7 @@ void tasksReportWlanDisconnected(void)
 //        sl_Start(NULL, NULL, (P_INIT_CALLBACK)SimpleLinkInitCallback);
 //    }
     gIsWlanConnected = 0;
-    mq_send(provSrvrMq, (char*)&mqEvt, sizeof(msgQueue_t), MQ_LOW_PRIOR);
+    MsgLane_send(provSrvrMq, &mqEvt);
 }
 
 //*****************************************************************************
@@ -1535,7 +1541,7 @@ void tasksReportWlanDisconnected(void)
 void taskInitComplete(void)
 {
     msgQueue_t mqEvt = {GatewayEvent_INIT_COMPLETE, NULL, 0};
-    mq_send(provSrvrMq, (char*)&mqEvt, sizeof(msgQueue_t), MQ_LOW_PRIOR);
+    MsgLane_send(provSrvrMq, &mqEvt);
 }
 //*****************************************************************************
 //
@@ -1552,6 +1558,6 @@ void tasksReportWlanConnected(void)
     {
         msgQueue_t mqEvt = {CommonEvent_WLAN_CONNECTED, NULL, 0};
         gIsWlanConnected = 1;
-        mq_send(provSrvrMq, (char*)&mqEvt, sizeof(msgQueue_t), MQ_LOW_PRIOR);
+        MsgLane_send(provSrvrMq, &mqEvt);
     }
 }
@@ -0,0 +1,267 @@
+/******************************************************************************
+
+ @file regBench.c
+
+ @brief Microbenchmark of the gateway device registry
+
+ Group: WCS LPC
+ Target Device: CC13xx CC32xx
+
+ ******************************************************************************
+
+ Copyright (c) 2016-2017, Texas Instruments Incorporated
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions
+ are met:
+
+ *  Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+
+ *  Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+
+ *  Neither the name of Texas Instruments Incorporated nor the names of
+    its contributors may be used to endorse or promote products derived
+    from this software without specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+ ******************************************************************************
+ Release Name:
+ Release Date:
+ *****************************************************************************/
+
+/******************************************************************************
+ Includes
+ *****************************************************************************/
+#include <string.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <Common/commonDefs.h>
+#include <Utils/util.h>
+#include "devRegistry.h"
+#include "regBench.h"
+
+/******************************************************************************
+ Constants and definitions
+ *****************************************************************************/
+
+/* Objects of each benchmark device */
+#define BENCH_OBJECTS       3
+
+/******************************************************************************
+ Local variables
+ *****************************************************************************/
+
+/* Flat list of the gateway before the registry, and its device count */
+static dev_t *pDevList = NULL;
+static int devListCount = 0;
+
+/* Handles found, keeps the lookups from being optimized away */
+static volatile int benchSink;
+
+/******************************************************************************
+ Local function prototypes
+ *****************************************************************************/
+static void benchDevice(dev_t *pDev, uint8_t devIdx);
+static int devSearchExt(uint8_t *pAddr);
+static int devSearchShort(uint16_t sAddr);
+static int listDevUpdate(dev_t *newDev);
+
+/******************************************************************************
+ Public Functions
+ *****************************************************************************/
+
+/*!
+ Time lookups and updates on the registry and on a flat list
+
+ Public function defined in regBench.h
+ */
+bool RegBench_run(uint16_t iterations, uint8_t numDevices,
+                  RegBench_result_t *pResult)
+{
+    static dev_t device;
+    uint32_t startMs;
+    uint16_t iter;
+    uint8_t devIdx;
+
+    if(numDevices > MAX_NUM_OF_DEVICES)
+    {
+        numDevices = MAX_NUM_OF_DEVICES;
+    }
+    if((numDevices == 0) || (iterations == 0))
+    {
+        return false;
+    }
+    pDevList = (dev_t *)malloc(sizeof(dev_t) * numDevices);
+    if(pDevList == NULL)
+    {
+        return false;
+    }
+
+    DevReg_init();
+    devListCount = 0;
+    for(devIdx = 0; devIdx < numDevices; devIdx++)
+    {
+        benchDevice(&device, devIdx);
+        DevReg_update(&device);
+        listDevUpdate(&device);
+    }
+    pResult->numDevices = numDevices;
+
+    /* Lookups hit devices all over the list, not only the first ones */
+    startMs = Util_getTimeMs();
+    for(iter = 0; iter < iterations; iter++)
+    {
+        dev_t *pDev = &pDevList[(iter * 7) % numDevices];
+        benchSink = DevReg_findShort(pDev->shortAddr);
+        benchSink = DevReg_findExt(pDev->extAddr);
+    }
+    pResult->hashLookupNs = ((Util_getTimeMs() - startMs) * 1000000)
+                            / iterations;
+
+    startMs = Util_getTimeMs();
+    for(iter = 0; iter < iterations; iter++)
+    {
+        dev_t *pDev = &pDevList[(iter * 7) % numDevices];
+        benchSink = devSearchShort(pDev->shortAddr);
+        benchSink = devSearchExt(pDev->extAddr);
+    }
+    pResult->linearLookupNs = ((Util_getTimeMs() - startMs) * 1000000)
+                              / iterations;
+
+    startMs = Util_getTimeMs();
+    for(iter = 0; iter < iterations; iter++)
+    {
+        benchDevice(&device, (uint8_t)((iter * 7) % numDevices));
+        benchSink = DevReg_update(&device);
+    }
+    pResult->hashUpdateNs = ((Util_getTimeMs() - startMs) * 1000000)
+                            / iterations;
+
+    startMs = Util_getTimeMs();
+    for(iter = 0; iter < iterations; iter++)
+    {
+        benchDevice(&device, (uint8_t)((iter * 7) % numDevices));
+        benchSink = listDevUpdate(&device);
+    }
+    pResult->linearUpdateNs = ((Util_getTimeMs() - startMs) * 1000000)
+                              / iterations;
+
+    DevReg_init();
+    free(pDevList);
+    pDevList = NULL;
+    return true;
+}
+
+/******************************************************************************
+ Local Functions
+ *****************************************************************************/
+
+/*!
+ * @brief       Build the update of a benchmark device
+ *
+ * @param       pDev - filled in
+ * @param       devIdx - device number, gives distinct addresses
+ */
+static void benchDevice(dev_t *pDev, uint8_t devIdx)
+{
+    static const char *types[BENCH_OBJECTS] = {TEMP_TYPE, HUM_TYPE, LIGHT_TYPE};
+    uint8_t objIdx;
+
+    memset(pDev, 0, sizeof(dev_t));
+    pDev->shortAddr = 0x0001 + devIdx;
+    /* Same OUI for all, as in a real network */
+    memcpy(pDev->extAddr, "\x00\x00\x00\x00\x00\x4B\x12\x00", 8);
+    pDev->extAddr[0] = devIdx;
+    pDev->extAddr[1] = (uint8_t)(devIdx * 37);
+    pDev->rssi = -60;
+    pDev->active = true;
+    pDev->objectCount = BENCH_OBJECTS;
+    for(objIdx = 0; objIdx < BENCH_OBJECTS; objIdx++)
+    {
+        strcpy(pDev->object[objIdx].type, types[objIdx]);
+        pDev->object[objIdx].sensorVal = devIdx + objIdx;
+    }
+}
+
+/*!
+ * @brief       devSearchExt of the gateway before the registry, without
+ *              the log lines
+ *
+ * @param       pAddr - extended address
+ *
+ * @return      index of the device, -1 if not found
+ */
+static int devSearchExt(uint8_t *pAddr)
+{
+    for(int i = 0; i < devListCount; i++)
+    {
+        if(memcmp(pDevList[i].extAddr, pAddr, APIMAC_SADDR_EXT_LEN) == 0)
+        {
+            return i;
+        }
+    }
+    return -1;
+}
+
+/*!
+ * @brief       devSearchShort of the gateway before the registry
+ *
+ * @param       sAddr - short address
+ *
+ * @return      index of the device, -1 if not found
+ */
+static int devSearchShort(uint16_t sAddr)
+{
+    for(int i = 0; i < devListCount; i++)
+    {
+        if(pDevList[i].shortAddr == sAddr)
+        {
+            return i;
+        }
+    }
+    return -1;
+}
+
+/*!
+ * @brief       listDevUpdate of the gateway before the registry
+ *
+ * @param       newDev - device update
+ *
+ * @return      index of the device
+ */
+static int listDevUpdate(dev_t *newDev)
+{
+    int devIdx = devSearchShort(newDev->shortAddr);
+    if(devIdx != -1)
+    {
+        pDevList[devIdx].active = newDev->active;
+        memcpy(pDevList[devIdx].object, newDev->object, sizeof(smartObject_t)*newDev->objectCount);
+        pDevList[devIdx].objectCount = newDev->objectCount;
+        pDevList[devIdx].rssi = newDev->rssi;
+        return devIdx;
+    }
+    devIdx = devSearchExt(newDev->extAddr);
+    if(devIdx != -1)
+    {
+        memcpy(&pDevList[devIdx], newDev, sizeof(dev_t));
+        return devIdx;
+    }
+    devIdx = devListCount++;
+    memcpy(&pDevList[devIdx], newDev, sizeof(dev_t));
+    return devIdx;
+}
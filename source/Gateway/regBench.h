@@ -0,0 +1,114 @@
+/******************************************************************************
+
+ @file regBench.h
+
+ @brief Microbenchmark of the gateway device registry
+
+ Group: WCS LPC
+ Target Device: CC13xx CC32xx
+
+ ******************************************************************************
+
+ Copyright (c) 2016-2017, Texas Instruments Incorporated
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions
+ are met:
+
+ *  Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+
+ *  Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+
+ *  Neither the name of Texas Instruments Incorporated nor the names of
+    its contributors may be used to endorse or promote products derived
+    from this software without specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+ ******************************************************************************
+ Release Name:
+ Release Date:
+ *****************************************************************************/
+
+#ifndef GATEWAY_REGBENCH_H_
+#define GATEWAY_REGBENCH_H_
+
+//*****************************************************************************
+//
+// If building with a C++ compiler, make all of the definitions in this header
+// have a C binding.
+//
+//*****************************************************************************
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/*! Run the benchmark when the gateway starts, before any device is known.
+    Build with MAX_NUM_OF_DEVICES and DEVREG_HASH_SIZE raised (e.g. 250 and
+    512) to time a registry of a few hundred devices. */
+#ifndef GTWAY_REG_BENCH
+#define GTWAY_REG_BENCH         false
+#endif
+
+/*! Lookups and updates timed per variant, the time is measured in
+    milliseconds */
+#define REGBENCH_ITERATIONS     20000
+
+/*! Time per operation of the registry and of the list it replaced */
+typedef struct
+{
+    /*! Devices in the registry and in the list */
+    uint8_t numDevices;
+    /*! Short and extended address lookup pair, DevReg_findShort and
+        DevReg_findExt */
+    uint32_t hashLookupNs;
+    /*! Same pair, linear scans of the flat list */
+    uint32_t linearLookupNs;
+    /*! Update of a known device, DevReg_update */
+    uint32_t hashUpdateNs;
+    /*! Same update, the flat list's listDevUpdate */
+    uint32_t linearUpdateNs;
+} RegBench_result_t;
+
+/*!
+ * @brief       Fill the registry and a flat list with the same devices and
+ *              time lookups and updates on both. The registry is cleared
+ *              when done.
+ *
+ * @param       iterations - operations timed per variant
+ * @param       numDevices - devices, up to MAX_NUM_OF_DEVICES
+ * @param       pResult - filled with the time per operation
+ *
+ * @return      false if the flat list could not be allocated
+ */
+extern bool RegBench_run(uint16_t iterations, uint8_t numDevices,
+                         RegBench_result_t *pResult);
+
+//*****************************************************************************
+//
+// Mark the end of the C bindings section for C++ compilers.
+//
+//*****************************************************************************
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* GATEWAY_REGBENCH_H_ */
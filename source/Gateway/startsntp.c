@@ -30,49 +30,186 @@
  * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
 
+/*
+ *  ======== startsntp.c ========
+ *
+ *  Time service of the gateway. A task of its own queries all servers of
+ *  NTP_SERVER_NAMES in parallel, keeps the measurement with the smallest
+ *  root distance among the servers that agree with each other and steers
+ *  the clock with it: large offsets are stepped, small ones are slewed in
+ *  and the frequency error learned between polls is corrected on every
+ *  tick so the clock stays close between polls.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
 #include <time.h>
 #include <unistd.h>
+#include <pthread.h>
+#include <mqueue.h>
 
-#include <semaphore.h>
-
-#include <ti/display/Display.h>
-#include <ti/net/sntp/sntp.h>
-
+#include <ti/net/socket.h>
 #include <ti/drivers/net/wifi/simplelink.h>
 #include <ti/drivers/net/wifi/device.h>
+#include <Common/commonDefs.h>
+#define LOG_MODULE LogModule_NTP
 #include <Utils/uart_term.h>
+#include <Utils/msgLane.h>
+#include <Utils/mqStats.h>
+
+#include "startsntp.h"
+
+#define NTP_MQ              "ntpMq"
 
-#define NTP_PORT          123
-#define NTP_SERVERS       1
-#define NTP_SERVERS_SIZE  (NTP_SERVERS * sizeof(struct sockaddr_in))
-#define NTP_TIMEOUT       30000
+/*
+ *  The NTP timebase is 00:00 Jan 1 1900. The local time base is 00:00
+ *  Jan 1 1970, 70 years later of which 17 were leap years.
+ */
+#define TIME_BASEDIFF       ((((uint32_t)70 * 365 + 17) * 24 * 3600))
+
+#define NTP_VERSION         4
+#define NTP_MODE_CLIENT     3
+#define NTP_MODE_SERVER     4
+#define NTP_LI_NOSYNC       3
+#define NTP_MAX_STRATUM     15
+
+/* Lower bound of the root distance, covers the resolution of the clocks */
+#define NTP_MIN_DIST_US     1000
 
-/* Must wait at least 15 sec to retry NTP server (RFC 4330) */
-#define NTP_POLL_TIME     15
+/* Share of the measured frequency error applied per poll */
+#define NTP_FREQ_GAIN       4
 
-char NTP_HOSTNAME[] = "pool.ntp.org";
+typedef enum
+{
+    NtpEvent_START,
+    NtpEvent_STOP
+} NtpEvent;
 
-//extern Display_Handle AWSIOT_display;
+/* SNTP Header (as specified in RFC 4330), all fields in network order */
+typedef struct
+{
+    uint8_t  flags;
+    uint8_t  stratum;
+    uint8_t  poll;
+    int8_t   precision;
+    uint32_t rootDelay;
+    uint32_t rootDispersion;
+    uint32_t referenceID;
+    uint32_t referenceTS[2];
+    uint32_t originateTS[2];
+    uint32_t receiveTS[2];
+    uint32_t transmitTS[2];
+} ntpPacket_t;
 
-void startNTP(void);
+/* Server of the list and its request of the current poll */
+typedef struct
+{
+    struct sockaddr_in addr;
+    int sock;
+    /* Local time the request was sent, the server echoes txTS back */
+    int64_t t1;
+    uint32_t txTS[2];
+    /* Monotonic second before which the server asked not to be polled */
+    uint32_t backoff;
+    /* Server refused access with a DENY or RSTR kiss code */
+    bool denied;
+} ntpServer_t;
+
+/* Measurement against one server, all times in microseconds */
+typedef struct
+{
+    int64_t offset;
+    int64_t delay;
+    int64_t dist;
+    uint8_t stratum;
+    int8_t server;
+} ntpSample_t;
+
+static const char *serverNames[] = { NTP_SERVER_NAMES };
+
+#define NTP_NUM_SERVERS     (sizeof(serverNames) / sizeof(serverNames[0]))
+
+static ntpServer_t servers[NTP_NUM_SERVERS];
+static mqd_t ntpMq;
+static MsgLane_t *clientMq;
+
+/* Status is read by other tasks, everything else is owned by the task */
+static pthread_mutex_t statusMutex;
+static Ntp_status_t status;
+static bool running;
+static uint32_t lastErrorUs;
+static int64_t lastSyncMono;
+/* Wall clock minus monotonic clock, follows every adjustment */
+static int64_t utcOffsetMs;
+
+static uint32_t nextPoll;
+static uint8_t failures;
+static int64_t lastTickMono;
+static int64_t pendingAdjNs;
 
 /*
- *  ======== setTime ========
+ *  ======== monoUs ========
  */
-void setTime(uint32_t t)
+static int64_t monoUs(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (((int64_t)ts.tv_sec * 1000000) + (ts.tv_nsec / 1000));
+}
+
+/*
+ *  ======== realUs ========
+ */
+static int64_t realUs(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_REALTIME, &ts);
+
+    return (((int64_t)ts.tv_sec * 1000000) + (ts.tv_nsec / 1000));
+}
+
+/*
+ *  ======== usToNtp ========
+ *
+ *  Convert local microseconds to an NTP timestamp in host order.
+ */
+static void usToNtp(int64_t us, uint32_t *pTS)
+{
+    pTS[0] = (uint32_t)(us / 1000000) + TIME_BASEDIFF;
+    pTS[1] = (uint32_t)((((uint64_t)(us % 1000000)) << 32) / 1000000);
+}
+
+/*
+ *  ======== ntpToUs ========
+ *
+ *  Convert an NTP timestamp in network order to local microseconds.
+ */
+static int64_t ntpToUs(const uint32_t *pTS)
+{
+    uint32_t sec = ntohl(pTS[0]) - TIME_BASEDIFF;
+    uint64_t frac = ntohl(pTS[1]);
+
+    return (((int64_t)sec * 1000000) + (int64_t)((frac * 1000000) >> 32));
+}
+
+/*
+ *  ======== setNwpTime ========
+ *
+ *  Set system clock on network processor to validate certificates.
+ */
+static void setNwpTime(void)
 {
     SlDateTime_t dt;
     struct tm tm;
-    struct timespec tspec;
     time_t ts;
 
-    tspec.tv_sec = t;
-    clock_settime(CLOCK_REALTIME, &tspec);
-
     time(&ts);
     tm = *localtime(&ts);
 
-    /* Set system clock on network processor to validate certificate */
     dt.tm_day  = tm.tm_mday;
     /* tm.tm_mon is the month since January, so add 1 to get the actual month */
     dt.tm_mon  = tm.tm_mon + 1;
@@ -86,55 +223,585 @@ void setTime(uint32_t t)
 }
 
 /*
- *  ======== getTime ========
+ *  ======== adjustClock ========
+ *
+ *  Must be called with statusMutex held.
  */
-uint32_t getTime(void)
+static void adjustClock(int64_t deltaNs, bool step)
 {
-    struct timespec tspec;
+    struct timespec ts;
+    int64_t ns;
 
-    clock_gettime(CLOCK_REALTIME, &tspec);
+    clock_gettime(CLOCK_REALTIME, &ts);
+    ns = ts.tv_nsec + (deltaNs % 1000000000);
+    ts.tv_sec += (time_t)(deltaNs / 1000000000);
+    if (ns < 0) {
+        ns += 1000000000;
+        ts.tv_sec--;
+    }
+    else if (ns >= 1000000000) {
+        ns -= 1000000000;
+        ts.tv_sec++;
+    }
+    ts.tv_nsec = (long)ns;
+    clock_settime(CLOCK_REALTIME, &ts);
+    utcOffsetMs = (realUs() - monoUs()) / 1000;
 
-    return (tspec.tv_sec);
+    if (step) {
+        setNwpTime();
+    }
 }
 
 /*
- *  ======== startNTP ========
+ *  ======== clampInt32 ========
  */
-void startNTP(void)
+static int32_t clampInt32(int64_t value)
 {
-    int ret;
-    int ip;
-    int retryCnt = 4;
-    time_t ts;
-    struct sockaddr_in ntpAddr = {0};
+    if (value > INT32_MAX) {
+        return (INT32_MAX);
+    }
+    if (value < INT32_MIN) {
+        return (INT32_MIN);
+    }
+    return ((int32_t)value);
+}
+
+/*
+ *  ======== notifyClient ========
+ */
+static void notifyClient(void)
+{
+    msgQueue_t msg;
+
+    msg.event = GatewayEvent_TIME_UPDATE;
+    msg.msgPtr = NULL;
+    msg.msgPtrLen = 0;
+    MsgLane_send(clientMq, &msg);
+}
+
+/*
+ *  ======== resolveServer ========
+ */
+static bool resolveServer(uint8_t idx)
+{
+    unsigned int a, b, c, d;
+    char tail;
+    uint32_t ip;
     struct hostent *dnsEntry;
     struct in_addr **addr_list;
 
-    dnsEntry = gethostbyname(NTP_HOSTNAME);
-    if (dnsEntry == NULL) {
-        UART_PRINT(" [NTP] startNTP: NTP host cannot be resolved!\n\r");
+    if ((sscanf(serverNames[idx], "%u.%u.%u.%u%c", &a, &b, &c, &d, &tail) == 4)
+            && (a < 256) && (b < 256) && (c < 256) && (d < 256)) {
+        ip = (a << 24) | (b << 16) | (c << 8) | d;
+    }
+    else {
+        dnsEntry = gethostbyname(serverNames[idx]);
+        if (dnsEntry == NULL) {
+            UART_PRINT(" [NTP] %s cannot be resolved\n\r", serverNames[idx]);
+            return (false);
+        }
+
+        /* Get the first IP address returned from DNS, in host order */
+        addr_list = (struct in_addr **)dnsEntry->h_addr_list;
+        ip = (*addr_list[0]).s_addr;
+    }
+
+    memset(&servers[idx].addr, 0, sizeof(struct sockaddr_in));
+    servers[idx].addr.sin_addr.s_addr = htonl(ip);
+    servers[idx].addr.sin_port = htons(NTP_PORT);
+    servers[idx].addr.sin_family = AF_INET;
+
+    return (true);
+}
+
+/*
+ *  ======== sendRequest ========
+ */
+static bool sendRequest(uint8_t idx)
+{
+    ntpServer_t *pSrv = &servers[idx];
+    ntpPacket_t pkt;
+
+    pSrv->sock = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    if (pSrv->sock < 0) {
+        pSrv->sock = -1;
+        return (false);
+    }
+
+    /* Connect so that only replies of this server reach the socket */
+    if (connect(pSrv->sock, (struct sockaddr *)&pSrv->addr,
+            sizeof(struct sockaddr_in)) < 0) {
+        close(pSrv->sock);
+        pSrv->sock = -1;
+        return (false);
+    }
+
+    memset(&pkt, 0, sizeof(ntpPacket_t));
+    pkt.flags = (NTP_VERSION << 3) | NTP_MODE_CLIENT;
+
+    pSrv->t1 = realUs();
+    usToNtp(pSrv->t1, pSrv->txTS);
+    pkt.transmitTS[0] = htonl(pSrv->txTS[0]);
+    pkt.transmitTS[1] = htonl(pSrv->txTS[1]);
+
+    if (send(pSrv->sock, (void *)&pkt, sizeof(ntpPacket_t), 0)
+            != sizeof(ntpPacket_t)) {
+        close(pSrv->sock);
+        pSrv->sock = -1;
+        return (false);
+    }
+
+    return (true);
+}
+
+/*
+ *  ======== readReply ========
+ *
+ *  Read the reply of a server and turn it into a sample. Returns false if
+ *  the reply is not usable.
+ */
+static bool readReply(uint8_t idx, ntpSample_t *pSample)
+{
+    ntpServer_t *pSrv = &servers[idx];
+    ntpPacket_t pkt;
+    int ret;
+    int64_t t2, t3, t4;
+    int64_t rootDelay, rootDisp;
+
+    ret = recv(pSrv->sock, &pkt, sizeof(ntpPacket_t), 0);
+    t4 = realUs();
+    close(pSrv->sock);
+    pSrv->sock = -1;
+
+    if ((ret != sizeof(ntpPacket_t)) ||
+        (ntohl(pkt.originateTS[0]) != pSrv->txTS[0]) ||
+        (ntohl(pkt.originateTS[1]) != pSrv->txTS[1])) {
+        return (false);
+    }
+
+    /* Per RFC5905, we MUST handle Kiss O' Death packets */
+    if (pkt.stratum == 0) {
+        if (memcmp(&pkt.referenceID, "RATE", 4) == 0) {
+            pSrv->backoff = (uint32_t)(monoUs() / 1000000) + NTP_MAX_POLL_SEC;
+        }
+        else if ((memcmp(&pkt.referenceID, "DENY", 4) == 0) ||
+                 (memcmp(&pkt.referenceID, "RSTR", 4) == 0)) {
+            UART_PRINT(" [NTP] %s denied access\n\r", serverNames[idx]);
+            pSrv->denied = true;
+        }
+        return (false);
+    }
+
+    if (((pkt.flags & 0x7) != NTP_MODE_SERVER) ||
+        ((pkt.flags >> 6) == NTP_LI_NOSYNC) ||
+        (pkt.stratum > NTP_MAX_STRATUM) || (pkt.transmitTS[0] == 0)) {
+        return (false);
+    }
+
+    t2 = ntpToUs(pkt.receiveTS);
+    t3 = ntpToUs(pkt.transmitTS);
+
+    pSample->offset = ((t2 - pSrv->t1) + (t3 - t4)) / 2;
+    pSample->delay = (t4 - pSrv->t1) - (t3 - t2);
+    if (pSample->delay < 0) {
+        pSample->delay = 0;
+    }
+
+    /* Root delay and dispersion are 16.16 fixed point seconds */
+    rootDelay = ((int64_t)(int32_t)ntohl(pkt.rootDelay) * 1000000) >> 16;
+    rootDisp = ((int64_t)ntohl(pkt.rootDispersion) * 1000000) >> 16;
+    if (rootDelay < 0) {
+        rootDelay = 0;
+    }
+
+    pSample->dist = (pSample->delay / 2) + (rootDelay / 2) + rootDisp;
+    if (pSample->dist < NTP_MIN_DIST_US) {
+        pSample->dist = NTP_MIN_DIST_US;
+    }
+    pSample->stratum = pkt.stratum;
+    pSample->server = (int8_t)idx;
+
+    return (true);
+}
+
+/*
+ *  ======== selectSample ========
+ *
+ *  Two samples agree if their offsets are within the sum of their root
+ *  distances. Samples that do not agree with a majority are dropped and
+ *  the one with the smallest root distance of the rest is returned.
+ */
+static ntpSample_t *selectSample(ntpSample_t *pSamples, uint8_t num)
+{
+    ntpSample_t *pBest = NULL;
+    uint8_t i, j, agree;
+
+    for (i = 0; i < num; i++) {
+        agree = 0;
+        for (j = 0; j < num; j++) {
+            if (llabs(pSamples[i].offset - pSamples[j].offset) <=
+                    (pSamples[i].dist + pSamples[j].dist)) {
+                agree++;
+            }
+        }
+        if ((agree * 2) <= num) {
+            continue;
+        }
+        if ((pBest == NULL) || (pSamples[i].dist < pBest->dist) ||
+            ((pSamples[i].dist == pBest->dist) &&
+             (pSamples[i].stratum < pBest->stratum))) {
+            pBest = &pSamples[i];
+        }
+    }
+
+    return (pBest);
+}
+
+/*
+ *  ======== discipline ========
+ */
+static void discipline(ntpSample_t *pSample)
+{
+    int64_t now = monoUs();
+    int64_t interval;
+    int64_t freq;
+    bool stepped = false;
+    time_t ts;
+
+    pthread_mutex_lock(&statusMutex);
+
+    if ((status.state == Ntp_state_unsynced) ||
+        (llabs(pSample->offset) > NTP_STEP_THRESHOLD_US)) {
+        adjustClock(pSample->offset * 1000, true);
+        status.slewUs = 0;
+        status.pollSec = NTP_MIN_POLL_SEC;
+        stepped = true;
+    }
+    else {
+        /*
+         *  What built up since the last sample on top of the part that was
+         *  still to be slewed in is frequency error of the local clock
+         */
+        interval = (now - lastSyncMono) / 1000000;
+        if (interval > 0) {
+            freq = status.freqPpb +
+                   (((pSample->offset - status.slewUs) * 1000) / interval) /
+                   NTP_FREQ_GAIN;
+            if (freq > NTP_FREQ_MAX_PPB) {
+                freq = NTP_FREQ_MAX_PPB;
+            }
+            else if (freq < -NTP_FREQ_MAX_PPB) {
+                freq = -NTP_FREQ_MAX_PPB;
+            }
+            status.freqPpb = (int32_t)freq;
+        }
+        status.slewUs = (int32_t)pSample->offset;
+
+        if (llabs(pSample->offset) < NTP_STABLE_OFFSET_US) {
+            if (status.pollSec < NTP_MAX_POLL_SEC) {
+                status.pollSec *= 2;
+            }
+        }
+        else if (status.pollSec > NTP_MIN_POLL_SEC) {
+            status.pollSec /= 2;
+        }
+    }
+
+    status.state = Ntp_state_synced;
+    status.server = pSample->server;
+    status.stratum = pSample->stratum;
+    status.offsetUs = clampInt32(pSample->offset);
+    status.lastSync = (uint32_t)time(NULL);
+    lastErrorUs = (uint32_t)pSample->dist;
+    lastSyncMono = now;
+
+    pthread_mutex_unlock(&statusMutex);
+
+    failures = 0;
+    nextPoll = (uint32_t)(now / 1000000) + status.pollSec;
+
+    if (stepped) {
+        ts = time(NULL);
+        UART_PRINT(" [NTP] Clock set from %s: %s\r",
+                serverNames[pSample->server], ctime(&ts));
+        notifyClient();
+    }
+}
+
+/*
+ *  ======== pollFailed ========
+ */
+static void pollFailed(void)
+{
+    uint32_t retry = NTP_RETRY_SEC << ((failures < 6) ? failures : 6);
+
+    if (retry > NTP_MAX_POLL_SEC) {
+        retry = NTP_MAX_POLL_SEC;
+    }
+    failures++;
+    nextPoll = (uint32_t)(monoUs() / 1000000) + retry;
+
+    UART_PRINT(" [NTP] No usable reply, retry in %u secs\n\r", retry);
+
+    /* Let the gateway go on without the time, polling continues */
+    if ((status.state == Ntp_state_unsynced) &&
+        (failures == NTP_FIRST_SYNC_TRIES)) {
+        notifyClient();
+    }
+}
+
+/*
+ *  ======== pollServers ========
+ *
+ *  Send a request to every server at once and collect the replies until
+ *  all arrived or NTP_REPLY_WAIT_MS passed.
+ */
+static void pollServers(void)
+{
+    ntpSample_t samples[NTP_NUM_SERVERS];
+    ntpSample_t *pBest;
+    uint8_t numSamples = 0;
+    uint8_t pending = 0;
+    uint8_t i;
+    uint32_t nowSec = (uint32_t)(monoUs() / 1000000);
+    int64_t deadline;
+    int64_t left;
+    fd_set readSet;
+    struct timeval tv;
+    int maxSock;
+
+    for (i = 0; i < NTP_NUM_SERVERS; i++) {
+        servers[i].sock = -1;
+        if (servers[i].denied || (nowSec < servers[i].backoff)) {
+            continue;
+        }
+        if (resolveServer(i) && sendRequest(i)) {
+            pending++;
+        }
+    }
+
+    deadline = monoUs() + ((int64_t)NTP_REPLY_WAIT_MS * 1000);
+    while (pending > 0) {
+        left = deadline - monoUs();
+        if (left <= 0) {
+            break;
+        }
+
+        FD_ZERO(&readSet);
+        maxSock = -1;
+        for (i = 0; i < NTP_NUM_SERVERS; i++) {
+            if (servers[i].sock >= 0) {
+                FD_SET(servers[i].sock, &readSet);
+                if (servers[i].sock > maxSock) {
+                    maxSock = servers[i].sock;
+                }
+            }
+        }
+
+        tv.tv_sec = (long)(left / 1000000);
+        tv.tv_usec = (long)(left % 1000000);
+        if (select(maxSock + 1, &readSet, NULL, NULL, &tv) <= 0) {
+            break;
+        }
+
+        for (i = 0; i < NTP_NUM_SERVERS; i++) {
+            if ((servers[i].sock >= 0) && FD_ISSET(servers[i].sock, &readSet)) {
+                if (readReply(i, &samples[numSamples])) {
+                    numSamples++;
+                }
+                pending--;
+            }
+        }
+    }
+
+    for (i = 0; i < NTP_NUM_SERVERS; i++) {
+        if (servers[i].sock >= 0) {
+            close(servers[i].sock);
+            servers[i].sock = -1;
+        }
+    }
+
+    pBest = selectSample(samples, numSamples);
+    if (pBest != NULL) {
+        discipline(pBest);
+    }
+    else {
+        pollFailed();
+    }
+}
+
+/*
+ *  ======== slewTick ========
+ *
+ *  Apply the frequency correction and the next share of the pending
+ *  offset for the time passed since the last tick.
+ */
+static void slewTick(void)
+{
+    int64_t now = monoUs();
+    int64_t elapsed = now - lastTickMono;
+    int64_t maxSlew = (elapsed * NTP_SLEW_MAX_PPM) / 1000000;
+    int64_t slew;
+
+    lastTickMono = now;
+
+    pthread_mutex_lock(&statusMutex);
+    if (status.state == Ntp_state_unsynced) {
+        pthread_mutex_unlock(&statusMutex);
         return;
     }
 
-    /* Get the first IP address returned from DNS */
-    addr_list = (struct in_addr **)dnsEntry->h_addr_list;
-    ip = (*addr_list[0]).s_addr;
+    slew = status.slewUs;
+    if (slew > maxSlew) {
+        slew = maxSlew;
+    }
+    else if (slew < -maxSlew) {
+        slew = -maxSlew;
+    }
+    status.slewUs -= (int32_t)slew;
+    pendingAdjNs += (slew * 1000) + ((status.freqPpb * elapsed) / 1000000);
+
+    /* Adjustments below a microsecond are carried over to the next tick */
+    if (llabs(pendingAdjNs) >= 1000) {
+        adjustClock(pendingAdjNs, false);
+        pendingAdjNs = 0;
+    }
+    pthread_mutex_unlock(&statusMutex);
+}
+
+/*
+ *  ======== ntpThread ========
+ */
+static void *ntpThread(void *pvParameters)
+{
+    msgQueue_t msg;
+    struct timespec waitTime;
+
+    lastTickMono = monoUs();
+
+    for (;;) {
+        clock_gettime(CLOCK_REALTIME, &waitTime);
+        waitTime.tv_sec += NTP_TICK_MS / 1000;
+        waitTime.tv_nsec += (NTP_TICK_MS % 1000) * 1000000;
+        if (waitTime.tv_nsec >= 1000000000) {
+            waitTime.tv_nsec -= 1000000000;
+            waitTime.tv_sec++;
+        }
+
+        if (MqStats_timedReceive(ntpMq, &msg, &waitTime) >= 0) {
+            pthread_mutex_lock(&statusMutex);
+            running = (msg.event == NtpEvent_START);
+            pthread_mutex_unlock(&statusMutex);
+            if (running) {
+                failures = 0;
+                nextPoll = 0;
+            }
+        }
+
+        slewTick();
+
+        if (running && ((uint32_t)(monoUs() / 1000000) >= nextPoll)) {
+            pollServers();
+        }
+    }
+}
+
+/*
+ *  ======== Ntp_init ========
+ */
+void Ntp_init(char *clientMqName)
+{
+    pthread_t thread;
+    pthread_attr_t pAttrs;
+    struct sched_param priParam;
+    int32_t retc;
+    mq_attr attr;
+    uint8_t i;
+
+    attr.mq_curmsgs = 0;
+    attr.mq_flags = 0;
+    attr.mq_maxmsg = 4;
+    attr.mq_msgsize = sizeof(msgQueue_t);
+    ntpMq = MqStats_open(NTP_MQ, O_CREAT, &attr);
+    clientMq = MsgLane_open(clientMqName);
+
+    pthread_mutex_init(&statusMutex, NULL);
+    utcOffsetMs = (realUs() - monoUs()) / 1000;
+    status.state = Ntp_state_unsynced;
+    status.server = -1;
+    status.pollSec = NTP_MIN_POLL_SEC;
+    for (i = 0; i < NTP_NUM_SERVERS; i++) {
+        servers[i].sock = -1;
+    }
+
+    pthread_attr_init(&pAttrs);
+    priParam.sched_priority = NTP_TASK_PRI;
+    retc = pthread_attr_setschedparam(&pAttrs, &priParam);
+    retc |= pthread_attr_setstacksize(&pAttrs, TASKSTACKSIZE);
+    retc |= pthread_attr_setdetachstate(&pAttrs, PTHREAD_CREATE_DETACHED);
+    retc |= pthread_create(&thread, &pAttrs, ntpThread, NULL);
+    if (retc != 0) {
+        UART_PRINT(" [NTP] could not create time service task\n\r");
+    }
+}
+
+/*
+ *  ======== Ntp_start ========
+ */
+void Ntp_start(void)
+{
+    msgQueue_t msg = {NtpEvent_START, NULL, 0};
+
+    MqStats_send(ntpMq, &msg, 0);
+}
+
+/*
+ *  ======== Ntp_stop ========
+ */
+void Ntp_stop(void)
+{
+    msgQueue_t msg = {NtpEvent_STOP, NULL, 0};
+
+    MqStats_send(ntpMq, &msg, 0);
+}
 
-    ntpAddr.sin_addr.s_addr = htonl(ip);
-    ntpAddr.sin_port = htons(NTP_PORT);
-    ntpAddr.sin_family = AF_INET;
+/*
+ *  ======== Ntp_getStatus ========
+ *
+ *  The error bound is the root distance of the last sample plus what is
+ *  still to be slewed in plus the wander of the clock since that sample.
+ */
+void Ntp_getStatus(Ntp_status_t *pStatus)
+{
+    uint32_t age;
 
-    do {
-        ret = SNTP_getTime((struct sockaddr *)&ntpAddr, getTime, setTime);
-        if (ret != 0)
-        {
-            UART_PRINT("startNTP: couldn't get time (%d), will retry in %d secs ...",
-                ret, NTP_POLL_TIME);
-            sleep(NTP_POLL_TIME);
-            UART_PRINT("startNTP: retrying ...");
+    pthread_mutex_lock(&statusMutex);
+    *pStatus = status;
+    if (status.state != Ntp_state_unsynced) {
+        age = (uint32_t)((monoUs() - lastSyncMono) / 1000000);
+        pStatus->errorUs = lastErrorUs + (uint32_t)abs(status.slewUs) +
+                           (age * NTP_TOLERANCE_PPM);
+        if (!running || (age > (2 * NTP_MAX_POLL_SEC))) {
+            pStatus->state = Ntp_state_holdover;
         }
-    } while (ret != 0 && retryCnt--);
+    }
+    pthread_mutex_unlock(&statusMutex);
+}
+
+/*
+ *  ======== Ntp_toUtcMs ========
+ */
+uint64_t Ntp_toUtcMs(uint32_t monoMs)
+{
+    int64_t mono = monoUs() / 1000;
+    int64_t offset;
+
+    /* Widen the stamp, it wraps like the low 32 bits of the clock */
+    mono -= (uint32_t)((uint32_t)mono - monoMs);
+
+    pthread_mutex_lock(&statusMutex);
+    offset = utcOffsetMs;
+    pthread_mutex_unlock(&statusMutex);
 
-    ts = time(NULL);
-    UART_PRINT(" [NTP] Current time: %s\n\r", ctime(&ts));
+    return ((uint64_t)(mono + offset));
 }
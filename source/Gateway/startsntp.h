@@ -0,0 +1,201 @@
+/******************************************************************************
+
+ @file startsntp.h
+
+ @brief SNTP time service
+
+ Group: WCS LPC
+ Target Device: CC13xx CC32xx
+
+ ******************************************************************************
+
+ Copyright (c) 2016-2017, Texas Instruments Incorporated
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions
+ are met:
+
+ *  Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+
+ *  Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+
+ *  Neither the name of Texas Instruments Incorporated nor the names of
+    its contributors may be used to endorse or promote products derived
+    from this software without specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+ ******************************************************************************
+ Release Name:
+ Release Date:
+ *****************************************************************************/
+
+#ifndef GATEWAY_STARTSNTP_H_
+#define GATEWAY_STARTSNTP_H_
+
+//*****************************************************************************
+//
+// If building with a C++ compiler, make all of the definitions in this header
+// have a C binding.
+//
+//*****************************************************************************
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/*!
+ Servers queried in parallel on every poll. Each entry is a host name or a
+ dotted IPv4 address, so a local SNTP responder can be used for testing.
+ */
+#ifndef NTP_SERVER_NAMES
+#define NTP_SERVER_NAMES        "0.pool.ntp.org", "1.pool.ntp.org", \
+                                "2.pool.ntp.org", "time.google.com"
+#endif
+
+/*! UDP port of the servers */
+#ifndef NTP_PORT
+#define NTP_PORT                123
+#endif
+
+/*! Time to collect the replies of one poll in milliseconds */
+#define NTP_REPLY_WAIT_MS       2000
+
+/*!
+ Bounds of the poll interval in seconds. The interval doubles while the
+ measured offset stays below NTP_STABLE_OFFSET_US and drops back otherwise.
+ */
+#ifndef NTP_MIN_POLL_SEC
+#define NTP_MIN_POLL_SEC        64
+#endif
+#ifndef NTP_MAX_POLL_SEC
+#define NTP_MAX_POLL_SEC        1024
+#endif
+#define NTP_STABLE_OFFSET_US    10000
+
+/*! Must wait at least 15 sec to retry a failed poll (RFC 4330) */
+#define NTP_RETRY_SEC           15
+
+/*!
+ Number of failed polls after which the first sync is given up on for the
+ purpose of startup. The service keeps polling in the background.
+ */
+#define NTP_FIRST_SYNC_TRIES    4
+
+/*!
+ Offsets above this are stepped, smaller ones are slewed in at no more
+ than NTP_SLEW_MAX_PPM so that time never runs backwards.
+ */
+#define NTP_STEP_THRESHOLD_US   128000
+#define NTP_SLEW_MAX_PPM        500
+
+/*! Limit of the frequency correction learned between polls */
+#define NTP_FREQ_MAX_PPB        500000
+
+/*! Assumed wander of the disciplined clock, grows the error estimate */
+#define NTP_TOLERANCE_PPM       15
+
+/*! Period of the clock adjustments in milliseconds */
+#define NTP_TICK_MS             1000
+
+/*! Synchronization state of the time service */
+typedef enum
+{
+    /*! Clock was never set */
+    Ntp_state_unsynced,
+    /*! Clock follows a server that answered within the last polls */
+    Ntp_state_synced,
+    /*! Clock was set but the servers are not reachable */
+    Ntp_state_holdover
+} Ntp_state_t;
+
+/*! Snapshot of the time service */
+typedef struct
+{
+    Ntp_state_t state;
+    /*! Index in NTP_SERVER_NAMES of the selected server, -1 if none */
+    int8_t server;
+    /*! Stratum of the selected server */
+    uint8_t stratum;
+    /*! Current poll interval in seconds */
+    uint16_t pollSec;
+    /*! Wall clock seconds of the last accepted measurement */
+    uint32_t lastSync;
+    /*! Last measured offset in microseconds */
+    int32_t offsetUs;
+    /*! Part of the offset that is still being slewed in */
+    int32_t slewUs;
+    /*! Learned frequency correction in parts per billion */
+    int32_t freqPpb;
+    /*! Estimated bound of the clock error right now in microseconds */
+    uint32_t errorUs;
+} Ntp_status_t;
+
+/*!
+ * @brief       Create the time service task. The task stays idle until
+ *              Ntp_start is called.
+ *
+ * @param       clientMq - queue that receives GatewayEvent_TIME_UPDATE
+ *                         after the first sync, after every step of the
+ *                         clock and when the first sync is given up on
+ */
+extern void Ntp_init(char *clientMq);
+
+/*!
+ * @brief       Start polling the servers right away. Does not wait for
+ *              the result.
+ */
+extern void Ntp_start(void);
+
+/*!
+ * @brief       Stop polling, the clock keeps running on the learned
+ *              frequency correction.
+ */
+extern void Ntp_stop(void);
+
+/*!
+ * @brief       Get the synchronization state and error estimate
+ *
+ * @param       pStatus - filled with the current state
+ */
+extern void Ntp_getStatus(Ntp_status_t *pStatus);
+
+/*!
+ * @brief       Map a monotonic time stamp to wall clock time. The offset
+ *              between both clocks follows every adjustment, so a stamp
+ *              taken before a correction maps to the corrected time.
+ *
+ * @param       monoMs - Util_getTimeMs() at the time of the event, at most
+ *                       49 days in the past
+ *
+ * @return      milliseconds since 00:00 Jan 1 1970 UTC
+ */
+extern uint64_t Ntp_toUtcMs(uint32_t monoMs);
+
+//*****************************************************************************
+//
+// Mark the end of the C bindings section for C++ compilers.
+//
+//*****************************************************************************
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* GATEWAY_STARTSNTP_H_ */
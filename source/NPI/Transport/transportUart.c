@@ -9,6 +9,7 @@
 #include <ti/sysbios/BIOS.h>
 
  #include <Common/commonDefs.h>
+ #include <Utils/mqStats.h>
 
  #include "mqueue.h"
 
@@ -169,5 +170,5 @@ void transportReadCb(UART_Handle handle, void *buf, size_t count)
     //incoming messages should have a higher priority
     // so NPI handles them before trying to send anything back to the CoP
     // TODO: Check for mq return value in case queue is full
-    mq_send(*readMq, (char*)&npiReportReadMq, sizeof(msgQueue_t), MQ_HIGH_PRIOR);
+    MqStats_send(*readMq, &npiReportReadMq, MQ_HIGH_PRIOR);
 }
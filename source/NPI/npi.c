@@ -47,6 +47,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <Common/commonDefs.h>
+#include <Utils/mqStats.h>
 #include <Board.h>
 #include <npiParse.h>
 #include "mqueue.h"
@@ -77,14 +78,11 @@ int npiInit(const char *npiMqName)
     pthread_attr_t pAttrs;
     struct sched_param priParam;
     int ret = 0;
-    /* mode is not implemented in TI-RTOS POSIX wrappers */
-    /* modify mode as needed if running in a different platform */
-    unsigned mode = 0;
 
     /* sync object for inter thread communication                             */
     attr.mq_maxmsg = 50;
     attr.mq_msgsize = sizeof(msgQueue_t);
-    npiMqHandle = mq_open(npiMqName, O_CREAT, mode, &attr);
+    npiMqHandle = MqStats_open(npiMqName, O_CREAT, &attr);
 
     pthread_attr_init(&pAttrs);
     priParam.sched_priority = NPI_TASK_PRI;
@@ -103,7 +101,7 @@ int npiInit(const char *npiMqName)
 // for example one task registers for 15.4 stack and another one registers for BLE
 void npiCliMqReg(const char *npiClientMq)
 {
-    appRegisterMq = mq_open(npiClientMq, O_RDWR); // set to read write so we can flush srsps
+    appRegisterMq = MqStats_open(npiClientMq, O_RDWR, NULL); // set to read write so we can flush srsps
     mtRegisterSrspMq(MT_SRSP_MQ);
     mtRegisterClientMq(&appRegisterMq);
     mtRegisterServerMq(&npiMqHandle);
@@ -123,7 +121,7 @@ void * npiThread(void *pvParameters)
         incomingMsg.msgPtr = NULL;
         incomingMsg.msgPtrLen = 0;
         // block here and wait for a msg from either transport or the application
-        mq_receive(npiMqHandle, (char*)&incomingMsg, sizeof(msgQueue_t), NULL);
+        MqStats_receive(npiMqHandle, &incomingMsg);
         switch (incomingMsg.event)
         {
         case NPIEvent_TRANSPRT_RX:
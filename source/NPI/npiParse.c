@@ -48,7 +48,10 @@
 #include <string.h>
 #include <mqueue.h>
 #include <Common/commonDefs.h>
+#define LOG_MODULE LogModule_NPI
 #include <Utils/uart_term.h>
+#include <Utils/util.h>
+#include <Utils/mqStats.h>
 #include "npiParse.h"
 
 #define xNPI_DEBUG
@@ -59,6 +62,7 @@
 static mqd_t *clientMq = NULL;
 static mqd_t mtSrspMq;
 static mqd_t *mtServerMq = NULL; // NPI queue from applications perspective
+static uint32_t mtRxTime; // Util_getTimeMs() at the SOF of the frame being read
 
 /*!----------------------------------------------------------------------------
  * \brief  Calculates FCS for MT Frame
@@ -81,7 +85,7 @@ void mtRegisterSrspMq(const char *mtMqName)
     mq_attr attr;
     attr.mq_maxmsg = 30;
     attr.mq_msgsize = sizeof(msgQueue_t);
-    mtSrspMq = mq_open(mtMqName, O_CREAT | O_NONBLOCK, 0, &attr);
+    mtSrspMq = MqStats_open(mtMqName, O_CREAT | O_NONBLOCK, &attr);
 }
 void mtRegisterServerMq(mqd_t *mqHandle)
 {
@@ -98,6 +102,8 @@ uint32_t mtProcessInCmd(uint8_t * data, uint32_t len)
         case MT_WAITING_SOF:
             if(len == MT_SOF_LEN && data[0] == MT_SOF)
             {
+                /* stamp at ingress, before the frame waits in any queue */
+                mtRxTime = Util_getTimeMs();
                 readBytes = MT_HDR_LEN; // TODO: if supporting Unified NPI modify this length
                 rxState = MT_WAITING_HEADER;
             }
@@ -106,7 +112,7 @@ uint32_t mtProcessInCmd(uint8_t * data, uint32_t len)
             // header parser, check if there is SOF if not return 4 to read another header dont change state
             if(len == MT_HDR_LEN) // if for some reason this function is called with a different length then something went wrong go back to waiting for SOF
             {
-                currentMtPacket = (uint8_t*)malloc((size_t)(MT_HDR_LEN + data[0]));
+                currentMtPacket = (uint8_t*)malloc((size_t)(MT_HDR_LEN + data[0] + MT_RX_TIME_LEN));
                 memcpy(currentMtPacket, data, MT_HDR_LEN);
                 //TODO: if supporting unified NPI then modify line below because unified uses 2 Byte length
                 readBytes = (uint32_t)(data[0] + MT_FCS_LEN);
@@ -129,6 +135,7 @@ uint32_t mtProcessInCmd(uint8_t * data, uint32_t len)
             if(len == (currLen + MT_FCS_LEN))
             {
                 memcpy((currentMtPacket + MT_HDR_LEN), data, currLen);
+                memcpy((currentMtPacket + MT_HDR_LEN + currLen), &mtRxTime, MT_RX_TIME_LEN);
                 calcFCS = mtCalcFCS(currentMtPacket, MT_HDR_LEN + currLen);
                 if(calcFCS == data[len - 1])
                 {
@@ -153,11 +160,11 @@ uint32_t mtProcessInCmd(uint8_t * data, uint32_t len)
                     if(prio == MQ_HIGH_PRIOR)
                     {
                         clientReportMsg.event = MtEvent_RECEIVED_SRSP;
-                        mq_send(mtSrspMq, (char*)&clientReportMsg, sizeof(msgQueue_t), prio);
+                        MqStats_send(mtSrspMq, &clientReportMsg, prio);
                     }
                     else
                     {
-                        mq_send(*clientMq, (char*)&clientReportMsg, sizeof(msgQueue_t), prio);
+                        MqStats_send(*clientMq, &clientReportMsg, prio);
                     }
 
                 }
@@ -206,6 +213,7 @@ void Mt_bufToMsg(mtMsg_t *inMtMsg, uint8_t *pBuf)
         temppBuf++;
         inMtMsg->attrs = (uint8_t*)malloc(inMtMsg->len);
         memcpy(inMtMsg->attrs, temppBuf, inMtMsg->len);
+        memcpy(&inMtMsg->rxTime, temppBuf + inMtMsg->len, MT_RX_TIME_LEN);
     }
 }
 void Mt_sendCmd(mtMsg_t *cmdDesc)
@@ -231,7 +239,7 @@ void Mt_sendCmd(mtMsg_t *cmdDesc)
     UART_PRINT("\n\r");
 #endif
     //send message to NPI task
-    mq_send(*mtServerMq, (char*)&serverReportMsg, sizeof(msgQueue_t), MQ_LOW_PRIOR);
+    MqStats_send(*mtServerMq, &serverReportMsg, MQ_LOW_PRIOR);
 }
 
 
@@ -249,7 +257,7 @@ uint8_t Mt_rcvSrsp(mtMsg_t *cmdDesc)
         incomingMsg.event = 0xff;
         incomingMsg.msgPtr = NULL;
         usleep(MT_SRSP_SLEEP_TIMEOUT);
-        mq_receive(mtSrspMq, (char*)&incomingMsg, sizeof(msgQueue_t), NULL);
+        MqStats_receive(mtSrspMq, &incomingMsg);
         if(incomingMsg.event == MtEvent_RECEIVED_SRSP)
         {
             Mt_bufToMsg(&tempCmd, incomingMsg.msgPtr);
@@ -293,6 +301,7 @@ void Mt_parseCmd(uint8_t *inCmd, int32_t cmdLen)
     parsedCmd.len = inCmd[0];
     parsedCmd.cmd0 = inCmd[1];
     parsedCmd.cmd1 = inCmd[2];
+    memcpy(&parsedCmd.rxTime, &inCmd[MT_HDR_LEN + parsedCmd.len], MT_RX_TIME_LEN);
 
     if(parsedCmd.len > 0)
     {
@@ -86,6 +86,9 @@ extern "C"
 
 #define MT_UART_HDR_LEN           (MT_SOF_LEN + MT_HDR_LEN)
 
+/* host receive time appended behind the frames handed to the MT clients */
+#define MT_RX_TIME_LEN            (4)
+
 #define MT_FAIL     0xFF
 
 // Cmd0 Command Type
@@ -147,6 +150,7 @@ typedef struct
     uint8_t cmd0;
     uint8_t cmd1;
     uint8_t *attrs;
+    uint32_t rxTime; // Util_getTimeMs() when the SOF of the frame was read
 } mtMsg_t;
 
 
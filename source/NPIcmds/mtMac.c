@@ -52,6 +52,17 @@
 #include <NPI/npiParse.h>
 #include "mtMac.h"
 
+/*
+ Number of MAC_ADD_DEVICE_REQ requests kept outstanding by
+ MtMac_addDeviceListReq(). The coprocessor queues the requests on its
+ NPI port and answers them in order, so the UART and the coprocessor
+ stay busy instead of idling for every round trip. Set to 1 to fall
+ back to strict request/response.
+ */
+#ifndef MT_ADD_DEVICE_PIPELINE_DEPTH
+#define MT_ADD_DEVICE_PIPELINE_DEPTH 4
+#endif
+
 
 /*============== AREQs ==============*/
 
@@ -77,6 +88,9 @@ static void MtMac_processWsAsyncCnf(mtMsg_t *inMtCmd);
 
 static MtMac_callbacks_t *mtMacCbs = NULL;
 
+static void MtMac_sendAddDeviceReq(MtMac_addDeviceReq_t *pData);
+static uint8_t MtMac_rcvAddDeviceSrsp(void);
+
 void MtMac_RegisterCbs(MtMac_callbacks_t *pCbFuncs)
 {
     mtMacCbs = pCbFuncs;
@@ -190,6 +204,7 @@ void MtMac_processDataInd(mtMsg_t *inMtCmd)
 	    uint8_t *attrPtr = inMtCmd->attrs;
         MtMac_dataInd_t aReqCmd;
 
+        aReqCmd.RxTime = inMtCmd->rxTime;
         aReqCmd.SrcAddrMode = *attrPtr;
         attrPtr++;
         memcpy(aReqCmd.SrcAddr, attrPtr, 8);
@@ -1156,9 +1171,44 @@ uint8_t MtMac_updatePanidReq(MtMac_updatePanidReq_t *pData)
 
 uint8_t MtMac_addDeviceReq(MtMac_addDeviceReq_t *pData)
 {
-    uint8_t srspStatus = MT_FAIL;
+    MtMac_sendAddDeviceReq(pData);
+
+    return MtMac_rcvAddDeviceSrsp();
+}
+
+uint8_t MtMac_addDeviceListReq(MtMac_addDeviceReq_t *pData, uint16_t numDevices)
+{
+    uint8_t srspStatus = MT_SUCCESS;
+    uint16_t sent = 0;
+    uint16_t acked = 0;
+
+    while(acked < numDevices)
+    {
+        uint8_t status;
+
+        /* Top up the window before waiting for the oldest response */
+        while((sent < numDevices)
+              && ((sent - acked) < MT_ADD_DEVICE_PIPELINE_DEPTH))
+        {
+            MtMac_sendAddDeviceReq(&pData[sent]);
+            sent++;
+        }
+
+        /* Responses come back in request order */
+        status = MtMac_rcvAddDeviceSrsp();
+        if((status != MT_SUCCESS) && (srspStatus == MT_SUCCESS))
+        {
+            srspStatus = status;
+        }
+        acked++;
+    }
+
+    return srspStatus;
+}
+
+static void MtMac_sendAddDeviceReq(MtMac_addDeviceReq_t *pData)
+{
     mtMsg_t cmdDesc;
-    uint8_t *srspAttrBuf;
 
     cmdDesc.len = 0x1D;
     cmdDesc.cmd0 = MT_CMD_SREQ | MT_MAC;
@@ -1188,6 +1238,17 @@ uint8_t MtMac_addDeviceReq(MtMac_addDeviceReq_t *pData)
 
     Mt_sendCmd(&cmdDesc);
     free(cmdDesc.attrs);
+}
+
+static uint8_t MtMac_rcvAddDeviceSrsp(void)
+{
+    uint8_t srspStatus = MT_FAIL;
+    mtMsg_t cmdDesc;
+    uint8_t *srspAttrBuf;
+
+    cmdDesc.cmd0 = MT_CMD_SREQ | MT_MAC;
+    cmdDesc.cmd1 = MAC_ADD_DEVICE_REQ;
+
     if(Mt_rcvSrsp(&cmdDesc) == MT_SUCCESS)
     {
         if(cmdDesc.len > 0 && cmdDesc.attrs != NULL)
@@ -108,6 +108,7 @@ typedef struct
     uint16_t IELength;
     uint8_t *DataPayload;
     uint8_t *IEPayload;
+    uint32_t RxTime;
 }MtMac_dataInd_t;
 
 typedef struct
@@ -666,6 +667,7 @@ uint8_t MtMac_securityGetReq(MtMac_securityGetReq_t *pData, MtMac_securityGetReq
 uint8_t MtMac_securitySetReq(MtMac_securitySetReq_t *pData);
 uint8_t MtMac_updatePanidReq(MtMac_updatePanidReq_t *pData);
 uint8_t MtMac_addDeviceReq(MtMac_addDeviceReq_t *pData);
+uint8_t MtMac_addDeviceListReq(MtMac_addDeviceReq_t *pData, uint16_t numDevices);
 uint8_t MtMac_deleteDeviceReq(MtMac_deleteDeviceReq_t *pData);
 uint8_t MtMac_deleteAllDevicesReq(void);
 uint8_t MtMac_deleteKeyReq(MtMac_deleteKeyReq_t *pData);
@@ -0,0 +1,353 @@
+/******************************************************************************
+
+ @file cbor.c
+
+ @brief Bounded CBOR (RFC 7049) writer and reader
+
+ Group: WCS LPC
+ Target Device: CC13xx CC32xx
+
+ ******************************************************************************
+
+ Copyright (c) 2016-2017, Texas Instruments Incorporated
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions
+ are met:
+
+ *  Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+
+ *  Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+
+ *  Neither the name of Texas Instruments Incorporated nor the names of
+    its contributors may be used to endorse or promote products derived
+    from this software without specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+ ******************************************************************************
+ Release Name:
+ Release Date:
+ *****************************************************************************/
+
+/******************************************************************************
+ Includes
+ *****************************************************************************/
+#include <string.h>
+#include "cbor.h"
+
+/******************************************************************************
+ Constants and definitions
+ *****************************************************************************/
+
+/* Additional information of a head: value in the next 1, 2, 4 or 8 bytes */
+#define CBOR_AI_1BYTE       24
+#define CBOR_AI_2BYTES      25
+#define CBOR_AI_4BYTES      26
+#define CBOR_AI_8BYTES      27
+
+/******************************************************************************
+ Local function prototypes
+ *****************************************************************************/
+static void put(CborWriter_t *pWriter, const uint8_t *pData, uint16_t len);
+static void putHead(CborWriter_t *pWriter, uint8_t major, uint64_t value);
+
+/******************************************************************************
+ Public Functions
+ *****************************************************************************/
+
+/*!
+ Start an encoding in a buffer
+
+ Public function defined in cbor.h
+ */
+void CborWriter_init(CborWriter_t *pWriter, uint8_t *pBuf, uint16_t size)
+{
+    pWriter->pBuf = pBuf;
+    pWriter->size = size;
+    pWriter->len = 0;
+    pWriter->truncated = false;
+}
+
+/*!
+ Open a map
+
+ Public function defined in cbor.h
+ */
+void CborWriter_map(CborWriter_t *pWriter, uint32_t count)
+{
+    putHead(pWriter, CBOR_MAJOR_MAP, count);
+}
+
+/*!
+ Open an array
+
+ Public function defined in cbor.h
+ */
+void CborWriter_array(CborWriter_t *pWriter, uint32_t count)
+{
+    putHead(pWriter, CBOR_MAJOR_ARRAY, count);
+}
+
+/*!
+ Write an unsigned integer
+
+ Public function defined in cbor.h
+ */
+void CborWriter_uint(CborWriter_t *pWriter, uint64_t value)
+{
+    putHead(pWriter, CBOR_MAJOR_UINT, value);
+}
+
+/*!
+ Write a signed integer
+
+ Public function defined in cbor.h
+ */
+void CborWriter_int(CborWriter_t *pWriter, int64_t value)
+{
+    if(value < 0)
+    {
+        /* -1 - n is encoded as n */
+        putHead(pWriter, CBOR_MAJOR_NINT, (uint64_t)(-1 - value));
+    }
+    else
+    {
+        putHead(pWriter, CBOR_MAJOR_UINT, (uint64_t)value);
+    }
+}
+
+/*!
+ Write a text string
+
+ Public function defined in cbor.h
+ */
+void CborWriter_text(CborWriter_t *pWriter, const char *pStr)
+{
+    uint16_t len = (uint16_t)strlen(pStr);
+
+    putHead(pWriter, CBOR_MAJOR_TEXT, len);
+    put(pWriter, (const uint8_t*)pStr, len);
+}
+
+/*!
+ Write a byte string
+
+ Public function defined in cbor.h
+ */
+void CborWriter_bytes(CborWriter_t *pWriter, const uint8_t *pData, uint16_t len)
+{
+    putHead(pWriter, CBOR_MAJOR_BYTES, len);
+    put(pWriter, pData, len);
+}
+
+/*!
+ Write true or false
+
+ Public function defined in cbor.h
+ */
+void CborWriter_bool(CborWriter_t *pWriter, bool value)
+{
+    putHead(pWriter, CBOR_MAJOR_SIMPLE, value ? CBOR_TRUE : CBOR_FALSE);
+}
+
+/*!
+ End the encoding
+
+ Public function defined in cbor.h
+ */
+int32_t CborWriter_finish(CborWriter_t *pWriter)
+{
+    if(pWriter->truncated)
+    {
+        return -1;
+    }
+    return pWriter->len;
+}
+
+/*!
+ Start reading an encoding
+
+ Public function defined in cbor.h
+ */
+void CborReader_init(CborReader_t *pReader, const uint8_t *pBuf, uint16_t len)
+{
+    pReader->pBuf = pBuf;
+    pReader->len = len;
+    pReader->pos = 0;
+}
+
+/*!
+ Read the next item
+
+ Public function defined in cbor.h
+ */
+bool CborReader_next(CborReader_t *pReader, CborItem_t *pItem)
+{
+    uint8_t head;
+    uint8_t info;
+    uint8_t numBytes;
+
+    if(pReader->pos >= pReader->len)
+    {
+        return false;
+    }
+    head = pReader->pBuf[pReader->pos++];
+    pItem->major = head >> 5;
+    pItem->pData = NULL;
+    info = head & 0x1F;
+    if(info < CBOR_AI_1BYTE)
+    {
+        pItem->value = info;
+    }
+    else
+    {
+        if(info > CBOR_AI_8BYTES)
+        {
+            /* Indefinite lengths and reserved values */
+            return false;
+        }
+        numBytes = 1 << (info - CBOR_AI_1BYTE);
+        if((pReader->len - pReader->pos) < numBytes)
+        {
+            return false;
+        }
+        pItem->value = 0;
+        while(numBytes--)
+        {
+            pItem->value = (pItem->value << 8) | pReader->pBuf[pReader->pos++];
+        }
+    }
+
+    if((pItem->major == CBOR_MAJOR_BYTES) || (pItem->major == CBOR_MAJOR_TEXT))
+    {
+        if(pItem->value > (uint64_t)(pReader->len - pReader->pos))
+        {
+            return false;
+        }
+        pItem->pData = &pReader->pBuf[pReader->pos];
+        pReader->pos += (uint16_t)pItem->value;
+    }
+    return true;
+}
+
+/*!
+ Pass over the contents of an item
+
+ Public function defined in cbor.h
+ */
+bool CborReader_skip(CborReader_t *pReader, const CborItem_t *pItem)
+{
+    CborItem_t item = *pItem;
+    uint32_t pending = 0;
+
+    /* Counting the items left is enough, no stack of containers is kept */
+    for(;;)
+    {
+        if(item.major == CBOR_MAJOR_ARRAY)
+        {
+            pending += (uint32_t)item.value;
+        }
+        else if(item.major == CBOR_MAJOR_MAP)
+        {
+            pending += 2 * (uint32_t)item.value;
+        }
+        else if(item.major == CBOR_MAJOR_TAG)
+        {
+            pending++;
+        }
+        if(pending == 0)
+        {
+            return true;
+        }
+        if(!CborReader_next(pReader, &item))
+        {
+            return false;
+        }
+        pending--;
+    }
+}
+
+/******************************************************************************
+ Local Functions
+ *****************************************************************************/
+
+/*!
+ * @brief       Append bytes, nothing more is written once they do not fit
+ *
+ * @param       pWriter - writer
+ * @param       pData - bytes
+ * @param       len - number of bytes
+ */
+static void put(CborWriter_t *pWriter, const uint8_t *pData, uint16_t len)
+{
+    if(pWriter->truncated || (len > (pWriter->size - pWriter->len)))
+    {
+        pWriter->truncated = true;
+        return;
+    }
+    memcpy(&pWriter->pBuf[pWriter->len], pData, len);
+    pWriter->len += len;
+}
+
+/*!
+ * @brief       Append the head of an item, in its shortest form
+ *
+ * @param       pWriter - writer
+ * @param       major - major type
+ * @param       value - value, length or count
+ */
+static void putHead(CborWriter_t *pWriter, uint8_t major, uint64_t value)
+{
+    uint8_t head[9];
+    uint8_t numBytes;
+
+    if(value < CBOR_AI_1BYTE)
+    {
+        head[0] = (uint8_t)((major << 5) | value);
+        put(pWriter, head, 1);
+        return;
+    }
+
+    if(value <= 0xFF)
+    {
+        head[0] = (uint8_t)((major << 5) | CBOR_AI_1BYTE);
+        numBytes = 1;
+    }
+    else if(value <= 0xFFFF)
+    {
+        head[0] = (uint8_t)((major << 5) | CBOR_AI_2BYTES);
+        numBytes = 2;
+    }
+    else if(value <= 0xFFFFFFFF)
+    {
+        head[0] = (uint8_t)((major << 5) | CBOR_AI_4BYTES);
+        numBytes = 4;
+    }
+    else
+    {
+        head[0] = (uint8_t)((major << 5) | CBOR_AI_8BYTES);
+        numBytes = 8;
+    }
+    /* Network byte order */
+    for(uint8_t idx = numBytes; idx > 0; idx--)
+    {
+        head[idx] = (uint8_t)value;
+        value >>= 8;
+    }
+    put(pWriter, head, numBytes + 1);
+}
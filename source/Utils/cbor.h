@@ -0,0 +1,227 @@
+/******************************************************************************
+
+ @file cbor.h
+
+ @brief Bounded CBOR (RFC 7049) writer and reader
+
+ Group: WCS LPC
+ Target Device: CC13xx CC32xx
+
+ ******************************************************************************
+
+ Copyright (c) 2016-2017, Texas Instruments Incorporated
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions
+ are met:
+
+ *  Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+
+ *  Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+
+ *  Neither the name of Texas Instruments Incorporated nor the names of
+    its contributors may be used to endorse or promote products derived
+    from this software without specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+ ******************************************************************************
+ Release Name:
+ Release Date:
+ *****************************************************************************/
+
+#ifndef UTILS_CBOR_H_
+#define UTILS_CBOR_H_
+
+//*****************************************************************************
+//
+// If building with a C++ compiler, make all of the definitions in this header
+// have a C binding.
+//
+//*****************************************************************************
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/*! Major types */
+#define CBOR_MAJOR_UINT         0
+#define CBOR_MAJOR_NINT         1
+#define CBOR_MAJOR_BYTES        2
+#define CBOR_MAJOR_TEXT         3
+#define CBOR_MAJOR_ARRAY        4
+#define CBOR_MAJOR_MAP          5
+#define CBOR_MAJOR_TAG          6
+#define CBOR_MAJOR_SIMPLE       7
+
+/*! Simple values */
+#define CBOR_FALSE              20
+#define CBOR_TRUE               21
+#define CBOR_NULL               22
+
+/*!
+ Writer state. Arrays and maps are written with their number of items, so
+ the caller knows it when opening them, and there is nothing to close.
+ */
+typedef struct
+{
+    uint8_t *pBuf;
+    uint16_t size;
+    uint16_t len;
+    /*! The output did not fit, everything written afterwards is dropped */
+    bool truncated;
+} CborWriter_t;
+
+/*! Item read by CborReader_next() */
+typedef struct
+{
+    uint8_t major;
+    /*! Value of an integer or simple value, length of a string, number of
+        items of an array, number of pairs of a map, number of a tag */
+    uint64_t value;
+    /*! Characters of a string, not NUL terminated */
+    const uint8_t *pData;
+} CborItem_t;
+
+/*! Reader state */
+typedef struct
+{
+    const uint8_t *pBuf;
+    uint16_t len;
+    uint16_t pos;
+} CborReader_t;
+
+/*!
+ * @brief       Start an encoding in a buffer
+ *
+ * @param       pWriter - writer
+ * @param       pBuf - output buffer
+ * @param       size - size of the buffer
+ */
+extern void CborWriter_init(CborWriter_t *pWriter, uint8_t *pBuf, uint16_t size);
+
+/*!
+ * @brief       Open a map, it is followed by count keys each with its value
+ *
+ * @param       pWriter - writer
+ * @param       count - number of pairs
+ */
+extern void CborWriter_map(CborWriter_t *pWriter, uint32_t count);
+
+/*!
+ * @brief       Open an array, it is followed by count items
+ *
+ * @param       pWriter - writer
+ * @param       count - number of items
+ */
+extern void CborWriter_array(CborWriter_t *pWriter, uint32_t count);
+
+/*!
+ * @brief       Write an unsigned integer, also used for integer map keys
+ *
+ * @param       pWriter - writer
+ * @param       value - value
+ */
+extern void CborWriter_uint(CborWriter_t *pWriter, uint64_t value);
+
+/*!
+ * @brief       Write a signed integer
+ *
+ * @param       pWriter - writer
+ * @param       value - value
+ */
+extern void CborWriter_int(CborWriter_t *pWriter, int64_t value);
+
+/*!
+ * @brief       Write a text string
+ *
+ * @param       pWriter - writer
+ * @param       pStr - NUL terminated UTF-8 string
+ */
+extern void CborWriter_text(CborWriter_t *pWriter, const char *pStr);
+
+/*!
+ * @brief       Write a byte string
+ *
+ * @param       pWriter - writer
+ * @param       pData - bytes
+ * @param       len - number of bytes
+ */
+extern void CborWriter_bytes(CborWriter_t *pWriter, const uint8_t *pData, uint16_t len);
+
+/*!
+ * @brief       Write true or false
+ *
+ * @param       pWriter - writer
+ * @param       value - value
+ */
+extern void CborWriter_bool(CborWriter_t *pWriter, bool value);
+
+/*!
+ * @brief       End the encoding
+ *
+ * @param       pWriter - writer
+ *
+ * @return      length of the encoding, -1 if it was truncated
+ */
+extern int32_t CborWriter_finish(CborWriter_t *pWriter);
+
+/*!
+ * @brief       Start reading an encoding
+ *
+ * @param       pReader - reader
+ * @param       pBuf - encoding
+ * @param       len - length of the encoding
+ */
+extern void CborReader_init(CborReader_t *pReader, const uint8_t *pBuf, uint16_t len);
+
+/*!
+ * @brief       Read the next item. The contents of a string are passed
+ *              over, those of an array or a map are the next items.
+ *              Indefinite lengths are not supported.
+ *
+ * @param       pReader - reader
+ * @param       pItem - item read
+ *
+ * @return      false at the end of the encoding or if it is not valid
+ */
+extern bool CborReader_next(CborReader_t *pReader, CborItem_t *pItem);
+
+/*!
+ * @brief       Pass over the contents of an item just read, i.e. all the
+ *              items of an array or a map and the item of a tag
+ *
+ * @param       pReader - reader
+ * @param       pItem - item read last
+ *
+ * @return      false if the encoding ends first or is not valid
+ */
+extern bool CborReader_skip(CborReader_t *pReader, const CborItem_t *pItem);
+
+//*****************************************************************************
+//
+// Mark the end of the C bindings section for C++ compilers.
+//
+//*****************************************************************************
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* UTILS_CBOR_H_ */
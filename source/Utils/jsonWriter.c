@@ -0,0 +1,493 @@
+/******************************************************************************
+
+ @file jsonWriter.c
+
+ @brief Bounded streaming JSON writer
+
+ Group: WCS LPC
+ Target Device: CC13xx CC32xx
+
+ ******************************************************************************
+
+ Copyright (c) 2016-2017, Texas Instruments Incorporated
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions
+ are met:
+
+ *  Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+
+ *  Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+
+ *  Neither the name of Texas Instruments Incorporated nor the names of
+    its contributors may be used to endorse or promote products derived
+    from this software without specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+ ******************************************************************************
+ Release Name:
+ Release Date:
+ *****************************************************************************/
+
+/******************************************************************************
+ Includes
+ *****************************************************************************/
+#include <string.h>
+#include "jsonWriter.h"
+
+/******************************************************************************
+ Constants and definitions
+ *****************************************************************************/
+
+/* Digits of the largest 32 bit number, and of a 64 bit one in hexadecimal */
+#define UINT_MAX_DIGITS     10
+#define HEX_MAX_DIGITS      16
+
+/******************************************************************************
+ Local function prototypes
+ *****************************************************************************/
+static void put(JsonWriter_t *pWriter, const char *pData, uint16_t len);
+static void putChar(JsonWriter_t *pWriter, char c);
+static void putEscaped(JsonWriter_t *pWriter, const char *pStr);
+static void putUint(JsonWriter_t *pWriter, uint32_t value, bool negative);
+static void startValue(JsonWriter_t *pWriter, const char *pKey);
+static void openLevel(JsonWriter_t *pWriter, const char *pKey, char c);
+static void closeLevel(JsonWriter_t *pWriter, char c);
+
+/******************************************************************************
+ Public Functions
+ *****************************************************************************/
+
+/*!
+ Start a document in a buffer
+
+ Public function defined in jsonWriter.h
+ */
+void JsonWriter_init(JsonWriter_t *pWriter, char *pBuf, uint16_t size)
+{
+    memset(pWriter, 0, sizeof(JsonWriter_t));
+    pWriter->pBuf = pBuf;
+    pWriter->size = size;
+}
+
+/*!
+ Hand the buffer to a sink each time it is full
+
+ Public function defined in jsonWriter.h
+ */
+void JsonWriter_setSink(JsonWriter_t *pWriter, JsonWriter_sinkFp_t pfnSink,
+                        void *pArg)
+{
+    pWriter->pfnSink = pfnSink;
+    pWriter->pSinkArg = pArg;
+}
+
+/*!
+ Open an object
+
+ Public function defined in jsonWriter.h
+ */
+void JsonWriter_beginObject(JsonWriter_t *pWriter, const char *pKey)
+{
+    openLevel(pWriter, pKey, '{');
+}
+
+/*!
+ Close the last object opened
+
+ Public function defined in jsonWriter.h
+ */
+void JsonWriter_endObject(JsonWriter_t *pWriter)
+{
+    closeLevel(pWriter, '}');
+}
+
+/*!
+ Open an array
+
+ Public function defined in jsonWriter.h
+ */
+void JsonWriter_beginArray(JsonWriter_t *pWriter, const char *pKey)
+{
+    openLevel(pWriter, pKey, '[');
+}
+
+/*!
+ Close the last array opened
+
+ Public function defined in jsonWriter.h
+ */
+void JsonWriter_endArray(JsonWriter_t *pWriter)
+{
+    closeLevel(pWriter, ']');
+}
+
+/*!
+ Write a string
+
+ Public function defined in jsonWriter.h
+ */
+void JsonWriter_string(JsonWriter_t *pWriter, const char *pKey,
+                       const char *pValue)
+{
+    startValue(pWriter, pKey);
+    putChar(pWriter, '"');
+    putEscaped(pWriter, pValue);
+    putChar(pWriter, '"');
+}
+
+/*!
+ Write a signed number
+
+ Public function defined in jsonWriter.h
+ */
+void JsonWriter_int(JsonWriter_t *pWriter, const char *pKey, int32_t value)
+{
+    startValue(pWriter, pKey);
+    if(value < 0)
+    {
+        putUint(pWriter, 0U - (uint32_t)value, true);
+    }
+    else
+    {
+        putUint(pWriter, (uint32_t)value, false);
+    }
+}
+
+/*!
+ Write an unsigned number
+
+ Public function defined in jsonWriter.h
+ */
+void JsonWriter_uint(JsonWriter_t *pWriter, const char *pKey, uint32_t value)
+{
+    startValue(pWriter, pKey);
+    putUint(pWriter, value, false);
+}
+
+/*!
+ Write a signed number as a string
+
+ Public function defined in jsonWriter.h
+ */
+void JsonWriter_intString(JsonWriter_t *pWriter, const char *pKey, int32_t value)
+{
+    startValue(pWriter, pKey);
+    putChar(pWriter, '"');
+    if(value < 0)
+    {
+        putUint(pWriter, 0U - (uint32_t)value, true);
+    }
+    else
+    {
+        putUint(pWriter, (uint32_t)value, false);
+    }
+    putChar(pWriter, '"');
+}
+
+/*!
+ Write a number as a hexadecimal string
+
+ Public function defined in jsonWriter.h
+ */
+void JsonWriter_hex(JsonWriter_t *pWriter, const char *pKey, uint64_t value,
+                    uint8_t minDigits, bool upper)
+{
+    const char *pDigits = upper ? "0123456789ABCDEF" : "0123456789abcdef";
+    char digits[HEX_MAX_DIGITS + 3];
+    char *pStr = &digits[sizeof(digits)];
+    uint8_t numDigits = 0;
+
+    *--pStr = '"';
+    do
+    {
+        *--pStr = pDigits[value & 0x0F];
+        value >>= 4;
+        numDigits++;
+    } while((value != 0) || ((numDigits < minDigits) && (numDigits < HEX_MAX_DIGITS)));
+
+    startValue(pWriter, pKey);
+    put(pWriter, "\"0x", 3);
+    put(pWriter, pStr, &digits[sizeof(digits)] - pStr);
+}
+
+/*!
+ Write true or false
+
+ Public function defined in jsonWriter.h
+ */
+void JsonWriter_bool(JsonWriter_t *pWriter, const char *pKey, bool value)
+{
+    startValue(pWriter, pKey);
+    if(value)
+    {
+        put(pWriter, "true", 4);
+    }
+    else
+    {
+        put(pWriter, "false", 5);
+    }
+}
+
+/*!
+ Write a value that is already JSON
+
+ Public function defined in jsonWriter.h
+ */
+void JsonWriter_raw(JsonWriter_t *pWriter, const char *pKey,
+                    const char *pJson, uint16_t len)
+{
+    startValue(pWriter, pKey);
+    put(pWriter, pJson, len);
+}
+
+/*!
+ End the document
+
+ Public function defined in jsonWriter.h
+ */
+int32_t JsonWriter_finish(JsonWriter_t *pWriter)
+{
+    pWriter->pBuf[pWriter->len] = '\0';
+    if((pWriter->pfnSink != NULL) && (pWriter->len > 0) && !pWriter->truncated)
+    {
+        if(!pWriter->pfnSink(pWriter->pSinkArg, pWriter->pBuf, pWriter->len))
+        {
+            pWriter->truncated = true;
+        }
+        pWriter->len = 0;
+    }
+
+    if(pWriter->truncated || (pWriter->depth != 0))
+    {
+        return -1;
+    }
+    return (int32_t)pWriter->total;
+}
+
+/******************************************************************************
+ Local Functions
+ *****************************************************************************/
+
+/*!
+ * @brief       Append characters, handing the buffer to the sink when full.
+ *              Once something did not fit nothing more is written, so the
+ *              output is a cut document and never a corrupted one.
+ *
+ * @param       pWriter - writer
+ * @param       pData - characters
+ * @param       len - number of characters
+ */
+static void put(JsonWriter_t *pWriter, const char *pData, uint16_t len)
+{
+    uint16_t space;
+
+    if(!pWriter->truncated && (len < (pWriter->size - pWriter->len)))
+    {
+        memcpy(&pWriter->pBuf[pWriter->len], pData, len);
+        pWriter->len += len;
+        pWriter->total += len;
+        return;
+    }
+    while((len > 0) && !pWriter->truncated)
+    {
+        space = pWriter->size - 1 - pWriter->len;
+        if(space == 0)
+        {
+            if((pWriter->pfnSink == NULL) ||
+               !pWriter->pfnSink(pWriter->pSinkArg, pWriter->pBuf, pWriter->len))
+            {
+                pWriter->truncated = true;
+                break;
+            }
+            pWriter->len = 0;
+            continue;
+        }
+        if(space > len)
+        {
+            space = len;
+        }
+        memcpy(&pWriter->pBuf[pWriter->len], pData, space);
+        pWriter->len += space;
+        pWriter->total += space;
+        pData += space;
+        len -= space;
+    }
+}
+
+/*!
+ * @brief       Append a character
+ *
+ * @param       pWriter - writer
+ * @param       c - character
+ */
+static void putChar(JsonWriter_t *pWriter, char c)
+{
+    if(!pWriter->truncated && (pWriter->len < (pWriter->size - 1)))
+    {
+        pWriter->pBuf[pWriter->len++] = c;
+        pWriter->total++;
+    }
+    else
+    {
+        put(pWriter, &c, 1);
+    }
+}
+
+/*!
+ * @brief       Append a string without its quotes. Runs of characters that
+ *              need no escape are copied at once.
+ *
+ * @param       pWriter - writer
+ * @param       pStr - NUL terminated string
+ */
+static void putEscaped(JsonWriter_t *pWriter, const char *pStr)
+{
+    static const char hexDigits[] = "0123456789abcdef";
+    const char *pRun = pStr;
+    char escape[6];
+    uint8_t c;
+
+    for(;;)
+    {
+        c = (uint8_t)*pStr;
+        if((c >= 0x20) && (c != '"') && (c != '\\'))
+        {
+            pStr++;
+            continue;
+        }
+        put(pWriter, pRun, pStr - pRun);
+        if(c == '\0')
+        {
+            break;
+        }
+
+        escape[0] = '\\';
+        switch(c)
+        {
+        case '"':
+        case '\\':
+            escape[1] = c;
+            put(pWriter, escape, 2);
+            break;
+        case '\n':
+            put(pWriter, "\\n", 2);
+            break;
+        case '\r':
+            put(pWriter, "\\r", 2);
+            break;
+        case '\t':
+            put(pWriter, "\\t", 2);
+            break;
+        default:
+            escape[1] = 'u';
+            escape[2] = '0';
+            escape[3] = '0';
+            escape[4] = hexDigits[c >> 4];
+            escape[5] = hexDigits[c & 0x0F];
+            put(pWriter, escape, 6);
+            break;
+        }
+        pRun = ++pStr;
+    }
+}
+
+/*!
+ * @brief       Append a number in decimal
+ *
+ * @param       pWriter - writer
+ * @param       value - magnitude of the number
+ * @param       negative - write a minus sign first
+ */
+static void putUint(JsonWriter_t *pWriter, uint32_t value, bool negative)
+{
+    char digits[UINT_MAX_DIGITS + 1];
+    char *pStr = &digits[sizeof(digits)];
+
+    do
+    {
+        *--pStr = (char)('0' + (value % 10));
+        value /= 10;
+    } while(value != 0);
+    if(negative)
+    {
+        *--pStr = '-';
+    }
+    put(pWriter, pStr, &digits[sizeof(digits)] - pStr);
+}
+
+/*!
+ * @brief       Write the separator and the member name of a value
+ *
+ * @param       pWriter - writer
+ * @param       pKey - member name, NULL for an array element
+ */
+static void startValue(JsonWriter_t *pWriter, const char *pKey)
+{
+    uint8_t levelBit = (uint8_t)(1 << pWriter->depth);
+
+    if(pWriter->hasMember & levelBit)
+    {
+        putChar(pWriter, ',');
+    }
+    pWriter->hasMember |= levelBit;
+    if(pKey != NULL)
+    {
+        putChar(pWriter, '"');
+        putEscaped(pWriter, pKey);
+        put(pWriter, "\":", 2);
+    }
+}
+
+/*!
+ * @brief       Open an object or an array
+ *
+ * @param       pWriter - writer
+ * @param       pKey - member name, NULL for an array element
+ * @param       c - opening character
+ */
+static void openLevel(JsonWriter_t *pWriter, const char *pKey, char c)
+{
+    startValue(pWriter, pKey);
+    if(pWriter->depth == (JSONWRITER_MAX_DEPTH - 1))
+    {
+        /* Too deep, the document cannot be written right */
+        pWriter->truncated = true;
+        return;
+    }
+    putChar(pWriter, c);
+    pWriter->depth++;
+    pWriter->hasMember &= (uint8_t)~(1 << pWriter->depth);
+}
+
+/*!
+ * @brief       Close an object or an array
+ *
+ * @param       pWriter - writer
+ * @param       c - closing character
+ */
+static void closeLevel(JsonWriter_t *pWriter, char c)
+{
+    if(pWriter->depth == 0)
+    {
+        pWriter->truncated = true;
+        return;
+    }
+    pWriter->depth--;
+    putChar(pWriter, c);
+}
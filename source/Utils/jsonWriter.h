@@ -0,0 +1,241 @@
+/******************************************************************************
+
+ @file jsonWriter.h
+
+ @brief Bounded streaming JSON writer
+
+ Group: WCS LPC
+ Target Device: CC13xx CC32xx
+
+ ******************************************************************************
+
+ Copyright (c) 2016-2017, Texas Instruments Incorporated
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions
+ are met:
+
+ *  Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+
+ *  Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+
+ *  Neither the name of Texas Instruments Incorporated nor the names of
+    its contributors may be used to endorse or promote products derived
+    from this software without specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+ ******************************************************************************
+ Release Name:
+ Release Date:
+ *****************************************************************************/
+
+#ifndef UTILS_JSONWRITER_H_
+#define UTILS_JSONWRITER_H_
+
+//*****************************************************************************
+//
+// If building with a C++ compiler, make all of the definitions in this header
+// have a C binding.
+//
+//*****************************************************************************
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/*! Deepest nesting of objects and arrays */
+#define JSONWRITER_MAX_DEPTH    8
+
+/*!
+ Sink taking the buffer once it is full, e.g. to send it as an HTTP
+ response chunk. Returns false when the data could not be taken, the
+ document is then truncated.
+ */
+typedef bool (*JsonWriter_sinkFp_t)(void *pArg, const char *pData, uint16_t len);
+
+/*!
+ Writer state. Members, array elements and the separators between them are
+ appended as they are written, nothing is formatted twice or read back.
+ */
+typedef struct
+{
+    /*! Output buffer, one byte is kept for the terminating NUL */
+    char *pBuf;
+    uint16_t size;
+    /*! Characters in the buffer */
+    uint16_t len;
+    /*! Characters written so far, including those taken by the sink */
+    uint32_t total;
+    JsonWriter_sinkFp_t pfnSink;
+    void *pSinkArg;
+    /*! Objects and arrays open */
+    uint8_t depth;
+    /*! One bit per depth, set once the level has a member */
+    uint8_t hasMember;
+    /*! The output did not fit, everything written afterwards is dropped */
+    bool truncated;
+} JsonWriter_t;
+
+/*!
+ * @brief       Start a document in a buffer. Without a sink the whole
+ *              document must fit in it.
+ *
+ * @param       pWriter - writer
+ * @param       pBuf - output buffer
+ * @param       size - size of the buffer, at least 2
+ */
+extern void JsonWriter_init(JsonWriter_t *pWriter, char *pBuf, uint16_t size);
+
+/*!
+ * @brief       Hand the buffer to a sink each time it is full, the buffer
+ *              is then reused for the rest of the document
+ *
+ * @param       pWriter - writer
+ * @param       pfnSink - sink
+ * @param       pArg - passed to the sink
+ */
+extern void JsonWriter_setSink(JsonWriter_t *pWriter, JsonWriter_sinkFp_t pfnSink,
+                               void *pArg);
+
+/*!
+ * @brief       Open an object
+ *
+ * @param       pWriter - writer
+ * @param       pKey - member name, NULL for an array element or the
+ *                     document itself
+ */
+extern void JsonWriter_beginObject(JsonWriter_t *pWriter, const char *pKey);
+
+/*!
+ * @brief       Close the last object opened
+ *
+ * @param       pWriter - writer
+ */
+extern void JsonWriter_endObject(JsonWriter_t *pWriter);
+
+/*!
+ * @brief       Open an array
+ *
+ * @param       pWriter - writer
+ * @param       pKey - member name, NULL for an array element or the
+ *                     document itself
+ */
+extern void JsonWriter_beginArray(JsonWriter_t *pWriter, const char *pKey);
+
+/*!
+ * @brief       Close the last array opened
+ *
+ * @param       pWriter - writer
+ */
+extern void JsonWriter_endArray(JsonWriter_t *pWriter);
+
+/*!
+ * @brief       Write a string, quotes and control characters are escaped
+ *
+ * @param       pWriter - writer
+ * @param       pKey - member name, NULL for an array element
+ * @param       pValue - NUL terminated string
+ */
+extern void JsonWriter_string(JsonWriter_t *pWriter, const char *pKey,
+                              const char *pValue);
+
+/*!
+ * @brief       Write a signed number
+ *
+ * @param       pWriter - writer
+ * @param       pKey - member name, NULL for an array element
+ * @param       value - number
+ */
+extern void JsonWriter_int(JsonWriter_t *pWriter, const char *pKey, int32_t value);
+
+/*!
+ * @brief       Write an unsigned number
+ *
+ * @param       pWriter - writer
+ * @param       pKey - member name, NULL for an array element
+ * @param       value - number
+ */
+extern void JsonWriter_uint(JsonWriter_t *pWriter, const char *pKey, uint32_t value);
+
+/*!
+ * @brief       Write a signed number as a string, e.g. "-30", for the
+ *              documents that carry numbers that way
+ *
+ * @param       pWriter - writer
+ * @param       pKey - member name, NULL for an array element
+ * @param       value - number
+ */
+extern void JsonWriter_intString(JsonWriter_t *pWriter, const char *pKey, int32_t value);
+
+/*!
+ * @brief       Write a number as a hexadecimal string, e.g. "0x00AB"
+ *
+ * @param       pWriter - writer
+ * @param       pKey - member name, NULL for an array element
+ * @param       value - number
+ * @param       minDigits - digits written at least, padded with zeros
+ * @param       upper - use A-F instead of a-f
+ */
+extern void JsonWriter_hex(JsonWriter_t *pWriter, const char *pKey, uint64_t value,
+                           uint8_t minDigits, bool upper);
+
+/*!
+ * @brief       Write true or false
+ *
+ * @param       pWriter - writer
+ * @param       pKey - member name, NULL for an array element
+ * @param       value - value
+ */
+extern void JsonWriter_bool(JsonWriter_t *pWriter, const char *pKey, bool value);
+
+/*!
+ * @brief       Write a value that is already JSON, e.g. a document
+ *              formatted by another task. It is copied as is.
+ *
+ * @param       pWriter - writer
+ * @param       pKey - member name, NULL for an array element
+ * @param       pJson - JSON value
+ * @param       len - length of the value
+ */
+extern void JsonWriter_raw(JsonWriter_t *pWriter, const char *pKey,
+                           const char *pJson, uint16_t len);
+
+/*!
+ * @brief       End the document: terminate the buffer and hand what is
+ *              left of it to the sink, if any
+ *
+ * @param       pWriter - writer
+ *
+ * @return      length of the document, -1 if it was truncated or objects
+ *              or arrays were left open
+ */
+extern int32_t JsonWriter_finish(JsonWriter_t *pWriter);
+
+//*****************************************************************************
+//
+// Mark the end of the C bindings section for C++ compilers.
+//
+//*****************************************************************************
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* UTILS_JSONWRITER_H_ */
@@ -0,0 +1,1075 @@
+/******************************************************************************
+
+ @file logRing.c
+
+ @brief Deferred logger, per-thread rings drained by a low priority task
+
+ Group: WCS LPC
+ Target Device: CC13xx CC32xx
+
+ ******************************************************************************
+
+ Copyright (c) 2016-2017, Texas Instruments Incorporated
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions
+ are met:
+
+ *  Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+
+ *  Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+
+ *  Neither the name of Texas Instruments Incorporated nor the names of
+    its contributors may be used to endorse or promote products derived
+    from this software without specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+ ******************************************************************************
+ Release Name:
+ Release Date:
+ *****************************************************************************/
+
+/******************************************************************************
+ Includes
+ *****************************************************************************/
+#include <string.h>
+#include <stdio.h>
+#include <stddef.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <Common/commonDefs.h>
+#include "util.h"
+#include "uart_term.h"
+#include "logRing.h"
+
+/******************************************************************************
+ Constants and definitions
+ *****************************************************************************/
+
+#define RING_MASK           (LOGRING_SIZE - 1)
+
+/* Argument of a conversion */
+#define ARG_NONE            0   /* %% */
+#define ARG_INT             1
+#define ARG_DOUBLE          2
+#define ARG_PTR             3
+#define ARG_STR             4
+#define ARG_BAD             5   /* not supported, ends the arguments */
+
+/* Length modifiers of integer conversions, h and hh are promoted to int */
+#define LEN_INT             0
+#define LEN_LONG            1
+#define LEN_LLONG           2
+#define LEN_INTMAX          3
+#define LEN_SIZE            4
+#define LEN_PTRDIFF         5
+
+/* Longest conversion specification, from '%' to the conversion character */
+#define MAX_SPEC            16
+
+/* Largest frame payload, the length is sent in one byte */
+#define MAX_PAYLOAD         255
+
+/* Record stored in a ring, followed by the arguments */
+typedef struct
+{
+    /* Size of the record, header included */
+    uint16_t len;
+    uint8_t module;
+    uint8_t level;
+    uint32_t time;
+    /* The format, identifies the line */
+    const char *pFormat;
+} logHdr_t;
+
+/* Conversion specification parsed from a format */
+typedef struct
+{
+    uint8_t arg;
+    uint8_t lenMod;
+    /* Number of '*' in width and precision, each takes an int */
+    uint8_t stars;
+    /* Characters from '%' to the conversion character */
+    uint8_t specLen;
+} logSpec_t;
+
+/* Single producer, single consumer ring */
+typedef struct
+{
+    /* Thread writing to the ring */
+    pthread_t owner;
+    /* Free running offsets, head is moved by the owner, tail by the drain */
+    volatile uint32_t head;
+    volatile uint32_t tail;
+    /* Counters, written by the owner only */
+    uint32_t logged[LogModule_NUM];
+    uint32_t dropped[LogModule_NUM];
+    volatile uint8_t buf[LOGRING_SIZE];
+} logRing_t;
+
+/* Writes one argument in the record, gives up on the others once full */
+#define PACK_ARG(type)                                                  \
+    {                                                                   \
+        type value = va_arg(args, type);                                \
+        full = !packArg(rec, &len, &value, sizeof(value));              \
+    }
+
+/******************************************************************************
+ Local variables
+ *****************************************************************************/
+
+/* Rings owned by the first threads that log */
+static logRing_t rings[LOGRING_NUM_RINGS];
+static volatile uint8_t numRings = 0;
+
+/* Ring of the other threads */
+static logRing_t sharedRing;
+static pthread_mutex_t sharedMutex;
+
+static pthread_mutex_t claimMutex;
+
+/* Serializes the drain task and LogRing_flush() */
+static pthread_mutex_t drainMutex;
+
+/* Zero, i.e. LogLevel_NONE, until LogRing_init() */
+static volatile uint8_t moduleLevel[LogModule_NUM];
+
+static volatile LogRing_output_t output = LogRing_output_text;
+static bool started = false;
+
+/* Used by the drain only */
+static char line[LOGRING_MAX_LINE];
+static uint8_t drainRec[LOGRING_MAX_RECORD];
+static uint8_t frame[MAX_PAYLOAD + 4];
+static uint32_t reportedDrops[LogModule_NUM];
+static const char *announced[LOGRING_NUM_FORMATS];
+static uint8_t numAnnounced = 0;
+static uint32_t announceTime = 0;
+
+static const char *moduleNames[LogModule_NUM] =
+{
+    "general", "gateway", "provisioning", "collector", "npi", "cloud",
+    "websrvr", "ntp"
+};
+
+/******************************************************************************
+ Local function prototypes
+ *****************************************************************************/
+static void *logThread(void *pvParameters);
+static const char *parseSpec(const char *pFormat, logSpec_t *pSpec);
+static bool packArg(uint8_t *pRec, uint16_t *pLen, const void *pArg,
+                    uint16_t size);
+static logRing_t *threadRing(void);
+static bool ringPut(logRing_t *pRing, const uint8_t *pRec, uint16_t len);
+static void ringRead(logRing_t *pRing, uint8_t *pDst, uint16_t len);
+static bool drainOne(void);
+static void reportDrops(void);
+static void formatRecord(const uint8_t *pRec, uint16_t recLen);
+static int formatArg(char *pOut, size_t size, const char *pSpec,
+                     const logSpec_t *pParsed, const uint8_t *pArg,
+                     uint16_t argLen, uint16_t *pUsed);
+static uint16_t intSize(uint8_t lenMod);
+static void sendFrame(uint8_t type, const uint8_t *pPayload, uint16_t len);
+static void announce(const char *pFormat);
+
+/******************************************************************************
+ Public Functions
+ *****************************************************************************/
+
+/*!
+ Set the module levels and start the drain task
+
+ Public function defined in logRing.h
+ */
+void LogRing_init(void)
+{
+    pthread_t thread;
+    pthread_attr_t pAttrs;
+    struct sched_param priParam;
+    int32_t retc;
+
+    if(started)
+    {
+        return;
+    }
+
+    pthread_mutex_init(&sharedMutex, NULL);
+    pthread_mutex_init(&claimMutex, NULL);
+    pthread_mutex_init(&drainMutex, NULL);
+    started = true;
+    LogRing_setLevel(LogModule_NUM, LOGRING_DEFAULT_LEVEL);
+
+    pthread_attr_init(&pAttrs);
+    priParam.sched_priority = LOG_TASK_PRI;
+    retc = pthread_attr_setschedparam(&pAttrs, &priParam);
+    retc |= pthread_attr_setstacksize(&pAttrs, TASKSTACKSIZE);
+    retc |= pthread_attr_setdetachstate(&pAttrs, PTHREAD_CREATE_DETACHED);
+    retc |= pthread_create(&thread, &pAttrs, logThread, NULL);
+    if(retc != 0)
+    {
+        Message("[Log] could not create log task\n\r");
+    }
+}
+
+/*!
+ Record a log line
+
+ Public function defined in logRing.h
+ */
+int LogRing_print(LogModule_t module, LogLevel_t level,
+                  const char *pFormat, ...)
+{
+    va_list args;
+    int ret;
+
+    va_start(args, pFormat);
+    ret = LogRing_vprint(module, level, pFormat, args);
+    va_end(args);
+
+    return ret;
+}
+
+/*!
+ Record a log line from a variable argument list. Only the arguments are
+ copied, the line is formatted by the drain task.
+
+ Public function defined in logRing.h
+ */
+int LogRing_vprint(LogModule_t module, LogLevel_t level,
+                   const char *pFormat, va_list args)
+{
+    uint8_t rec[LOGRING_MAX_RECORD];
+    logHdr_t hdr;
+    logSpec_t spec;
+    logRing_t *pRing;
+    const char *pStr;
+    const char *p = pFormat;
+    uint16_t len = sizeof(logHdr_t);
+    uint16_t strLen;
+    uint8_t i;
+    bool full = false;
+    bool kept;
+
+    if((module >= LogModule_NUM) || (level > moduleLevel[module]))
+    {
+        return 0;
+    }
+
+    while(!full && ((p = strchr(p, '%')) != NULL))
+    {
+        p = parseSpec(p, &spec);
+        if(spec.arg == ARG_BAD)
+        {
+            break;
+        }
+
+        for(i = 0; (i < spec.stars) && !full; i++)
+        {
+            PACK_ARG(int);
+        }
+        if(full)
+        {
+            break;
+        }
+
+        switch(spec.arg)
+        {
+            case ARG_INT:
+                switch(spec.lenMod)
+                {
+                    case LEN_LONG:
+                        PACK_ARG(long);
+                        break;
+                    case LEN_LLONG:
+                        PACK_ARG(long long);
+                        break;
+                    case LEN_INTMAX:
+                        PACK_ARG(intmax_t);
+                        break;
+                    case LEN_SIZE:
+                        PACK_ARG(size_t);
+                        break;
+                    case LEN_PTRDIFF:
+                        PACK_ARG(ptrdiff_t);
+                        break;
+                    default:
+                        PACK_ARG(int);
+                        break;
+                }
+                break;
+
+            case ARG_DOUBLE:
+                PACK_ARG(double);
+                break;
+
+            case ARG_PTR:
+                PACK_ARG(void *);
+                break;
+
+            case ARG_STR:
+                /* Copied, the string may not outlive the call */
+                pStr = va_arg(args, const char *);
+                if(pStr == NULL)
+                {
+                    pStr = "(null)";
+                }
+                for(strLen = 0; (strLen < LOGRING_MAX_STR) && pStr[strLen];
+                    strLen++);
+                if(len + 1 + strLen > LOGRING_MAX_RECORD)
+                {
+                    full = true;
+                    strLen = (len < LOGRING_MAX_RECORD) ?
+                             LOGRING_MAX_RECORD - len - 1 : 0;
+                }
+                if(len < LOGRING_MAX_RECORD)
+                {
+                    rec[len++] = (uint8_t)strLen;
+                    memcpy(&rec[len], pStr, strLen);
+                    len += strLen;
+                }
+                break;
+
+            default:
+                break;
+        }
+    }
+
+    hdr.len = len;
+    hdr.module = module;
+    hdr.level = level;
+    hdr.time = Util_getTimeMs();
+    hdr.pFormat = pFormat;
+    memcpy(rec, &hdr, sizeof(hdr));
+
+    pRing = threadRing();
+    if(pRing != NULL)
+    {
+        kept = ringPut(pRing, rec, len);
+    }
+    else
+    {
+        pRing = &sharedRing;
+        pthread_mutex_lock(&sharedMutex);
+        kept = ringPut(pRing, rec, len);
+        pthread_mutex_unlock(&sharedMutex);
+    }
+
+    return kept ? len : -1;
+}
+
+/*!
+ Output the pending records from the calling thread
+
+ Public function defined in logRing.h
+ */
+void LogRing_flush(void)
+{
+    if(!started)
+    {
+        return;
+    }
+
+    pthread_mutex_lock(&drainMutex);
+    while(drainOne());
+    reportDrops();
+    pthread_mutex_unlock(&drainMutex);
+}
+
+/*!
+ Set the level of a module
+
+ Public function defined in logRing.h
+ */
+void LogRing_setLevel(LogModule_t module, LogLevel_t level)
+{
+    uint8_t i;
+
+    if(!started || (module > LogModule_NUM))
+    {
+        return;
+    }
+
+    for(i = 0; i < LogModule_NUM; i++)
+    {
+        if((module == LogModule_NUM) || (module == i))
+        {
+            moduleLevel[i] = level;
+        }
+    }
+}
+
+/*!
+ Get the level of a module
+
+ Public function defined in logRing.h
+ */
+LogLevel_t LogRing_getLevel(LogModule_t module)
+{
+    if(module >= LogModule_NUM)
+    {
+        return LogLevel_NONE;
+    }
+
+    return (LogLevel_t)moduleLevel[module];
+}
+
+/*!
+ Select text or binary output
+
+ Public function defined in logRing.h
+ */
+void LogRing_setOutput(LogRing_output_t newOutput)
+{
+    if(!started)
+    {
+        output = newOutput;
+        return;
+    }
+
+    pthread_mutex_lock(&drainMutex);
+    output = newOutput;
+    numAnnounced = 0;
+    pthread_mutex_unlock(&drainMutex);
+}
+
+/*!
+ Get the counters of the logger
+
+ Public function defined in logRing.h
+ */
+void LogRing_getStats(LogRing_stats_t *pStats)
+{
+    uint8_t n = numRings;
+    uint8_t i, m;
+
+    memset(pStats, 0, sizeof(LogRing_stats_t));
+    for(m = 0; m < LogModule_NUM; m++)
+    {
+        for(i = 0; i < n; i++)
+        {
+            pStats->logged[m] += rings[i].logged[m];
+            pStats->dropped[m] += rings[i].dropped[m];
+        }
+        pStats->logged[m] += sharedRing.logged[m];
+        pStats->dropped[m] += sharedRing.dropped[m];
+    }
+    pStats->ringsInUse = n;
+}
+
+/******************************************************************************
+ Local Functions
+ *****************************************************************************/
+
+/*!
+ * @brief       Drain task, outputs the records oldest first and sleeps once
+ *              all rings are empty
+ *
+ * @param       pvParameters - unused
+ */
+static void *logThread(void *pvParameters)
+{
+    bool busy;
+
+    while(1)
+    {
+        pthread_mutex_lock(&drainMutex);
+        busy = drainOne();
+        if(!busy)
+        {
+            reportDrops();
+        }
+        pthread_mutex_unlock(&drainMutex);
+
+        if(!busy)
+        {
+            usleep(LOGRING_IDLE_MS * 1000);
+        }
+    }
+}
+
+/*!
+ * @brief       Parse a conversion specification
+ *
+ * @param       pFormat - points to the '%'
+ * @param       pSpec - filled in
+ *
+ * @return      first character after the specification
+ */
+static const char *parseSpec(const char *pFormat, logSpec_t *pSpec)
+{
+    const char *p = pFormat + 1;
+
+    pSpec->stars = 0;
+    pSpec->lenMod = LEN_INT;
+
+    /* Flags, width and precision */
+    while(*p && strchr("-+ #0123456789.*", *p))
+    {
+        if(*p == '*')
+        {
+            pSpec->stars++;
+        }
+        p++;
+    }
+
+    switch(*p)
+    {
+        case 'h':
+            p += (p[1] == 'h') ? 2 : 1;
+            break;
+        case 'l':
+            if(p[1] == 'l')
+            {
+                pSpec->lenMod = LEN_LLONG;
+                p++;
+            }
+            else
+            {
+                pSpec->lenMod = LEN_LONG;
+            }
+            p++;
+            break;
+        case 'j':
+            pSpec->lenMod = LEN_INTMAX;
+            p++;
+            break;
+        case 'z':
+            pSpec->lenMod = LEN_SIZE;
+            p++;
+            break;
+        case 't':
+            pSpec->lenMod = LEN_PTRDIFF;
+            p++;
+            break;
+        default:
+            break;
+    }
+
+    switch(*p)
+    {
+        case '%':
+            pSpec->arg = ARG_NONE;
+            break;
+        case 'd': case 'i': case 'u': case 'o': case 'x': case 'X': case 'c':
+            pSpec->arg = ARG_INT;
+            break;
+        case 'f': case 'F': case 'e': case 'E': case 'g': case 'G':
+        case 'a': case 'A':
+            pSpec->arg = ARG_DOUBLE;
+            break;
+        case 'p':
+            pSpec->arg = ARG_PTR;
+            break;
+        case 's':
+            /* Wide strings are not supported */
+            pSpec->arg = (pSpec->lenMod == LEN_INT) ? ARG_STR : ARG_BAD;
+            break;
+        default:
+            /* %n, %L and the unknown ones */
+            pSpec->arg = ARG_BAD;
+            break;
+    }
+
+    if(pSpec->arg != ARG_BAD)
+    {
+        p++;
+    }
+    if((p - pFormat) >= MAX_SPEC)
+    {
+        pSpec->arg = ARG_BAD;
+    }
+    pSpec->specLen = (uint8_t)(p - pFormat);
+
+    return p;
+}
+
+/*!
+ * @brief       Append an argument to a record
+ *
+ * @param       pRec - record
+ * @param       pLen - length of the record, updated
+ * @param       pArg - argument
+ * @param       size - size of the argument
+ *
+ * @return      false if the record is full
+ */
+static bool packArg(uint8_t *pRec, uint16_t *pLen, const void *pArg,
+                    uint16_t size)
+{
+    if(*pLen + size > LOGRING_MAX_RECORD)
+    {
+        return false;
+    }
+
+    memcpy(&pRec[*pLen], pArg, size);
+    *pLen += size;
+    return true;
+}
+
+/*!
+ * @brief       Find the ring of the calling thread, claim one on the first
+ *              call
+ *
+ * @return      ring, NULL if all are taken
+ */
+static logRing_t *threadRing(void)
+{
+    pthread_t self = pthread_self();
+    logRing_t *pRing = NULL;
+    uint8_t n = numRings;
+    uint8_t i;
+
+    for(i = 0; i < n; i++)
+    {
+        if(pthread_equal(rings[i].owner, self))
+        {
+            return &rings[i];
+        }
+    }
+
+    pthread_mutex_lock(&claimMutex);
+    if(numRings < LOGRING_NUM_RINGS)
+    {
+        pRing = &rings[numRings];
+        pRing->owner = self;
+        numRings++;
+    }
+    pthread_mutex_unlock(&claimMutex);
+
+    return pRing;
+}
+
+/*!
+ * @brief       Write a record to a ring, called by the owner of the ring
+ *
+ * @param       pRing - ring
+ * @param       pRec - record
+ * @param       len - length of the record
+ *
+ * @return      false if the record was dropped
+ */
+static bool ringPut(logRing_t *pRing, const uint8_t *pRec, uint16_t len)
+{
+    uint32_t head = pRing->head;
+    uint8_t module = ((const logHdr_t *)pRec)->module;
+    uint16_t i;
+
+    if((LOGRING_SIZE - (head - pRing->tail)) < len)
+    {
+        pRing->dropped[module]++;
+        return false;
+    }
+
+    for(i = 0; i < len; i++)
+    {
+        pRing->buf[(head + i) & RING_MASK] = pRec[i];
+    }
+    /* Publish the record once written */
+    pRing->head = head + len;
+    pRing->logged[module]++;
+
+    return true;
+}
+
+/*!
+ * @brief       Copy bytes from the tail of a ring, called by the drain
+ *
+ * @param       pRing - ring
+ * @param       pDst - copied to
+ * @param       len - number of bytes
+ */
+static void ringRead(logRing_t *pRing, uint8_t *pDst, uint16_t len)
+{
+    uint32_t tail = pRing->tail;
+    uint16_t i;
+
+    for(i = 0; i < len; i++)
+    {
+        pDst[i] = pRing->buf[(tail + i) & RING_MASK];
+    }
+}
+
+/*!
+ * @brief       Output the oldest pending record of all rings, with
+ *              drainMutex held
+ *
+ * @return      false if all rings are empty
+ */
+static bool drainOne(void)
+{
+    logRing_t *pRing = NULL;
+    logRing_t *pNext;
+    logHdr_t hdr;
+    logHdr_t oldest;
+    uint32_t id;
+    uint8_t n = numRings;
+    uint8_t i;
+
+    for(i = 0; i <= n; i++)
+    {
+        pNext = (i < n) ? &rings[i] : &sharedRing;
+        if(pNext->head == pNext->tail)
+        {
+            continue;
+        }
+
+        ringRead(pNext, (uint8_t *)&hdr, sizeof(hdr));
+        if((pRing == NULL) || ((int32_t)(hdr.time - oldest.time) < 0))
+        {
+            pRing = pNext;
+            oldest = hdr;
+        }
+    }
+
+    if(pRing == NULL)
+    {
+        return false;
+    }
+
+    ringRead(pRing, drainRec, oldest.len);
+    pRing->tail += oldest.len;
+
+    if(output == LogRing_output_binary)
+    {
+        announce(oldest.pFormat);
+        /* Module, level and time are sent as they are in the header */
+        memcpy(&line[0], &drainRec[offsetof(logHdr_t, module)], 6);
+        id = (uint32_t)(uintptr_t)oldest.pFormat;
+        memcpy(&line[6], &id, sizeof(id));
+        memcpy(&line[10], &drainRec[sizeof(logHdr_t)],
+               oldest.len - sizeof(logHdr_t));
+        sendFrame(LOGRING_FRAME_RECORD, (uint8_t *)line,
+                  10 + oldest.len - sizeof(logHdr_t));
+    }
+    else
+    {
+        formatRecord(drainRec, oldest.len);
+        Message(line);
+    }
+
+    return true;
+}
+
+/*!
+ * @brief       Report the records dropped since the last report, with
+ *              drainMutex held
+ */
+static void reportDrops(void)
+{
+    LogRing_stats_t stats;
+    uint32_t count;
+    uint8_t m;
+
+    LogRing_getStats(&stats);
+    for(m = 0; m < LogModule_NUM; m++)
+    {
+        if(stats.dropped[m] == reportedDrops[m])
+        {
+            continue;
+        }
+
+        count = stats.dropped[m] - reportedDrops[m];
+        reportedDrops[m] = stats.dropped[m];
+        if(output == LogRing_output_binary)
+        {
+            memcpy(&line[0], &m, 1);
+            memcpy(&line[1], &count, sizeof(count));
+            sendFrame(LOGRING_FRAME_DROPS, (uint8_t *)line, 5);
+        }
+        else
+        {
+            snprintf(line, sizeof(line), "[Log] %s dropped %u lines\n\r",
+                     moduleNames[m], (unsigned int)count);
+            Message(line);
+        }
+    }
+}
+
+/*!
+ * @brief       Format a record in line
+ *
+ * @param       pRec - record
+ * @param       recLen - length of the record
+ */
+static void formatRecord(const uint8_t *pRec, uint16_t recLen)
+{
+    const char *p = ((const logHdr_t *)pRec)->pFormat;
+    const char *pStart;
+    char spec[MAX_SPEC + 24];
+    logSpec_t parsed;
+    uint16_t pos = sizeof(logHdr_t);
+    uint16_t out = 0;
+    uint16_t used;
+    int ret;
+
+    while(*p && (out < (LOGRING_MAX_LINE - 1)))
+    {
+        if(*p != '%')
+        {
+            line[out++] = *p++;
+            continue;
+        }
+
+        pStart = p;
+        p = parseSpec(p, &parsed);
+        if(parsed.arg == ARG_BAD)
+        {
+            /* No argument was recorded past this point, print it as is */
+            ret = strlen(pStart);
+            if(ret > (LOGRING_MAX_LINE - 1 - out))
+            {
+                ret = LOGRING_MAX_LINE - 1 - out;
+            }
+            memcpy(&line[out], pStart, ret);
+            out += ret;
+            break;
+        }
+        if(parsed.arg == ARG_NONE)
+        {
+            line[out++] = '%';
+            continue;
+        }
+
+        memcpy(spec, pStart, parsed.specLen);
+        spec[parsed.specLen] = '\0';
+        ret = formatArg(&line[out], LOGRING_MAX_LINE - out, spec, &parsed,
+                        &pRec[pos], recLen - pos, &used);
+        if(ret < 0)
+        {
+            /* Record was cut */
+            ret = snprintf(&line[out], LOGRING_MAX_LINE - out, "...\n\r");
+            out += (ret < (LOGRING_MAX_LINE - out)) ?
+                   ret : (LOGRING_MAX_LINE - 1 - out);
+            break;
+        }
+        out += (ret < (LOGRING_MAX_LINE - out)) ?
+               ret : (LOGRING_MAX_LINE - 1 - out);
+        pos += used;
+    }
+
+    line[out] = '\0';
+}
+
+/*!
+ * @brief       Format one recorded argument
+ *
+ * @param       pOut - output
+ * @param       size - size of the output
+ * @param       pSpec - conversion specification, rewritten for the stars
+ * @param       pParsed - parsed specification
+ * @param       pArg - recorded argument, stars first
+ * @param       argLen - bytes left in the record
+ * @param       pUsed - bytes of the record consumed
+ *
+ * @return      as snprintf, -1 if the argument is missing
+ */
+static int formatArg(char *pOut, size_t size, const char *pSpec,
+                     const logSpec_t *pParsed, const uint8_t *pArg,
+                     uint16_t argLen, uint16_t *pUsed)
+{
+    char fmt[MAX_SPEC + 24];
+    char str[LOGRING_MAX_STR + 1];
+    uint16_t used = 0;
+    uint16_t f = 0;
+    uint16_t argSize;
+    int star;
+    const char *p;
+
+    /* Stars are replaced by their value */
+    for(p = pSpec; *p; p++)
+    {
+        if(*p != '*')
+        {
+            fmt[f++] = *p;
+            continue;
+        }
+
+        if(used + sizeof(int) > argLen)
+        {
+            return -1;
+        }
+        memcpy(&star, &pArg[used], sizeof(int));
+        used += sizeof(int);
+        if((star < 0) && (f > 0) && (fmt[f - 1] == '.'))
+        {
+            /* Negative precision is as if omitted */
+            f--;
+            continue;
+        }
+        f += snprintf(&fmt[f], sizeof(fmt) - f, "%d", star);
+    }
+    fmt[f] = '\0';
+
+    switch(pParsed->arg)
+    {
+        case ARG_INT:
+            argSize = intSize(pParsed->lenMod);
+            break;
+        case ARG_DOUBLE:
+            argSize = sizeof(double);
+            break;
+        case ARG_PTR:
+            argSize = sizeof(void *);
+            break;
+        default:
+            if(used + 1 > argLen)
+            {
+                return -1;
+            }
+            argSize = 1 + pArg[used];
+            break;
+    }
+    if(used + argSize > argLen)
+    {
+        return -1;
+    }
+    pArg += used;
+    *pUsed = used + argSize;
+
+#define FORMAT_AS(type)                                                 \
+    {                                                                   \
+        type value;                                                     \
+        memcpy(&value, pArg, sizeof(value));                            \
+        return snprintf(pOut, size, fmt, value);                        \
+    }
+
+    switch(pParsed->arg)
+    {
+        case ARG_INT:
+            switch(pParsed->lenMod)
+            {
+                case LEN_LONG:
+                    FORMAT_AS(long);
+                case LEN_LLONG:
+                    FORMAT_AS(long long);
+                case LEN_INTMAX:
+                    FORMAT_AS(intmax_t);
+                case LEN_SIZE:
+                    FORMAT_AS(size_t);
+                case LEN_PTRDIFF:
+                    FORMAT_AS(ptrdiff_t);
+                default:
+                    FORMAT_AS(int);
+            }
+        case ARG_DOUBLE:
+            FORMAT_AS(double);
+        case ARG_PTR:
+            FORMAT_AS(void *);
+        default:
+            memcpy(str, &pArg[1], pArg[0]);
+            str[pArg[0]] = '\0';
+            return snprintf(pOut, size, fmt, str);
+    }
+
+#undef FORMAT_AS
+}
+
+/*!
+ * @brief       Size of a recorded integer
+ *
+ * @param       lenMod - length modifier
+ *
+ * @return      size in bytes
+ */
+static uint16_t intSize(uint8_t lenMod)
+{
+    switch(lenMod)
+    {
+        case LEN_LONG:
+            return sizeof(long);
+        case LEN_LLONG:
+            return sizeof(long long);
+        case LEN_INTMAX:
+            return sizeof(intmax_t);
+        case LEN_SIZE:
+            return sizeof(size_t);
+        case LEN_PTRDIFF:
+            return sizeof(ptrdiff_t);
+        default:
+            return sizeof(int);
+    }
+}
+
+/*!
+ * @brief       Write a binary frame to the UART
+ *
+ * @param       type - LOGRING_FRAME_xxx
+ * @param       pPayload - payload
+ * @param       len - length of the payload, cut to MAX_PAYLOAD
+ */
+static void sendFrame(uint8_t type, const uint8_t *pPayload, uint16_t len)
+{
+    uint8_t fcs;
+    uint16_t i;
+
+    if(len > MAX_PAYLOAD)
+    {
+        len = MAX_PAYLOAD;
+    }
+
+    frame[0] = LOGRING_SOF;
+    frame[1] = (uint8_t)len;
+    frame[2] = type;
+    memcpy(&frame[3], pPayload, len);
+    fcs = 0;
+    for(i = 1; i < len + 3; i++)
+    {
+        fcs ^= frame[i];
+    }
+    frame[len + 3] = fcs;
+
+    MessageLen((const char *)frame, len + 4);
+}
+
+/*!
+ * @brief       Send the format frame of a format not sent recently
+ *
+ * @param       pFormat - format of the record about to be sent
+ */
+static void announce(const char *pFormat)
+{
+    uint32_t now = Util_getTimeMs();
+    uint32_t id = (uint32_t)(uintptr_t)pFormat;
+    uint16_t len;
+    uint8_t i;
+
+    if((numAnnounced == LOGRING_NUM_FORMATS) ||
+       ((now - announceTime) >= LOGRING_ANNOUNCE_MS))
+    {
+        numAnnounced = 0;
+        announceTime = now;
+    }
+
+    for(i = 0; i < numAnnounced; i++)
+    {
+        if(announced[i] == pFormat)
+        {
+            return;
+        }
+    }
+    announced[numAnnounced++] = pFormat;
+
+    len = strlen(pFormat);
+    if(len > (MAX_PAYLOAD - sizeof(id)))
+    {
+        len = MAX_PAYLOAD - sizeof(id);
+    }
+    memcpy(&line[0], &id, sizeof(id));
+    memcpy(&line[sizeof(id)], pFormat, len);
+    sendFrame(LOGRING_FRAME_FORMAT, (uint8_t *)line, sizeof(id) + len);
+}
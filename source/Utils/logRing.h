@@ -0,0 +1,239 @@
+/******************************************************************************
+
+ @file logRing.h
+
+ @brief Deferred logger, per-thread rings drained by a low priority task
+
+ Group: WCS LPC
+ Target Device: CC13xx CC32xx
+
+ ******************************************************************************
+
+ Copyright (c) 2016-2017, Texas Instruments Incorporated
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions
+ are met:
+
+ *  Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+
+ *  Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+
+ *  Neither the name of Texas Instruments Incorporated nor the names of
+    its contributors may be used to endorse or promote products derived
+    from this software without specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+ ******************************************************************************
+ Release Name:
+ Release Date:
+ *****************************************************************************/
+
+#ifndef UTILS_LOGRING_H_
+#define UTILS_LOGRING_H_
+
+//*****************************************************************************
+//
+// If building with a C++ compiler, make all of the definitions in this header
+// have a C binding.
+//
+//*****************************************************************************
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdarg.h>
+
+/*!
+ Number of threads that get a ring of their own. Threads logging after all
+ rings are taken share one more ring, guarded by a mutex.
+ */
+#ifndef LOGRING_NUM_RINGS
+#define LOGRING_NUM_RINGS       8
+#endif
+
+/*! Size of each ring in bytes, must be a power of 2 */
+#ifndef LOGRING_SIZE
+#define LOGRING_SIZE            1024
+#endif
+
+/*! Largest record, header included. Arguments that do not fit are cut. */
+#define LOGRING_MAX_RECORD      160
+
+/*! String arguments are copied at the call site, up to this length */
+#define LOGRING_MAX_STR         64
+
+/*! Longest line the drain task formats */
+#define LOGRING_MAX_LINE        256
+
+/*! Default level of every module */
+#ifndef LOGRING_DEFAULT_LEVEL
+#define LOGRING_DEFAULT_LEVEL   LogLevel_DEBUG
+#endif
+
+/*! Sleep of the drain task once all rings are empty, in milliseconds */
+#define LOGRING_IDLE_MS         10
+
+/*!
+ Number of formats remembered as sent in binary output. The table is
+ cleared when full and every LOGRING_ANNOUNCE_MS, so that a decoder
+ attached to a running gateway learns all formats again.
+ */
+#define LOGRING_NUM_FORMATS     64
+#define LOGRING_ANNOUNCE_MS     10000
+
+/*!
+ Binary output frames: SOF, payload length, frame type, payload, and the
+ XOR of length, type and payload. Numbers are little endian. Arguments are
+ stored as passed on the target: 4 bytes for int, long and pointers,
+ 8 bytes for long long and double, strings as a length byte and the
+ characters. See Utils/logdecode.py.
+ */
+#define LOGRING_SOF             0xFE
+
+/*! Frame carrying a format ID (4 bytes) and the format string */
+#define LOGRING_FRAME_FORMAT    0x01
+/*!
+ Frame carrying a record: module (1 byte), level (1 byte),
+ time in milliseconds (4 bytes), format ID (4 bytes) and the arguments
+ */
+#define LOGRING_FRAME_RECORD    0x02
+/*! Frame carrying the module (1 byte) and drop count (4 bytes) of records lost */
+#define LOGRING_FRAME_DROPS     0x03
+
+/*! Modules with their own log level, set LOG_MODULE before including uart_term.h */
+typedef enum
+{
+    LogModule_GENERAL,
+    LogModule_GATEWAY,
+    LogModule_PROVISIONING,
+    LogModule_COLLECTOR,
+    LogModule_NPI,
+    LogModule_CLOUD,
+    LogModule_WEBSRVR,
+    LogModule_NTP,
+    LogModule_NUM
+} LogModule_t;
+
+/*! Levels, a record is kept when its level is at or below the module level */
+typedef enum
+{
+    LogLevel_NONE,
+    LogLevel_ERROR,
+    LogLevel_INFO,
+    LogLevel_DEBUG
+} LogLevel_t;
+
+/*! Output of the drain task */
+typedef enum
+{
+    /*! Formatted text, as printed by Report */
+    LogRing_output_text,
+    /*! Frames decoded on the host */
+    LogRing_output_binary
+} LogRing_output_t;
+
+/*! Counters of the logger */
+typedef struct
+{
+    /*! Records kept, per module */
+    uint32_t logged[LogModule_NUM];
+    /*! Records lost to a full ring, per module */
+    uint32_t dropped[LogModule_NUM];
+    /*! Threads with a ring of their own */
+    uint8_t ringsInUse;
+} LogRing_stats_t;
+
+/*!
+ * @brief       Set the module levels to LOGRING_DEFAULT_LEVEL and start the
+ *              drain task. Records are discarded until this is called.
+ *              The UART must be open.
+ */
+extern void LogRing_init(void);
+
+/*!
+ * @brief       Record a log line. The format must be a string literal, as
+ *              its address identifies it until the line is drained.
+ *
+ * @param       module - module of the call site
+ * @param       level - level of the line
+ * @param       pFormat - printf format
+ *
+ * @return      size of the record, 0 if filtered out, -1 if dropped
+ */
+extern int LogRing_print(LogModule_t module, LogLevel_t level,
+                         const char *pFormat, ...);
+
+/*!
+ * @brief       Record a log line from a variable argument list
+ *
+ * @param       module - module of the call site
+ * @param       level - level of the line
+ * @param       pFormat - printf format, a string literal
+ * @param       args - arguments of the format
+ *
+ * @return      size of the record, 0 if filtered out, -1 if dropped
+ */
+extern int LogRing_vprint(LogModule_t module, LogLevel_t level,
+                          const char *pFormat, va_list args);
+
+/*!
+ * @brief       Output all pending records from the calling thread, before
+ *              halting for instance
+ */
+extern void LogRing_flush(void);
+
+/*!
+ * @brief       Set the level of a module
+ *
+ * @param       module - module, LogModule_NUM for all of them
+ * @param       level - new level
+ */
+extern void LogRing_setLevel(LogModule_t module, LogLevel_t level);
+
+/*!
+ * @brief       Get the level of a module
+ *
+ * @param       module - module
+ *
+ * @return      level
+ */
+extern LogLevel_t LogRing_getLevel(LogModule_t module);
+
+/*!
+ * @brief       Select text or binary output
+ *
+ * @param       output - new output
+ */
+extern void LogRing_setOutput(LogRing_output_t output);
+
+/*!
+ * @brief       Get the counters of the logger
+ *
+ * @param       pStats - filled in
+ */
+extern void LogRing_getStats(LogRing_stats_t *pStats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* UTILS_LOGRING_H_ */
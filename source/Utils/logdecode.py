@@ -0,0 +1,210 @@
+#!/usr/bin/env python3
+"""
+ @file logdecode.py
+
+ @brief Decoder of the binary output of the deferred logger (logRing.c)
+
+ Reads the gateway console from a capture file, stdin or a serial port
+ (needs pyserial) and prints the log lines with their time, module and
+ level. Text sent before the logger is switched to binary output is passed
+ through as is.
+
+   python3 logdecode.py capture.bin
+   python3 logdecode.py /dev/ttyACM0 --baud 115200
+
+ The frame layout and the argument sizes follow logRing.h, for the 32 bit
+ little endian target.
+"""
+
+import argparse
+import re
+import struct
+import sys
+
+SOF = 0xFE
+FRAME_FORMAT = 0x01
+FRAME_RECORD = 0x02
+FRAME_DROPS = 0x03
+
+MODULES = ["general", "gateway", "provisioning", "collector", "npi", "cloud",
+           "websrvr", "ntp"]
+LEVELS = ["none", "error", "info", "debug"]
+
+# Size and struct code of the integers, per length modifier
+INT_ARGS = {"": 4, "h": 4, "hh": 4, "l": 4, "ll": 8, "j": 8, "z": 4, "t": 4}
+SIGNED = "di"
+
+SPEC = re.compile(r"%([-+ #0-9.*]*)(hh|h|ll|l|j|z|t)?(.)", re.S)
+
+
+class Cut(Exception):
+    """The record ends before the format"""
+
+
+class Args:
+    """Arguments of a record, read in format order"""
+
+    def __init__(self, data):
+        self.data = data
+        self.pos = 0
+
+    def take(self, size):
+        if self.pos + size > len(self.data):
+            raise Cut()
+        value = self.data[self.pos:self.pos + size]
+        self.pos += size
+        return value
+
+    def int(self, size, signed):
+        code = {4: "i", 8: "q"}[size]
+        return struct.unpack("<" + (code if signed else code.upper()),
+                             self.take(size))[0]
+
+    def double(self):
+        return struct.unpack("<d", self.take(8))[0]
+
+    def string(self):
+        length = self.take(1)[0]
+        return self.take(length).decode("latin-1")
+
+
+def format_line(fmt, data):
+    """Format a record the way the drain task does"""
+    args = Args(data)
+    out = []
+    pos = 0
+    for m in SPEC.finditer(fmt):
+        out.append(fmt[pos:m.start()])
+        pos = m.end()
+        flags, length, conv = m.group(1), m.group(2) or "", m.group(3)
+        if conv == "%":
+            out.append("%")
+            continue
+        if conv not in "diouxXcfFeEgGaAps" or (conv == "s" and length):
+            # Not recorded, printed as is from here on
+            pos = m.start()
+            break
+        try:
+            spec = ""
+            for c in flags:
+                if c != "*":
+                    spec += c
+                    continue
+                star = args.int(4, True)
+                if star < 0 and spec.endswith("."):
+                    spec = spec[:-1]
+                else:
+                    spec += str(star)
+            if conv in "diouxXc":
+                value = args.int(INT_ARGS[length], conv in SIGNED)
+                if conv == "c":
+                    out.append(("%" + spec + "c") % chr(value & 0xFF))
+                else:
+                    out.append(("%" + spec + conv.replace("u", "d")) % value)
+            elif conv in "aA":
+                text = args.double().hex()
+                out.append(("%" + spec + "s") % (text.upper()
+                                                 if conv == "A" else text))
+            elif conv in "fFeEgG":
+                out.append(("%" + spec + conv) % args.double())
+            elif conv == "p":
+                out.append(("%" + spec + "s") % hex(args.int(4, False)))
+            else:
+                out.append(("%" + spec + "s") % args.string())
+        except Cut:
+            out.append("...\n\r")
+            return "".join(out)
+    out.append(fmt[pos:])
+    return "".join(out)
+
+
+class Decoder:
+    """Splits the console stream in frames and text"""
+
+    def __init__(self, write):
+        self.write = write
+        self.formats = {}
+        self.buf = bytearray()
+
+    def feed(self, data):
+        self.buf += data
+        while self.buf:
+            if self.buf[0] != SOF:
+                end = self.buf.find(bytes([SOF]))
+                if end < 0:
+                    end = len(self.buf)
+                self.write(self.buf[:end].decode("latin-1"))
+                del self.buf[:end]
+                continue
+            if len(self.buf) < 3:
+                return
+            length = self.buf[1]
+            if len(self.buf) < length + 4:
+                return
+            frame = self.buf[1:length + 4]
+            fcs = 0
+            for b in frame[:-1]:
+                fcs ^= b
+            if fcs != frame[-1]:
+                # Not a frame, resync on the next SOF
+                del self.buf[:1]
+                continue
+            del self.buf[:length + 4]
+            self.frame(frame[1], bytes(frame[2:-1]))
+
+    def frame(self, ftype, payload):
+        if ftype == FRAME_FORMAT:
+            fid = struct.unpack_from("<I", payload)[0]
+            self.formats[fid] = payload[4:].decode("latin-1")
+        elif ftype == FRAME_RECORD:
+            module, level, time, fid = struct.unpack_from("<BBII", payload)
+            fmt = self.formats.get(fid)
+            if fmt is None:
+                line = "<format 0x%08x not received yet>\n" % fid
+            else:
+                line = format_line(fmt, payload[10:])
+            self.write("%10.3f %-12s %-5s %s" % (
+                time / 1000.0, name(MODULES, module), name(LEVELS, level),
+                line.rstrip("\r\n") + "\n"))
+        elif ftype == FRAME_DROPS:
+            module, count = struct.unpack_from("<BI", payload)
+            self.write("%10s %-12s drop  %u lines lost\n" % (
+                "", name(MODULES, module), count))
+
+
+def name(names, index):
+    return names[index] if index < len(names) else str(index)
+
+
+def open_input(path, baud):
+    if path == "-":
+        return sys.stdin.buffer
+    if path.startswith("/dev/") or path.upper().startswith("COM"):
+        import serial
+        return serial.Serial(path, baud, timeout=0.1)
+    return open(path, "rb")
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split("\n")[3])
+    parser.add_argument("input", help="capture file, serial port or -")
+    parser.add_argument("--baud", type=int, default=115200)
+    opts = parser.parse_args()
+
+    src = open_input(opts.input, opts.baud)
+    decoder = Decoder(lambda text: (sys.stdout.write(text),
+                                    sys.stdout.flush()))
+    try:
+        while True:
+            data = src.read(256)
+            if not data:
+                if hasattr(src, "in_waiting"):
+                    continue
+                break
+            decoder.feed(data)
+    except KeyboardInterrupt:
+        pass
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,574 @@
+/******************************************************************************
+
+ @file mqStats.c
+
+ @brief Depth, wait time and throughput of the inter-task message queues
+
+ Group: WCS LPC
+ Target Device: CC13xx CC32xx
+
+ ******************************************************************************
+
+ Copyright (c) 2016-2017, Texas Instruments Incorporated
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions
+ are met:
+
+ *  Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+
+ *  Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+
+ *  Neither the name of Texas Instruments Incorporated nor the names of
+    its contributors may be used to endorse or promote products derived
+    from this software without specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+ ******************************************************************************
+ Release Name:
+ Release Date:
+ *****************************************************************************/
+
+/******************************************************************************
+ Includes
+ *****************************************************************************/
+#include <string.h>
+#include <pthread.h>
+#include <ti/drivers/dpl/HwiP.h>
+#include "util.h"
+#include "mqStats.h"
+
+/******************************************************************************
+ Constants and definitions
+ *****************************************************************************/
+
+struct MqStats_queue_s
+{
+    char name[MQSTATS_NAME_LEN];
+    uint16_t capacity;
+    /* Written by the senders with the interrupts disabled */
+    volatile uint16_t depth;
+    volatile uint16_t peak;
+    volatile uint16_t windowPeak;
+    volatile uint32_t sent;
+    volatile uint32_t sendFailed;
+    /* Written by the reader and the window, under the mutex */
+    uint32_t received;
+    uint32_t windowReceived;
+    uint32_t windowMax;
+    uint16_t bins[MQSTATS_NUM_BINS];
+    /* Results of the last window */
+    uint16_t lastPeak;
+    uint16_t lastRate;
+    uint16_t lastP50;
+    uint16_t lastP90;
+    uint16_t lastP99;
+    uint32_t lastMax;
+};
+
+/* Queue descriptor opened through MqStats_open() */
+typedef struct
+{
+    mqd_t mq;
+    MqStats_queue_t *pQueue;
+} MqStats_desc_t;
+
+/******************************************************************************
+ Local variables
+ *****************************************************************************/
+
+static MqStats_queue_t queues[MQSTATS_MAX_QUEUES];
+static uint8_t numQueues = 0;
+static MqStats_desc_t descs[MQSTATS_MAX_DESCS];
+static uint8_t numDescs = 0;
+
+static pthread_mutex_t statsMutex;
+static uint32_t windowStart;
+static volatile uint32_t windowCount = 0;
+
+/******************************************************************************
+ Local function prototypes
+ *****************************************************************************/
+static MqStats_queue_t *findDesc(mqd_t mq);
+static uint16_t queueDepth(mqd_t mq);
+static void countSent(MqStats_queue_t *pQueue, uint16_t depth);
+static void copyQueue(MqStats_queue_t *pQueue, MqStats_snapshot_t *pSnapshot);
+static void closeWindow(uint32_t now);
+static uint16_t percentile(MqStats_queue_t *pQueue, uint32_t total,
+                           uint8_t pct);
+
+/******************************************************************************
+ Public Functions
+ *****************************************************************************/
+
+/*!
+ Clear the counters
+
+ Public function defined in mqStats.h
+ */
+void MqStats_init(void)
+{
+    pthread_mutex_init(&statsMutex, NULL);
+    memset(queues, 0, sizeof(queues));
+    numQueues = 0;
+    numDescs = 0;
+    windowStart = Util_getTimeMs();
+    windowCount = 0;
+}
+
+/*!
+ Get the counters of a queue
+
+ Public function defined in mqStats.h
+ */
+MqStats_queue_t *MqStats_add(const char *pName, uint16_t capacity)
+{
+    MqStats_queue_t *pQueue = NULL;
+
+    pthread_mutex_lock(&statsMutex);
+    for(uint8_t queueIdx = 0; queueIdx < numQueues; queueIdx++)
+    {
+        if(strncmp(queues[queueIdx].name, pName, MQSTATS_NAME_LEN - 1) == 0)
+        {
+            pQueue = &queues[queueIdx];
+            break;
+        }
+    }
+    if((pQueue == NULL) && (numQueues < MQSTATS_MAX_QUEUES))
+    {
+        pQueue = &queues[numQueues++];
+        strncpy(pQueue->name, pName, MQSTATS_NAME_LEN - 1);
+    }
+    if((pQueue != NULL) && (capacity != 0))
+    {
+        pQueue->capacity = capacity;
+    }
+    pthread_mutex_unlock(&statsMutex);
+
+    return pQueue;
+}
+
+/*!
+ Stamp a message that was queued
+
+ Public function defined in mqStats.h
+ */
+void MqStats_enqueued(MqStats_queue_t *pQueue, msgQueue_t *pMsg,
+                      uint16_t depth)
+{
+    pMsg->enqueueTime = Util_getTimeMs();
+    if(pQueue != NULL)
+    {
+        countSent(pQueue, depth);
+    }
+}
+
+/*!
+ Count a message that could not be queued
+
+ Public function defined in mqStats.h
+ */
+void MqStats_sendFailed(MqStats_queue_t *pQueue)
+{
+    uintptr_t key;
+
+    if(pQueue != NULL)
+    {
+        key = HwiP_disable();
+        pQueue->sendFailed++;
+        HwiP_restore(key);
+    }
+}
+
+/*!
+ Count a message that was read
+
+ Public function defined in mqStats.h
+ */
+void MqStats_dequeued(MqStats_queue_t *pQueue, const msgQueue_t *pMsg,
+                      uint16_t depth)
+{
+    uint32_t now = Util_getTimeMs();
+    uint32_t wait = now - pMsg->enqueueTime;
+    uint8_t bin = 0;
+
+    if(pQueue == NULL)
+    {
+        return;
+    }
+
+    while((bin < (MQSTATS_NUM_BINS - 1)) && ((wait >> bin) != 0))
+    {
+        bin++;
+    }
+
+    pthread_mutex_lock(&statsMutex);
+    pQueue->depth = depth;
+    pQueue->received++;
+    if(pQueue->bins[bin] != UINT16_MAX)
+    {
+        pQueue->bins[bin]++;
+    }
+    if(wait > pQueue->windowMax)
+    {
+        pQueue->windowMax = wait;
+    }
+    closeWindow(now);
+    pthread_mutex_unlock(&statsMutex);
+}
+
+/*!
+ Open a POSIX queue
+
+ Public function defined in mqStats.h
+ */
+mqd_t MqStats_open(const char *pName, int oflag, mq_attr *pAttr)
+{
+    /* mode is not implemented in TI-RTOS POSIX wrappers */
+    mqd_t mq = mq_open(pName, oflag, 0, pAttr);
+    MqStats_queue_t *pQueue;
+
+    if(mq == (mqd_t)-1)
+    {
+        return mq;
+    }
+    pQueue = MqStats_add(pName, (pAttr != NULL) ? pAttr->mq_maxmsg : 0);
+
+    pthread_mutex_lock(&statsMutex);
+    if((pQueue != NULL) && (numDescs < MQSTATS_MAX_DESCS))
+    {
+        descs[numDescs].mq = mq;
+        descs[numDescs].pQueue = pQueue;
+        /* Senders may look it up from here on */
+        numDescs++;
+    }
+    pthread_mutex_unlock(&statsMutex);
+
+    return mq;
+}
+
+/*!
+ Send a message
+
+ Public function defined in mqStats.h
+ */
+int MqStats_send(mqd_t mq, msgQueue_t *pMsg, unsigned int prio)
+{
+    MqStats_queue_t *pQueue = findDesc(mq);
+    int ret;
+
+    /* Stamped before the send, the reader may run before it returns */
+    pMsg->enqueueTime = Util_getTimeMs();
+    ret = mq_send(mq, (char*)pMsg, sizeof(msgQueue_t), prio);
+    if(pQueue == NULL)
+    {
+        return ret;
+    }
+
+    if(ret == 0)
+    {
+        countSent(pQueue, queueDepth(mq));
+    }
+    else
+    {
+        MqStats_sendFailed(pQueue);
+    }
+    return ret;
+}
+
+/*!
+ Read a message
+
+ Public function defined in mqStats.h
+ */
+ssize_t MqStats_receive(mqd_t mq, msgQueue_t *pMsg)
+{
+    ssize_t ret = mq_receive(mq, (char*)pMsg, sizeof(msgQueue_t), NULL);
+
+    if(ret > 0)
+    {
+        MqStats_dequeued(findDesc(mq), pMsg, queueDepth(mq));
+    }
+    return ret;
+}
+
+/*!
+ Read a message with a timeout
+
+ Public function defined in mqStats.h
+ */
+ssize_t MqStats_timedReceive(mqd_t mq, msgQueue_t *pMsg,
+                             const struct timespec *pAbsTimeout)
+{
+    ssize_t ret = mq_timedreceive(mq, (char*)pMsg, sizeof(msgQueue_t), NULL,
+                                  pAbsTimeout);
+
+    if(ret > 0)
+    {
+        MqStats_dequeued(findDesc(mq), pMsg, queueDepth(mq));
+    }
+    return ret;
+}
+
+/*!
+ Close the window if it is over
+
+ Public function defined in mqStats.h
+ */
+uint32_t MqStats_tick(void)
+{
+    pthread_mutex_lock(&statsMutex);
+    closeWindow(Util_getTimeMs());
+    pthread_mutex_unlock(&statsMutex);
+
+    return windowCount;
+}
+
+/*!
+ Get the counters of all queues
+
+ Public function defined in mqStats.h
+ */
+uint8_t MqStats_snapshot(MqStats_snapshot_t *pSnapshot, uint8_t maxQueues)
+{
+    uint8_t queueIdx;
+
+    pthread_mutex_lock(&statsMutex);
+    closeWindow(Util_getTimeMs());
+    for(queueIdx = 0; (queueIdx < numQueues) && (queueIdx < maxQueues);
+        queueIdx++)
+    {
+        copyQueue(&queues[queueIdx], &pSnapshot[queueIdx]);
+    }
+    pthread_mutex_unlock(&statsMutex);
+
+    return queueIdx;
+}
+
+/*!
+ Write the counters of all queues
+
+ Public function defined in mqStats.h
+ */
+void MqStats_writeJson(JsonWriter_t *pWriter, const char *pKey)
+{
+    MqStats_snapshot_t snapshot;
+    bool found;
+
+    JsonWriter_beginArray(pWriter, pKey);
+    /* One queue at a time, all of them would take too much of the stack */
+    for(uint8_t queueIdx = 0; queueIdx < MQSTATS_MAX_QUEUES; queueIdx++)
+    {
+        pthread_mutex_lock(&statsMutex);
+        closeWindow(Util_getTimeMs());
+        found = (queueIdx < numQueues);
+        if(found)
+        {
+            copyQueue(&queues[queueIdx], &snapshot);
+        }
+        pthread_mutex_unlock(&statsMutex);
+        if(!found)
+        {
+            break;
+        }
+
+        JsonWriter_beginObject(pWriter, NULL);
+        JsonWriter_string(pWriter, "q", snapshot.pName);
+        JsonWriter_uint(pWriter, "cap", snapshot.capacity);
+        JsonWriter_uint(pWriter, "depth", snapshot.depth);
+        JsonWriter_uint(pWriter, "peak", snapshot.peak);
+        JsonWriter_uint(pWriter, "tx", snapshot.sent);
+        JsonWriter_uint(pWriter, "rx", snapshot.received);
+        JsonWriter_uint(pWriter, "fail", snapshot.sendFailed);
+        JsonWriter_uint(pWriter, "wPeak", snapshot.windowPeak);
+        JsonWriter_uint(pWriter, "rate", snapshot.rate);
+        JsonWriter_uint(pWriter, "p50", snapshot.waitP50);
+        JsonWriter_uint(pWriter, "p90", snapshot.waitP90);
+        JsonWriter_uint(pWriter, "p99", snapshot.waitP99);
+        JsonWriter_uint(pWriter, "max", snapshot.waitMax);
+        JsonWriter_endObject(pWriter);
+    }
+    JsonWriter_endArray(pWriter);
+}
+
+/******************************************************************************
+ Local Functions
+ *****************************************************************************/
+
+/*!
+ * @brief       Find the counters of a queue descriptor
+ *
+ * @param       mq - queue descriptor
+ *
+ * @return      counters, NULL if it was not opened through MqStats_open()
+ */
+static MqStats_queue_t *findDesc(mqd_t mq)
+{
+    for(uint8_t descIdx = 0; descIdx < numDescs; descIdx++)
+    {
+        if(descs[descIdx].mq == mq)
+        {
+            return descs[descIdx].pQueue;
+        }
+    }
+    return NULL;
+}
+
+/*!
+ * @brief       Get the number of messages in a POSIX queue
+ *
+ * @param       mq - queue descriptor
+ *
+ * @return      messages queued
+ */
+static uint16_t queueDepth(mqd_t mq)
+{
+    mq_attr attr;
+
+    if(mq_getattr(mq, &attr) != 0)
+    {
+        return 0;
+    }
+    return (uint16_t)attr.mq_curmsgs;
+}
+
+/*!
+ * @brief       Count a message that was queued
+ *
+ * @param       pQueue - counters
+ * @param       depth - messages queued, including this one
+ */
+static void countSent(MqStats_queue_t *pQueue, uint16_t depth)
+{
+    uintptr_t key = HwiP_disable();
+
+    pQueue->sent++;
+    pQueue->depth = depth;
+    if(depth > pQueue->peak)
+    {
+        pQueue->peak = depth;
+    }
+    if(depth > pQueue->windowPeak)
+    {
+        pQueue->windowPeak = depth;
+    }
+    HwiP_restore(key);
+}
+
+/*!
+ * @brief       Copy the counters of a queue, with the mutex held
+ *
+ * @param       pQueue - counters
+ * @param       pSnapshot - copy
+ */
+static void copyQueue(MqStats_queue_t *pQueue, MqStats_snapshot_t *pSnapshot)
+{
+    pSnapshot->pName = pQueue->name;
+    pSnapshot->capacity = pQueue->capacity;
+    pSnapshot->depth = pQueue->depth;
+    pSnapshot->peak = pQueue->peak;
+    pSnapshot->sent = pQueue->sent;
+    pSnapshot->received = pQueue->received;
+    pSnapshot->sendFailed = pQueue->sendFailed;
+    pSnapshot->windowPeak = pQueue->lastPeak;
+    pSnapshot->rate = pQueue->lastRate;
+    pSnapshot->waitP50 = pQueue->lastP50;
+    pSnapshot->waitP90 = pQueue->lastP90;
+    pSnapshot->waitP99 = pQueue->lastP99;
+    pSnapshot->waitMax = pQueue->lastMax;
+}
+
+/*!
+ * @brief       Keep the results of the window and start the next one, if
+ *              it is over. The mutex is held.
+ *
+ * @param       now - time in milliseconds
+ */
+static void closeWindow(uint32_t now)
+{
+    uint32_t elapsed = now - windowStart;
+    MqStats_queue_t *pQueue;
+    uintptr_t key;
+    uint32_t total;
+
+    if(elapsed < MQSTATS_WINDOW_MS)
+    {
+        return;
+    }
+
+    for(uint8_t queueIdx = 0; queueIdx < numQueues; queueIdx++)
+    {
+        pQueue = &queues[queueIdx];
+        total = pQueue->received - pQueue->windowReceived;
+        /* Tenths of messages per second */
+        pQueue->lastRate = (uint16_t)((total * 10000) / elapsed);
+        pQueue->lastP50 = percentile(pQueue, total, 50);
+        pQueue->lastP90 = percentile(pQueue, total, 90);
+        pQueue->lastP99 = percentile(pQueue, total, 99);
+        pQueue->lastMax = pQueue->windowMax;
+        key = HwiP_disable();
+        pQueue->lastPeak = pQueue->windowPeak;
+        pQueue->windowPeak = pQueue->depth;
+        HwiP_restore(key);
+
+        memset(pQueue->bins, 0, sizeof(pQueue->bins));
+        pQueue->windowMax = 0;
+        pQueue->windowReceived = pQueue->received;
+    }
+    windowStart = now;
+    windowCount++;
+}
+
+/*!
+ * @brief       Get a percentile of the wait times of the window
+ *
+ * @param       pQueue - counters
+ * @param       total - messages read in the window
+ * @param       pct - percentile
+ *
+ * @return      upper limit of the bin the percentile is in, no more than the
+ *              longest wait, in milliseconds
+ */
+static uint16_t percentile(MqStats_queue_t *pQueue, uint32_t total,
+                           uint8_t pct)
+{
+    uint32_t rank = ((total * pct) + 99) / 100;
+    uint32_t count = 0;
+    uint32_t limit;
+    uint8_t bin;
+
+    if(total == 0)
+    {
+        return 0;
+    }
+    for(bin = 0; bin < (MQSTATS_NUM_BINS - 1); bin++)
+    {
+        count += pQueue->bins[bin];
+        if(count >= rank)
+        {
+            break;
+        }
+    }
+
+    limit = (bin == 0) ? 0 : ((1UL << bin) - 1);
+    if((bin == (MQSTATS_NUM_BINS - 1)) || (limit > pQueue->windowMax))
+    {
+        limit = pQueue->windowMax;
+    }
+    return (uint16_t)((limit > UINT16_MAX) ? UINT16_MAX : limit);
+}
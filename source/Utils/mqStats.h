@@ -0,0 +1,264 @@
+/******************************************************************************
+
+ @file mqStats.h
+
+ @brief Depth, wait time and throughput of the inter-task message queues
+
+ Group: WCS LPC
+ Target Device: CC13xx CC32xx
+
+ ******************************************************************************
+
+ Copyright (c) 2016-2017, Texas Instruments Incorporated
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions
+ are met:
+
+ *  Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+
+ *  Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+
+ *  Neither the name of Texas Instruments Incorporated nor the names of
+    its contributors may be used to endorse or promote products derived
+    from this software without specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+ ******************************************************************************
+ Release Name:
+ Release Date:
+ *****************************************************************************/
+
+#ifndef UTILS_MQSTATS_H_
+#define UTILS_MQSTATS_H_
+
+//*****************************************************************************
+//
+// If building with a C++ compiler, make all of the definitions in this header
+// have a C binding.
+//
+//*****************************************************************************
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <time.h>
+#include <mqueue.h>
+#include <Common/commonDefs.h>
+#include <Utils/jsonWriter.h>
+
+/*!
+ Counters of each named message queue, to tell which task falls behind.
+ The POSIX queues are opened, sent to and read through the wrappers below,
+ the lanes (msgLane.h) report to the same counters. Every message is
+ stamped when it is queued, its time in the queue is taken when it is read.
+
+ The send side takes no mutex, so it may be used from clock and driver
+ callbacks. Its counters are updated with the interrupts disabled for a few
+ instructions.
+ */
+
+/******************************************************************************
+ Constants and definitions
+ *****************************************************************************/
+
+/*! Number of queues with counters */
+#define MQSTATS_MAX_QUEUES      12
+
+/*! Longest queue name kept, longer ones are cut */
+#define MQSTATS_NAME_LEN        16
+
+/*! Number of queue descriptors that can be opened through MqStats_open() */
+#define MQSTATS_MAX_DESCS       16
+
+/*! Length of the window the rates and wait times are given for */
+#ifndef MQSTATS_WINDOW_MS
+#define MQSTATS_WINDOW_MS       10000
+#endif
+
+/*! Wait time bins, bin 0 counts waits below 1ms, bin n waits below
+    (1 << n) milliseconds, the last bin counts everything above */
+#define MQSTATS_NUM_BINS        12
+
+/*! Counters of a queue, opaque */
+typedef struct MqStats_queue_s MqStats_queue_t;
+
+/*! Counters of a queue at the time of a snapshot */
+typedef struct
+{
+    const char *pName;
+    /*! Messages the queue holds, 0 if not known */
+    uint16_t capacity;
+    /*! Messages queued now and at most */
+    uint16_t depth;
+    uint16_t peak;
+    /*! Since start up */
+    uint32_t sent;
+    uint32_t received;
+    /*! Sends that found the queue full */
+    uint32_t sendFailed;
+    /*! Over the last window: highest depth, messages read per second in
+        tenths, and time in the queue in milliseconds. The percentiles are
+        the upper limit of their bin. */
+    uint16_t windowPeak;
+    uint16_t rate;
+    uint16_t waitP50;
+    uint16_t waitP90;
+    uint16_t waitP99;
+    uint32_t waitMax;
+} MqStats_snapshot_t;
+
+/******************************************************************************
+ Function Prototypes
+ *****************************************************************************/
+
+/*!
+ * @brief       Clear the counters and start the first window. Called once,
+ *              before any queue is opened.
+ */
+extern void MqStats_init(void);
+
+/*!
+ * @brief       Get the counters of a queue, added if needed. Used by queues
+ *              that are not POSIX queues.
+ *
+ * @param       pName - name of the queue, copied
+ * @param       capacity - messages the queue holds, 0 if not known
+ *
+ * @return      counters, NULL if there is no room for them
+ */
+extern MqStats_queue_t *MqStats_add(const char *pName, uint16_t capacity);
+
+/*!
+ * @brief       Stamp a message that was queued and count it
+ *
+ * @param       pQueue - counters, may be NULL
+ * @param       pMsg - message as held by the queue
+ * @param       depth - messages queued, including this one
+ */
+extern void MqStats_enqueued(MqStats_queue_t *pQueue, msgQueue_t *pMsg,
+                             uint16_t depth);
+
+/*!
+ * @brief       Count a message that could not be queued
+ *
+ * @param       pQueue - counters, may be NULL
+ */
+extern void MqStats_sendFailed(MqStats_queue_t *pQueue);
+
+/*!
+ * @brief       Count a message that was read and add its time in the queue.
+ *              Must be called from a task.
+ *
+ * @param       pQueue - counters, may be NULL
+ * @param       pMsg - message read
+ * @param       depth - messages left in the queue
+ */
+extern void MqStats_dequeued(MqStats_queue_t *pQueue, const msgQueue_t *pMsg,
+                             uint16_t depth);
+
+/*!
+ * @brief       Open a POSIX queue of msgQueue_t messages, in place of
+ *              mq_open(). Its sends and reads are counted if they go
+ *              through MqStats_send() and MqStats_receive().
+ *
+ * @param       pName - name of the queue
+ * @param       oflag - as for mq_open()
+ * @param       pAttr - as for mq_open() with O_CREAT, NULL otherwise
+ *
+ * @return      queue descriptor, as mq_open()
+ */
+extern mqd_t MqStats_open(const char *pName, int oflag, mq_attr *pAttr);
+
+/*!
+ * @brief       Send a message, in place of mq_send()
+ *
+ * @param       mq - queue descriptor
+ * @param       pMsg - message, stamped before it is copied
+ * @param       prio - priority of the message
+ *
+ * @return      as mq_send()
+ */
+extern int MqStats_send(mqd_t mq, msgQueue_t *pMsg, unsigned int prio);
+
+/*!
+ * @brief       Read a message, in place of mq_receive()
+ *
+ * @param       mq - queue descriptor
+ * @param       pMsg - message read
+ *
+ * @return      as mq_receive()
+ */
+extern ssize_t MqStats_receive(mqd_t mq, msgQueue_t *pMsg);
+
+/*!
+ * @brief       Read a message with a timeout, in place of mq_timedreceive()
+ *
+ * @param       mq - queue descriptor
+ * @param       pMsg - message read
+ * @param       pAbsTimeout - CLOCK_REALTIME time to give up at
+ *
+ * @return      as mq_timedreceive()
+ */
+extern ssize_t MqStats_timedReceive(mqd_t mq, msgQueue_t *pMsg,
+                                    const struct timespec *pAbsTimeout);
+
+/*!
+ * @brief       Close the window if it is over
+ *
+ * @return      number of windows closed since start up
+ */
+extern uint32_t MqStats_tick(void);
+
+/*!
+ * @brief       Get the counters of all queues. The window is closed first
+ *              if it is over.
+ *
+ * @param       pSnapshot - counters of each queue
+ * @param       maxQueues - room in pSnapshot
+ *
+ * @return      number of queues written
+ */
+extern uint8_t MqStats_snapshot(MqStats_snapshot_t *pSnapshot,
+                                uint8_t maxQueues);
+
+/*!
+ * @brief       Write the counters of all queues as an array of objects,
+ *              short member names keep it in one HTTP response:
+ *              {"q":name,"cap","depth","peak","tx","rx","fail","wPeak",
+ *              "rate","p50","p90","p99","max"} as in MqStats_snapshot_t
+ *
+ * @param       pWriter - writer
+ * @param       pKey - member name, NULL for an array element or the
+ *                     document itself
+ */
+extern void MqStats_writeJson(JsonWriter_t *pWriter, const char *pKey);
+
+//*****************************************************************************
+//
+// Mark the end of the C bindings section for C++ compilers.
+//
+//*****************************************************************************
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* UTILS_MQSTATS_H_ */
@@ -0,0 +1,481 @@
+/******************************************************************************
+
+ @file msgLane.c
+
+ @brief Bounded inter-task message queues with priority classes
+
+ Group: WCS LPC
+ Target Device: CC13xx CC32xx
+
+ ******************************************************************************
+
+ Copyright (c) 2016-2017, Texas Instruments Incorporated
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions
+ are met:
+
+ *  Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+
+ *  Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+
+ *  Neither the name of Texas Instruments Incorporated nor the names of
+    its contributors may be used to endorse or promote products derived
+    from this software without specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+ ******************************************************************************
+ Release Name:
+ Release Date:
+ *****************************************************************************/
+
+/******************************************************************************
+ Includes
+ *****************************************************************************/
+#include <string.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <pthread.h>
+#include "mqStats.h"
+#include "msgLane.h"
+
+/******************************************************************************
+ Constants and definitions
+ *****************************************************************************/
+
+struct MsgLane_s
+{
+    const char *pName;
+    MsgLane_config_t config;
+    /* FIFO of each class, a ring of size messages, the bound and the
+       spare places of a class that blocks */
+    msgQueue_t *pRing[MsgLane_class_NUM];
+    uint8_t size[MsgLane_class_NUM];
+    uint8_t head[MsgLane_class_NUM];
+    uint16_t total;
+    MsgLane_stats_t stats[MsgLane_class_NUM];
+    /* Counters shared with the POSIX queues, see mqStats.h */
+    MqStats_queue_t *pQueueStats;
+    pthread_mutex_t mutex;
+    /* Signaled when a message is queued, and when one is taken */
+    pthread_cond_t notEmpty;
+    pthread_cond_t notFull;
+    /* Receiving task, known once it took a message */
+    pthread_t receiver;
+    bool hasReceiver;
+    /* Lane the receiving task waits for room on, guarded by waitMutex */
+    struct MsgLane_s *pWaitingOn;
+};
+
+/******************************************************************************
+ Local variables
+ *****************************************************************************/
+
+static MsgLane_t lanes[MSGLANE_MAX_LANES];
+static uint8_t numLanes = 0;
+
+/* Guards the pWaitingOn links of all lanes */
+static pthread_mutex_t waitMutex;
+
+/******************************************************************************
+ Local function prototypes
+ *****************************************************************************/
+static msgQueue_t *slot(MsgLane_t *pLane, MsgLane_class_t msgClass,
+                        uint8_t pos);
+static bool coalesce(MsgLane_t *pLane, MsgLane_class_t msgClass,
+                     const msgQueue_t *pMsg, void **ppOldPayload);
+static bool startWait(MsgLane_t *pLane, MsgLane_t **ppOwn);
+static void endWait(MsgLane_t *pOwn);
+
+/******************************************************************************
+ Public Functions
+ *****************************************************************************/
+
+/*!
+ Create a lane
+
+ Public function defined in msgLane.h
+ */
+MsgLane_t *MsgLane_create(const char *pName, const MsgLane_config_t *pConfig)
+{
+    MsgLane_t *pLane;
+    uint8_t classSize[MsgLane_class_NUM];
+    uint16_t size = 0;
+    msgQueue_t *pMsgs;
+
+    if(numLanes == MSGLANE_MAX_LANES)
+    {
+        return NULL;
+    }
+    for(int msgClass = 0; msgClass < MsgLane_class_NUM; msgClass++)
+    {
+        classSize[msgClass] = pConfig->bound[msgClass];
+        if(pConfig->policy[msgClass] == MsgLane_policy_block)
+        {
+            classSize[msgClass] += MSGLANE_SPARE;
+        }
+        size += classSize[msgClass];
+    }
+    if(numLanes == 0)
+    {
+        pthread_mutex_init(&waitMutex, NULL);
+    }
+    pMsgs = (msgQueue_t*) malloc(size * sizeof(msgQueue_t));
+    if(pMsgs == NULL)
+    {
+        return NULL;
+    }
+
+    pLane = &lanes[numLanes];
+    memset(pLane, 0, sizeof(MsgLane_t));
+    pLane->pName = pName;
+    memcpy(&pLane->config, pConfig, sizeof(MsgLane_config_t));
+    for(int msgClass = 0; msgClass < MsgLane_class_NUM; msgClass++)
+    {
+        pLane->pRing[msgClass] = pMsgs;
+        pLane->size[msgClass] = classSize[msgClass];
+        pMsgs += classSize[msgClass];
+    }
+    pLane->pQueueStats = MqStats_add(pName, size);
+    pthread_mutex_init(&pLane->mutex, NULL);
+    pthread_cond_init(&pLane->notEmpty, NULL);
+    pthread_cond_init(&pLane->notFull, NULL);
+    /* Senders may look it up from here on */
+    numLanes++;
+
+    return pLane;
+}
+
+/*!
+ Open a lane created before
+
+ Public function defined in msgLane.h
+ */
+MsgLane_t *MsgLane_open(const char *pName)
+{
+    for(uint8_t laneIdx = 0; laneIdx < numLanes; laneIdx++)
+    {
+        if(strcmp(lanes[laneIdx].pName, pName) == 0)
+        {
+            return &lanes[laneIdx];
+        }
+    }
+    return NULL;
+}
+
+/*!
+ Send a message
+
+ Public function defined in msgLane.h
+ */
+MsgLane_status_t MsgLane_send(MsgLane_t *pLane, const msgQueue_t *pMsg)
+{
+    MsgLane_class_t msgClass = pLane->config.pfnClass(pMsg);
+    MsgLane_stats_t *pStats = &pLane->stats[msgClass];
+    uint8_t bound = pLane->config.bound[msgClass];
+    MsgLane_status_t status = MsgLane_status_sent;
+    MsgLane_t *pOwn;
+    msgQueue_t *pSlot;
+    void *pFree = NULL;
+
+    pthread_mutex_lock(&pLane->mutex);
+    if(pStats->pending >= bound)
+    {
+        switch(pLane->config.policy[msgClass])
+        {
+        case MsgLane_policy_block:
+            if(startWait(pLane, &pOwn))
+            {
+                pStats->blocked++;
+                while(pStats->pending >= bound)
+                {
+                    pthread_cond_wait(&pLane->notFull, &pLane->mutex);
+                }
+                endWait(pOwn);
+                break;
+            }
+            if(pStats->pending < pLane->size[msgClass])
+            {
+                pStats->spared++;
+                break;
+            }
+            /* The spare places are taken too */
+            pStats->dropped++;
+            pFree = pMsg->msgPtr;
+            status = MsgLane_status_dropped;
+            break;
+        case MsgLane_policy_coalesce:
+            if(coalesce(pLane, msgClass, pMsg, &pFree))
+            {
+                pStats->coalesced++;
+                status = MsgLane_status_coalesced;
+                break;
+            }
+            /* Nothing to replace */
+        case MsgLane_policy_drop:
+        default:
+            pStats->dropped++;
+            pFree = pMsg->msgPtr;
+            status = MsgLane_status_dropped;
+            break;
+        }
+    }
+    if(status == MsgLane_status_sent)
+    {
+        pSlot = slot(pLane, msgClass, pStats->pending);
+        memcpy(pSlot, pMsg, sizeof(msgQueue_t));
+        pStats->pending++;
+        pStats->sent++;
+        if(pStats->pending > pStats->peak)
+        {
+            pStats->peak = pStats->pending;
+        }
+        pLane->total++;
+        MqStats_enqueued(pLane->pQueueStats, pSlot, pLane->total);
+        pthread_cond_signal(&pLane->notEmpty);
+    }
+    else if(status == MsgLane_status_dropped)
+    {
+        MqStats_sendFailed(pLane->pQueueStats);
+    }
+    pthread_mutex_unlock(&pLane->mutex);
+
+    if(pFree != NULL)
+    {
+        free(pFree);
+    }
+    return status;
+}
+
+/*!
+ Take the next message
+
+ Public function defined in msgLane.h
+ */
+bool MsgLane_receive(MsgLane_t *pLane, msgQueue_t *pMsg,
+                     const struct timespec *pAbsTimeout)
+{
+    int msgClass;
+    uint16_t depth;
+
+    pthread_mutex_lock(&pLane->mutex);
+    if(!pLane->hasReceiver)
+    {
+        pLane->receiver = pthread_self();
+        pLane->hasReceiver = true;
+    }
+    while(pLane->total == 0)
+    {
+        if(pAbsTimeout == NULL)
+        {
+            pthread_cond_wait(&pLane->notEmpty, &pLane->mutex);
+        }
+        else if((pthread_cond_timedwait(&pLane->notEmpty, &pLane->mutex,
+                                        pAbsTimeout) == ETIMEDOUT) &&
+                (pLane->total == 0))
+        {
+            pthread_mutex_unlock(&pLane->mutex);
+            return false;
+        }
+    }
+
+    for(msgClass = MsgLane_class_NUM - 1; pLane->stats[msgClass].pending == 0;
+        msgClass--);
+    memcpy(pMsg, slot(pLane, (MsgLane_class_t)msgClass, 0), sizeof(msgQueue_t));
+    pLane->head[msgClass] = (pLane->head[msgClass] + 1) %
+                            pLane->size[msgClass];
+    pLane->stats[msgClass].pending--;
+    pLane->total--;
+    depth = pLane->total;
+    /* Senders of any class may be waiting */
+    pthread_cond_broadcast(&pLane->notFull);
+    pthread_mutex_unlock(&pLane->mutex);
+
+    MqStats_dequeued(pLane->pQueueStats, pMsg, depth);
+
+    return true;
+}
+
+/*!
+ Check if a class is near its bound
+
+ Public function defined in msgLane.h
+ */
+bool MsgLane_congested(MsgLane_t *pLane, MsgLane_class_t msgClass)
+{
+    /* Read without the mutex, a stale answer only delays the producer */
+    return ((pLane->stats[msgClass].pending * 100) >=
+            (pLane->config.bound[msgClass] * pLane->config.congestedPct));
+}
+
+/*!
+ Get the counters of a class
+
+ Public function defined in msgLane.h
+ */
+void MsgLane_getStats(MsgLane_t *pLane, MsgLane_class_t msgClass,
+                      MsgLane_stats_t *pStats)
+{
+    pthread_mutex_lock(&pLane->mutex);
+    memcpy(pStats, &pLane->stats[msgClass], sizeof(MsgLane_stats_t));
+    pthread_mutex_unlock(&pLane->mutex);
+}
+
+/*!
+ Get the name of a lane
+
+ Public function defined in msgLane.h
+ */
+const char *MsgLane_name(MsgLane_t *pLane)
+{
+    return pLane->pName;
+}
+
+/******************************************************************************
+ Local Functions
+ *****************************************************************************/
+
+/*!
+ * @brief       Get a message of the FIFO of a class
+ *
+ * @param       pLane - lane
+ * @param       msgClass - class
+ * @param       pos - position from the oldest message
+ *
+ * @return      message
+ */
+static msgQueue_t *slot(MsgLane_t *pLane, MsgLane_class_t msgClass,
+                        uint8_t pos)
+{
+    return &pLane->pRing[msgClass][(pLane->head[msgClass] + pos) %
+                                   pLane->size[msgClass]];
+}
+
+/*!
+ * @brief       Check if the calling task may wait for room on a lane. It
+ *              may not if the lane's receiver waits, directly or through
+ *              other lanes, on the lane the calling task receives from.
+ *              If it may, it is marked as waiting.
+ *
+ * @param       pLane - lane to wait on, locked
+ * @param       ppOwn - lane the calling task receives from, NULL if none
+ *
+ * @return      true if the task may wait, endWait() must follow
+ */
+static bool startWait(MsgLane_t *pLane, MsgLane_t **ppOwn)
+{
+    MsgLane_t *pNext = pLane;
+    bool mayWait = true;
+    uint8_t laneIdx;
+
+    *ppOwn = NULL;
+    for(laneIdx = 0; laneIdx < numLanes; laneIdx++)
+    {
+        if(lanes[laneIdx].hasReceiver &&
+           pthread_equal(lanes[laneIdx].receiver, pthread_self()))
+        {
+            *ppOwn = &lanes[laneIdx];
+        }
+    }
+    if(*ppOwn == NULL)
+    {
+        /* Nobody waits on a task without a lane */
+        return true;
+    }
+
+    pthread_mutex_lock(&waitMutex);
+    for(laneIdx = 0; (pNext != NULL) && (laneIdx <= numLanes); laneIdx++)
+    {
+        if(pNext == *ppOwn)
+        {
+            mayWait = false;
+            break;
+        }
+        pNext = pNext->pWaitingOn;
+    }
+    if(mayWait)
+    {
+        (*ppOwn)->pWaitingOn = pLane;
+    }
+    pthread_mutex_unlock(&waitMutex);
+
+    return mayWait;
+}
+
+/*!
+ * @brief       Mark the calling task as no longer waiting
+ *
+ * @param       pOwn - lane given by startWait()
+ */
+static void endWait(MsgLane_t *pOwn)
+{
+    if(pOwn != NULL)
+    {
+        pthread_mutex_lock(&waitMutex);
+        pOwn->pWaitingOn = NULL;
+        pthread_mutex_unlock(&waitMutex);
+    }
+}
+
+/*!
+ * @brief       Replace the queued message that has the key of a new one.
+ *              The replaced message keeps its place in the FIFO.
+ *
+ * @param       pLane - lane, locked
+ * @param       msgClass - class of the message
+ * @param       pMsg - new message
+ * @param       ppOldPayload - payload of the replaced message, to be freed
+ *
+ * @return      true if a message was replaced
+ */
+static bool coalesce(MsgLane_t *pLane, MsgLane_class_t msgClass,
+                     const msgQueue_t *pMsg, void **ppOldPayload)
+{
+    uint32_t key;
+    uint32_t enqueueTime;
+    msgQueue_t *pQueued;
+
+    if(pLane->config.pfnKey == NULL)
+    {
+        return false;
+    }
+    key = pLane->config.pfnKey(pMsg);
+    if(key == MSGLANE_NO_KEY)
+    {
+        return false;
+    }
+    for(uint8_t pos = 0; pos < pLane->stats[msgClass].pending; pos++)
+    {
+        pQueued = slot(pLane, msgClass, pos);
+        if((pQueued->event == pMsg->event) &&
+           (pLane->config.pfnKey(pQueued) == key))
+        {
+            if(pLane->config.pfnSuperseded != NULL)
+            {
+                pLane->config.pfnSuperseded(pQueued);
+            }
+            /* The slot keeps the time it was queued at */
+            enqueueTime = pQueued->enqueueTime;
+            *ppOldPayload = pQueued->msgPtr;
+            memcpy(pQueued, pMsg, sizeof(msgQueue_t));
+            pQueued->enqueueTime = enqueueTime;
+            return true;
+        }
+    }
+    return false;
+}
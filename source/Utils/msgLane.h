@@ -0,0 +1,253 @@
+/******************************************************************************
+
+ @file msgLane.h
+
+ @brief Bounded inter-task message queues with priority classes
+
+ Group: WCS LPC
+ Target Device: CC13xx CC32xx
+
+ ******************************************************************************
+
+ Copyright (c) 2016-2017, Texas Instruments Incorporated
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions
+ are met:
+
+ *  Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+
+ *  Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+
+ *  Neither the name of Texas Instruments Incorporated nor the names of
+    its contributors may be used to endorse or promote products derived
+    from this software without specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+ ******************************************************************************
+ Release Name:
+ Release Date:
+ *****************************************************************************/
+
+#ifndef UTILS_MSGLANE_H_
+#define UTILS_MSGLANE_H_
+
+//*****************************************************************************
+//
+// If building with a C++ compiler, make all of the definitions in this header
+// have a C binding.
+//
+//*****************************************************************************
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <time.h>
+#include <Common/commonDefs.h>
+
+/*!
+ A lane carries the msgQueue_t messages of a task in place of a POSIX
+ message queue. Every message belongs to a class, given by the event. Each
+ class has a FIFO of its own, bounded so that a burst of one class cannot
+ take the room of the others, and the receiver always takes the oldest
+ message of the highest class first.
+
+ Senders and receiver must be tasks, lanes are guarded by a mutex.
+ */
+
+/*! Number of lanes that can be created */
+#define MSGLANE_MAX_LANES       4
+
+/*! Places a class that blocks has above its bound, for the sends that
+    cannot wait */
+#ifndef MSGLANE_SPARE
+#define MSGLANE_SPARE           4
+#endif
+
+/*! Key of a message that cannot be coalesced */
+#define MSGLANE_NO_KEY          0xFFFFFFFF
+
+/*! Classes, the receiver takes the highest one first */
+typedef enum
+{
+    /*! Sensor data, may be coalesced or dropped */
+    MsgLane_class_telemetry,
+    /*! Changes of the network, of devices and of commands */
+    MsgLane_class_state,
+    /*! Commands to devices */
+    MsgLane_class_actuator,
+    /*! Connection, provisioning and other events of the tasks */
+    MsgLane_class_control,
+    MsgLane_class_NUM
+} MsgLane_class_t;
+
+/*! What a send does when the FIFO of its class is full */
+typedef enum
+{
+    /*! Wait for room, for producers that can stall. A send that would
+        close a circle of tasks waiting on each other, e.g. the receiving
+        task sending to its own lane, takes a spare place instead and is
+        only dropped once MSGLANE_SPARE places are taken. */
+    MsgLane_policy_block,
+    /*! Drop the new message */
+    MsgLane_policy_drop,
+    /*! Replace the queued message with the same key, drop the new message
+        if there is none */
+    MsgLane_policy_coalesce
+} MsgLane_policy_t;
+
+/*! Outcome of a send */
+typedef enum
+{
+    MsgLane_status_sent,
+    /*! A queued message was replaced, its payload was freed */
+    MsgLane_status_coalesced,
+    /*! The message was dropped and its payload freed */
+    MsgLane_status_dropped
+} MsgLane_status_t;
+
+/*! Class of a message */
+typedef MsgLane_class_t (*MsgLane_classFn_t)(const msgQueue_t *pMsg);
+
+/*! Key of a message to coalesce, e.g. the device, MSGLANE_NO_KEY if none */
+typedef uint32_t (*MsgLane_keyFn_t)(const msgQueue_t *pMsg);
+
+/*! Called for a queued message that is replaced by coalescing, before its
+    payload is freed. Runs in the sending task with the lane locked. */
+typedef void (*MsgLane_supersededFn_t)(const msgQueue_t *pMsg);
+
+/*! Setup of a lane */
+typedef struct
+{
+    /*! Messages each class holds at most, at least 1 */
+    uint8_t bound[MsgLane_class_NUM];
+    /*! Policy of each class once full */
+    MsgLane_policy_t policy[MsgLane_class_NUM];
+    /*! Congestion is reported from this percentage of the bound on */
+    uint8_t congestedPct;
+    MsgLane_classFn_t pfnClass;
+    /*! May be NULL if no class coalesces */
+    MsgLane_keyFn_t pfnKey;
+    /*! May be NULL */
+    MsgLane_supersededFn_t pfnSuperseded;
+} MsgLane_config_t;
+
+/*! Counters of a class */
+typedef struct
+{
+    /*! Messages queued now and at most */
+    uint8_t pending;
+    uint8_t peak;
+    uint32_t sent;
+    uint32_t coalesced;
+    uint32_t dropped;
+    /*! Sends that had to wait for room */
+    uint32_t blocked;
+    /*! Sends that took a spare place rather than wait */
+    uint32_t spared;
+} MsgLane_stats_t;
+
+typedef struct MsgLane_s MsgLane_t;
+
+/*!
+ * @brief       Create a lane, by its receiver
+ *
+ * @param       pName - name the senders open the lane with
+ * @param       pConfig - setup, copied
+ *
+ * @return      lane, NULL if there is no room or memory for it
+ */
+extern MsgLane_t *MsgLane_create(const char *pName, const MsgLane_config_t *pConfig);
+
+/*!
+ * @brief       Open a lane created before, by a sender
+ *
+ * @param       pName - name of the lane
+ *
+ * @return      lane, NULL if it does not exist
+ */
+extern MsgLane_t *MsgLane_open(const char *pName);
+
+/*!
+ * @brief       Send a message. Unless the message is sent, the payload is
+ *              freed, so the sender never frees it.
+ *
+ * @param       pLane - lane
+ * @param       pMsg - message, copied
+ *
+ * @return      outcome
+ */
+extern MsgLane_status_t MsgLane_send(MsgLane_t *pLane, const msgQueue_t *pMsg);
+
+/*!
+ * @brief       Take the next message, waiting for one
+ *
+ * @param       pLane - lane
+ * @param       pMsg - message taken
+ * @param       pAbsTimeout - CLOCK_REALTIME time to give up at, NULL to
+ *                            wait forever
+ *
+ * @return      false if the time ran out
+ */
+extern bool MsgLane_receive(MsgLane_t *pLane, msgQueue_t *pMsg,
+                            const struct timespec *pAbsTimeout);
+
+/*!
+ * @brief       Check if a class is near its bound. Producers of messages
+ *              that can wait hold them back while it is, e.g. by
+ *              aggregating samples over a longer time.
+ *
+ * @param       pLane - lane
+ * @param       msgClass - class
+ *
+ * @return      true if congested
+ */
+extern bool MsgLane_congested(MsgLane_t *pLane, MsgLane_class_t msgClass);
+
+/*!
+ * @brief       Get the counters of a class
+ *
+ * @param       pLane - lane
+ * @param       msgClass - class
+ * @param       pStats - counters
+ */
+extern void MsgLane_getStats(MsgLane_t *pLane, MsgLane_class_t msgClass,
+                             MsgLane_stats_t *pStats);
+
+/*!
+ * @brief       Get the name of a lane
+ *
+ * @param       pLane - lane
+ *
+ * @return      name given at creation
+ */
+extern const char *MsgLane_name(MsgLane_t *pLane);
+
+//*****************************************************************************
+//
+// Mark the end of the C bindings section for C++ compilers.
+//
+//*****************************************************************************
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* UTILS_MSGLANE_H_ */
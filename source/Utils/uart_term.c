@@ -51,7 +51,6 @@
 
 #include "uart_term.h"
 // TODO: split this file into console and dbgprint
-extern int vsnprintf (char * s, size_t n, const char * format, va_list arg );
 
 //*****************************************************************************
 //                          LOCAL DEFINES
@@ -106,49 +105,20 @@ UART_Handle InitTerm(void)
 //! \param[in]  [variable number of] arguments according to the format in the
 //!             first parameters
 //!
-//! \return count of characters printed
+//! \return size of the record, -1 if it was dropped
+//!
+//! \note The string is formatted later by the log task, see logRing.h.
 //
 //*****************************************************************************
 int Report(const char *pcFormat, ...)
 {
     int     iRet = 0;
-    char        *pcBuff;
-    char        *pcTemp;
-    int         iSize = 256;
     va_list     list;
 
 
-    pcBuff = (char*)malloc(iSize);
-    if(pcBuff == NULL)
-    {
-        return -1;
-    }
-    while(1)
-    {
-        va_start(list,pcFormat);
-        iRet = vsnprintf(pcBuff, iSize, pcFormat, list);
-        va_end(list);
-        if((iRet > -1) && (iRet < iSize))
-        {
-            break;
-        }
-        else
-        {
-            iSize *= 2;
-            if((pcTemp = realloc(pcBuff, iSize)) == NULL)
-            {
-                Message("Could not reallocate memory\n\r");
-                iRet = -1;
-                break;
-            }
-            else
-            {
-                pcBuff = pcTemp;
-            }
-        }
-    }
-    Message(pcBuff);
-    free(pcBuff);
+    va_start(list,pcFormat);
+    iRet = LogRing_vprint(LOG_MODULE, LogLevel_INFO, pcFormat, list);
+    va_end(list);
 
     return iRet;
 }
@@ -300,6 +270,27 @@ void Message(const char *str)
 #endif
 }
 
+//*****************************************************************************
+//
+//! Outputs a buffer to the console
+//!
+//! \param[in]  str - is the pointer to the buffer, which may hold zeros
+//! \param[in]  uiLen - is the number of bytes to write
+//!
+//! \return none
+//!
+//! \note Same as Message
+//
+//*****************************************************************************
+void MessageLen(const char *str, unsigned int uiLen)
+{
+#ifdef UART_NONPOLLING
+    UART_write(uartHandle, str, uiLen);
+#else
+    UART_writePolling(uartHandle, str, uiLen);
+#endif
+}
+
 //*****************************************************************************
 //
 //! Clear the console window
@@ -49,12 +49,21 @@
 // TI-Driver includes
 #include <ti/drivers/UART.h>
 #include "Board.h"
+#include "logRing.h"
 
 //Defines
 
-#define UART_PRINT Report
-#define DBG_PRINT  Report
-#define ERR_PRINT(x) Report("Error [%d] at line [%d] in function [%s]  \n\r",x,__LINE__,__FUNCTION__)
+// Module the lines of a file are logged under, define it before including
+// this file to give the file its own level
+#ifndef LOG_MODULE
+#define LOG_MODULE LogModule_GENERAL
+#endif
+
+// Lines are recorded and printed later by the log task, so the format must
+// be a string literal
+#define UART_PRINT(...) LogRing_print(LOG_MODULE, LogLevel_INFO, __VA_ARGS__)
+#define DBG_PRINT(...)  LogRing_print(LOG_MODULE, LogLevel_DEBUG, __VA_ARGS__)
+#define ERR_PRINT(x) LogRing_print(LOG_MODULE, LogLevel_ERROR, "Error [%d] at line [%d] in function [%s]  \n\r",x,__LINE__,__FUNCTION__)
 
 /* API */
 
@@ -68,6 +77,8 @@ int GetCmd(char *pcBuffer, unsigned int uiBufLen);
 
 void Message(const char *str);
 
+void MessageLen(const char *str, unsigned int uiLen);
+
 void ClearTerm();
 
 char getch(void);
@@ -51,6 +51,7 @@
 #include <string.h>
 #include <stdint.h>
 #include <stdbool.h>
+#include <time.h>
 
 #include "util.h"
 
@@ -351,3 +352,16 @@ void Util_copyExtAddr(void *pSrcAddr, void *pDstAddr)
 {
     memcpy(pSrcAddr, pDstAddr, (UTIL_SADDR_EXT_LEN));
 }
+
+/*!
+ Utility function to get a monotonic time stamp
+
+ Public function defined in util.h
+ */
+uint32_t Util_getTimeMs(void)
+{
+    struct timespec currTime;
+
+    clock_gettime(CLOCK_MONOTONIC, &currTime);
+    return ((currTime.tv_sec * 1000) + (currTime.tv_nsec / 1000000));
+}
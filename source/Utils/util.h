@@ -241,6 +241,14 @@ extern void Util_setEvent(uint16_t *pEvent, uint16_t event);
  */
 extern void Util_copyExtAddr(void *pSrcAddr, void *pDstAddr);
 
+/*!
+ * @brief       Utility function to get a monotonic time stamp, not
+ *              affected by NTP updates of the wall clock
+ *
+ * @return      time in milliseconds, wraps around after ~49 days
+ */
+extern uint32_t Util_getTimeMs(void);
+
 /*! @} end group UtilMisc */
 
 #ifdef __cplusplus